@@ -0,0 +1,30 @@
+﻿#include "AccumulationBuffer.h"
+#include <algorithm>
+
+AccumulationBuffer::AccumulationBuffer(unsigned width, unsigned height)
+	: m_width(width)
+	, m_height(height)
+	, m_sums(size_t(width) * height)
+	, m_normalDepthSums(size_t(width) * height)
+	, m_albedoSums(size_t(width) * height)
+	, m_sampleCounts(size_t(width) * height)
+{
+}
+
+unsigned AccumulationBuffer::GetWidth() const noexcept
+{
+	return m_width;
+}
+
+unsigned AccumulationBuffer::GetHeight() const noexcept
+{
+	return m_height;
+}
+
+void AccumulationBuffer::Clear()
+{
+	std::fill(m_sums.begin(), m_sums.end(), CVector4f());
+	std::fill(m_normalDepthSums.begin(), m_normalDepthSums.end(), CVector4f());
+	std::fill(m_albedoSums.begin(), m_albedoSums.end(), CVector4f());
+	std::fill(m_sampleCounts.begin(), m_sampleCounts.end(), 0u);
+}
@@ -0,0 +1,97 @@
+﻿#pragma once
+#include <cassert>
+#include <vector>
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+
+/*
+	Признаки поверхности, видимой в пикселе (первой точки пути), по которым фильтр шума (см. Denoiser)
+	отличает границы объектов от шума. Для лучей, не столкнувшихся с объектами, нормаль и глубина нулевые
+*/
+struct PixelFeatures
+{
+	// Единичная нормаль, направленная навстречу лучу
+	CVector3d normal;
+	// Доля рассеиваемого поверхностью света (альбедо с учетом отражения и пропускания)
+	CVector4f albedo = CVector4f(1, 1, 1, 1);
+	// Расстояние от начала луча до точки
+	double depth = 0;
+};
+
+/*
+	Буфер накопления: суммы цветов выборок каждого пикселя (с плавающей точкой, без ограничения яркости),
+	их количество и суммы признаков видимой в пикселе поверхности. Используется при прогрессивной
+	трассировке путей, когда каждый проход добавляет к пикселям по одной выборке, а в буфер кадра
+	записывается среднее значение накопленных выборок.
+	Разные потоки могут одновременно добавлять выборки к разным пикселям
+*/
+class AccumulationBuffer
+{
+public:
+	AccumulationBuffer(unsigned width, unsigned height);
+
+	AccumulationBuffer(AccumulationBuffer const&) = delete;
+	AccumulationBuffer& operator=(AccumulationBuffer const&) = delete;
+
+	unsigned GetWidth() const noexcept;
+	unsigned GetHeight() const noexcept;
+
+	// Удаляет накопленные выборки (например, после изменения сцены или камеры)
+	void Clear();
+
+	// Добавляет выборку к пикселю с заданными координатами
+	void AddSample(unsigned x, unsigned y, CVector4f const& color, PixelFeatures const& features) noexcept
+	{
+		const size_t index = GetIndex(x, y);
+		m_sums[index] += color;
+		m_normalDepthSums[index] += CVector4f(
+			float(features.normal.x), float(features.normal.y), float(features.normal.z), float(features.depth));
+		m_albedoSums[index] += features.albedo;
+		++m_sampleCounts[index];
+	}
+
+	// Количество выборок, накопленных пикселем (номер следующей выборки пикселя)
+	unsigned GetSampleCount(unsigned x, unsigned y) const noexcept
+	{
+		return m_sampleCounts[GetIndex(x, y)];
+	}
+
+	// Среднее значение выборок пикселя (нулевой цвет, если выборок нет)
+	CVector4f GetAverage(unsigned x, unsigned y) const noexcept
+	{
+		const size_t index = GetIndex(x, y);
+		return (m_sampleCounts[index] != 0) ? (1.0f / static_cast<float>(m_sampleCounts[index])) * m_sums[index] : CVector4f();
+	}
+
+	// Средние значения признаков пикселя (нормаль - среднее нормалей выборок, поэтому может быть не единичной)
+	PixelFeatures GetAverageFeatures(unsigned x, unsigned y) const noexcept
+	{
+		const size_t index = GetIndex(x, y);
+		PixelFeatures features;
+		if (m_sampleCounts[index] != 0)
+		{
+			const float scale = 1.0f / static_cast<float>(m_sampleCounts[index]);
+			CVector4f const& normalDepth = m_normalDepthSums[index];
+			features.normal = CVector3d(normalDepth.x * scale, normalDepth.y * scale, normalDepth.z * scale);
+			features.depth = normalDepth.w * scale;
+			features.albedo = scale * m_albedoSums[index];
+		}
+		return features;
+	}
+
+private:
+	size_t GetIndex(unsigned x, unsigned y) const noexcept
+	{
+		assert(x < m_width);
+		assert(y < m_height);
+		return size_t(y) * m_width + x;
+	}
+
+	unsigned m_width;
+	unsigned m_height;
+	std::vector<CVector4f> m_sums;
+	// Суммы нормалей (x, y, z) и глубин (w), суммы альбедо
+	std::vector<CVector4f> m_normalDepthSums;
+	std::vector<CVector4f> m_albedoSums;
+	std::vector<unsigned> m_sampleCounts;
+};
@@ -0,0 +1,120 @@
+﻿#include "AmbientOcclusionBaker.h"
+#include <cmath>
+#include "../Matrix/Matrix4.h"
+#include "../PathTracer/PathTracer.h"
+#include "../PointRandom/PointRandom.h"
+
+namespace
+{
+// Смещение начала лучей от вершины вдоль нормали (в долях диагонали ограничивающего параллелепипеда)
+constexpr double RAY_OFFSET = 1e-5;
+
+// Есть ли среди граней candidates грань на отрезке луча длиной maxDistance
+bool IsOccluded(CTriangle const* triangles, std::vector<unsigned> const& candidates, CVector3d const& rayStart,
+	CVector3d const& rayDirection, double maxDistance)
+{
+	double hitTime, w0, w1, w2;
+	CVector3d hitPoint;
+	for (unsigned index : candidates)
+	{
+		if (triangles[index].HitTest(rayStart, rayDirection, hitTime, hitPoint, w0, w1, w2) && hitTime <= maxDistance)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+} // namespace
+
+std::vector<float> AmbientOcclusionBaker::Bake(CTriangleMeshData const& meshData, AmbientOcclusionBaking const& baking)
+{
+	const size_t vertexCount = meshData.GetVertexCount();
+	const size_t triangleCount = meshData.GetTriangleCount();
+	std::vector<float> occlusion(vertexCount, 1.0f);
+	if (triangleCount == 0)
+	{
+		return occlusion;
+	}
+
+	Vertex const* const vertices = meshData.GetVertices();
+	CTriangle const* const triangles = meshData.GetTriangles();
+
+	/*
+		Нормали вершин - суммы нормалей прилегающих граней с весами, равными их площадям. Нормали вершин
+		из файла для этого не подходят: у вершин плоских граней они могут быть не заданы
+	*/
+	std::vector<CVector3d> normals(vertexCount);
+	std::vector<CBoundingBox> triangleBounds(triangleCount);
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		CTriangle const& triangle = triangles[i];
+		const CVector3d faceNormal = triangle.GetPlaneEquation();
+		normals[size_t(&triangle.GetVertex0() - vertices)] += faceNormal;
+		normals[size_t(&triangle.GetVertex1() - vertices)] += faceNormal;
+		normals[size_t(&triangle.GetVertex2() - vertices)] += faceNormal;
+
+		triangleBounds[i].Extend(triangle.GetVertex0().position);
+		triangleBounds[i].Extend(triangle.GetVertex1().position);
+		triangleBounds[i].Extend(triangle.GetVertex2().position);
+	}
+
+	CBoundingBox const& bounds = meshData.GetBounds();
+	const double diagonal = (bounds.GetMax() - bounds.GetMin()).GetLength();
+	const double maxDistance = baking.maxDistance * diagonal;
+	const double offset = RAY_OFFSET * diagonal;
+	const unsigned grid = Max(baking.hemisphereGrid, 1u);
+
+	// Вершины обрабатываются независимо. Внутри параллельной загрузки сеток (см. FileScene) цикл выполняется одним потоком
+	const int count = int(vertexCount);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+	for (int vertexIndex = 0; vertexIndex < count; ++vertexIndex)
+	{
+		const CVector3d normal = normals[size_t(vertexIndex)];
+		const double normalLength = normal.GetLength();
+		if (normalLength == 0)
+		{
+			// Вершина не принадлежит ни одной невырожденной грани
+			continue;
+		}
+		const CVector3d unitNormal = (1 / normalLength) * normal;
+
+		CVector3d const& position = vertices[vertexIndex].position;
+		const CVector3d rayStart = position + offset * unitNormal;
+
+		/*
+			Грани, которые могут затенять вершину: лучи всех направлений проверяются только с ними.
+			Грани, ограничивающие параллелепипеды которых дальше maxDistance, затенять вершину не могут
+		*/
+		const double maxSquaredDistance = Sqr(maxDistance + offset);
+		std::vector<unsigned> candidates;
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			if (triangleBounds[i].GetSquaredDistance(rayStart) <= maxSquaredDistance)
+			{
+				candidates.push_back(unsigned(i));
+			}
+		}
+
+		// Выборки стратифицированы по сетке grid x grid
+		PointRandom random(position, PointRandomStream::AmbientOcclusion);
+		unsigned unoccludedRays = 0;
+		for (unsigned i = 0; i < grid; ++i)
+		{
+			for (unsigned j = 0; j < grid; ++j)
+			{
+				const double u = (i + random.NextDouble()) / grid;
+				const double v = (j + random.NextDouble()) / grid;
+				const CVector3d direction = PathTracer::SampleCosineHemisphere(unitNormal, u, v);
+				if (!IsOccluded(triangles, candidates, rayStart, direction, maxDistance))
+				{
+					++unoccludedRays;
+				}
+			}
+		}
+		occlusion[size_t(vertexIndex)] = float(unoccludedRays) / float(grid * grid);
+	}
+
+	return occlusion;
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <vector>
+#include "../TriangleMesh/TriangleMesh.h"
+
+// Параметры вычисления фонового затенения вершин сетки (см. AmbientOcclusionBaker)
+struct AmbientOcclusionBaking
+{
+	// Количество лучей на сторону стратифицированной сетки направлений полусферы
+	unsigned hemisphereGrid = 8;
+	// Наибольшее расстояние до затеняющей грани в долях диагонали ограничивающего параллелепипеда сетки
+	double maxDistance = 0.25;
+};
+
+/*
+	Предварительное вычисление фонового затенения (ambient occlusion) неподвижных сеток.
+	Из каждой вершины выпускаются лучи по полусфере вокруг нормали (с плотностью, пропорциональной косинусу угла
+	с нормалью), и затенение вершины - доля лучей, не столкнувшихся с гранями сетки на расстоянии maxDistance.
+	Учитывается только затенение гранями самой сетки: оно не зависит от трансформации объекта, поэтому
+	вычисляется один раз при загрузке и используется всеми объектами, ссылающимися на данные сетки (см. MeshCache).
+	При закрашивании значения вершин интерполируются по весовым коэффициентам точки треугольника (см. CTriangleMesh::Hit)
+*/
+class AmbientOcclusionBaker
+{
+public:
+	/*
+		Вычисляет затенение вершин сетки: 1 - вершина не затенена, 0 - затенена полностью.
+		Вершины обрабатываются параллельно
+	*/
+	static std::vector<float> Bake(CTriangleMeshData const& meshData, AmbientOcclusionBaking const& baking = AmbientOcclusionBaking());
+};
@@ -1,26 +1,34 @@
 ﻿// Debug
 #include <iostream>
+#include <utility>
 
 #include "Application.h"
-#include "../LightSource/OmniLightSource.h"
-#include "../SceneObject/SceneObject.h"
+#include "../LightSource/ILightSource.h"
 #include "../Vector/VectorMath.h"
-#include "../ViewPort/ViewPort.h"
-#include "../Material/ComplexMaterial.h"
-#include "../TriangleMesh/TriangleMesh.h"
-#include "../GeometryObjects/Dodecahedron/Dodecahedron.h"
-#include "../GeometryObjects/Icosahedron/Icosahedron.h"
-#include "../GeometryObjects/HyperbolicParaboloid/HyperbolicParaboloid.h"
 
 
 // Debug
 size_t MOVABLE_LIGHT_SOURCE_INDEX = 0;
 
-Application::Application()
-	: m_frameBuffer(600, 400)
+namespace
+{
+// Событие, сообщающее о появлении в буфере кадра новых построенных блоков
+constexpr Uint8 RENDER_PROGRESS_EVENT = SDL_USEREVENT;
+
+// Минимальный интервал между обновлениями окна в процессе построения изображения (мс)
+constexpr Uint32 DISPLAY_UPDATE_INTERVAL = 20;
+}
+
+Application::Application(std::string const& workerExecutable, unsigned workerProcessCount,
+	unsigned threadsPerWorker, std::vector<std::string> const& renderFarmWorkers)
+	: m_pathTracing(false)
+	, m_demoScene(600, 400)
+	, m_scene(m_demoScene.GetScene())
+	, m_context(m_demoScene.GetContext())
 	, m_pMainSurface(NULL)
-	, m_timerId(NULL)
 	, m_mainSurfaceUpdated(0)
+	, m_lastSurfaceUpdateTicks(0)
+	, m_deferredUpdatePending(0)
 {
 	// Инициализация SDL (таймер и видео)
 	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER);
@@ -30,37 +38,32 @@ Application::Application()
 	// на поверхность, связанную с ним
 	m_pMainSurface = SDL_SetVideoMode(600, 400, 32,
 		SDL_SWSURFACE | SDL_DOUBLEBUF);
+	CreateFrameBuffer(600, 400);
 
-	/*
-	Задаем цвет заднего фона сцены
-	*/
-	m_scene.SetBackdropColor(CVector4f(0, 0, 1, 1));
-
-	AddSomePlane();
-	AddSomeLight();
-
-	AddSomeHyperbolicParaboloid();
-	AddSomeCubes();
-	AddSomeTetrahedron();
-	AddSomeOctahedron();
-	AddSomeDodecahedron();
-	AddSomeIcosahedron();
+	if (!renderFarmWorkers.empty())
+	{
+		m_pNetworkRenderer = std::make_unique<NetworkRenderCoordinator>(renderFarmWorkers,
+			m_pFrameBuffer->GetWidth(), m_pFrameBuffer->GetHeight());
+	}
+	else if (workerProcessCount > 0)
+	{
+		m_pProcessRenderer = std::make_unique<ProcessRenderCoordinator>(workerExecutable, workerProcessCount,
+			m_pFrameBuffer->GetWidth(), m_pFrameBuffer->GetHeight(), threadsPerWorker);
+	}
 
-	/*
-		Задаем параметры видового порта и матрицы проецирования в контексте визуализации
-	*/
-	m_context.SetViewPort(CViewPort(0, 0, 600, 400));
-	CMatrix4d proj;
-	proj.LoadPerspective(75, 600.0 / 400.0, 0.1, 10);
-	m_context.SetProjectionMatrix(proj);
-
-	// Задаем матрицу камеры
-	CMatrix4d modelView;
-	modelView.LoadLookAtRH(
-		1, 1, 5,
-		0, 0, 0,
-		0, 1, 0);
-	m_context.SetModelViewMatrix(modelView);
+	// Окно обновляется по мере построения блоков изображения
+	auto progressCallback = [this](bool frameCompleted) {
+		OnRenderProgress(frameCompleted);
+	};
+	m_renderer.SetProgressCallback(progressCallback);
+	if (m_pProcessRenderer)
+	{
+		m_pProcessRenderer->SetProgressCallback(progressCallback);
+	}
+	if (m_pNetworkRenderer)
+	{
+		m_pNetworkRenderer->SetProgressCallback(progressCallback);
+	}
 }
 
 Application::~Application()
@@ -72,11 +75,11 @@ Application::~Application()
 void Application::MainLoop()
 {
 	// Инициализация приложения.
-	// Запуск в отдельном потоке и запуск таймера для периодического обновления содержимого окна приложения.
+	// Запуск построения изображения в отдельном потоке. Окно обновляется по сообщениям визуализатора
 	Initialize();
 
 	// Обновляем изначальное содержимое окна
-	UpdateMainSurface();
+	UpdateMainSurface(true);
 
 	// Цикл обработки сообщений, продолжающийся пока не будет
 	// получен запрос на завершение работы
@@ -87,17 +90,25 @@ void Application::MainLoop()
 		{
 		case SDL_VIDEOEXPOSE:
 		{
-			// Обновляем содержимое главного окна,
-			// если оно нуждается в перерисовке
-			UpdateMainSurface();
+			// Окно нуждается в перерисовке целиком
+			UpdateMainSurface(true);
+			break;
+		}
+		case RENDER_PROGRESS_EVENT:
+		{
+			// Переносим на экран только построенные с момента предыдущего обновления области
+			UpdateMainSurface(false);
 			break;
 		}
 		case SDL_KEYDOWN:
 		{
 			CMatrix4d modelViewMatrix = m_context.GetModelViewMatrix();
-			auto lightTranslate = m_scene.GetLight(MOVABLE_LIGHT_SOURCE_INDEX).GetTransform();
+			// Неконстантный доступ к источнику считается его изменением, поэтому матрица читается через константную ссылку
+			auto lightTranslate = std::as_const(m_scene).GetLight(MOVABLE_LIGHT_SOURCE_INDEX).GetTransform();
+			CMatrix4d objectTransform = m_demoScene.GetMovableObject().GetTransform();
 			bool cameraPosChanged = false;
 			bool lightPosChanged = false;
+			bool objectPosChanged = false;
 			switch (evt.key.keysym.sym)
 			{
 			case SDLK_UP:
@@ -116,13 +127,49 @@ void Application::MainLoop()
 				lightTranslate.Translate(1, 0, 0);
 				lightPosChanged = true;
 				break;
+			case SDLK_w:
+				objectTransform.Translate(0, 0, -0.5);
+				objectPosChanged = true;
+				break;
+			case SDLK_s:
+				objectTransform.Translate(0, 0, 0.5);
+				objectPosChanged = true;
+				break;
+			case SDLK_a:
+				objectTransform.Translate(-0.5, 0, 0);
+				objectPosChanged = true;
+				break;
+			case SDLK_d:
+				objectTransform.Translate(0.5, 0, 0);
+				objectPosChanged = true;
+				break;
+			case SDLK_p:
+				TogglePathTracing();
+				break;
+			case SDLK_n:
+				ToggleDenoising();
+				break;
+			case SDLK_i:
+				ToggleIrradianceCache();
+				break;
 			default:
 				break;
 			}
-			if (lightPosChanged)
+			// Процессы-исполнители строят изображение своей копии сцены, поэтому изменения сцены им не передаются
+			if ((lightPosChanged || objectPosChanged) && !m_pProcessRenderer)
 			{
-				m_scene.GetLight(MOVABLE_LIGHT_SOURCE_INDEX).SetTransform(lightTranslate);
-				Initialize();
+				// Сцену нельзя изменять, пока фоновый поток строит изображение
+				m_renderer.Stop();
+
+				if (lightPosChanged)
+				{
+					m_scene.SetLightTransform(MOVABLE_LIGHT_SOURCE_INDEX, lightTranslate);
+				}
+				if (objectPosChanged)
+				{
+					m_scene.SetObjectTransform(m_demoScene.GetMovableObject(), objectTransform);
+				}
+				RenderSceneChanges();
 			}
 		}
 		}
@@ -135,382 +182,317 @@ void Application::MainLoop()
 
 void Application::Initialize()
 {
-	// Запускаем построение изображения и таймер обновления экрана
-	m_renderer.Render(m_scene, m_context, m_frameBuffer);
-	m_timerId = SDL_AddTimer(50, &TimerCallback, this);
-}
-
-void Application::Uninitialize()
-{
-	// Останавливаем таймер обновления экрана и построение изображения
-	SDL_RemoveTimer(m_timerId);
-	m_renderer.Stop();
+	// Запускаем построение изображения
+	if (m_pNetworkRenderer)
+	{
+		m_pNetworkRenderer->Render(m_demoScene.GetState());
+	}
+	else if (m_pProcessRenderer)
+	{
+		m_pProcessRenderer->Render();
+	}
+	else
+	{
+		RenderFullFrame();
+	}
 }
 
-// Обновляем содержимое главного окна
-
-// Основной поток приложения выполняет периодическое обновление окна. 
-// Копируя в его теневой (внеэкранный буфер) содержимое буфера кадра.
-
-// То есть крч: подсистема визуализации -> Буфер кадра -> Теневой буфер, связанный с окном -> Видимое изображение в окне
-void Application::UpdateMainSurface()
+void Application::RenderFullFrame()
 {
-	// Копирование буфера кадра в область главного окна
-	CopyFrameBufferToSDLSurface(); // (1)
-
-	// Для отображения содержимого на экране из внеэкранного буфера.
-	SDL_Flip(m_pMainSurface); // (2)
+	// Блоки, построенные до остановки визуализатора, переносим на поверхность окна, пока новый кадр их не перезаписал
+	UpdateMainSurface(false);
 
-	// Устанавливается флаг "Поверхность обновлена"
-	m_mainSurfaceUpdated.store(1); // (3)
+	if (m_pathTracing)
+	{
+		m_renderer.RenderProgressive(m_scene, m_context, *m_pFrameBuffer, *m_pAccumulationBuffer);
+	}
+	else
+	{
+		m_renderer.Render(m_scene, m_context, *m_pFrameBuffer);
+	}
 }
 
-// Копирование буфера кадра в область главного окна
-// Перенос пикселей изображения из буфера кадра в теневой буфер, связанный с окном
-void Application::CopyFrameBufferToSDLSurface()
+void Application::TogglePathTracing()
 {
-	// Выполняется доступ к пикселям поверхности
-	SDL_LockSurface(m_pMainSurface);
-	const SDL_PixelFormat* pixelFormat = m_pMainSurface->format;
-
-	// Проверка формата пикселей поверхности, для простоты только поддержка 32 битных.
-	if (pixelFormat->BitsPerPixel == 32)
+	if (m_pProcessRenderer || m_pNetworkRenderer)
 	{
-		const Uint8 rShift = pixelFormat->Rshift;
-		const Uint8 gShift = pixelFormat->Gshift;
-		const Uint8 bShift = pixelFormat->Bshift;
-		const Uint8 aShift = pixelFormat->Ashift;
-		const Uint32 aMask = pixelFormat->Amask;
-
-		const unsigned h = m_frameBuffer.GetHeight();
-		const unsigned w = m_frameBuffer.GetWidth();
-
-	    // Цикл с построчным копированием пикселей изображения. Адрес каждой последующей строки смещён относительно адреса предыдущей на pitch
-		Uint8* pixels = reinterpret_cast<Uint8*>(m_pMainSurface->pixels);
-		for (unsigned y = 0; y < h; ++y, pixels += m_pMainSurface->pitch)
-		{
-			// Вычисляются адреса начала строки буфера кадра и теневого буфера
-			std::uint32_t const* srcLine = m_frameBuffer.GetPixels(y);
-			Uint32* dstLine = reinterpret_cast<Uint32*>(pixels);
-
-			// Когда формат пикселей буфера кадра и теневого буфера совпадают, то копируем обычной memcpy
-			if (bShift == 0 && gShift == 8 && rShift == 16)
-			{
-				memcpy(dstLine, srcLine, w * sizeof(Uint32));
-			}
-			// В противном случае, каждый пиксель буфера кадра трансформируется в требуемый формат с манипулированием над битами на основе сдвигов.
-			else
-			{
-				for (unsigned x = 0; x < w; ++x)
-				{
-					boost::uint32_t srcColor = srcLine[x];
-					Uint32 dstColor = ((srcColor & 0xff) << bShift) | (((srcColor >> 8) & 0xff) << gShift) | (((srcColor >> 16) & 0xff) << rShift) | ((((srcColor >> 24)) << aShift) & aMask);
-					dstLine[x] = dstColor;
-				}
-			}
-		}
+		return;
 	}
 
-	SDL_UnlockSurface(m_pMainSurface);
+	m_renderer.Stop();
+	m_pathTracing = !m_pathTracing;
+	m_pAccumulationBuffer->Clear();
+	RenderFullFrame();
 }
 
-Uint32 SDLCALL Application::TimerCallback(Uint32 interval, void* param)
+void Application::ToggleDenoising()
 {
-	/*
-		Статический метод TimerCallback вызывается библиотекой SDL.
+	if (m_pProcessRenderer || m_pNetworkRenderer)
+	{
+		return;
+	}
 
-		Поскольку при инициализации таймера в качестве параметра таймера был передан указатель this экземпляра класса CApplication,
-		здесь используется оператор приведения типа для обратного преобразования указателя void* к указателю на CApplication
-		и происходит вызов метода OnTimer соответствующего экземпляра класса.
-	*/
-	Application* pMyApp = reinterpret_cast<Application*>(param);
-	return pMyApp->OnTimer(interval);
+	m_renderer.Stop();
+	m_renderer.SetDenoising(!m_renderer.IsDenoising());
+	if (m_pathTracing)
+	{
+		// Накопленные выборки остаются действительными - изменяется лишь способ их вывода в буфер кадра
+		RenderFullFrame();
+	}
 }
 
-Uint32 Application::OnTimer(Uint32 interval)
+void Application::ToggleIrradianceCache()
 {
-	unsigned renderedChunks = 0;
-	unsigned totalChunks = 0;
-	if (m_renderer.GetProgress(renderedChunks, totalChunks))
+	if (m_pProcessRenderer || m_pNetworkRenderer)
 	{
-		// Если формирование завершено, то заносим значение 0.
-		interval = 0;
+		return;
 	}
-	// Независимо от того, было ли завершено построение, необходимо принудительно пометить окно для последующего обновления.
-	InvalidateMainSurface();
 
-	// Интервал, через который должно произойти обновление.
-	return interval;
+	// Сцену нельзя изменять, пока фоновый поток строит изображение
+	m_renderer.Stop();
+	IrradianceCaching caching = m_scene.GetIrradianceCaching();
+	caching.enabled = !caching.enabled;
+	m_scene.SetIrradianceCaching(caching);
+	RenderSceneChanges();
 }
 
-void Application::InvalidateMainSurface()
+void Application::RenderSceneChanges()
 {
-	/*
-	Считывается значение флага m_mainSurfaceUpdated. Значение данного флага, равное 1 сигнализирует о том, что основной поток приложения ранее выполнил обновление содержимого окна.
-	*/
-	bool redrawIsNeeded = m_mainSurfaceUpdated.load() == 1;
-
-	/*
-	* 
-	Принудительное обновление содержимого окна приложения заключается в добавлении события SDL_VIDEOEXPOSE в очередь событий. 
-	Т.к. доабвление данного события в очередь и его обработка выполняются разными потоками, 
-	необходимо следить за тем, чтобы в очереди сообщений одновременно находилось не более одного8 события SDL_VIDEOEXPOSE.
-	*/
-	if (redrawIsNeeded)
+	if (m_pNetworkRenderer)
 	{
-		// Выполняется сброс флага m_mainsurfaceUpdated, благодаря чему последующее добавление события SDL_VIDEOEXPOSE будет возможно только после обновления содержимого окна.
-		m_mainSurfaceUpdated.store(0);
+		// Узлам фермы передается новое состояние сцены, и кадр строится заново целиком
+		m_pNetworkRenderer->Stop();
+		m_pNetworkRenderer->Render(m_demoScene.GetState());
+		m_scene.ResetChanges();
+		return;
+	}
 
-		// Событие SDL_VIDEOEXPOSE добавляется в очередь.
-		SDL_Event evt;
-		evt.type = SDL_VIDEOEXPOSE;
-		SDL_PushEvent(&evt);
+	if (m_pathTracing)
+	{
+		// Выборки, накопленные для прежнего состояния сцены, устарели. Накопление начинается заново
+		m_pAccumulationBuffer->Clear();
+		RenderFullFrame();
+		m_scene.ResetChanges();
+		return;
 	}
-}
 
-void Application::AddSomePlane()
-{
-	/*
-		Матрица трансформации плоскости
-	*/
-	CMatrix4d planeTransform;
-	planeTransform.Translate(0, -2, -3);
+	// Если предыдущий кадр был построен не полностью, часть буфера кадра устарела независимо от изменений
+	unsigned renderedChunks = 0;
+	unsigned totalChunks = 0;
+	bool previousFrameCompleted = m_renderer.GetProgress(renderedChunks, totalChunks);
 
-	/*
-		Материал плоскости
-	*/
-	ComplexMaterial planeMaterial;
-	planeMaterial.SetDiffuseColor(CVector4f(0, 0, 1, 1));
-	planeMaterial.SetSpecularColor(CVector4f(1, 1, 1, 1));
-	planeMaterial.SetAmbientColor(CVector4f(0.0f, 0.2f, 0.2f, 1));
+	// Блоки, построенные до остановки визуализатора, переносим на поверхность окна, пока новый кадр их не перезаписал
+	UpdateMainSurface(false);
 
-	AddPlane(CreatePhongShader(planeMaterial), 0, 1, 0, 0, planeTransform);
+	std::vector<CScreenRect> changedRegions;
+	if (previousFrameCompleted && m_scene.GetChangedScreenArea(m_context, changedRegions))
+	{
+		// Перестраиваем только измененные области. Если изменения не видны, перестраивать нечего
+		if (!m_renderer.RenderRegions(m_scene, m_context, *m_pFrameBuffer, changedRegions))
+		{
+			m_scene.ResetChanges();
+			return;
+		}
+	}
+	else
+	{
+		m_renderer.Render(m_scene, m_context, *m_pFrameBuffer);
+	}
+	m_scene.ResetChanges();
 }
 
-void Application::AddSomeLight()
+void Application::Uninitialize()
 {
-	COmniLightPtr pLightFront(new COmniLightSource(CVector3d(0.f, 5.0, 10.f)));
-	pLightFront->SetDiffuseIntensity(CVector4f(1, 1, 1, 1));
-	pLightFront->SetSpecularIntensity(CVector4f(1, 1, 1, 1));
-	pLightFront->SetAmbientIntensity(CVector4f(1, 1, 1, 1));
-	m_scene.AddLightSource(pLightFront);
+	// Останавливаем построение изображения
+	m_renderer.Stop();
+	if (m_pProcessRenderer)
+	{
+		m_pProcessRenderer->Stop();
+	}
+	if (m_pNetworkRenderer)
+	{
+		m_pNetworkRenderer->Stop();
+	}
 }
 
-void Application::AddSomeCubes()
+void Application::CreateFrameBuffer(unsigned width, unsigned height)
 {
-	// Матрица трансформации куба
-	CMatrix4d cubeTransform;
-	cubeTransform.Translate(-4, -0.5f, 0);
-	cubeTransform.Scale(1, 1, 1);
-	cubeTransform.Rotate(30, 0, 1, 0);
-	cubeTransform.Rotate(-15, 1, 0, 0);
-
-	//Материал куба
-	ComplexMaterial cubeMaterial;
-	cubeMaterial.SetDiffuseColor(CVector4f(1, 0, 0, 1));
-	cubeMaterial.SetSpecularColor(CVector4f(1, 1, 1, 1));
-	cubeMaterial.SetAmbientColor(CVector4f(0.2f, 0.2f, 0.2f, 1));
-	cubeMaterial.SetSpecularCoefficient(2048);
-
-	// Создаю PhongShader на основе материала, начальный размер = 1, центр и матрица трансформации
-	AddCube(CreatePhongShader(cubeMaterial), 1, CVector3d(0, 0, 0), cubeTransform);
+	/*
+		Визуализатор не строит изображение в памяти поверхности окна, даже если форматы пикселей совпадают:
+		иначе перерисовка окна показывала бы недостроенный кадр, а потоки визуализатора записывали бы пиксели,
+		которые в это же время выводит на экран SDL_UpdateRects
+	*/
+	m_pFrameBuffer = std::make_unique<FrameBuffer>(width, height);
+	m_pAccumulationBuffer = std::make_unique<AccumulationBuffer>(width, height);
 }
 
-void Application::AddSomeTetrahedron()
+FrameBuffer& Application::GetDisplayFrameBuffer()
 {
-	// Вершины
-	CVector3d v0(-1, 0, 1);
-	CVector3d v1(+1, 0, 1);
-	CVector3d v2(0, 0, -1);
-	CVector3d v3(0, 2, 0);
-	std::vector<Vertex> vertices;
-	vertices.push_back(Vertex(v0));
-	vertices.push_back(Vertex(v1));
-	vertices.push_back(Vertex(v2));
-	vertices.push_back(Vertex(v3));
-
-	// Грани
-	std::vector<Face> faces;
-	faces.push_back(Face(0, 2, 1));
-	faces.push_back(Face(3, 0, 1));
-	faces.push_back(Face(3, 1, 2));
-	faces.push_back(Face(3, 2, 0));
-
-	// Данные полигональной сетки
-	CTriangleMeshData* pMeshData = CreateTriangleMeshData(vertices, faces);
-
-	CMatrix4d transform;
-	transform.Translate(3, 0.5f, -1);
-	transform.Rotate(170, 0, 1, 0);
-	CSimpleMaterial blue;
-	blue.SetDiffuseColor(CVector4f(0.5f, 0.8f, 1, 1));
-
-	AddTriangleMesh(CreateSimpleDiffuseShader(blue), pMeshData, transform);
+	if (m_pNetworkRenderer)
+	{
+		return m_pNetworkRenderer->GetFrameBuffer();
+	}
+	return m_pProcessRenderer ? m_pProcessRenderer->GetFrameBuffer() : *m_pFrameBuffer;
 }
 
-void Application::AddSomeOctahedron()
+bool Application::TakeChangedRegions(std::vector<CScreenRect>& regions)
 {
-	// Вершины
-	CVector3d v0(0, 1, 0);
-	CVector3d v1(1, 0, 0);
-	CVector3d v2(0, -1, 0);
-	CVector3d v3(-1, 0, 0);
-	CVector3d v4(0, 0, 1);
-	CVector3d v5(0, 0, -1);
-	std::vector<Vertex> vertices;
-	vertices.push_back(Vertex(v0));
-	vertices.push_back(Vertex(v1));
-	vertices.push_back(Vertex(v2));
-	vertices.push_back(Vertex(v3));
-	vertices.push_back(Vertex(v4));
-	vertices.push_back(Vertex(v5));
-
-	// Грани
-	std::vector<Face> faces;
-	faces.push_back(Face(2, 1, 4));
-	faces.push_back(Face(1, 0, 4));
-	faces.push_back(Face(0, 3, 4));
-	faces.push_back(Face(3, 2, 4));
-	faces.push_back(Face(2, 5, 1));
-	faces.push_back(Face(1, 5, 0));
-	faces.push_back(Face(0, 5, 3));
-	faces.push_back(Face(3, 5, 2));
-
-	// Данные полигональной сетки
-	CTriangleMeshData* pMeshData = CreateTriangleMeshData(vertices, faces);
-
-	CMatrix4d transform;
-	transform.Translate(-3, 2, -5);
-	transform.Scale(2, 2, 2);
-	CSimpleMaterial violet;
-	violet.SetDiffuseColor(CVector4f(0.8f, 0.0f, 0.8f, 1));
-
-	AddTriangleMesh(CreateSimpleDiffuseShader(violet), pMeshData, transform);
+	if (m_pNetworkRenderer)
+	{
+		return m_pNetworkRenderer->TakeChangedRegions(regions);
+	}
+	return m_pProcessRenderer
+		? m_pProcessRenderer->TakeChangedRegions(regions)
+		: m_renderer.TakeChangedRegions(regions);
 }
 
-void Application::AddSomeDodecahedron()
-{
-	CMatrix4d transform;
-	transform.Translate(-2.5, -1, -3);
-	transform.Rotate(75, 0, 1, 1);
-
-	//Материал додекадра
-	ComplexMaterial material;
-	material.SetDiffuseColor(CVector4f(1, 0, 0, 1));
-	material.SetSpecularColor(CVector4f(1, 1, 1, 1));
-	material.SetAmbientColor(CVector4f(0.2f, 0.2f, 0.2f, 1));
-	material.SetSpecularCoefficient(2048);
-
-	AddDodecahedron(CreatePhongShader(material), transform);
-}
+// Обновляем содержимое главного окна
 
-void Application::AddSomeIcosahedron()
-{
-	CMatrix4d transform;
-	transform.Translate(3, 0, 1);
-	transform.Rotate(20, 0, 1, 1);
-
-	//Материал икосаэдра
-	ComplexMaterial material;
-	material.SetDiffuseColor(CVector4f(0.5f, 0.2f, 0.9f, 1));
-	material.SetSpecularColor(CVector4f(1, 1, 1, 1));
-	material.SetAmbientColor(CVector4f(0.2f, 0.2f, 0.2f, 1));
-	material.SetSpecularCoefficient(2048);
-
-	AddIcosahedron(CreatePhongShader(material), transform);
-}
+// Основной поток приложения выполняет обновление окна по сообщениям визуализатора,
+// копируя в его теневой (внеэкранный буфер) построенные области буфера кадра.
 
-void Application::AddSomeHyperbolicParaboloid()
+// То есть крч: подсистема визуализации -> Буфер кадра -> Теневой буфер, связанный с окном -> Видимое изображение в окне
+void Application::UpdateMainSurface(bool fullUpdate)
 {
-	CMatrix4d transform;
-	transform.Rotate(-25, 0, 1, 0);
-	transform.Translate(1, -1, 0);
-	transform.Scale(0.7f, 0.7f, 0.7f);
-
-	// Материал гиперболического параболоида
-	ComplexMaterial material;
-	material.SetDiffuseColor(CVector4f(1, 0.4f, 0.6f, 1));
-	material.SetSpecularColor(CVector4f(1, 1, 1, 1));
-	material.SetAmbientColor(CVector4f(0.2f, 0.2f, 0.2f, 1));
-	material.SetSpecularCoefficient(256);
-
-	AddHyperbolicParaboloid(CreatePhongShader(material), transform);
-}
+	// Флаг устанавливаем до получения областей: блоки, построенные после этого момента, вызовут новое обновление
+	m_mainSurfaceUpdated.store(1);
+	m_lastSurfaceUpdateTicks.store(SDL_GetTicks());
 
+	/*
+		Поверхность окна - передний буфер: в нее копируются только построенные блоки, а остальная ее часть
+		хранит предыдущее изображение. Поэтому при перерисовке всего окна на экран выводится поверхность,
+		а недостроенные блоки буфера кадра на нее не копируются
+	*/
+	std::vector<CScreenRect> regions;
+	const bool hasChanges = TakeChangedRegions(regions);
+	if (hasChanges)
+	{
+		CopyFrameBufferToSDLSurface(regions); // (1)
+	}
 
-CSimpleDiffuseShader& Application::CreateSimpleDiffuseShader(CSimpleMaterial const& material)
-{
-	auto shader = std::make_unique<CSimpleDiffuseShader>(material);
-	auto& shaderRef = *shader;
-	m_shaders.emplace_back(std::move(shader));
-	return shaderRef;
-}
+	if (fullUpdate)
+	{
+		SDL_UpdateRect(m_pMainSurface, 0, 0, 0, 0);
+		return;
+	}
+	if (!hasChanges)
+	{
+		return;
+	}
 
-PhongShader& Application::CreatePhongShader(const ComplexMaterial& material)
-{
-	auto shader = std::make_unique<PhongShader>(material);
-	auto& shaderRef = *shader;
-	m_shaders.emplace_back(std::move(shader));
-	return shaderRef;
+	// Для отображения содержимого на экране из внеэкранного буфера обновляем только скопированные области
+	std::vector<SDL_Rect> rects;
+	rects.reserve(regions.size());
+	for (CScreenRect const& region : regions)
+	{
+		rects.push_back(SDL_Rect{ Sint16(region.left), Sint16(region.top), Uint16(region.GetWidth()), Uint16(region.GetHeight()) });
+	}
+	SDL_UpdateRects(m_pMainSurface, int(rects.size()), rects.data()); // (2)
 }
 
-CSceneObject& Application::AddPlane(IShader const& shader, double a, double b, double c, double d, CMatrix4d const& transform)
+// Копирование буфера кадра в область главного окна
+// Перенос пикселей изображения из буфера кадра в теневой буфер, связанный с окном
+void Application::CopyFrameBufferToSDLSurface(std::vector<CScreenRect> const& regions)
 {
-	const auto& plane = *m_geometryObjects.emplace_back(
-		std::make_unique<CPlane>(a, b, c, d, transform));
-
-	return AddSceneObject(plane, shader);
-}
+	// Выполняется доступ к пикселям поверхности
+	SDL_LockSurface(m_pMainSurface);
+	const SDL_PixelFormat* pixelFormat = m_pMainSurface->format;
 
-CSceneObject& Application::AddSceneObject(IGeometryObject const& object, IShader const& shader)
-{
-	auto obj = std::make_shared<CSceneObject>(object, shader);
-	m_scene.AddObject(obj);
+	// Проверка формата пикселей поверхности, для простоты только поддержка 32 битных.
+	if (pixelFormat->BitsPerPixel == 32)
+	{
+		const Uint8 rShift = pixelFormat->Rshift;
+		const Uint8 gShift = pixelFormat->Gshift;
+		const Uint8 bShift = pixelFormat->Bshift;
+		const Uint8 aShift = pixelFormat->Ashift;
+		const Uint32 aMask = pixelFormat->Amask;
 
-	return *obj;
-}
+		FrameBuffer const& frameBuffer = GetDisplayFrameBuffer();
 
-CSceneObject& Application::AddCube(IShader const& shader, double size, CVector3d const& center, CMatrix4d const& transform)
-{
-	const auto& cube = *m_geometryObjects.emplace_back(
-		std::make_unique<Cube>(size, center, transform));
+		for (CScreenRect const& region : regions)
+		{
+			const unsigned w = region.GetWidth();
 
-	return AddSceneObject(cube, shader);
-}
+			// Цикл с построчным копированием пикселей области. Адрес каждой последующей строки смещён относительно адреса предыдущей на pitch
+			Uint8* pixels = reinterpret_cast<Uint8*>(m_pMainSurface->pixels) + region.top * m_pMainSurface->pitch;
+			for (unsigned y = region.top; y < region.bottom; ++y, pixels += m_pMainSurface->pitch)
+			{
+				// Вычисляются адреса начала строки области в буфере кадра и теневом буфере
+				std::uint32_t const* srcLine = frameBuffer.GetPixels(y) + region.left;
+				Uint32* dstLine = reinterpret_cast<Uint32*>(pixels) + region.left;
 
-CSceneObject& Application::AddTriangleMesh(IShader const& shader, CTriangleMeshData const* pMeshData, CMatrix4d const& transform)
-{
-	const auto& mesh = *m_geometryObjects.emplace_back(std::make_unique<CTriangleMesh>(pMeshData, transform));
-	return AddSceneObject(mesh, shader);
-}
+				// Когда формат пикселей буфера кадра и теневого буфера совпадают, то копируем обычной memcpy
+				if (bShift == 0 && gShift == 8 && rShift == 16)
+				{
+					memcpy(dstLine, srcLine, w * sizeof(Uint32));
+				}
+				// В противном случае, каждый пиксель буфера кадра трансформируется в требуемый формат с манипулированием над битами на основе сдвигов.
+				else
+				{
+					for (unsigned x = 0; x < w; ++x)
+					{
+						boost::uint32_t srcColor = srcLine[x];
+						Uint32 dstColor = ((srcColor & 0xff) << bShift) | (((srcColor >> 8) & 0xff) << gShift) | (((srcColor >> 16) & 0xff) << rShift) | ((((srcColor >> 24)) << aShift) & aMask);
+						dstLine[x] = dstColor;
+					}
+				}
+			}
+		}
+	}
 
-CTriangleMeshData* Application::CreateTriangleMeshData(std::vector<Vertex> const& vertices, std::vector<Face> const& faces)
-{
-	auto* meshData = m_triangleMeshDataObjects.emplace_back(std::make_unique<CTriangleMeshData>(vertices, faces)).get();
-	return meshData;
+	SDL_UnlockSurface(m_pMainSurface);
 }
 
-CSceneObject& Application::AddDodecahedron(IShader const& shader, CMatrix4d const& transform)
+void Application::OnRenderProgress(bool frameCompleted)
 {
-	const auto& dodecahedron = *m_geometryObjects.emplace_back(
-		std::make_unique<Dodecahedron>(transform));
+	// Завершенный кадр отображаем сразу, а промежуточные обновления - не чаще DISPLAY_UPDATE_INTERVAL
+	const Uint32 elapsed = SDL_GetTicks() - m_lastSurfaceUpdateTicks.load();
+	if (frameCompleted || elapsed >= DISPLAY_UPDATE_INTERVAL)
+	{
+		InvalidateMainSurface();
+		return;
+	}
 
-	return AddSceneObject(dodecahedron, shader);
+	// Слишком раннее обновление откладываем. Блоки, построенные за время ожидания, будут перенесены на экран вместе
+	if (m_deferredUpdatePending.exchange(1) == 0)
+	{
+		SDL_AddTimer(DISPLAY_UPDATE_INTERVAL - elapsed, &DeferredUpdateCallback, this);
+	}
 }
 
-CSceneObject& Application::AddIcosahedron(IShader const& shader, CMatrix4d const& transform)
+Uint32 SDLCALL Application::DeferredUpdateCallback(Uint32 /*interval*/, void* param)
 {
-	const auto& icosahedron = *m_geometryObjects.emplace_back(
-		std::make_unique<Icosahedron>(transform));
+	/*
+		Статический метод DeferredUpdateCallback вызывается библиотекой SDL.
+
+		Поскольку при инициализации таймера в качестве параметра таймера был передан указатель this экземпляра класса Application,
+		здесь используется оператор приведения типа для обратного преобразования указателя void* к указателю на Application.
+	*/
+	Application* pMyApp = reinterpret_cast<Application*>(param);
+	pMyApp->m_deferredUpdatePending.store(0);
+	pMyApp->InvalidateMainSurface();
 
-	return AddSceneObject(icosahedron, shader);
+	// Таймер однократный
+	return 0;
 }
 
-CSceneObject& Application::AddHyperbolicParaboloid(IShader const& shader, CMatrix4d const& transform)
+void Application::InvalidateMainSurface()
 {
-	const auto& hyperbolicParaboloid = *m_geometryObjects.emplace_back(
-		std::make_unique<HyperbolicParaboloid>(transform));
-
-	return AddSceneObject(hyperbolicParaboloid, shader);
+	/*
+	Считывается значение флага m_mainSurfaceUpdated. Значение данного флага, равное 1 сигнализирует о том, что основной поток приложения ранее выполнил обновление содержимого окна.
+	*/
+	/*
+	* 
+	Принудительное обновление содержимого окна приложения заключается в добавлении события RENDER_PROGRESS_EVENT в очередь событий. 
+	Т.к. доабвление данного события в очередь и его обработка выполняются разными потоками (в том числе несколькими потоками визуализатора), 
+	необходимо следить за тем, чтобы в очереди сообщений одновременно находилось не более одного события RENDER_PROGRESS_EVENT.
+	Флаг m_mainSurfaceUpdated сбрасывается атомарно, благодаря чему последующее добавление события будет возможно только после обновления содержимого окна.
+	*/
+	if (m_mainSurfaceUpdated.exchange(0) == 1)
+	{
+		// Событие RENDER_PROGRESS_EVENT добавляется в очередь.
+		SDL_Event evt;
+		evt.type = RENDER_PROGRESS_EVENT;
+		SDL_PushEvent(&evt);
+	}
 }
-
@@ -1,20 +1,28 @@
 ﻿#pragma once
 #include <SDL.h>
 #include <memory>
+#include <string>
+#include <vector>
+#include "../AccumulationBuffer/AccumulationBuffer.h"
+#include "../DemoScene/DemoScene.h"
 #include "../FrameBuffer/FrameBuffer.h"
-#include "../GeometryObjects/Plane/Plane.h"
+#include "../NetworkRenderer/NetworkRenderCoordinator.h"
+#include "../ProcessRenderer/ProcessRenderCoordinator.h"
 #include "../RenderContext/RenderContext.h"
 #include "../Renderer/Renderer.h"
 #include "../Scene/Scene.h"
-#include "../Shader/SimpleDiffuseShader.h"
-#include "../Shader/PhongShader.h"
-#include "../GeometryObjects/Cube/Cube.h"
-#include "../TriangleMesh/TriangleMesh.h"
 
 class Application
 {
 public:
-	Application();
+	/*
+		workerExecutable, workerProcessCount - исполняемый файл и количество процессов-исполнителей.
+		threadsPerWorker - количество потоков каждого исполнителя (см. ProcessRenderCoordinator).
+		renderFarmWorkers - адреса узлов фермы визуализации ("хост:порт").
+		Если не задано ни то, ни другое, изображение строится в потоках текущего процесса
+	*/
+	Application(std::string const& workerExecutable = std::string(), unsigned workerProcessCount = 0,
+		unsigned threadsPerWorker = 0, std::vector<std::string> const& renderFarmWorkers = std::vector<std::string>());
 
 	~Application();
 
@@ -25,62 +33,84 @@ private:
 
 	void Uninitialize();
 
-	// Обновление содержимого окна приложения
-	void UpdateMainSurface();
+	/*
+		Перенос на поверхность окна областей, построенных с момента предыдущего обновления, и вывод их на экран.
+		При fullUpdate == true на экран выводится вся поверхность окна (например, после перекрытия окна другим)
+	*/
+	void UpdateMainSurface(bool fullUpdate);
 
-	// Копирование буфера кадра в область главного окна
-	void CopyFrameBufferToSDLSurface();
+	// Копирование заданных областей буфера кадра в область главного окна
+	void CopyFrameBufferToSDLSurface(std::vector<CScreenRect> const& regions);
 
-	// Обработчик таймера, вызываемый SDL
-	static Uint32 SDLCALL TimerCallback(Uint32 interval, void* param);
+	/*
+		Обработчик построения очередного блока изображения, вызываемый потоками визуализатора.
+		Обновления окна объединяются так, чтобы выполняться не чаще DISPLAY_UPDATE_INTERVAL миллисекунд
+	*/
+	void OnRenderProgress(bool frameCompleted);
 
-	// Обработчик таймера SDL объекта CApplication
-	Uint32 OnTimer(Uint32 interval);
+	// Обработчик таймера отложенного обновления окна, вызываемый SDL
+	static Uint32 SDLCALL DeferredUpdateCallback(Uint32 interval, void* param);
 
 	// Пометка содержимого окна, как нуждающейся в перерисовке
 	void InvalidateMainSurface();
 
-	void AddSomePlane();
-	void AddSomeLight();
-	void AddSomeCubes();
-	void AddSomeTetrahedron();
-	void AddSomeOctahedron();
-	void AddSomeDodecahedron();
-	void AddSomeIcosahedron();
-	void AddSomeHyperbolicParaboloid();
-
-	// Методы создания и добавления шейдеров в коллекцию m_shaders
-	CSimpleDiffuseShader& CreateSimpleDiffuseShader(CSimpleMaterial const& material);
-	PhongShader& CreatePhongShader(const ComplexMaterial& material);
-
-	// Методы, создающие и добавляющие объекты к сцене
-	CSceneObject& AddPlane(IShader const& shader, double a, double b, double c, double d, CMatrix4d const& transform = CMatrix4d());
-	CSceneObject& AddSceneObject(IGeometryObject const& object, IShader const& shader);
-	CSceneObject& AddCube(IShader const& shader, double size, CVector3d const& center = CVector3d(), CMatrix4d const& transform = CMatrix4d());
-	CSceneObject& AddTriangleMesh(IShader const& shader, CTriangleMeshData const* pMeshData, CMatrix4d const& transform = CMatrix4d());
-	CTriangleMeshData* CreateTriangleMeshData(std::vector<Vertex> const& vertices, std::vector<Face> const& faces);
-	CSceneObject& AddDodecahedron(IShader const& shader, CMatrix4d const& transform = CMatrix4d());
-	CSceneObject& AddIcosahedron(IShader const& shader, CMatrix4d const& transform = CMatrix4d());
-	CSceneObject& AddHyperbolicParaboloid(IShader const& shader, CMatrix4d const& transform = CMatrix4d());
+	// Перестроение изображения после изменения сцены: только измененных областей, если их удается ограничить,
+	// либо всего кадра
+	void RenderSceneChanges();
+
+	/*
+		Переключение между рекурсивной трассировкой лучей и прогрессивной трассировкой путей
+		(только при построении изображения в потоках текущего процесса)
+	*/
+	void TogglePathTracing();
+
+	// Включение и выключение фильтрации шума трассировки путей (см. Denoiser)
+	void ToggleDenoising();
+
+	// Включение и выключение кэша непрямой освещенности (см. IrradianceCache)
+	void ToggleIrradianceCache();
+
+	// Запуск построения всего кадра текущим способом визуализации
+	void RenderFullFrame();
+
+	// Создает буфер кадра визуализатора и буфер накопления выборок трассировки путей
+	void CreateFrameBuffer(unsigned width, unsigned height);
+
+	// Буфер кадра, содержимое которого отображается в окне
+	FrameBuffer& GetDisplayFrameBuffer();
+
+	// Области буфера кадра, построенные текущим визуализатором с момента предыдущего вызова
+	bool TakeChangedRegions(std::vector<CScreenRect>& regions);
 
 private:
-	// Буфер кадра
-	FrameBuffer m_frameBuffer;
+	/*
+		Буфер кадра (задний буфер), в котором строит изображение визуализатор. Передним буфером служит
+		поверхность окна: в нее переносятся только построенные блоки
+	*/
+	std::unique_ptr<FrameBuffer> m_pFrameBuffer;
 	// Визуализатор
 	Renderer m_renderer;
+	// Буфер накопления выборок прогрессивной трассировки путей
+	std::unique_ptr<AccumulationBuffer> m_pAccumulationBuffer;
+	// Строится ли изображение трассировкой путей (иначе - рекурсивной трассировкой лучей)
+	bool m_pathTracing;
+	// Многопроцессный визуализатор (если изображение строится процессами-исполнителями)
+	std::unique_ptr<ProcessRenderCoordinator> m_pProcessRenderer;
+	// Координатор фермы визуализации (если изображение строится узлами фермы)
+	std::unique_ptr<NetworkRenderCoordinator> m_pNetworkRenderer;
+	// Демонстрационная сцена
+	DemoScene m_demoScene;
 	// Сцена
-	CScene m_scene;
+	CScene& m_scene;
 	// Контекст
-	CRenderContext m_context;
+	CRenderContext& m_context;
 
 	// Поверхность окна приложения
 	SDL_Surface* m_pMainSurface;
-	// Идентификатор SDL-таймера
-	SDL_TimerID m_timerId;
 	// Обновлена ли поверхность окна приложения (1 - да, 0 - нет)
 	std::atomic<uint32_t> m_mainSurfaceUpdated;
-
-	std::vector<std::unique_ptr<IGeometryObject>> m_geometryObjects;
-	std::vector<std::unique_ptr<IShader>> m_shaders;
-	std::vector<std::unique_ptr<CTriangleMeshData>> m_triangleMeshDataObjects;
+	// Время последнего обновления окна (в миллисекундах, см. SDL_GetTicks)
+	std::atomic<Uint32> m_lastSurfaceUpdateTicks;
+	// Запущен ли таймер отложенного обновления окна (1 - да, 0 - нет)
+	std::atomic<uint32_t> m_deferredUpdatePending;
 };
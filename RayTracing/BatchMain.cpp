@@ -0,0 +1,608 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "AccumulationBuffer/AccumulationBuffer.h"
+#include "ClusteredMesh/ClusteredMeshFile.h"
+#include "DemoScene/DemoScene.h"
+#include "FileScene/FileScene.h"
+#include "FrameBuffer/FrameBuffer.h"
+#include "GeometryObjects/PolytopeReader/PolytopeReader.h"
+#include "ImageWriter/ImageWriter.h"
+#include "Intersection/Intersection.h"
+#include "NetworkRenderer/NetworkRenderCoordinator.h"
+#include "QuantizedMesh/QuantizedMesh.h"
+#include "Ray/Ray.h"
+#include "Renderer/Renderer.h"
+#include "SceneFile/SceneFile.h"
+
+/*
+	Построение изображения без вывода на экран (для узлов визуализации без дисплея и для замеров
+	производительности). Изображение сохраняется в файл, в консоль выводится время выполнения этапов.
+
+	Параметры командной строки:
+		--output <file.ppm|file.png> - файл изображения
+		--scene demo|<file> - демонстрационная сцена (по умолчанию) либо файл описания сцены (см. SceneFile)
+		--save-binary-scene <file> - сохранение загруженного описания сцены в двоичном формате
+		--width <pixels>, --height <pixels> - размер изображения (по умолчанию 800x600)
+		--threads <count> - количество потоков построения изображения (по умолчанию - по числу ядер)
+		--cluster-memory <megabytes> - ограничение объема памяти загруженных кластеров каждой кластеризованной сетки
+		--no-lod - не строить упрощенные уровни детализации сеток (сетки всегда используют исходные данные)
+		--no-freeze - не переносить трансформации неподвижных сеток в их данные (см. FileScene::FreezeStaticMeshes)
+		--bake-ao - вычислить при загрузке фоновое затенение вершин сеток из файлов OBJ (см. AmbientOcclusionBaker)
+		--light-samples <count> - количество теневых лучей на точку при стохастическом выборе источников света
+			(по умолчанию 0 - перебор всех источников, см. LightSampling)
+		--light-candidates <count> - количество кандидатов для выбора каждого источника света
+		--max-depth <count> - наибольшее количество отражений/преломлений на пути луча (см. SecondaryRayLimits)
+		--roulette <throughput> - доля пути в цвете пикселя, ниже которой путь прерывается русской рулеткой
+		--soft-shadow-grid <n> - сетка n x n теневых лучей к протяженному источнику света (см. SoftShadowSampling)
+		--soft-shadow-refined <n> - сетка n x n лучей, добавляемых в полутени (0 - без уточнения)
+		--path-samples <count> - трассировка путей (см. PathTracer) с заданным количеством выборок на пиксель
+			вместо рекурсивной трассировки лучей
+		--denoise - фильтрация шума изображения, построенного трассировкой путей (см. Denoiser)
+		--sampler independent|sobol|owen|blue-noise - генератор выборок пикселей трассировки путей (см. ISampler),
+			по умолчанию owen
+		--irradiance-cache - непрямая освещенность из кэша (см. IrradianceCache) вместо постоянного фонового света
+		--irradiance-accuracy <a> - допустимая погрешность интерполяции кэша (по умолчанию 0.3)
+		--irradiance-grid <n> - сетка n x n лучей по полусфере при вычислении записи кэша
+		--render-farm <host:port>[,<host:port>...] - построение изображения узлами фермы визуализации
+			(см. NetworkRenderWorker). Исполнителям передаются описание сцены и файлы ее сеток; параметры
+			построения изображения (--light-samples, --max-depth и т.п.) ими не учитываются
+		--convert-mesh <file.obj> <file.rtcm> - преобразование сетки в файл кластеризованной сетки (см. ClusteredMeshFile)
+		--compare-mesh-storage <file.obj> - сравнение объема памяти и скорости поиска пересечений
+			для несжатых (CTriangleMeshData) и квантованных (QuantizedMeshData) данных сетки
+*/
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double GetElapsedMilliseconds(Clock::time_point start, Clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void PrintUsage(const char* programName)
+{
+	std::cerr << "Usage: " << programName
+			  << " --output <file.ppm|file.png> [--scene demo|<file>] [--save-binary-scene <file>]"
+			  << " [--width <pixels>] [--height <pixels>] [--threads <count>] [--cluster-memory <megabytes>]"
+			  << " [--no-lod] [--no-freeze] [--bake-ao] [--light-samples <count>] [--light-candidates <count>]"
+			  << " [--max-depth <count>] [--roulette <throughput>] [--soft-shadow-grid <n>] [--soft-shadow-refined <n>]"
+			  << " [--path-samples <count>] [--denoise]"
+			  << " [--sampler independent|sobol|owen|blue-noise]"
+			  << " [--irradiance-cache] [--irradiance-accuracy <a>] [--irradiance-grid <n>]"
+			  << " [--render-farm <host:port>[,<host:port>...]]\n"
+			  << "       " << programName << " --convert-mesh <file.obj> <file.rtcm>\n"
+			  << "       " << programName << " --compare-mesh-storage <file.obj>\n";
+}
+
+SamplerType ParseSamplerType(std::string const& name)
+{
+	if (name == "independent")
+	{
+		return SamplerType::Independent;
+	}
+	if (name == "sobol")
+	{
+		return SamplerType::Sobol;
+	}
+	if (name == "owen")
+	{
+		return SamplerType::OwenScrambledSobol;
+	}
+	if (name == "blue-noise")
+	{
+		return SamplerType::BlueNoise;
+	}
+	throw std::invalid_argument("unknown sampler " + name);
+}
+
+int ConvertMesh(std::string const& inputFileName, std::string const& outputFileName)
+{
+	const Clock::time_point readStart = Clock::now();
+	std::vector<Vertex> vertices;
+	std::vector<Face> faces;
+	PolytopeReader(inputFileName).Read(vertices, faces);
+	if (faces.empty())
+	{
+		std::cerr << "Failed to load mesh " << inputFileName << "\n";
+		return 1;
+	}
+	const Clock::time_point readEnd = Clock::now();
+
+	try
+	{
+		ClusteredMeshFile::Write(vertices, faces, outputFileName);
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	const Clock::time_point writeEnd = Clock::now();
+
+	std::cout << "Mesh:         " << inputFileName << ", " << vertices.size() << " vertices, " << faces.size() << " triangles\n"
+			  << "Mesh load:    " << GetElapsedMilliseconds(readStart, readEnd) << " ms\n"
+			  << "Clustering:   " << GetElapsedMilliseconds(readEnd, writeEnd) << " ms\n"
+			  << "Output:       " << outputFileName << "\n";
+	return 0;
+}
+
+// Выводит время поиска пересечений заданных лучей с объектом и количество лучей, пересекших его
+void MeasureHits(IGeometryObject const& object, std::vector<CRay> const& rays)
+{
+	size_t hitRays = 0;
+	const Clock::time_point start = Clock::now();
+	for (CRay const& ray : rays)
+	{
+		CIntersection intersection;
+		if (object.Hit(ray, intersection))
+		{
+			++hitRays;
+		}
+	}
+	const double milliseconds = GetElapsedMilliseconds(start, Clock::now());
+	std::cout << ", " << rays.size() / (milliseconds / 1000.0) << " rays/s, " << hitRays << " hits";
+}
+
+int CompareMeshStorage(std::string const& inputFileName)
+{
+	std::vector<Vertex> vertices;
+	std::vector<Face> faces;
+	PolytopeReader(inputFileName).Read(vertices, faces);
+	if (faces.empty())
+	{
+		std::cerr << "Failed to load mesh " << inputFileName << "\n";
+		return 1;
+	}
+
+	// Лучи направлены из точек сферы, описанной вокруг сетки, в случайные точки ее ограничивающего параллелепипеда.
+	// Поиск пересечений перебирает все грани, поэтому количество лучей уменьшается с ростом размера сетки
+	CBoundingBox bounds;
+	for (Vertex const& vertex : vertices)
+	{
+		bounds.Extend(vertex.position);
+	}
+	const CVector3d center = (bounds.GetMin() + bounds.GetMax()) * 0.5;
+	const double radius = (bounds.GetMax() - bounds.GetMin()).GetLength();
+	const size_t rayCount = std::clamp<size_t>(size_t(200'000'000) / faces.size(), 16, 100'000);
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::normal_distribution<double> normal;
+	std::vector<CRay> rays;
+	rays.reserve(rayCount);
+	for (size_t i = 0; i < rayCount; ++i)
+	{
+		const CVector3d start = center + Normalize(CVector3d(normal(random), normal(random), normal(random))) * radius;
+		const CVector3d target(
+			bounds.GetMin().x + unit(random) * (bounds.GetMax().x - bounds.GetMin().x),
+			bounds.GetMin().y + unit(random) * (bounds.GetMax().y - bounds.GetMin().y),
+			bounds.GetMin().z + unit(random) * (bounds.GetMax().z - bounds.GetMin().z));
+		rays.emplace_back(start, target - start);
+	}
+
+	const double megabyte = double(1 << 20);
+	std::cout << "Mesh:         " << inputFileName << ", " << vertices.size() << " vertices, " << faces.size() << " triangles, "
+			  << rayCount << " rays\n";
+
+	{
+		const Clock::time_point buildStart = Clock::now();
+		const CTriangleMeshData meshData(vertices, faces);
+		const Clock::time_point buildEnd = Clock::now();
+		std::cout << "Uncompressed: " << meshData.GetMemoryUsage() / megabyte << " MB, build "
+				  << GetElapsedMilliseconds(buildStart, buildEnd) << " ms";
+		MeasureHits(CTriangleMesh(&meshData), rays);
+		std::cout << "\n";
+	}
+
+	for (PositionPrecision precision : { PositionPrecision::Bits16, PositionPrecision::Bits21 })
+	{
+		const Clock::time_point buildStart = Clock::now();
+		const QuantizedMeshData meshData(vertices, faces, precision);
+		const Clock::time_point buildEnd = Clock::now();
+
+		// Наибольшая погрешность координат вершин после квантования
+		double maxError = 0;
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const CVector3d error = meshData.GetVertexPosition(i) - vertices[i].position;
+			maxError = std::max({ maxError, std::abs(error.x), std::abs(error.y), std::abs(error.z) });
+		}
+
+		std::cout << "Quantized " << int(precision) << ": " << meshData.GetMemoryUsage() / megabyte << " MB, build "
+				  << GetElapsedMilliseconds(buildStart, buildEnd) << " ms";
+		MeasureHits(QuantizedMesh(&meshData), rays);
+		std::cout << ", max position error " << maxError << "\n";
+	}
+	return 0;
+}
+}
+
+int main(int argc, char** argv)
+{
+	std::string sceneName = "demo";
+	std::string outputFileName;
+	std::string binarySceneFileName;
+	unsigned width = 800;
+	unsigned height = 600;
+	unsigned threadCount = 0;
+	size_t clusterMemoryBudget = ClusteredMeshData::DEFAULT_MEMORY_BUDGET;
+	FileSceneOptions sceneOptions;
+	LightSampling lightSampling;
+	SecondaryRayLimits secondaryRayLimits;
+	SoftShadowSampling softShadowSampling;
+	unsigned pathSamples = 0;
+	bool denoise = false;
+	SamplerType samplerType = SamplerType::OwenScrambledSobol;
+	IrradianceCaching irradianceCaching;
+	std::vector<std::string> renderFarmWorkers;
+
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const bool hasValue = (i + 1 < argc);
+			if (i + 2 < argc && std::strcmp(argv[i], "--convert-mesh") == 0)
+			{
+				return ConvertMesh(argv[i + 1], argv[i + 2]);
+			}
+			else if (hasValue && std::strcmp(argv[i], "--compare-mesh-storage") == 0)
+			{
+				return CompareMeshStorage(argv[i + 1]);
+			}
+			else if (hasValue && std::strcmp(argv[i], "--scene") == 0)
+			{
+				sceneName = argv[++i];
+			}
+			else if (hasValue && std::strcmp(argv[i], "--output") == 0)
+			{
+				outputFileName = argv[++i];
+			}
+			else if (hasValue && std::strcmp(argv[i], "--save-binary-scene") == 0)
+			{
+				binarySceneFileName = argv[++i];
+			}
+			else if (hasValue && std::strcmp(argv[i], "--width") == 0)
+			{
+				width = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--height") == 0)
+			{
+				height = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--threads") == 0)
+			{
+				threadCount = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--cluster-memory") == 0)
+			{
+				clusterMemoryBudget = size_t(std::stoull(argv[++i])) << 20;
+			}
+			else if (std::strcmp(argv[i], "--no-lod") == 0)
+			{
+				sceneOptions.levelsOfDetail = false;
+			}
+			else if (std::strcmp(argv[i], "--no-freeze") == 0)
+			{
+				sceneOptions.freezeStaticMeshes = false;
+			}
+			else if (std::strcmp(argv[i], "--bake-ao") == 0)
+			{
+				sceneOptions.bakeAmbientOcclusion = true;
+			}
+			else if (hasValue && std::strcmp(argv[i], "--light-samples") == 0)
+			{
+				lightSampling.shadowRays = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--light-candidates") == 0)
+			{
+				lightSampling.candidates = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--max-depth") == 0)
+			{
+				secondaryRayLimits.maxDepth = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--roulette") == 0)
+			{
+				secondaryRayLimits.rouletteThroughput = std::stod(argv[++i]);
+			}
+			else if (hasValue && std::strcmp(argv[i], "--soft-shadow-grid") == 0)
+			{
+				softShadowSampling.initialGrid = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--soft-shadow-refined") == 0)
+			{
+				softShadowSampling.refinedGrid = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--path-samples") == 0)
+			{
+				pathSamples = unsigned(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(argv[i], "--denoise") == 0)
+			{
+				denoise = true;
+			}
+			else if (hasValue && std::strcmp(argv[i], "--sampler") == 0)
+			{
+				samplerType = ParseSamplerType(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--irradiance-cache") == 0)
+			{
+				irradianceCaching.enabled = true;
+			}
+			else if (hasValue && std::strcmp(argv[i], "--irradiance-accuracy") == 0)
+			{
+				irradianceCaching.accuracy = std::stod(argv[++i]);
+			}
+			else if (hasValue && std::strcmp(argv[i], "--irradiance-grid") == 0)
+			{
+				irradianceCaching.hemisphereGrid = unsigned(std::stoul(argv[++i]));
+			}
+			else if (hasValue && std::strcmp(argv[i], "--render-farm") == 0)
+			{
+				std::istringstream addresses(argv[++i]);
+				std::string address;
+				while (std::getline(addresses, address, ','))
+				{
+					renderFarmWorkers.push_back(address);
+				}
+			}
+			else
+			{
+				std::cerr << "Unknown or incomplete argument: " << argv[i] << "\n";
+				PrintUsage(argv[0]);
+				return 1;
+			}
+		}
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << "Invalid argument value: " << e.what() << "\n";
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	ImageWriter::Format format = ImageWriter::Format::PPM;
+	if ((outputFileName.empty() && binarySceneFileName.empty())
+		|| (!outputFileName.empty() && !ImageWriter::GetFormatFromFileName(outputFileName, format)))
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	const bool isDemoScene = (sceneName == "demo");
+	if (isDemoScene && !binarySceneFileName.empty())
+	{
+		std::cerr << "The demo scene has no description to save\n";
+		return 1;
+	}
+	if (width == 0 || height == 0)
+	{
+		std::cerr << "Image size must be positive\n";
+		return 1;
+	}
+	if (!renderFarmWorkers.empty() && pathSamples > 0)
+	{
+		std::cerr << "Path tracing is not supported by the render farm\n";
+		return 1;
+	}
+
+#ifdef _OPENMP
+	if (threadCount > 0)
+	{
+		omp_set_num_threads(int(threadCount));
+	}
+	threadCount = unsigned(omp_get_max_threads());
+#else
+	if (threadCount > 1)
+	{
+		std::cerr << "Built without OpenMP, rendering in a single thread\n";
+	}
+	threadCount = 1;
+#endif
+
+	// Загрузка описания сцены
+	const Clock::time_point loadStart = Clock::now();
+	SceneDescription sceneDescription;
+	try
+	{
+		if (!isDemoScene)
+		{
+			sceneDescription = SceneFile::Load(sceneName);
+		}
+		if (!binarySceneFileName.empty())
+		{
+			SceneFile::WriteBinary(sceneDescription, binarySceneFileName);
+		}
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	const Clock::time_point loadEnd = Clock::now();
+
+	if (outputFileName.empty())
+	{
+		std::cout << "Scene load:   " << GetElapsedMilliseconds(loadStart, loadEnd) << " ms\n"
+				  << "Binary scene: " << binarySceneFileName << "\n";
+		return 0;
+	}
+
+	// Построение сцены
+	const Clock::time_point sceneStart = Clock::now();
+	std::unique_ptr<DemoScene> pDemoScene;
+	std::unique_ptr<FileScene> pFileScene;
+	// Пути к файлам сеток задаются относительно каталога файла сцены
+	const std::string baseDirectory = std::filesystem::path(sceneName).parent_path().string();
+	try
+	{
+		if (isDemoScene)
+		{
+			pDemoScene = std::make_unique<DemoScene>(width, height);
+		}
+		else
+		{
+			pFileScene = std::make_unique<FileScene>(sceneDescription, baseDirectory, width, height, sceneOptions);
+			pFileScene->SetClusterMemoryBudget(clusterMemoryBudget);
+		}
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	CScene& scene = isDemoScene ? pDemoScene->GetScene() : pFileScene->GetScene();
+	scene.SetLightSampling(lightSampling);
+	scene.SetSecondaryRayLimits(secondaryRayLimits);
+	scene.SetSoftShadowSampling(softShadowSampling);
+	scene.SetSamplerType(samplerType);
+	scene.SetIrradianceCaching(irradianceCaching);
+	scene.ResetRayStatistics();
+	CRenderContext const& context = isDemoScene ? pDemoScene->GetContext() : pFileScene->GetContext();
+	const Clock::time_point sceneEnd = Clock::now();
+
+	// Построение изображения. Фоновый поток визуализатора (либо координатора фермы) запускается и дожидается завершения
+	FrameBuffer frameBuffer(width, height);
+	AccumulationBuffer accumulationBuffer(width, height);
+	Renderer renderer;
+	renderer.SetDenoising(denoise);
+	std::unique_ptr<NetworkRenderCoordinator> pRenderFarm;
+	const Clock::time_point renderStart = Clock::now();
+	if (!renderFarmWorkers.empty())
+	{
+		try
+		{
+			pRenderFarm = std::make_unique<NetworkRenderCoordinator>(renderFarmWorkers, width, height);
+			if (!(isDemoScene ? pRenderFarm->Render(pDemoScene->GetState()) : pRenderFarm->Render(sceneDescription, baseDirectory)))
+			{
+				std::cerr << "Failed to start rendering\n";
+				return 1;
+			}
+		}
+		catch (std::exception const& e)
+		{
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+		while (pRenderFarm->IsRendering())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		unsigned renderedChunks = 0;
+		unsigned totalChunks = 0;
+		if (!pRenderFarm->GetProgress(renderedChunks, totalChunks))
+		{
+			std::cerr << "Render farm built " << renderedChunks << " of " << totalChunks << " tiles\n";
+			return 1;
+		}
+	}
+	else
+	{
+		const bool renderStarted = (pathSamples > 0)
+			? renderer.RenderProgressive(scene, context, frameBuffer, accumulationBuffer, pathSamples)
+			: renderer.Render(scene, context, frameBuffer);
+		if (!renderStarted)
+		{
+			std::cerr << "Failed to start rendering\n";
+			return 1;
+		}
+		renderer.Wait();
+	}
+	const Clock::time_point renderEnd = Clock::now();
+
+	// Сохранение изображения
+	const Clock::time_point encodeStart = Clock::now();
+	if (!ImageWriter::Write(pRenderFarm ? pRenderFarm->GetFrameBuffer() : frameBuffer, outputFileName, format))
+	{
+		return 1;
+	}
+	const Clock::time_point encodeEnd = Clock::now();
+
+	const double renderMilliseconds = GetElapsedMilliseconds(renderStart, renderEnd);
+	// Учитываются только первичные лучи (по одному на пиксель в каждом проходе), теневые лучи не считаются
+	const double primaryRays = double(width) * double(height) * std::max(pathSamples, 1u);
+
+	std::cout << "Scene:        " << sceneName << ", " << width << "x" << height << ", ";
+	if (pRenderFarm)
+	{
+		std::cout << renderFarmWorkers.size() << " render farm worker(s)\n";
+	}
+	else
+	{
+		std::cout << threadCount << " thread(s)\n";
+	}
+	std::cout
+			  << "Scene load:   " << GetElapsedMilliseconds(loadStart, loadEnd) << " ms\n"
+			  << "Scene build:  " << GetElapsedMilliseconds(sceneStart, sceneEnd) << " ms\n"
+			  << "Render:       " << renderMilliseconds << " ms\n"
+			  << "Encode:       " << GetElapsedMilliseconds(encodeStart, encodeEnd) << " ms\n"
+			  << "Primary rays: " << primaryRays / (renderMilliseconds * 1000.0) << " Mrays/s\n"
+			  << "Output:       " << outputFileName << "\n";
+
+	// Отраженные и преломленные лучи по глубинам
+	const SecondaryRayStatistics secondaryRays = scene.GetSecondaryRayStatistics();
+	if (secondaryRays.rouletteTerminations + secondaryRays.depthTerminations > 0
+		|| std::any_of(secondaryRays.tracedRays.begin(), secondaryRays.tracedRays.end(), [](std::uint64_t count) { return count > 0; }))
+	{
+		std::cout << "Secondary:    ";
+		for (size_t depth = 0; depth < secondaryRays.tracedRays.size() && secondaryRays.tracedRays[depth] > 0; ++depth)
+		{
+			std::cout << "depth " << depth + 1 << ": " << secondaryRays.tracedRays[depth] << " rays, ";
+		}
+		std::cout << secondaryRays.rouletteTerminations << " paths terminated by roulette, "
+				  << secondaryRays.depthTerminations << " by depth\n";
+	}
+
+	// Теневые лучи к протяженным источникам света
+	const SoftShadowStatistics softShadows = scene.GetSoftShadowStatistics();
+	if (softShadows.estimates > 0)
+	{
+		std::cout << "Soft shadows: " << softShadows.shadowRays << " rays for " << softShadows.estimates << " points ("
+				  << double(softShadows.shadowRays) / double(softShadows.estimates) << " per point), "
+				  << softShadows.penumbraEstimates << " in penumbra\n";
+	}
+
+	// Записи кэша непрямой освещенности
+	const IrradianceCacheStatistics irradianceCache = scene.GetIrradianceCacheStatistics();
+	if (irradianceCache.lookups > 0)
+	{
+		std::cout << "Irradiance:   " << irradianceCache.computedRecords << " records computed for "
+				  << irradianceCache.lookups << " lookups (" << irradianceCache.records << " cached)\n";
+	}
+
+	if (pFileScene)
+	{
+		const ClusterCacheStatistics statistics = pFileScene->GetClusterCacheStatistics();
+		if (statistics.hits + statistics.misses > 0)
+		{
+			std::cout << "Clusters:     " << statistics.hits << " hits, " << statistics.misses << " misses, "
+					  << statistics.evictions << " evictions, " << statistics.residentClusters << " resident ("
+					  << statistics.residentMemory / double(1 << 20) << " MB)\n";
+		}
+
+		if (pFileScene->GetFrozenMeshCount() > 0)
+		{
+			std::cout << "Frozen:       " << pFileScene->GetFrozenMeshCount() << " meshes\n";
+		}
+
+		const LevelOfDetailStatistics lodStatistics = pFileScene->GetLevelOfDetailStatistics();
+		if (lodStatistics.meshes > 0)
+		{
+			std::cout << "LOD:          " << lodStatistics.simplifiedMeshes << " of " << lodStatistics.meshes
+					  << " meshes simplified, " << lodStatistics.triangles << " of " << lodStatistics.fullTriangles << " triangles\n";
+		}
+	}
+
+	return 0;
+}
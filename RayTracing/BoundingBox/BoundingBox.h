@@ -0,0 +1,134 @@
+﻿#pragma once
+#include <cassert>
+#include <limits>
+#include "../Matrix/Matrix4.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/VectorMath.h"
+
+/*
+	Класс "Ограничивающий параллелепипед", стороны которого параллельны осям координат (AABB).
+	Используется для грубой оценки области пространства, занимаемой объектом.
+	Пустой параллелепипед не содержит ни одной точки, бесконечный - содержит все пространство
+	(например, для бесконечной плоскости)
+*/
+class CBoundingBox
+{
+public:
+	// Конструирует пустой ограничивающий параллелепипед
+	CBoundingBox() noexcept
+		: m_min(Infinity(), Infinity(), Infinity())
+		, m_max(-Infinity(), -Infinity(), -Infinity())
+	{
+	}
+
+	// Конструирует параллелепипед по минимальной и максимальной точкам
+	CBoundingBox(CVector3d const& minPoint, CVector3d const& maxPoint) noexcept
+		: m_min(minPoint)
+		, m_max(maxPoint)
+	{
+	}
+
+	// Ограничивающий параллелепипед, охватывающий все пространство
+	static CBoundingBox GetInfinite() noexcept
+	{
+		return CBoundingBox(
+			CVector3d(-Infinity(), -Infinity(), -Infinity()),
+			CVector3d(Infinity(), Infinity(), Infinity()));
+	}
+
+	// Не содержит ни одной точки
+	bool IsEmpty() const noexcept
+	{
+		return m_min.x > m_max.x || m_min.y > m_max.y || m_min.z > m_max.z;
+	}
+
+	// Хотя бы по одной из осей параллелепипед не ограничен
+	bool IsInfinite() const noexcept
+	{
+		return !IsEmpty() && (
+			m_min.x == -Infinity() || m_min.y == -Infinity() || m_min.z == -Infinity() ||
+			m_max.x == Infinity() || m_max.y == Infinity() || m_max.z == Infinity());
+	}
+
+	CVector3d const& GetMin() const noexcept
+	{
+		return m_min;
+	}
+
+	CVector3d const& GetMax() const noexcept
+	{
+		return m_max;
+	}
+
+	// Возвращает одну из 8 вершин параллелепипеда (биты индекса выбирают max по x, y и z)
+	CVector3d GetCorner(unsigned index) const noexcept
+	{
+		assert(index < 8);
+		return CVector3d(
+			(index & 1) ? m_max.x : m_min.x,
+			(index & 2) ? m_max.y : m_min.y,
+			(index & 4) ? m_max.z : m_min.z);
+	}
+
+	// Расширяет параллелепипед так, чтобы он содержал заданную точку
+	void Extend(CVector3d const& point) noexcept
+	{
+		m_min = CVector3d(Min(m_min.x, point.x), Min(m_min.y, point.y), Min(m_min.z, point.z));
+		m_max = CVector3d(Max(m_max.x, point.x), Max(m_max.y, point.y), Max(m_max.z, point.z));
+	}
+
+	// Расширяет параллелепипед так, чтобы он содержал другой параллелепипед
+	void Extend(CBoundingBox const& other) noexcept
+	{
+		if (!other.IsEmpty())
+		{
+			Extend(other.m_min);
+			Extend(other.m_max);
+		}
+	}
+
+	// Имеет ли параллелепипед общие точки с другим параллелепипедом
+	bool Intersects(CBoundingBox const& other) const noexcept
+	{
+		return m_min.x <= other.m_max.x && other.m_min.x <= m_max.x
+			&& m_min.y <= other.m_max.y && other.m_min.y <= m_max.y
+			&& m_min.z <= other.m_max.z && other.m_min.z <= m_max.z;
+	}
+
+	// Квадрат расстояния от точки до ближайшей точки параллелепипеда (0 для точек внутри него)
+	double GetSquaredDistance(CVector3d const& point) const noexcept
+	{
+		const double dx = Max(Max(m_min.x - point.x, point.x - m_max.x), 0.0);
+		const double dy = Max(Max(m_min.y - point.y, point.y - m_max.y), 0.0);
+		const double dz = Max(Max(m_min.z - point.z, point.z - m_max.z), 0.0);
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	/*
+		Ограничивающий параллелепипед для трансформированного параллелепипеда.
+		Трансформируются все 8 вершин, результат охватывает их все
+	*/
+	CBoundingBox GetTransformed(CMatrix4d const& matrix) const noexcept
+	{
+		if (IsEmpty() || IsInfinite())
+		{
+			return *this;
+		}
+
+		CBoundingBox result;
+		for (unsigned i = 0; i < 8; ++i)
+		{
+			result.Extend((matrix * CVector4d(GetCorner(i), 1)).Project());
+		}
+		return result;
+	}
+
+private:
+	static constexpr double Infinity() noexcept
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+
+	CVector3d m_min;
+	CVector3d m_max;
+};
@@ -0,0 +1,169 @@
+﻿#include <algorithm>
+#include <cmath>
+#include "ClusteredMesh.h"
+#include "../Intersection/Intersection.h"
+#include "../Ray/Ray.h"
+
+namespace
+{
+// Максимальная глубина BVH кластера (узлы делятся пополам, поэтому глубина не превышает log2 числа треугольников)
+constexpr size_t MAX_BVH_DEPTH = 64;
+
+/*
+	Пересекает ли луч параллелепипед с заданными минимальной и максимальной точками в момент времени t >= 0.
+	invDirection - величины, обратные координатам направления луча
+*/
+template <typename T>
+bool RayHitsBox(CVector3d const& rayStart, CVector3d const& rayDirection, CVector3d const& invDirection,
+	T const* boxMin, T const* boxMax)
+{
+	double tNear = 0;
+	double tFar = std::numeric_limits<double>::infinity();
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const double start = rayStart[axis];
+		if (rayDirection[axis] == 0)
+		{
+			// Луч параллелен граням параллелепипеда, перпендикулярным оси
+			if (start < boxMin[axis] || start > boxMax[axis])
+			{
+				return false;
+			}
+			continue;
+		}
+
+		double t0 = (boxMin[axis] - start) * invDirection[axis];
+		double t1 = (boxMax[axis] - start) * invDirection[axis];
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+		tNear = std::max(tNear, t0);
+		tFar = std::min(tFar, t1);
+		if (tNear > tFar)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+} // namespace
+
+ClusteredMesh::ClusteredMesh(ClusteredMeshData const* pMeshData, CMatrix4d const& transform)
+	: CGeometryObjectImpl(transform)
+	, m_pMeshData(pMeshData)
+{
+}
+
+bool ClusteredMesh::Hit(CRay const& ray, CIntersection& intersection) const
+{
+	// Вычисляем обратно преобразованный луч (вместо вполнения прямого преобразования объекта)
+	CRay invRay = Transform(ray, GetInverseTransform());
+	CVector3d const& invRayStart = invRay.GetStart();
+	CVector3d const& invRayDirection = invRay.GetDirection();
+	CVector3d const invDirection(1 / invRayDirection.x, 1 / invRayDirection.y, 1 / invRayDirection.z);
+
+	// Информация о пересечении луча с гранью сетки. Нормаль вычисляется сразу, т.к. после обработки
+	// кластера его данные могут быть выгружены из памяти
+	struct FaceHit
+	{
+		CVector3d hitPointInObjectSpace; // Точка пересечения
+		CVector3d normalInObjectSpace; // Нормаль в точке пересечения
+		double hitTime; // Время пересечения
+	};
+	std::vector<FaceHit> faceHits;
+
+	const size_t clusterCount = m_pMeshData->GetClusterCount();
+	for (size_t clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex)
+	{
+		CBoundingBox const& clusterBounds = m_pMeshData->GetClusterBounds(clusterIndex);
+		if (!RayHitsBox(invRayStart, invRayDirection, invDirection, &clusterBounds.GetMin().x, &clusterBounds.GetMax().x))
+		{
+			continue;
+		}
+
+		// Кластер загружается из файла только при пересечении лучом его ограничивающего параллелепипеда
+		const auto pCluster = m_pMeshData->GetCluster(clusterIndex);
+		CTriangle const* const triangles = pCluster->GetMeshData().GetTriangles();
+		ClusterNode const* const nodes = pCluster->GetNodes().data();
+
+		// Обход BVH в глубину с помощью стека индексов узлов
+		std::uint32_t nodeStack[MAX_BVH_DEPTH];
+		size_t stackSize = 0;
+		nodeStack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			ClusterNode const& node = nodes[nodeStack[--stackSize]];
+			if (!RayHitsBox(invRayStart, invRayDirection, invDirection, node.boundsMin, node.boundsMax))
+			{
+				continue;
+			}
+
+			if (node.triangleCount == 0)
+			{
+				if (stackSize + 2 > MAX_BVH_DEPTH)
+				{
+					// BVH, построенные ClusteredMeshFile, настолько глубокими не бывают
+					continue;
+				}
+				nodeStack[stackSize++] = node.firstOrRightChild;
+				nodeStack[stackSize++] = std::uint32_t(&node - nodes) + 1;
+				continue;
+			}
+
+			for (std::uint32_t i = node.firstOrRightChild; i < node.firstOrRightChild + node.triangleCount; ++i)
+			{
+				CTriangle const& triangle = triangles[i];
+
+				FaceHit hit;
+				double w0, w1, w2;
+				if (!triangle.HitTest(invRayStart, invRayDirection, hit.hitTime, hit.hitPointInObjectSpace, w0, w1, w2))
+				{
+					continue;
+				}
+
+				// Нормаль "плоской грани" во всех точках столкновения равна нормали самой грани
+				hit.normalInObjectSpace = triangle.GetPlaneEquation();
+				if (!triangle.IsFlatShaded())
+				{
+					// Для неплоских граней выполняется интерполяция нормалей вершин треугольника
+					hit.normalInObjectSpace = w0 * triangle.GetVertex0().normal + w1 * triangle.GetVertex1().normal
+						+ w2 * triangle.GetVertex2().normal;
+				}
+
+				if (faceHits.empty())
+				{
+					faceHits.reserve(8);
+				}
+				faceHits.push_back(hit);
+			}
+		}
+	}
+
+	// При отсутствии пересечений выходим
+	if (faceHits.empty())
+	{
+		return false;
+	}
+
+	// Возвращаем найденные пересечения в порядке возрастания времени столкновения
+	std::sort(faceHits.begin(), faceHits.end(), [](FaceHit const& a, FaceHit const& b) {
+		return a.hitTime < b.hitTime;
+	});
+	for (FaceHit const& faceHit : faceHits)
+	{
+		intersection.AddHit(
+			CHitInfo(
+				faceHit.hitTime, *this,
+				ray.GetPointAtTime(faceHit.hitTime),
+				faceHit.hitPointInObjectSpace,
+				GetNormalMatrix() * faceHit.normalInObjectSpace, faceHit.normalInObjectSpace));
+	}
+
+	return true;
+}
+
+CBoundingBox ClusteredMesh::GetBounds() const
+{
+	return m_pMeshData->GetBounds().GetTransformed(GetTransform());
+}
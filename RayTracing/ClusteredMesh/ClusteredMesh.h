@@ -0,0 +1,24 @@
+﻿#pragma once
+#include "../GeometryObject/GeometryObjectImpl.h"
+#include "ClusteredMeshData.h"
+
+/*
+	Сетка из треугольников, данные которой загружаются из файла кластеризованной сетки по мере необходимости.
+	При поиске пересечений луч проверяется только с кластерами, ограничивающие параллелепипеды которых
+	он пересекает, а внутри кластера - с треугольниками листьев BVH, через которые он проходит
+*/
+class ClusteredMesh : public CGeometryObjectImpl
+{
+public:
+	ClusteredMesh(ClusteredMeshData const* pMeshData, CMatrix4d const& transform = CMatrix4d());
+
+	// Поиск пересечения луча с полигональной сеткой
+	bool Hit(CRay const& ray, CIntersection& intersection) const override;
+
+	// Ограничивающий параллелепипед сетки в мировой системе координат
+	CBoundingBox GetBounds() const override;
+
+private:
+	// Адрес данных полигональной сетки
+	ClusteredMeshData const* m_pMeshData;
+};
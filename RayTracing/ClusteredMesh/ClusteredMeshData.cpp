@@ -0,0 +1,228 @@
+﻿#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "ClusteredMeshData.h"
+
+namespace ipc = boost::interprocess;
+
+namespace
+{
+CBoundingBox MakeBounds(const double* boundsMin, const double* boundsMax)
+{
+	return CBoundingBox(CVector3d(boundsMin[0], boundsMin[1], boundsMin[2]), CVector3d(boundsMax[0], boundsMax[1], boundsMax[2]));
+}
+} // namespace
+
+ClusteredMeshData::Cluster::Cluster(std::vector<Vertex> const& vertices, std::vector<Face> const& faces, std::vector<ClusterNode>&& nodes)
+	: m_meshData(vertices, faces)
+	, m_nodes(std::move(nodes))
+{
+}
+
+ClusteredMeshData::ClusteredMeshData(std::string const& fileName, size_t memoryBudget)
+	: m_fileName(fileName)
+	, m_memoryBudget(memoryBudget)
+{
+	try
+	{
+		ipc::file_mapping(fileName.c_str(), ipc::read_only).swap(m_file);
+		ipc::mapped_region(m_file, ipc::read_only).swap(m_region);
+	}
+	catch (ipc::interprocess_exception const& e)
+	{
+		throw std::runtime_error("Failed to map " + fileName + ": " + e.what());
+	}
+
+	const char* data = static_cast<const char*>(m_region.get_address());
+	const size_t size = m_region.get_size();
+
+	ClusteredMeshFileHeader header;
+	if (size < sizeof(header))
+	{
+		throw std::runtime_error(fileName + " is not a clustered mesh file");
+	}
+	std::memcpy(&header, data, sizeof(header));
+	if (!std::equal(std::begin(header.signature), std::end(header.signature), std::begin(ClusteredMeshFile::SIGNATURE)))
+	{
+		throw std::runtime_error(fileName + " is not a clustered mesh file");
+	}
+	if (header.version != ClusteredMeshFile::VERSION)
+	{
+		throw std::runtime_error("Unsupported clustered mesh file version in " + fileName);
+	}
+	if ((size - sizeof(header)) / sizeof(ClusterRecord) < header.clusterCount)
+	{
+		throw std::runtime_error("Truncated clustered mesh file " + fileName);
+	}
+
+	m_clusterRecords.resize(header.clusterCount);
+	std::memcpy(m_clusterRecords.data(), data + sizeof(header), m_clusterRecords.size() * sizeof(ClusterRecord));
+
+	// Проверяем, что данные всех кластеров находятся в пределах файла
+	m_clusterBounds.reserve(m_clusterRecords.size());
+	for (ClusterRecord const& record : m_clusterRecords)
+	{
+		const std::uint64_t clusterSize = std::uint64_t(record.vertexCount) * sizeof(ClusterVertex)
+			+ std::uint64_t(record.triangleCount) * sizeof(ClusterTriangle) + std::uint64_t(record.nodeCount) * sizeof(ClusterNode);
+		if (record.offset > size || clusterSize > size - record.offset || record.nodeCount == 0)
+		{
+			throw std::runtime_error("Invalid cluster record in " + fileName);
+		}
+		m_clusterBounds.push_back(MakeBounds(record.boundsMin, record.boundsMax));
+	}
+
+	m_bounds = MakeBounds(header.boundsMin, header.boundsMax);
+	m_triangleCount = header.triangleCount;
+	m_cacheEntries.resize(m_clusterRecords.size());
+}
+
+std::shared_ptr<ClusteredMeshData::Cluster const> ClusteredMeshData::GetCluster(size_t clusterIndex) const
+{
+	std::promise<ClusterPtr> loadPromise;
+	std::shared_future<ClusterPtr> cluster;
+	{
+		std::lock_guard lock(m_mutex);
+		CacheEntry& entry = m_cacheEntries[clusterIndex];
+		if (entry.isResident)
+		{
+			// Кластер загружен либо загружается другим потоком: перемещаем его в начало списка LRU
+			++m_statistics.hits;
+			m_lruList.splice(m_lruList.begin(), m_lruList, entry.lruPosition);
+			cluster = entry.cluster;
+		}
+		else
+		{
+			++m_statistics.misses;
+			entry.cluster = loadPromise.get_future().share();
+			entry.lruPosition = m_lruList.insert(m_lruList.begin(), clusterIndex);
+			entry.isResident = true;
+		}
+	}
+
+	if (cluster.valid())
+	{
+		return cluster.get();
+	}
+
+	ClusterPtr loadedCluster;
+	try
+	{
+		loadedCluster = LoadCluster(clusterIndex);
+	}
+	catch (...)
+	{
+		// Ожидающие потоки получат то же исключение, а следующее обращение повторит загрузку
+		loadPromise.set_exception(std::current_exception());
+		std::lock_guard lock(m_mutex);
+		CacheEntry& entry = m_cacheEntries[clusterIndex];
+		m_lruList.erase(entry.lruPosition);
+		entry = CacheEntry();
+		throw;
+	}
+	loadPromise.set_value(loadedCluster);
+
+	std::lock_guard lock(m_mutex);
+	CacheEntry& entry = m_cacheEntries[clusterIndex];
+	entry.memoryUsage = loadedCluster->GetMemoryUsage();
+	++m_statistics.residentClusters;
+	m_statistics.residentMemory += entry.memoryUsage;
+	EvictLocked();
+
+	return loadedCluster;
+}
+
+ClusteredMeshData::ClusterPtr ClusteredMeshData::LoadCluster(size_t clusterIndex) const
+{
+	ClusterRecord const& record = m_clusterRecords[clusterIndex];
+	const char* data = static_cast<const char*>(m_region.get_address()) + record.offset;
+
+	// Координаты и нормали вершин хранятся в файле с одинарной точностью
+	std::vector<Vertex> vertices(record.vertexCount);
+	for (Vertex& vertex : vertices)
+	{
+		ClusterVertex clusterVertex;
+		std::memcpy(&clusterVertex, data, sizeof(clusterVertex));
+		data += sizeof(clusterVertex);
+
+		vertex.position = CVector3d(clusterVertex.position[0], clusterVertex.position[1], clusterVertex.position[2]);
+		vertex.normal = CVector3d(clusterVertex.normal[0], clusterVertex.normal[1], clusterVertex.normal[2]);
+	}
+
+	std::vector<Face> faces;
+	faces.reserve(record.triangleCount);
+	for (std::uint32_t i = 0; i < record.triangleCount; ++i)
+	{
+		ClusterTriangle triangle;
+		std::memcpy(&triangle, data, sizeof(triangle));
+		data += sizeof(triangle);
+
+		if (triangle.vertex0 >= record.vertexCount || triangle.vertex1 >= record.vertexCount || triangle.vertex2 >= record.vertexCount)
+		{
+			throw std::runtime_error("Invalid triangle in " + m_fileName);
+		}
+		faces.emplace_back(triangle.vertex0, triangle.vertex1, triangle.vertex2, triangle.isFlat != 0);
+	}
+
+	std::vector<ClusterNode> nodes(record.nodeCount);
+	std::memcpy(nodes.data(), data, nodes.size() * sizeof(ClusterNode));
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		ClusterNode const& node = nodes[i];
+		const bool isValid = (node.triangleCount > 0)
+			? (node.firstOrRightChild <= record.triangleCount && node.triangleCount <= record.triangleCount - node.firstOrRightChild)
+			: (node.firstOrRightChild > i + 1 && node.firstOrRightChild < record.nodeCount);
+		if (!isValid)
+		{
+			throw std::runtime_error("Invalid BVH node in " + m_fileName);
+		}
+	}
+
+	return std::make_shared<Cluster const>(vertices, faces, std::move(nodes));
+}
+
+void ClusteredMeshData::EvictLocked() const
+{
+	if (m_memoryBudget == 0)
+	{
+		return;
+	}
+
+	// Последний загруженный кластер (в начале списка) не выгружается, даже если он один превышает ограничение
+	while (m_statistics.residentMemory > m_memoryBudget && m_lruList.size() > 1)
+	{
+		const size_t clusterIndex = m_lruList.back();
+		CacheEntry& entry = m_cacheEntries[clusterIndex];
+		if (entry.memoryUsage == 0)
+		{
+			// Наиболее давно использованный кластер еще загружается
+			break;
+		}
+
+		m_lruList.pop_back();
+		--m_statistics.residentClusters;
+		m_statistics.residentMemory -= entry.memoryUsage;
+		++m_statistics.evictions;
+		entry = CacheEntry();
+	}
+}
+
+void ClusteredMeshData::SetMemoryBudget(size_t budget)
+{
+	std::lock_guard lock(m_mutex);
+	m_memoryBudget = budget;
+	EvictLocked();
+}
+
+ClusterCacheStatistics ClusteredMeshData::GetStatistics() const
+{
+	std::lock_guard lock(m_mutex);
+	return m_statistics;
+}
+
+void ClusteredMeshData::ResetStatistics()
+{
+	std::lock_guard lock(m_mutex);
+	m_statistics.hits = 0;
+	m_statistics.misses = 0;
+	m_statistics.evictions = 0;
+}
@@ -0,0 +1,134 @@
+﻿#pragma once
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "../BoundingBox/BoundingBox.h"
+#include "../TriangleMesh/TriangleMesh.h"
+#include "ClusteredMeshFile.h"
+
+// Статистика обращений к кластерам сетки
+struct ClusterCacheStatistics
+{
+	// Обращения к кластерам, находившимся в памяти
+	unsigned long long hits = 0;
+	// Обращения, потребовавшие загрузки кластера из файла
+	unsigned long long misses = 0;
+	// Кластеры, выгруженные из памяти для соблюдения ограничения ее объема
+	unsigned long long evictions = 0;
+	// Кластеры, находящиеся в памяти, и занимаемый ими объем памяти в байтах
+	size_t residentClusters = 0;
+	size_t residentMemory = 0;
+};
+
+/*
+	Данные кластеризованной сетки, хранящейся в файле .rtcm (см. ClusteredMeshFile).
+
+	Файл отображается в память, но в оперативной памяти постоянно находится только таблица кластеров.
+	Данные кластеров (вершины, треугольники с вычисленными параметрами и BVH) загружаются при первом
+	обращении к ним и выгружаются в порядке давности использования (LRU), когда их суммарный объем
+	превышает заданное ограничение. Кластер, используемый в данный момент каким-либо потоком,
+	не освобождается до окончания его использования, поэтому ограничение может быть ненадолго превышено.
+
+	Методы класса потокобезопасны. Данные, как и данные CTriangleMeshData, могут совместно
+	использоваться несколькими сетками с различными трансформациями
+*/
+class ClusteredMeshData
+{
+public:
+	// Ограничение объема памяти загруженных кластеров по умолчанию
+	static constexpr size_t DEFAULT_MEMORY_BUDGET = size_t(256) << 20;
+
+	// Загруженный кластер
+	class Cluster
+	{
+	public:
+		Cluster(std::vector<Vertex> const& vertices, std::vector<Face> const& faces, std::vector<ClusterNode>&& nodes);
+
+		CTriangleMeshData const& GetMeshData() const { return m_meshData; }
+
+		// Узлы BVH. Треугольники листьев заданы индексами в массиве треугольников GetMeshData()
+		std::vector<ClusterNode> const& GetNodes() const { return m_nodes; }
+
+		size_t GetMemoryUsage() const
+		{
+			return sizeof(*this) + m_meshData.GetMemoryUsage() - sizeof(m_meshData) + m_nodes.capacity() * sizeof(ClusterNode);
+		}
+
+	private:
+		CTriangleMeshData m_meshData;
+		std::vector<ClusterNode> m_nodes;
+	};
+
+	/*
+		Открывает файл кластеризованной сетки. Кластеры при этом не загружаются.
+		Если файл не удалось открыть или он поврежден, выбрасывает исключение std::runtime_error
+	*/
+	explicit ClusteredMeshData(std::string const& fileName, size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+	ClusteredMeshData(ClusteredMeshData const&) = delete;
+	ClusteredMeshData& operator=(ClusteredMeshData const&) = delete;
+
+	size_t GetClusterCount() const { return m_clusterRecords.size(); }
+
+	// Ограничивающий параллелепипед кластера (в системе координат сетки)
+	CBoundingBox const& GetClusterBounds(size_t clusterIndex) const { return m_clusterBounds[clusterIndex]; }
+
+	// Ограничивающий параллелепипед сетки (в системе координат сетки)
+	CBoundingBox const& GetBounds() const { return m_bounds; }
+
+	unsigned long long GetTriangleCount() const { return m_triangleCount; }
+
+	/*
+		Возвращает кластер, при необходимости загружая его из файла.
+		Если кластер одновременно запрашивают несколько потоков, загружает его только первый из них
+	*/
+	std::shared_ptr<Cluster const> GetCluster(size_t clusterIndex) const;
+
+	// Ограничение объема памяти загруженных кластеров (0 - без ограничения)
+	void SetMemoryBudget(size_t budget);
+
+	ClusterCacheStatistics GetStatistics() const;
+	// Сбрасывает счетчики обращений (кластеры остаются в памяти)
+	void ResetStatistics();
+
+private:
+	using ClusterPtr = std::shared_ptr<Cluster const>;
+
+	struct CacheEntry
+	{
+		// Результат загрузки (доступен после того, как загружающий поток прочитает кластер)
+		std::shared_future<ClusterPtr> cluster;
+		// Объем памяти кластера (0, пока кластер загружается)
+		size_t memoryUsage = 0;
+		// Положение в списке m_lruList
+		std::list<size_t>::iterator lruPosition;
+		bool isResident = false;
+	};
+
+	ClusterPtr LoadCluster(size_t clusterIndex) const;
+
+	// Выгружает давно не использовавшиеся кластеры, пока объем памяти превышает ограничение. Вызывается под блокировкой
+	void EvictLocked() const;
+
+private:
+	std::string m_fileName;
+	boost::interprocess::file_mapping m_file;
+	boost::interprocess::mapped_region m_region;
+
+	std::vector<ClusterRecord> m_clusterRecords;
+	std::vector<CBoundingBox> m_clusterBounds;
+	CBoundingBox m_bounds;
+	unsigned long long m_triangleCount = 0;
+
+	mutable std::mutex m_mutex;
+	mutable std::vector<CacheEntry> m_cacheEntries;
+	// Номера загруженных кластеров, начиная с использованного последним
+	mutable std::list<size_t> m_lruList;
+	mutable ClusterCacheStatistics m_statistics;
+	size_t m_memoryBudget;
+};
@@ -0,0 +1,294 @@
+﻿#include <algorithm>
+#include <array>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include "ClusteredMeshFile.h"
+
+namespace
+{
+// Максимальное количество треугольников в листе BVH
+constexpr std::uint32_t MAX_LEAF_TRIANGLES = 4;
+
+constexpr std::uint32_t NO_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+using Point = std::array<float, 3>;
+
+// Ограничивающий параллелепипед с координатами одинарной точности
+struct FloatBounds
+{
+	Point min = { std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+	Point max = { -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+
+	void Extend(const float* point)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			min[axis] = std::min(min[axis], point[axis]);
+			max[axis] = std::max(max[axis], point[axis]);
+		}
+	}
+
+	int GetLongestAxis() const
+	{
+		const Point size = { max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+		return (size[0] >= size[1] && size[0] >= size[2]) ? 0 : (size[1] >= size[2] ? 1 : 2);
+	}
+};
+
+/*
+	Делит диапазон индексов треугольников пополам по медиане их центров вдоль оси наибольшей протяженности
+	центров. Возвращает указатель на начало второй половины
+*/
+std::uint32_t* SplitAtMedian(std::uint32_t* begin, std::uint32_t* end, std::vector<Point> const& centroids)
+{
+	FloatBounds centroidBounds;
+	for (const std::uint32_t* p = begin; p != end; ++p)
+	{
+		centroidBounds.Extend(centroids[*p].data());
+	}
+	const int axis = centroidBounds.GetLongestAxis();
+
+	std::uint32_t* middle = begin + (end - begin) / 2;
+	std::nth_element(begin, middle, end, [&](std::uint32_t a, std::uint32_t b) {
+		return centroids[a][axis] < centroids[b][axis];
+	});
+	return middle;
+}
+
+struct ClusterData
+{
+	std::vector<ClusterVertex> vertices;
+	std::vector<ClusterTriangle> triangles;
+	std::vector<ClusterNode> nodes;
+	FloatBounds bounds;
+};
+
+class ClusterBuilder
+{
+public:
+	ClusterBuilder(std::vector<Vertex> const& vertices, std::vector<Face> const& faces)
+		: m_vertices(vertices)
+		, m_faces(faces)
+		, m_localIndices(vertices.size(), NO_INDEX)
+	{
+	}
+
+	// Строит кластер из треугольников сетки с заданными индексами
+	void Build(const std::uint32_t* begin, const std::uint32_t* end, ClusterData& cluster)
+	{
+		cluster.vertices.clear();
+		cluster.triangles.clear();
+		cluster.nodes.clear();
+		cluster.bounds = FloatBounds();
+		m_usedVertices.clear();
+
+		// Вершины кластера нумеруются заново в порядке первого обращения к ним
+		std::vector<ClusterTriangle> triangles;
+		triangles.reserve(size_t(end - begin));
+		for (const std::uint32_t* p = begin; p != end; ++p)
+		{
+			Face const& face = m_faces[*p];
+			triangles.push_back({ GetLocalIndex(face.vertex0, cluster), GetLocalIndex(face.vertex1, cluster),
+				GetLocalIndex(face.vertex2, cluster), face.isFlat ? 1u : 0u });
+		}
+		for (std::uint32_t vertexIndex : m_usedVertices)
+		{
+			m_localIndices[vertexIndex] = NO_INDEX;
+		}
+
+		// Центры треугольников, по которым строится BVH
+		std::vector<Point> centroids(triangles.size());
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			ClusterTriangle const& triangle = triangles[i];
+			const float* p0 = cluster.vertices[triangle.vertex0].position;
+			const float* p1 = cluster.vertices[triangle.vertex1].position;
+			const float* p2 = cluster.vertices[triangle.vertex2].position;
+			centroids[i] = { (p0[0] + p1[0] + p2[0]) / 3, (p0[1] + p1[1] + p2[1]) / 3, (p0[2] + p1[2] + p2[2]) / 3 };
+		}
+
+		std::vector<std::uint32_t> order(triangles.size());
+		std::iota(order.begin(), order.end(), 0u);
+		BuildNode(triangles, cluster, centroids, order.data(), order.data(), order.data() + order.size());
+
+		// Треугольники сохраняются в порядке листьев BVH
+		cluster.triangles.reserve(triangles.size());
+		for (std::uint32_t triangleIndex : order)
+		{
+			cluster.triangles.push_back(triangles[triangleIndex]);
+		}
+	}
+
+private:
+	std::uint32_t GetLocalIndex(unsigned vertexIndex, ClusterData& cluster)
+	{
+		if (vertexIndex >= m_vertices.size())
+		{
+			throw std::runtime_error("Face refers to a missing vertex");
+		}
+
+		std::uint32_t& localIndex = m_localIndices[vertexIndex];
+		if (localIndex == NO_INDEX)
+		{
+			Vertex const& vertex = m_vertices[vertexIndex];
+			localIndex = std::uint32_t(cluster.vertices.size());
+			m_usedVertices.push_back(vertexIndex);
+
+			ClusterVertex const clusterVertex = {
+				{ float(vertex.position.x), float(vertex.position.y), float(vertex.position.z) },
+				{ float(vertex.normal.x), float(vertex.normal.y), float(vertex.normal.z) },
+			};
+			cluster.vertices.push_back(clusterVertex);
+			cluster.bounds.Extend(clusterVertex.position);
+		}
+		return localIndex;
+	}
+
+	// Добавляет узел BVH для треугольников [begin; end) и рекурсивно строит его потомков
+	void BuildNode(std::vector<ClusterTriangle> const& triangles, ClusterData& cluster, std::vector<Point> const& centroids,
+		std::uint32_t* first, std::uint32_t* begin, std::uint32_t* end)
+	{
+		FloatBounds bounds;
+		for (const std::uint32_t* p = begin; p != end; ++p)
+		{
+			ClusterTriangle const& triangle = triangles[*p];
+			bounds.Extend(cluster.vertices[triangle.vertex0].position);
+			bounds.Extend(cluster.vertices[triangle.vertex1].position);
+			bounds.Extend(cluster.vertices[triangle.vertex2].position);
+		}
+
+		const size_t nodeIndex = cluster.nodes.size();
+		ClusterNode node = {};
+		std::copy(bounds.min.begin(), bounds.min.end(), node.boundsMin);
+		std::copy(bounds.max.begin(), bounds.max.end(), node.boundsMax);
+		cluster.nodes.push_back(node);
+
+		const std::uint32_t triangleCount = std::uint32_t(end - begin);
+		if (triangleCount <= MAX_LEAF_TRIANGLES)
+		{
+			cluster.nodes[nodeIndex].firstOrRightChild = std::uint32_t(begin - first);
+			cluster.nodes[nodeIndex].triangleCount = triangleCount;
+			return;
+		}
+
+		std::uint32_t* middle = SplitAtMedian(begin, end, centroids);
+		BuildNode(triangles, cluster, centroids, first, begin, middle);
+		cluster.nodes[nodeIndex].firstOrRightChild = std::uint32_t(cluster.nodes.size());
+		BuildNode(triangles, cluster, centroids, first, middle, end);
+	}
+
+private:
+	std::vector<Vertex> const& m_vertices;
+	std::vector<Face> const& m_faces;
+	// Индексы вершин сетки в строящемся кластере
+	std::vector<std::uint32_t> m_localIndices;
+	// Вершины сетки, вошедшие в строящийся кластер
+	std::vector<std::uint32_t> m_usedVertices;
+};
+
+template <typename T>
+void WriteValues(std::ostream& output, T const* values, size_t count)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	output.write(reinterpret_cast<const char*>(values), std::streamsize(count * sizeof(T)));
+}
+} // namespace
+
+void ClusteredMeshFile::Write(std::vector<Vertex> const& vertices, std::vector<Face> const& faces, std::string const& fileName,
+	unsigned maxClusterTriangles)
+{
+	if (faces.empty())
+	{
+		throw std::runtime_error("Mesh has no triangles");
+	}
+	maxClusterTriangles = std::max(maxClusterTriangles, MAX_LEAF_TRIANGLES);
+
+	// Центры треугольников сетки
+	std::vector<Point> centroids(faces.size());
+	for (size_t i = 0; i < faces.size(); ++i)
+	{
+		Face const& face = faces[i];
+		if (face.vertex0 >= vertices.size() || face.vertex1 >= vertices.size() || face.vertex2 >= vertices.size())
+		{
+			throw std::runtime_error("Face refers to a missing vertex");
+		}
+		CVector3d const centroid = (vertices[face.vertex0].position + vertices[face.vertex1].position + vertices[face.vertex2].position) / 3.0;
+		centroids[i] = { float(centroid.x), float(centroid.y), float(centroid.z) };
+	}
+
+	// Разбиваем треугольники на кластеры делением пополам, пока кластеры не станут достаточно малы
+	std::vector<std::uint32_t> order(faces.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::vector<std::pair<std::uint32_t*, std::uint32_t*>> clusterRanges;
+	std::vector<std::pair<std::uint32_t*, std::uint32_t*>> pendingRanges = { { order.data(), order.data() + order.size() } };
+	while (!pendingRanges.empty())
+	{
+		const auto [begin, end] = pendingRanges.back();
+		pendingRanges.pop_back();
+		if (size_t(end - begin) <= maxClusterTriangles)
+		{
+			clusterRanges.emplace_back(begin, end);
+			continue;
+		}
+		std::uint32_t* middle = SplitAtMedian(begin, end, centroids);
+		pendingRanges.emplace_back(middle, end);
+		pendingRanges.emplace_back(begin, middle);
+	}
+
+	std::ofstream output(fileName, std::ios::binary);
+	if (!output)
+	{
+		throw std::runtime_error("Failed to open " + fileName + " for writing");
+	}
+
+	// Заголовок и таблица кластеров записываются после данных кластеров, а пока резервируем под них место
+	ClusteredMeshFileHeader header = {};
+	std::copy(std::begin(SIGNATURE), std::end(SIGNATURE), header.signature);
+	header.version = VERSION;
+	header.clusterCount = std::uint32_t(clusterRanges.size());
+	header.triangleCount = faces.size();
+	std::vector<ClusterRecord> records(clusterRanges.size());
+	WriteValues(output, &header, 1);
+	WriteValues(output, records.data(), records.size());
+
+	std::uint64_t offset = sizeof(header) + records.size() * sizeof(ClusterRecord);
+	FloatBounds meshBounds;
+	ClusterBuilder builder(vertices, faces);
+	ClusterData cluster;
+	for (size_t i = 0; i < clusterRanges.size(); ++i)
+	{
+		builder.Build(clusterRanges[i].first, clusterRanges[i].second, cluster);
+
+		ClusterRecord& record = records[i];
+		std::copy(cluster.bounds.min.begin(), cluster.bounds.min.end(), record.boundsMin);
+		std::copy(cluster.bounds.max.begin(), cluster.bounds.max.end(), record.boundsMax);
+		record.offset = offset;
+		record.vertexCount = std::uint32_t(cluster.vertices.size());
+		record.triangleCount = std::uint32_t(cluster.triangles.size());
+		record.nodeCount = std::uint32_t(cluster.nodes.size());
+
+		WriteValues(output, cluster.vertices.data(), cluster.vertices.size());
+		WriteValues(output, cluster.triangles.data(), cluster.triangles.size());
+		WriteValues(output, cluster.nodes.data(), cluster.nodes.size());
+		offset += cluster.vertices.size() * sizeof(ClusterVertex) + cluster.triangles.size() * sizeof(ClusterTriangle)
+			+ cluster.nodes.size() * sizeof(ClusterNode);
+
+		header.vertexCount += cluster.vertices.size();
+		meshBounds.Extend(cluster.bounds.min.data());
+		meshBounds.Extend(cluster.bounds.max.data());
+	}
+
+	std::copy(meshBounds.min.begin(), meshBounds.min.end(), header.boundsMin);
+	std::copy(meshBounds.max.begin(), meshBounds.max.end(), header.boundsMax);
+	output.seekp(0);
+	WriteValues(output, &header, 1);
+	WriteValues(output, records.data(), records.size());
+
+	output.flush();
+	if (!output)
+	{
+		throw std::runtime_error("Failed to write " + fileName);
+	}
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../TriangleMesh/TriangleMesh.h"
+
+/*
+	Файл кластеризованной полигональной сетки (.rtcm) для сеток, не помещающихся в оперативную память.
+
+	Треугольники сетки разбиваются на пространственные кластеры, каждый из которых хранит собственные
+	вершины, треугольники и иерархию ограничивающих объемов (BVH) и может быть загружен независимо
+	от остальных (см. ClusteredMeshData). Файл состоит из заголовка, таблицы кластеров и данных кластеров:
+		ClusteredMeshFileHeader
+		ClusterRecord[clusterCount]
+		для каждого кластера (со смещения ClusterRecord::offset):
+			ClusterVertex[vertexCount]
+			ClusterTriangle[triangleCount]
+			ClusterNode[nodeCount]
+	Все значения хранятся в порядке байтов little-endian
+*/
+
+struct ClusteredMeshFileHeader
+{
+	char signature[4];
+	std::uint32_t version;
+	std::uint32_t clusterCount;
+	std::uint32_t reserved;
+	std::uint64_t triangleCount;
+	// Суммарное количество вершин кластеров (вершины на границах кластеров повторяются)
+	std::uint64_t vertexCount;
+	double boundsMin[3];
+	double boundsMax[3];
+};
+static_assert(sizeof(ClusteredMeshFileHeader) == 80);
+
+struct ClusterRecord
+{
+	double boundsMin[3];
+	double boundsMax[3];
+	// Смещение данных кластера от начала файла
+	std::uint64_t offset;
+	std::uint32_t vertexCount;
+	std::uint32_t triangleCount;
+	std::uint32_t nodeCount;
+	std::uint32_t reserved;
+};
+static_assert(sizeof(ClusterRecord) == 72);
+
+struct ClusterVertex
+{
+	float position[3];
+	float normal[3];
+};
+static_assert(sizeof(ClusterVertex) == 24);
+
+struct ClusterTriangle
+{
+	// Индексы вершин в массиве вершин кластера
+	std::uint32_t vertex0, vertex1, vertex2;
+	// Является ли грань плоской (1 - да, 0 - нет)
+	std::uint32_t isFlat;
+};
+static_assert(sizeof(ClusterTriangle) == 16);
+
+/*
+	Узел BVH кластера. Узлы хранятся в порядке обхода в глубину: левый потомок внутреннего узла
+	следует сразу за ним, а индекс правого задан полем firstOrRightChild.
+	У листа (triangleCount > 0) firstOrRightChild - индекс первого из его треугольников
+*/
+struct ClusterNode
+{
+	float boundsMin[3];
+	float boundsMax[3];
+	std::uint32_t firstOrRightChild;
+	std::uint32_t triangleCount;
+};
+static_assert(sizeof(ClusterNode) == 32);
+
+class ClusteredMeshFile
+{
+public:
+	static constexpr char SIGNATURE[4] = { 'R', 'T', 'C', 'M' };
+	static constexpr std::uint32_t VERSION = 1;
+
+	// Количество треугольников в кластере по умолчанию
+	static constexpr unsigned DEFAULT_CLUSTER_TRIANGLES = 1u << 14;
+
+	/*
+		Разбивает сетку на кластеры не более чем по maxClusterTriangles треугольников
+		и сохраняет ее в файл fileName. Координаты и нормали вершин сохраняются с одинарной точностью.
+		При ошибке записи выбрасывает исключение std::runtime_error
+	*/
+	static void Write(std::vector<Vertex> const& vertices, std::vector<Face> const& faces, std::string const& fileName,
+		unsigned maxClusterTriangles = DEFAULT_CLUSTER_TRIANGLES);
+};
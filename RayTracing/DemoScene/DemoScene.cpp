@@ -0,0 +1,316 @@
+﻿#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+#include "DemoScene.h"
+#include "../GeometryObjects/Cube/Cube.h"
+#include "../GeometryObjects/Dodecahedron/Dodecahedron.h"
+#include "../GeometryObjects/HyperbolicParaboloid/HyperbolicParaboloid.h"
+#include "../GeometryObjects/Icosahedron/Icosahedron.h"
+#include "../GeometryObjects/Octahedron/Octahedron.h"
+#include "../GeometryObjects/Plane/Plane.h"
+#include "../GeometryObjects/Tetrahedron/Tetrahedron.h"
+#include "../LightSource/OmniLightSource.h"
+#include "../Material/ComplexMaterial.h"
+#include "../SceneObject/SceneObject.h"
+#include "../ViewPort/ViewPort.h"
+
+DemoScene::DemoScene(unsigned width, unsigned height)
+{
+	/*
+	Задаем цвет заднего фона сцены
+	*/
+	m_scene.SetBackdropColor(CVector4f(0, 0, 1, 1));
+
+	AddSomePlane();
+	AddSomeLight();
+
+	AddSomeHyperbolicParaboloid();
+	AddSomeCubes();
+	AddSomeTetrahedron();
+	AddSomeOctahedron();
+	AddSomeDodecahedron();
+	AddSomeIcosahedron();
+
+	/*
+		Задаем параметры видового порта и матрицы проецирования в контексте визуализации
+	*/
+	m_context.SetViewPort(CViewPort(0, 0, width, height));
+	CMatrix4d proj;
+	proj.LoadPerspective(75, double(width) / double(height), 0.1, 10);
+	m_context.SetProjectionMatrix(proj);
+
+	// Задаем матрицу камеры
+	CMatrix4d modelView;
+	modelView.LoadLookAtRH(
+		1, 1, 5,
+		0, 0, 0,
+		0, 1, 0);
+	m_context.SetModelViewMatrix(modelView);
+}
+
+CScene& DemoScene::GetScene()
+{
+	return m_scene;
+}
+
+CScene const& DemoScene::GetScene() const
+{
+	return m_scene;
+}
+
+CRenderContext& DemoScene::GetContext()
+{
+	return m_context;
+}
+
+CRenderContext const& DemoScene::GetContext() const
+{
+	return m_context;
+}
+
+IGeometryObject& DemoScene::GetMovableObject()
+{
+	assert(m_pMovableObject);
+	return *m_pMovableObject;
+}
+
+DemoSceneState DemoScene::GetState() const
+{
+	assert(m_pMovableObject);
+
+	DemoSceneState state;
+	state.modelViewMatrix = m_context.GetModelViewMatrix();
+	state.movableObjectTransform = m_pMovableObject->GetTransform();
+	for (size_t i = 0; i < m_scene.GetLightsCount(); ++i)
+	{
+		state.lightTransforms.push_back(m_scene.GetLight(i).GetTransform());
+	}
+	return state;
+}
+
+void DemoScene::SetState(DemoSceneState const& state)
+{
+	assert(m_pMovableObject);
+
+	// Изменения регистрируются только для действительно изменившихся объектов и источников света,
+	// чтобы не расширять область перестроения изображения
+	auto transformChanged = [](CMatrix4d const& oldTransform, CMatrix4d const& newTransform) {
+		return !std::equal(std::begin(oldTransform.data), std::end(oldTransform.data), std::begin(newTransform.data));
+	};
+
+	m_context.SetModelViewMatrix(state.modelViewMatrix);
+	if (transformChanged(m_pMovableObject->GetTransform(), state.movableObjectTransform))
+	{
+		m_scene.SetObjectTransform(*m_pMovableObject, state.movableObjectTransform);
+	}
+	for (size_t i = 0; i < std::min(state.lightTransforms.size(), m_scene.GetLightsCount()); ++i)
+	{
+		if (transformChanged(std::as_const(m_scene).GetLight(i).GetTransform(), state.lightTransforms[i]))
+		{
+			m_scene.SetLightTransform(i, state.lightTransforms[i]);
+		}
+	}
+}
+
+void DemoScene::AddSomePlane()
+{
+	/*
+		Матрица трансформации плоскости
+	*/
+	CMatrix4d planeTransform;
+	planeTransform.Translate(0, -2, -3);
+
+	/*
+		Материал плоскости
+	*/
+	ComplexMaterial planeMaterial;
+	planeMaterial.SetDiffuseColor(CVector4f(0, 0, 1, 1));
+	planeMaterial.SetSpecularColor(CVector4f(1, 1, 1, 1));
+	planeMaterial.SetAmbientColor(CVector4f(0.0f, 0.2f, 0.2f, 1));
+
+	AddPlane(CreatePhongShader(planeMaterial), 0, 1, 0, 0, planeTransform);
+}
+
+void DemoScene::AddSomeLight()
+{
+	COmniLightPtr pLightFront(new COmniLightSource(CVector3d(0.f, 5.0, 10.f)));
+	pLightFront->SetDiffuseIntensity(CVector4f(1, 1, 1, 1));
+	pLightFront->SetSpecularIntensity(CVector4f(1, 1, 1, 1));
+	pLightFront->SetAmbientIntensity(CVector4f(1, 1, 1, 1));
+	m_scene.AddLightSource(pLightFront);
+}
+
+void DemoScene::AddSomeCubes()
+{
+	// Матрица трансформации куба
+	CMatrix4d cubeTransform;
+	cubeTransform.Translate(-4, -0.5f, 0);
+	cubeTransform.Scale(1, 1, 1);
+	cubeTransform.Rotate(30, 0, 1, 0);
+	cubeTransform.Rotate(-15, 1, 0, 0);
+
+	//Материал куба
+	ComplexMaterial cubeMaterial;
+	cubeMaterial.SetDiffuseColor(CVector4f(1, 0, 0, 1));
+	cubeMaterial.SetSpecularColor(CVector4f(1, 1, 1, 1));
+	cubeMaterial.SetAmbientColor(CVector4f(0.2f, 0.2f, 0.2f, 1));
+	cubeMaterial.SetSpecularCoefficient(2048);
+
+	// Создаю PhongShader на основе материала, начальный размер = 1, центр и матрица трансформации
+	AddCube(CreatePhongShader(cubeMaterial), 1, CVector3d(0, 0, 0), cubeTransform);
+	m_pMovableObject = m_geometryObjects.back().get();
+}
+
+void DemoScene::AddSomeTetrahedron()
+{
+	CMatrix4d transform;
+	transform.Translate(3, 0.5f, -1);
+	transform.Rotate(170, 0, 1, 0);
+	CSimpleMaterial blue;
+	blue.SetDiffuseColor(CVector4f(0.5f, 0.8f, 1, 1));
+
+	AddTetrahedron(CreateSimpleDiffuseShader(blue), transform);
+}
+
+void DemoScene::AddSomeOctahedron()
+{
+	CMatrix4d transform;
+	transform.Translate(-3, 2, -5);
+	transform.Scale(2, 2, 2);
+	CSimpleMaterial violet;
+	violet.SetDiffuseColor(CVector4f(0.8f, 0.0f, 0.8f, 1));
+
+	AddOctahedron(CreateSimpleDiffuseShader(violet), transform);
+}
+
+void DemoScene::AddSomeDodecahedron()
+{
+	CMatrix4d transform;
+	transform.Translate(-2.5, -1, -3);
+	transform.Rotate(75, 0, 1, 1);
+
+	//Материал додекадра
+	ComplexMaterial material;
+	material.SetDiffuseColor(CVector4f(1, 0, 0, 1));
+	material.SetSpecularColor(CVector4f(1, 1, 1, 1));
+	material.SetAmbientColor(CVector4f(0.2f, 0.2f, 0.2f, 1));
+	material.SetSpecularCoefficient(2048);
+
+	AddDodecahedron(CreatePhongShader(material), transform);
+}
+
+void DemoScene::AddSomeIcosahedron()
+{
+	CMatrix4d transform;
+	transform.Translate(3, 0, 1);
+	transform.Rotate(20, 0, 1, 1);
+
+	//Материал икосаэдра
+	ComplexMaterial material;
+	material.SetDiffuseColor(CVector4f(0.5f, 0.2f, 0.9f, 1));
+	material.SetSpecularColor(CVector4f(1, 1, 1, 1));
+	material.SetAmbientColor(CVector4f(0.2f, 0.2f, 0.2f, 1));
+	material.SetSpecularCoefficient(2048);
+
+	AddIcosahedron(CreatePhongShader(material), transform);
+}
+
+void DemoScene::AddSomeHyperbolicParaboloid()
+{
+	CMatrix4d transform;
+	transform.Rotate(-25, 0, 1, 0);
+	transform.Translate(1, -1, 0);
+	transform.Scale(0.7f, 0.7f, 0.7f);
+
+	// Материал гиперболического параболоида
+	ComplexMaterial material;
+	material.SetDiffuseColor(CVector4f(1, 0.4f, 0.6f, 1));
+	material.SetSpecularColor(CVector4f(1, 1, 1, 1));
+	material.SetAmbientColor(CVector4f(0.2f, 0.2f, 0.2f, 1));
+	material.SetSpecularCoefficient(256);
+
+	AddHyperbolicParaboloid(CreatePhongShader(material), transform);
+}
+
+
+CSimpleDiffuseShader& DemoScene::CreateSimpleDiffuseShader(CSimpleMaterial const& material)
+{
+	auto shader = std::make_unique<CSimpleDiffuseShader>(material);
+	auto& shaderRef = *shader;
+	m_shaders.emplace_back(std::move(shader));
+	return shaderRef;
+}
+
+PhongShader& DemoScene::CreatePhongShader(const ComplexMaterial& material)
+{
+	auto shader = std::make_unique<PhongShader>(material);
+	auto& shaderRef = *shader;
+	m_shaders.emplace_back(std::move(shader));
+	return shaderRef;
+}
+
+CSceneObject& DemoScene::AddPlane(IShader const& shader, double a, double b, double c, double d, CMatrix4d const& transform)
+{
+	const auto& plane = *m_geometryObjects.emplace_back(
+		std::make_unique<CPlane>(a, b, c, d, transform));
+
+	return AddSceneObject(plane, shader);
+}
+
+CSceneObject& DemoScene::AddSceneObject(IGeometryObject const& object, IShader const& shader)
+{
+	auto obj = std::make_shared<CSceneObject>(object, shader);
+	m_scene.AddObject(obj);
+
+	return *obj;
+}
+
+CSceneObject& DemoScene::AddCube(IShader const& shader, double size, CVector3d const& center, CMatrix4d const& transform)
+{
+	const auto& cube = *m_geometryObjects.emplace_back(
+		std::make_unique<Cube>(size, center, transform));
+
+	return AddSceneObject(cube, shader);
+}
+
+CSceneObject& DemoScene::AddTetrahedron(IShader const& shader, CMatrix4d const& transform)
+{
+	const auto& tetrahedron = *m_geometryObjects.emplace_back(
+		std::make_unique<Tetrahedron>(transform));
+
+	return AddSceneObject(tetrahedron, shader);
+}
+
+CSceneObject& DemoScene::AddOctahedron(IShader const& shader, CMatrix4d const& transform)
+{
+	const auto& octahedron = *m_geometryObjects.emplace_back(
+		std::make_unique<Octahedron>(transform));
+
+	return AddSceneObject(octahedron, shader);
+}
+
+CSceneObject& DemoScene::AddDodecahedron(IShader const& shader, CMatrix4d const& transform)
+{
+	const auto& dodecahedron = *m_geometryObjects.emplace_back(
+		std::make_unique<Dodecahedron>(transform));
+
+	return AddSceneObject(dodecahedron, shader);
+}
+
+CSceneObject& DemoScene::AddIcosahedron(IShader const& shader, CMatrix4d const& transform)
+{
+	const auto& icosahedron = *m_geometryObjects.emplace_back(
+		std::make_unique<Icosahedron>(transform));
+
+	return AddSceneObject(icosahedron, shader);
+}
+
+CSceneObject& DemoScene::AddHyperbolicParaboloid(IShader const& shader, CMatrix4d const& transform)
+{
+	const auto& hyperbolicParaboloid = *m_geometryObjects.emplace_back(
+		std::make_unique<HyperbolicParaboloid>(transform));
+
+	return AddSceneObject(hyperbolicParaboloid, shader);
+}
+
@@ -0,0 +1,94 @@
+﻿#pragma once
+#include <memory>
+#include <vector>
+#include "../GeometryObject/IGeometryObject.h"
+#include "../Matrix/Matrix4.h"
+#include "../RenderContext/RenderContext.h"
+#include "../Scene/Scene.h"
+#include "../Shader/PhongShader.h"
+#include "../Shader/SimpleDiffuseShader.h"
+
+class CSceneObject;
+
+/*
+	Изменяемые параметры демонстрационной сцены. Позволяют воспроизвести состояние сцены
+	в другом процессе или на другом узле, где сцена построена тем же конструктором DemoScene
+*/
+struct DemoSceneState
+{
+	// Матрица камеры
+	CMatrix4d modelViewMatrix;
+	// Матрица трансформации объекта, перемещаемого с клавиатуры
+	CMatrix4d movableObjectTransform;
+	// Матрицы трансформации источников света
+	std::vector<CMatrix4d> lightTransforms;
+};
+
+/*
+	Демонстрационная сцена: геометрические объекты, шейдеры, источники света и параметры камеры.
+	Не зависит от SDL, поэтому используется как окном приложения, так и процессами,
+	выполняющими построение изображения без вывода на экран
+*/
+class DemoScene
+{
+public:
+	// Строит сцену и настраивает камеру для буфера кадра заданного размера
+	DemoScene(unsigned width, unsigned height);
+
+	DemoScene(DemoScene const&) = delete;
+	DemoScene& operator=(DemoScene const&) = delete;
+
+	CScene& GetScene();
+	CScene const& GetScene() const;
+
+	CRenderContext& GetContext();
+	CRenderContext const& GetContext() const;
+
+	// Объект, перемещаемый с клавиатуры
+	IGeometryObject& GetMovableObject();
+
+	// Текущее состояние изменяемых параметров сцены
+	DemoSceneState GetState() const;
+
+	/*
+		Применяет состояние изменяемых параметров сцены. Изменения объектов и источников света
+		регистрируются в сцене так же, как изменения, выполненные с клавиатуры
+	*/
+	void SetState(DemoSceneState const& state);
+
+private:
+	void AddSomePlane();
+	void AddSomeLight();
+	void AddSomeCubes();
+	void AddSomeTetrahedron();
+	void AddSomeOctahedron();
+	void AddSomeDodecahedron();
+	void AddSomeIcosahedron();
+	void AddSomeHyperbolicParaboloid();
+
+	// Методы создания и добавления шейдеров в коллекцию m_shaders
+	CSimpleDiffuseShader& CreateSimpleDiffuseShader(CSimpleMaterial const& material);
+	PhongShader& CreatePhongShader(const ComplexMaterial& material);
+
+	// Методы, создающие и добавляющие объекты к сцене
+	CSceneObject& AddPlane(IShader const& shader, double a, double b, double c, double d, CMatrix4d const& transform = CMatrix4d());
+	CSceneObject& AddSceneObject(IGeometryObject const& object, IShader const& shader);
+	CSceneObject& AddCube(IShader const& shader, double size, CVector3d const& center = CVector3d(), CMatrix4d const& transform = CMatrix4d());
+	CSceneObject& AddTetrahedron(IShader const& shader, CMatrix4d const& transform = CMatrix4d());
+	CSceneObject& AddOctahedron(IShader const& shader, CMatrix4d const& transform = CMatrix4d());
+	CSceneObject& AddDodecahedron(IShader const& shader, CMatrix4d const& transform = CMatrix4d());
+	CSceneObject& AddIcosahedron(IShader const& shader, CMatrix4d const& transform = CMatrix4d());
+	CSceneObject& AddHyperbolicParaboloid(IShader const& shader, CMatrix4d const& transform = CMatrix4d());
+
+private:
+	// Сцена
+	CScene m_scene;
+	// Контекст
+	CRenderContext m_context;
+
+	// Объект, перемещаемый с клавиатуры
+	IGeometryObject* m_pMovableObject = nullptr;
+
+	std::vector<std::unique_ptr<IGeometryObject>> m_geometryObjects;
+	std::vector<std::unique_ptr<IShader>> m_shaders;
+};
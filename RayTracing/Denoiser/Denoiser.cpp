@@ -0,0 +1,206 @@
+﻿#include "Denoiser.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include "../RenderContext/RenderContext.h"
+#include "../Vector/SimdFloat4.h"
+
+namespace
+{
+// Коэффициенты одномерного B3-сплайнового ядра
+constexpr float KERNEL[3] = { 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+// Минимальное альбедо, на которое делится цвет. Черные поверхности фильтруются по самому цвету
+constexpr float MIN_ALBEDO = 1e-3f;
+
+// Не дает допустимой разнице глубин обратиться в ноль у пикселей без поверхности (с нулевой глубиной)
+constexpr float MIN_DEPTH_TOLERANCE = 1e-4f;
+
+float GetDemodulationAlbedo(float albedo)
+{
+	return (albedo < MIN_ALBEDO) ? 1.0f : albedo;
+}
+} // namespace
+
+void Denoiser::SetSettings(DenoiserSettings const& settings)
+{
+	m_settings = settings;
+	m_settings.iterations = std::min(m_settings.iterations, MAX_ITERATIONS);
+}
+
+DenoiserSettings const& Denoiser::GetSettings() const noexcept
+{
+	return m_settings;
+}
+
+void Denoiser::Denoise(AccumulationBuffer const& accumulationBuffer, FrameBuffer& frameBuffer)
+{
+	assert(accumulationBuffer.GetWidth() == frameBuffer.GetWidth());
+	assert(accumulationBuffer.GetHeight() == frameBuffer.GetHeight());
+
+	PrepareInput(accumulationBuffer);
+
+	unsigned source = 0;
+	float colorSigma = m_settings.colorSigma;
+	for (unsigned iteration = 0; iteration < m_settings.iterations; ++iteration)
+	{
+		FilterIteration(1u << iteration, colorSigma, source, source ^ 1);
+		source ^= 1;
+		colorSigma *= 0.5f;
+	}
+
+	// Возвращаем отфильтрованной освещенности цвет поверхностей
+	std::vector<float> const* illumination = m_illumination[source];
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int y = 0; y < int(m_height); ++y)
+	{
+		std::uint32_t* rowPixels = frameBuffer.GetPixels(unsigned(y));
+		for (unsigned x = 0; x < m_width; ++x)
+		{
+			CVector4f color = accumulationBuffer.GetAverage(x, unsigned(y));
+			if (accumulationBuffer.GetSampleCount(x, unsigned(y)) != 0)
+			{
+				CVector4f const albedo = accumulationBuffer.GetAverageFeatures(x, unsigned(y)).albedo;
+				const size_t index = GetIndex(x, unsigned(y));
+				color.x = illumination[0][index] * GetDemodulationAlbedo(albedo.x);
+				color.y = illumination[1][index] * GetDemodulationAlbedo(albedo.y);
+				color.z = illumination[2][index] * GetDemodulationAlbedo(albedo.z);
+			}
+			rowPixels[x] = CRenderContext::ToPixelColor(color);
+		}
+	}
+}
+
+void Denoiser::PrepareInput(AccumulationBuffer const& accumulationBuffer)
+{
+	const unsigned width = accumulationBuffer.GetWidth();
+	const unsigned height = accumulationBuffer.GetHeight();
+	const unsigned padding = std::max(2u << (std::max(m_settings.iterations, 1u) - 1), 4u);
+	if (width != m_width || height != m_height || padding != m_padding)
+	{
+		m_width = width;
+		m_height = height;
+		m_padding = padding;
+		// Пакеты из 4 пикселей последней группы строки могут выходить за ширину изображения
+		m_stride = ((size_t(width) + 3) & ~size_t(3)) + 2 * size_t(padding);
+
+		// Поля заполняются нулями один раз и в дальнейшем не изменяются
+		const size_t size = m_stride * (size_t(height) + 2 * size_t(padding));
+		for (auto& planes : m_illumination)
+		{
+			for (auto& plane : planes)
+			{
+				plane.assign(size, 0.0f);
+			}
+		}
+		for (auto& plane : m_normal)
+		{
+			plane.assign(size, 0.0f);
+		}
+		m_depth.assign(size, 0.0f);
+		m_valid.assign(size, 0.0f);
+	}
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int y = 0; y < int(height); ++y)
+	{
+		for (unsigned x = 0; x < width; ++x)
+		{
+			const size_t index = GetIndex(x, unsigned(y));
+			const CVector4f color = accumulationBuffer.GetAverage(x, unsigned(y));
+			const PixelFeatures features = accumulationBuffer.GetAverageFeatures(x, unsigned(y));
+
+			m_illumination[0][0][index] = color.x / GetDemodulationAlbedo(features.albedo.x);
+			m_illumination[0][1][index] = color.y / GetDemodulationAlbedo(features.albedo.y);
+			m_illumination[0][2][index] = color.z / GetDemodulationAlbedo(features.albedo.z);
+			m_normal[0][index] = float(features.normal.x);
+			m_normal[1][index] = float(features.normal.y);
+			m_normal[2][index] = float(features.normal.z);
+			m_depth[index] = float(features.depth);
+			m_valid[index] = (accumulationBuffer.GetSampleCount(x, unsigned(y)) != 0) ? 1.0f : 0.0f;
+		}
+	}
+}
+
+void Denoiser::FilterIteration(unsigned step, float colorSigma, unsigned source, unsigned target)
+{
+	std::vector<float> const* input = m_illumination[source];
+	std::vector<float>* output = m_illumination[target];
+
+	const SimdFloat4 colorScale(1.0f / (colorSigma * colorSigma));
+	const SimdFloat4 normalScale(1.0f / (m_settings.normalSigma * m_settings.normalSigma));
+	const SimdFloat4 depthSigma2(m_settings.depthSigma * m_settings.depthSigma);
+	const SimdFloat4 minDepthTolerance(MIN_DEPTH_TOLERANCE);
+	const SimdFloat4 minWeight(1e-20f);
+	const SimdFloat4 zero(0.0f);
+
+	// Пиксели обрабатываются пакетами по 4 соседних в строке
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int y = 0; y < int(m_height); ++y)
+	{
+		for (unsigned x = 0; x < m_width; x += 4)
+		{
+			const size_t center = GetIndex(x, unsigned(y));
+			const SimdFloat4 r = SimdFloat4::Load(&input[0][center]);
+			const SimdFloat4 g = SimdFloat4::Load(&input[1][center]);
+			const SimdFloat4 b = SimdFloat4::Load(&input[2][center]);
+			const SimdFloat4 nx = SimdFloat4::Load(&m_normal[0][center]);
+			const SimdFloat4 ny = SimdFloat4::Load(&m_normal[1][center]);
+			const SimdFloat4 nz = SimdFloat4::Load(&m_normal[2][center]);
+			const SimdFloat4 depth = SimdFloat4::Load(&m_depth[center]);
+			const SimdFloat4 depthScale = SimdFloat4(1.0f) / (depthSigma2 * depth * depth + minDepthTolerance);
+
+			SimdFloat4 sumR, sumG, sumB, sumWeight;
+			for (int dy = -2; dy <= 2; ++dy)
+			{
+				const float kernelY = KERNEL[dy < 0 ? -dy : dy];
+				const ptrdiff_t row = ptrdiff_t(center) + ptrdiff_t(dy) * ptrdiff_t(step) * ptrdiff_t(m_stride);
+				for (int dx = -2; dx <= 2; ++dx)
+				{
+					const size_t sample = size_t(row + ptrdiff_t(dx) * ptrdiff_t(step));
+					const SimdFloat4 sampleR = SimdFloat4::Load(&input[0][sample]);
+					const SimdFloat4 sampleG = SimdFloat4::Load(&input[1][sample]);
+					const SimdFloat4 sampleB = SimdFloat4::Load(&input[2][sample]);
+
+					const SimdFloat4 dr = sampleR - r, dg = sampleG - g, db = sampleB - b;
+					const SimdFloat4 dnx = SimdFloat4::Load(&m_normal[0][sample]) - nx;
+					const SimdFloat4 dny = SimdFloat4::Load(&m_normal[1][sample]) - ny;
+					const SimdFloat4 dnz = SimdFloat4::Load(&m_normal[2][sample]) - nz;
+					const SimdFloat4 dz = SimdFloat4::Load(&m_depth[sample]) - depth;
+
+					// Произведение гауссовых весов по трем признакам вычисляется одной экспонентой
+					const SimdFloat4 distance = (dr * dr + dg * dg + db * db) * colorScale
+						+ (dnx * dnx + dny * dny + dnz * dnz) * normalScale
+						+ dz * dz * depthScale;
+					const SimdFloat4 weight = SimdFloat4(kernelY * KERNEL[dx < 0 ? -dx : dx])
+						* SimdFloat4::Load(&m_valid[sample]) * Exp(zero - distance);
+
+					sumR += weight * sampleR;
+					sumG += weight * sampleG;
+					sumB += weight * sampleB;
+					sumWeight += weight;
+				}
+			}
+
+			// Пиксели без выборок, окруженные такими же, получают нулевую освещенность
+			const SimdFloat4 normalization = SimdFloat4(1.0f) / Max(sumWeight, minWeight);
+			float result[3][4];
+			(sumR * normalization).Store(result[0]);
+			(sumG * normalization).Store(result[1]);
+			(sumB * normalization).Store(result[2]);
+
+			// Элементы пакета за правой границей изображения не сохраняются, чтобы поля оставались нулевыми
+			const unsigned count = std::min(m_width - x, 4u);
+			for (unsigned component = 0; component < 3; ++component)
+			{
+				std::copy(result[component], result[component] + count, &output[component][center]);
+			}
+		}
+	}
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <vector>
+#include "../AccumulationBuffer/AccumulationBuffer.h"
+#include "../FrameBuffer/FrameBuffer.h"
+
+/*
+	Параметры фильтра шума. Чем больше sigma, тем слабее вес соседнего пикселя зависит от соответствующей разницы
+*/
+struct DenoiserSettings
+{
+	// Количество итераций фильтра (не более Denoiser::MAX_ITERATIONS).
+	// На итерации i отсчеты ядра 5x5 берутся с шагом 2^i пикселей, поэтому радиус фильтра растет экспоненциально
+	unsigned iterations = 5;
+	// Допустимая разница освещенности (на каждой следующей итерации уменьшается вдвое)
+	float colorSigma = 0.5f;
+	// Допустимая длина разности нормалей
+	float normalSigma = 0.3f;
+	// Допустимая относительная разница глубин
+	float depthSigma = 0.05f;
+};
+
+/*
+	Фильтр шума изображения, построенного прогрессивной трассировкой путей при малом количестве выборок
+	на пиксель (edge-avoiding a-trous wavelet filter). Изображение размывается итерациями разреженного
+	B3-сплайнового ядра 5x5, а веса соседних пикселей уменьшаются с ростом разницы их освещенности, нормалей и глубин
+	(см. PixelFeatures), поэтому шум сглаживается, а границы объектов и тени сохраняются.
+	Фильтруется освещенность - цвет, деленный на альбедо, поэтому текстуры поверхностей не размываются
+*/
+class Denoiser
+{
+public:
+	static constexpr unsigned MAX_ITERATIONS = 8;
+
+	void SetSettings(DenoiserSettings const& settings);
+	DenoiserSettings const& GetSettings() const noexcept;
+
+	/*
+		Записывает в буфер кадра отфильтрованные средние значения выборок буфера накопления.
+		Пиксели без выборок остаются черными. Размеры буферов должны совпадать.
+		Пиксели обрабатываются в параллельных потоках
+	*/
+	void Denoise(AccumulationBuffer const& accumulationBuffer, FrameBuffer& frameBuffer);
+
+private:
+	// Подготавливает плоскости признаков и начальной освещенности
+	void PrepareInput(AccumulationBuffer const& accumulationBuffer);
+
+	// Выполняет итерацию фильтра с шагом step, читая освещенность из плоскостей source и записывая в target
+	void FilterIteration(unsigned step, float colorSigma, unsigned source, unsigned target);
+
+	// Индекс пикселя (x, y) в плоскостях с учетом полей
+	size_t GetIndex(unsigned x, unsigned y) const noexcept
+	{
+		return (size_t(y) + m_padding) * m_stride + x + m_padding;
+	}
+
+	DenoiserSettings m_settings;
+
+	unsigned m_width = 0;
+	unsigned m_height = 0;
+	// Ширина полей вокруг изображения (не меньше радиуса ядра на последней итерации),
+	// благодаря которым отсчеты ядра не требуют проверки выхода за границы изображения
+	unsigned m_padding = 0;
+	// Расстояние между началами соседних строк плоскостей
+	size_t m_stride = 0;
+
+	/*
+		Плоскости значений пикселей с полями: пиксель поля или без выборок имеет нулевой признак допустимости,
+		поэтому не учитывается при фильтрации.
+		Освещенность хранится в двух наборах плоскостей, между которыми чередуются итерации
+	*/
+	std::vector<float> m_illumination[2][3];
+	std::vector<float> m_normal[3];
+	std::vector<float> m_depth;
+	std::vector<float> m_valid;
+};
@@ -0,0 +1,376 @@
+﻿#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include "FileScene.h"
+#include "../ClusteredMesh/ClusteredMesh.h"
+#include "../GeometryObjects/Cube/Cube.h"
+#include "../GeometryObjects/Dodecahedron/Dodecahedron.h"
+#include "../GeometryObjects/HyperbolicParaboloid/HyperbolicParaboloid.h"
+#include "../GeometryObjects/Icosahedron/Icosahedron.h"
+#include "../GeometryObjects/Octahedron/Octahedron.h"
+#include "../GeometryObjects/Plane/Plane.h"
+#include "../GeometryObjects/Tetrahedron/Tetrahedron.h"
+#include "../LightSource/OmniLightSource.h"
+#include "../LightSource/RectangleLightSource.h"
+#include "../LightSource/SphereLightSource.h"
+#include "../MeshCache/MeshCache.h"
+#include "../SceneObject/SceneObject.h"
+#include "../Shader/PhongShader.h"
+#include "../Shader/SimpleDiffuseShader.h"
+#include "../ViewPort/ViewPort.h"
+
+FileScene::FileScene(SceneDescription const& description, std::string const& baseDirectory, unsigned width, unsigned height,
+	FileSceneOptions const& options)
+{
+	m_scene.SetBackdropColor(description.backdropColor);
+
+	LoadMeshes(description.meshFiles, baseDirectory, options);
+	AddLights(description.lights);
+	m_frozenMeshDataObjects.resize(description.meshFiles.size());
+	if (options.freezeStaticMeshes)
+	{
+		FreezeStaticMeshes(description.objects);
+	}
+	AddObjects(description.objects, CreateShaders(description.materials));
+
+	SetupCamera(description.camera, width, height);
+	UpdateLevelsOfDetail();
+}
+
+CScene& FileScene::GetScene()
+{
+	return m_scene;
+}
+
+CScene const& FileScene::GetScene() const
+{
+	return m_scene;
+}
+
+CRenderContext& FileScene::GetContext()
+{
+	return m_context;
+}
+
+CRenderContext const& FileScene::GetContext() const
+{
+	return m_context;
+}
+
+ClusterCacheStatistics FileScene::GetClusterCacheStatistics() const
+{
+	ClusterCacheStatistics total;
+	for (auto const& pMeshData : m_clusteredMeshDataObjects)
+	{
+		if (pMeshData)
+		{
+			const ClusterCacheStatistics statistics = pMeshData->GetStatistics();
+			total.hits += statistics.hits;
+			total.misses += statistics.misses;
+			total.evictions += statistics.evictions;
+			total.residentClusters += statistics.residentClusters;
+			total.residentMemory += statistics.residentMemory;
+		}
+	}
+	return total;
+}
+
+void FileScene::SetClusterMemoryBudget(size_t budget)
+{
+	for (auto const& pMeshData : m_clusteredMeshDataObjects)
+	{
+		if (pMeshData)
+		{
+			pMeshData->SetMemoryBudget(budget);
+		}
+	}
+}
+
+size_t FileScene::UpdateLevelsOfDetail()
+{
+	size_t changedMeshes = 0;
+	for (CTriangleMesh* pMesh : m_levelOfDetailMeshes)
+	{
+		if (pMesh->SelectLevelOfDetail(m_context))
+		{
+			++changedMeshes;
+		}
+	}
+	return changedMeshes;
+}
+
+LevelOfDetailStatistics FileScene::GetLevelOfDetailStatistics() const
+{
+	LevelOfDetailStatistics statistics;
+	for (CTriangleMesh const* pMesh : m_levelOfDetailMeshes)
+	{
+		++statistics.meshes;
+		if (pMesh->GetLevelOfDetail() > 0)
+		{
+			++statistics.simplifiedMeshes;
+		}
+		statistics.triangles += pMesh->GetLevelData().GetTriangleCount();
+		statistics.fullTriangles += pMesh->GetMeshData().GetTriangleCount();
+	}
+	return statistics;
+}
+
+size_t FileScene::GetFrozenMeshCount() const
+{
+	return size_t(std::count_if(m_frozenMeshDataObjects.begin(), m_frozenMeshDataObjects.end(),
+		[](auto const& pMeshData) { return pMeshData != nullptr; }));
+}
+
+void FileScene::LoadMeshes(std::vector<std::string> const& meshFiles, std::string const& baseDirectory, FileSceneOptions const& sceneOptions)
+{
+	MeshLoadOptions options;
+	options.buildLevelsOfDetail = sceneOptions.levelsOfDetail;
+	options.bakeAmbientOcclusion = sceneOptions.bakeAmbientOcclusion;
+
+	m_triangleMeshDataObjects.resize(meshFiles.size());
+	m_clusteredMeshDataObjects.resize(meshFiles.size());
+	std::vector<std::string> errors(meshFiles.size());
+
+	// Файлы сеток читаются независимо друг от друга, поэтому загружаются параллельно.
+	// Сетки, уже загруженные ранее (например, другой сценой), берутся из кэша
+	const int meshCount = int(meshFiles.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int meshIndex = 0; meshIndex < meshCount; ++meshIndex)
+	{
+		const std::filesystem::path meshPath = std::filesystem::path(baseDirectory) / meshFiles[size_t(meshIndex)];
+		if (meshPath.extension() == ".rtcm")
+		{
+			try
+			{
+				m_clusteredMeshDataObjects[size_t(meshIndex)] = std::make_unique<ClusteredMeshData>(meshPath.string());
+			}
+			catch (std::exception const& e)
+			{
+				errors[size_t(meshIndex)] = e.what();
+			}
+		}
+		else
+		{
+			m_triangleMeshDataObjects[size_t(meshIndex)] = MeshCache::GetInstance().Load(meshPath.string(), options);
+		}
+	}
+
+	// Исключения не должны покидать параллельный цикл, поэтому ошибка загрузки обнаруживается после него
+	for (size_t meshIndex = 0; meshIndex < meshFiles.size(); ++meshIndex)
+	{
+		if (!errors[meshIndex].empty())
+		{
+			throw std::runtime_error(errors[meshIndex]);
+		}
+		if (m_triangleMeshDataObjects[meshIndex] && m_triangleMeshDataObjects[meshIndex]->GetTriangleCount() == 0)
+		{
+			throw std::runtime_error("Failed to load mesh " + meshFiles[meshIndex]);
+		}
+	}
+}
+
+std::vector<IShader const*> FileScene::CreateShaders(std::vector<SceneMaterialDescription> const& materials)
+{
+	// Параметры материала, определяющие результат работы шейдера
+	using MaterialKey = std::pair<SceneMaterialType, std::array<float, 22>>;
+	std::map<MaterialKey, IShader const*> uniqueShaders;
+
+	std::vector<IShader const*> materialShaders;
+	materialShaders.reserve(materials.size());
+	for (SceneMaterialDescription const& material : materials)
+	{
+		MaterialKey key(material.type, {});
+		CVector4f const& diffuse = material.diffuseColor;
+		key.second = { diffuse.x, diffuse.y, diffuse.z, diffuse.w };
+		if (material.type == SceneMaterialType::Phong)
+		{
+			CVector4f const& specular = material.specularColor;
+			CVector4f const& ambient = material.ambientColor;
+			CVector4f const& reflection = material.reflectionColor;
+			CVector4f const& transparency = material.transparencyColor;
+			key.second = { diffuse.x, diffuse.y, diffuse.z, diffuse.w, specular.x, specular.y, specular.z, specular.w,
+				ambient.x, ambient.y, ambient.z, ambient.w, material.specularCoefficient,
+				reflection.x, reflection.y, reflection.z, reflection.w,
+				transparency.x, transparency.y, transparency.z, transparency.w, material.refractiveIndex };
+		}
+
+		auto [it, inserted] = uniqueShaders.emplace(key, nullptr);
+		if (inserted)
+		{
+			if (material.type == SceneMaterialType::Simple)
+			{
+				CSimpleMaterial simpleMaterial;
+				simpleMaterial.SetDiffuseColor(material.diffuseColor);
+				m_shaders.emplace_back(std::make_unique<CSimpleDiffuseShader>(simpleMaterial));
+			}
+			else
+			{
+				ComplexMaterial complexMaterial;
+				complexMaterial.SetDiffuseColor(material.diffuseColor);
+				complexMaterial.SetSpecularColor(material.specularColor);
+				complexMaterial.SetAmbientColor(material.ambientColor);
+				complexMaterial.SetSpecularCoefficient(material.specularCoefficient);
+				complexMaterial.SetReflectionColor(material.reflectionColor);
+				complexMaterial.SetTransparencyColor(material.transparencyColor);
+				complexMaterial.SetRefractiveIndex(material.refractiveIndex);
+				m_shaders.emplace_back(std::make_unique<PhongShader>(complexMaterial));
+			}
+			it->second = m_shaders.back().get();
+		}
+		materialShaders.push_back(it->second);
+	}
+	return materialShaders;
+}
+
+void FileScene::AddLights(std::vector<SceneLightDescription> const& lights)
+{
+	for (SceneLightDescription const& light : lights)
+	{
+		COmniLightPtr pLight;
+		switch (light.shape)
+		{
+		case SceneLightShape::Sphere:
+			pLight = std::make_shared<CSphereLightSource>(light.position, light.radius, light.transform);
+			break;
+		case SceneLightShape::Rectangle:
+			pLight = std::make_shared<CRectangleLightSource>(light.position, light.edgeU, light.edgeV, light.transform);
+			break;
+		default:
+			pLight = std::make_shared<COmniLightSource>(light.position, light.transform);
+			break;
+		}
+		pLight->SetDiffuseIntensity(light.diffuseIntensity);
+		pLight->SetSpecularIntensity(light.specularIntensity);
+		pLight->SetAmbientIntensity(light.ambientIntensity);
+		pLight->SetAttenuation(light.constantAttenuation, light.linearAttenuation, light.quadraticAttenuation);
+		pLight->SetInfluenceCutoff(light.influenceCutoff);
+		m_scene.AddLightSource(pLight);
+	}
+}
+
+void FileScene::FreezeStaticMeshes(std::vector<SceneObjectDescription> const& objects)
+{
+	// Объект, ссылающийся на каждый из файлов сеток OBJ, либо nullptr, если таких объектов несколько
+	std::vector<SceneObjectDescription const*> meshObjects(m_triangleMeshDataObjects.size());
+	std::vector<unsigned> meshReferences(m_triangleMeshDataObjects.size());
+	for (SceneObjectDescription const& object : objects)
+	{
+		if (object.type == SceneObjectType::Mesh && m_triangleMeshDataObjects[object.mesh])
+		{
+			meshObjects[object.mesh] = (++meshReferences[object.mesh] == 1) ? &object : nullptr;
+		}
+	}
+
+	// Данные сеток переводятся в мировую систему координат параллельно
+	const int meshCount = int(meshObjects.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int meshIndex = 0; meshIndex < meshCount; ++meshIndex)
+	{
+		if (SceneObjectDescription const* pObject = meshObjects[size_t(meshIndex)])
+		{
+			m_frozenMeshDataObjects[size_t(meshIndex)] = std::make_unique<CTriangleMeshData const>(
+				*m_triangleMeshDataObjects[size_t(meshIndex)], pObject->transform);
+		}
+	}
+
+	// Исходные данные "замороженных" сеток больше не используются сценой и могут быть удалены из кэша сеток
+	for (size_t meshIndex = 0; meshIndex < meshObjects.size(); ++meshIndex)
+	{
+		if (m_frozenMeshDataObjects[meshIndex])
+		{
+			m_triangleMeshDataObjects[meshIndex].reset();
+		}
+	}
+}
+
+void FileScene::AddObjects(std::vector<SceneObjectDescription> const& objects, std::vector<IShader const*> const& materialShaders)
+{
+	const size_t firstObject = m_geometryObjects.size();
+	m_geometryObjects.resize(firstObject + objects.size());
+
+	// Геометрические объекты создаются параллельно (вычисление обратных матриц и ограничивающих параллелепипедов),
+	// а в сцену добавляются последовательно, сохраняя порядок описания
+	const int objectCount = int(objects.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int objectIndex = 0; objectIndex < objectCount; ++objectIndex)
+	{
+		m_geometryObjects[firstObject + size_t(objectIndex)] = CreateGeometryObject(objects[size_t(objectIndex)]);
+	}
+
+	for (size_t objectIndex = 0; objectIndex < objects.size(); ++objectIndex)
+	{
+		IShader const& shader = *materialShaders.at(objects[objectIndex].material);
+		m_scene.AddObject(std::make_shared<CSceneObject>(*m_geometryObjects[firstObject + objectIndex], shader));
+
+		SceneObjectDescription const& object = objects[objectIndex];
+		if (object.type == SceneObjectType::Mesh && !m_clusteredMeshDataObjects[object.mesh])
+		{
+			auto pMesh = static_cast<CTriangleMesh*>(m_geometryObjects[firstObject + objectIndex].get());
+			if (pMesh->GetLevelOfDetailCount() > 1)
+			{
+				m_levelOfDetailMeshes.push_back(pMesh);
+			}
+		}
+	}
+}
+
+std::unique_ptr<IGeometryObject> FileScene::CreateGeometryObject(SceneObjectDescription const& object) const
+{
+	double const* parameters = object.parameters;
+	switch (object.type)
+	{
+	case SceneObjectType::Plane:
+		return std::make_unique<CPlane>(parameters[0], parameters[1], parameters[2], parameters[3], object.transform);
+	case SceneObjectType::Cube:
+		return std::make_unique<Cube>(parameters[0], CVector3d(parameters[1], parameters[2], parameters[3]), object.transform);
+	case SceneObjectType::Tetrahedron:
+		return std::make_unique<Tetrahedron>(object.transform);
+	case SceneObjectType::Octahedron:
+		return std::make_unique<Octahedron>(object.transform);
+	case SceneObjectType::Dodecahedron:
+		return std::make_unique<Dodecahedron>(object.transform);
+	case SceneObjectType::Icosahedron:
+		return std::make_unique<Icosahedron>(object.transform);
+	case SceneObjectType::HyperbolicParaboloid:
+		return std::make_unique<HyperbolicParaboloid>(object.transform);
+	case SceneObjectType::Mesh:
+	default:
+		if (m_clusteredMeshDataObjects[object.mesh])
+		{
+			return std::make_unique<ClusteredMesh>(m_clusteredMeshDataObjects[object.mesh].get(), object.transform);
+		}
+		if (m_frozenMeshDataObjects[object.mesh])
+		{
+			// Трансформация объекта уже перенесена в данные сетки
+			return std::make_unique<CTriangleMesh>(m_frozenMeshDataObjects[object.mesh].get());
+		}
+		return std::make_unique<CTriangleMesh>(m_triangleMeshDataObjects[object.mesh].get(), object.transform);
+	}
+}
+
+void FileScene::SetupCamera(SceneCameraDescription const& camera, unsigned width, unsigned height)
+{
+	/*
+		Задаем параметры видового порта и матрицы проецирования в контексте визуализации
+	*/
+	m_context.SetViewPort(CViewPort(0, 0, width, height));
+	CMatrix4d proj;
+	proj.LoadPerspective(camera.fieldOfView, double(width) / double(height), camera.zNear, camera.zFar);
+	m_context.SetProjectionMatrix(proj);
+
+	// Задаем матрицу камеры
+	CMatrix4d modelView;
+	modelView.LoadLookAtRH(
+		camera.eye.x, camera.eye.y, camera.eye.z,
+		camera.target.x, camera.target.y, camera.target.z,
+		camera.up.x, camera.up.y, camera.up.z);
+	m_context.SetModelViewMatrix(modelView);
+}
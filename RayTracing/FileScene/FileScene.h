@@ -0,0 +1,119 @@
+﻿#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "../ClusteredMesh/ClusteredMeshData.h"
+#include "../GeometryObject/IGeometryObject.h"
+#include "../RenderContext/RenderContext.h"
+#include "../Scene/Scene.h"
+#include "../SceneFile/SceneDescription.h"
+#include "../Shader/IShader.h"
+#include "../TriangleMesh/TriangleMesh.h"
+
+// Статистика уровней детализации сеток сцены (см. CTriangleMesh::SelectLevelOfDetail)
+struct LevelOfDetailStatistics
+{
+	size_t meshes = 0; // Количество сеток, имеющих упрощенные уровни детализации
+	size_t simplifiedMeshes = 0; // Количество сеток, использующих упрощенные уровни
+	size_t triangles = 0; // Количество треугольников выбранных уровней этих сеток
+	size_t fullTriangles = 0; // Количество треугольников исходных сеток
+};
+
+// Параметры построения сцены из файла
+struct FileSceneOptions
+{
+	// Строить ли упрощенные уровни детализации сеток из файлов OBJ (иначе сетки всегда используют исходные данные)
+	bool levelsOfDetail = true;
+	// "Замораживать" ли неподвижные сетки (см. FileScene::FreezeStaticMeshes)
+	bool freezeStaticMeshes = true;
+	// Вычислять ли при загрузке фоновое затенение вершин сеток из файлов OBJ (см. AmbientOcclusionBaker)
+	bool bakeAmbientOcclusion = false;
+};
+
+/*
+	Сцена, построенная по описанию из файла (см. SceneFile): геометрические объекты, шейдеры,
+	источники света и параметры камеры.
+	Объекты с одинаковыми материалами используют общий шейдер, а объекты, ссылающиеся на один
+	и тот же файл сетки, - общие данные сетки. Файлы сеток загружаются параллельно.
+	Файлы кластеризованных сеток (.rtcm, см. ClusteredMeshFile) только открываются, а их кластеры
+	загружаются по мере необходимости при построении изображения.
+	Для сеток из файлов OBJ строятся упрощенные уровни детализации, и каждая сетка сцены использует уровень,
+	соответствующий размеру ее проекции
+*/
+class FileScene
+{
+public:
+	/*
+		Строит сцену и настраивает камеру для буфера кадра заданного размера.
+		Пути к файлам сеток задаются относительно каталога baseDirectory.
+		Если файл сетки загрузить не удалось, выбрасывает исключение std::runtime_error
+	*/
+	FileScene(SceneDescription const& description, std::string const& baseDirectory, unsigned width, unsigned height,
+		FileSceneOptions const& options = FileSceneOptions());
+
+	FileScene(FileScene const&) = delete;
+	FileScene& operator=(FileScene const&) = delete;
+
+	CScene& GetScene();
+	CScene const& GetScene() const;
+
+	CRenderContext& GetContext();
+	CRenderContext const& GetContext() const;
+
+	// Суммарная статистика обращений к кластерам кластеризованных сеток сцены
+	ClusterCacheStatistics GetClusterCacheStatistics() const;
+
+	// Ограничение объема памяти загруженных кластеров для каждой из кластеризованных сеток (0 - без ограничения)
+	void SetClusterMemoryBudget(size_t budget);
+
+	/*
+		Выбирает уровни детализации сеток по текущим параметрам камеры. Вызывается конструктором;
+		после изменения камеры должен вызываться до построения изображения.
+		Возвращает количество сеток, сменивших уровень детализации
+	*/
+	size_t UpdateLevelsOfDetail();
+
+	LevelOfDetailStatistics GetLevelOfDetailStatistics() const;
+
+	// Количество "замороженных" сеток (см. FreezeStaticMeshes)
+	size_t GetFrozenMeshCount() const;
+
+private:
+	void LoadMeshes(std::vector<std::string> const& meshFiles, std::string const& baseDirectory, FileSceneOptions const& sceneOptions);
+
+	// Создает по одному шейдеру на каждый набор одинаковых материалов. Возвращает шейдеры для всех материалов описания
+	std::vector<IShader const*> CreateShaders(std::vector<SceneMaterialDescription> const& materials);
+
+	void AddLights(std::vector<SceneLightDescription> const& lights);
+
+	/*
+		"Замораживает" сетки из файлов OBJ, на которые ссылается только один объект сцены: трансформация объекта
+		переносится в копию данных сетки, поэтому при поиске пересечений луч и нормали не преобразуются.
+		Объекты сцены не перемещаются, а сетки, используемые несколькими объектами, продолжают использовать
+		общие данные с трансформацией каждого объекта
+	*/
+	void FreezeStaticMeshes(std::vector<SceneObjectDescription> const& objects);
+
+	void AddObjects(std::vector<SceneObjectDescription> const& objects, std::vector<IShader const*> const& materialShaders);
+
+	std::unique_ptr<IGeometryObject> CreateGeometryObject(SceneObjectDescription const& object) const;
+
+	void SetupCamera(SceneCameraDescription const& camera, unsigned width, unsigned height);
+
+private:
+	// Сцена
+	CScene m_scene;
+	// Контекст
+	CRenderContext m_context;
+
+	std::vector<std::unique_ptr<IGeometryObject>> m_geometryObjects;
+	std::vector<std::unique_ptr<IShader>> m_shaders;
+	// Данные сеток в порядке SceneDescription::meshFiles. Для каждого файла задан
+	// либо элемент m_triangleMeshDataObjects (файлы OBJ), либо m_clusteredMeshDataObjects (файлы .rtcm)
+	std::vector<std::shared_ptr<CTriangleMeshData const>> m_triangleMeshDataObjects;
+	std::vector<std::unique_ptr<ClusteredMeshData>> m_clusteredMeshDataObjects;
+	// Данные "замороженных" сеток в мировой системе координат (для остальных файлов - nullptr)
+	std::vector<std::unique_ptr<CTriangleMeshData const>> m_frozenMeshDataObjects;
+	// Сетки, данные которых содержат несколько уровней детализации
+	std::vector<CTriangleMesh*> m_levelOfDetailMeshes;
+};
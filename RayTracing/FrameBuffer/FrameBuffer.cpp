@@ -1,12 +1,25 @@
 ﻿#include "FrameBuffer.h"
+#include <algorithm>
 
 FrameBuffer::FrameBuffer(unsigned width, unsigned height)
-	: m_pixels(width * height)
+	: m_storage(size_t(width) * height)
+	, m_pixels(m_storage.data())
 	, m_width(width)
 	, m_height(height)
+	, m_rowStride(width)
 {
 }
 
+FrameBuffer::FrameBuffer(unsigned width, unsigned height, std::uint32_t* pExternalPixels, unsigned rowStride)
+	: m_pixels(pExternalPixels)
+	, m_width(width)
+	, m_height(height)
+	, m_rowStride(rowStride != 0 ? rowStride : width)
+{
+	assert(pExternalPixels != nullptr);
+	assert(m_rowStride >= width);
+}
+
 unsigned FrameBuffer::GetWidth() const noexcept
 {
 	return m_width;
@@ -19,31 +32,34 @@ unsigned FrameBuffer::GetHeight() const noexcept
 
 void FrameBuffer::Clear(std::uint32_t color)
 {
-	std::fill(m_pixels.begin(), m_pixels.end(), color);
+	for (unsigned y = 0; y < m_height; ++y)
+	{
+		std::fill_n(GetPixels(y), m_width, color);
+	}
 }
 
 const std::uint32_t* FrameBuffer::GetPixels(unsigned row) const noexcept
 {
 	assert(row < m_height);
-	return &m_pixels[size_t(row * m_width)];
+	return &m_pixels[size_t(row) * m_rowStride];
 }
 
 std::uint32_t* FrameBuffer::GetPixels(unsigned row) noexcept
 {
 	assert(row < m_height);
-	return &m_pixels[size_t(row * m_width)];
+	return &m_pixels[size_t(row) * m_rowStride];
 }
 
 std::uint32_t FrameBuffer::GetPixel(unsigned x, unsigned y) const noexcept
 {
 	assert(x < m_width);
 	assert(y < m_height);
-	return m_pixels[size_t(y * m_width + x)];
+	return m_pixels[size_t(y) * m_rowStride + x];
 }
 
 void FrameBuffer::SetPixel(unsigned x, unsigned y, std::uint32_t color) noexcept
 {
 	assert(x < m_width);
 	assert(y < m_height);
-	m_pixels[size_t(y * m_width + x)] = color;
+	m_pixels[size_t(y) * m_rowStride + x] = color;
 }
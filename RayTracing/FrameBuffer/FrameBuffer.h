@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <cassert>
+#include <cstdint>
 #include <vector>
 
 /*
@@ -13,6 +14,16 @@ class FrameBuffer
 public:
 	FrameBuffer(unsigned width, unsigned height);
 
+	/*
+		Буфер кадра, пиксели которого размещены во внешней памяти (например, в разделяемой памяти процессов
+		или в памяти поверхности окна). Соседние строки отстоят друг от друга на rowStride пикселей
+		(0 - строки следуют вплотную). Память должна существовать дольше буфера кадра
+	*/
+	FrameBuffer(unsigned width, unsigned height, std::uint32_t* pExternalPixels, unsigned rowStride = 0);
+
+	FrameBuffer(FrameBuffer const&) = delete;
+	FrameBuffer& operator=(FrameBuffer const&) = delete;
+
 	// Ширина буфера в пикселях
 	unsigned GetWidth() const noexcept;
 
@@ -35,7 +46,12 @@ public:
 	void SetPixel(unsigned x, unsigned y, std::uint32_t color) noexcept;
 
 private:
-	std::vector<std::uint32_t> m_pixels;
+	// Собственная память пикселей (пуста, если пиксели размещены во внешней памяти)
+	std::vector<std::uint32_t> m_storage;
+	// Адрес первого пикселя
+	std::uint32_t* m_pixels;
 	unsigned m_width;
 	unsigned m_height;
+	// Расстояние между началами соседних строк в пикселях
+	unsigned m_rowStride;
 };
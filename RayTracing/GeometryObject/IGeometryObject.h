@@ -4,6 +4,7 @@
 
 class CRay;
 class CIntersection;
+class CBoundingBox;
 
 /*
 Интерфейс "Геометрический объект"
@@ -22,4 +23,7 @@ public:
 
 	// Нахождение точек столкновения луча с объектом
 	virtual bool Hit(CRay const& ray, CIntersection & intersection) const = 0;
+
+	// Ограничивающий параллелепипед объекта в мировой системе координат
+	virtual CBoundingBox GetBounds() const = 0;
 };
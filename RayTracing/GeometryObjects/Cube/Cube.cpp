@@ -2,6 +2,7 @@
 #include <algorithm>
 #include "../../Ray/Ray.h"
 #include "../../Intersection/Intersection.h"
+#include "../../BoundingBox/BoundingBox.h"
 
 Cube::Cube(double size, CVector3d const& center, CMatrix4d const& transform)
 	: CGeometryObjectImpl(transform)
@@ -132,3 +133,15 @@ bool Cube::Hit(CRay const& ray, CIntersection& intersection) const
 	//   ,  true
 	return true;
 }
+
+CBoundingBox Cube::GetBounds() const
+{
+	// Hit()     m_center  m_size   ,
+	//   ,    -  
+	//       
+	CBoundingBox localBounds(
+		CVector3d(m_center.x - m_size, m_center.y - m_size, m_center.z - m_size),
+		CVector3d(m_center.x + m_size, m_center.y + m_size, m_center.z + m_size));
+
+	return localBounds.GetTransformed(GetTransform() * m_initialTransform);
+}
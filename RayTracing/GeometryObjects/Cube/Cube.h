@@ -18,6 +18,11 @@ public:
 	*/
 	virtual bool Hit(CRay const& ray, CIntersection& intersection) const override;
 
+	/*
+		      
+	*/
+	CBoundingBox GetBounds() const override;
+
 protected:
 	virtual void OnUpdateTransform() override;
 
@@ -1,15 +1,8 @@
 ﻿#pragma once
-#include "../../GeometryObject/GeometryObjectImpl.h"
-#include "../../TriangleMesh/TriangleMesh.h"
+#include "../Polyhedra/Polyhedron.h"
 
-class Dodecahedron : public CGeometryObjectImpl
+class Dodecahedron : public Polyhedron
 {
 public:
 	Dodecahedron(CMatrix4d const& transform = CMatrix4d());
-
-	bool Hit(CRay const& ray, CIntersection& intersection) const override;
-
-private:
-	std::unique_ptr<CTriangleMesh> m_triangleMesh;
-	std::unique_ptr<CTriangleMeshData> m_triangleMeshData;
 };
@@ -1,6 +1,7 @@
 ﻿#include "HyperbolicParaboloid.h"
 #include "../../Intersection/Intersection.h"
 #include "../../Ray/Ray.h"
+#include "../../BoundingBox/BoundingBox.h"
 
 HyperbolicParaboloid::HyperbolicParaboloid(CMatrix4d const& transform)
 	: CGeometryObjectImpl(transform)
@@ -134,4 +135,11 @@ bool HyperbolicParaboloid::Hit(CRay const& ray, CIntersection& intersection) con
 
 	// Возвращаем true, если было найдено хотя бы одно пересечение
 	return intersection.GetHitsCount() > 0;
+}
+
+CBoundingBox HyperbolicParaboloid::GetBounds() const
+{
+	// Поверхность y = x^2 - z^2 ограничена диапазоном x, z в [-1; 1], поэтому y также лежит в [-1; 1]
+	CBoundingBox localBounds(CVector3d(-1, -1, -1), CVector3d(1, 1, 1));
+	return localBounds.GetTransformed(GetTransform());
 }
\ No newline at end of file
@@ -7,4 +7,6 @@ public:
 	HyperbolicParaboloid(CMatrix4d const& transform = CMatrix4d());
 
 	bool Hit(CRay const& ray, CIntersection& intersection) const override;
+
+	CBoundingBox GetBounds() const override;
 };
@@ -1,6 +1,6 @@
 #include "Icosahedron.h"
 
 Icosahedron::Icosahedron(CMatrix4d const& transform)
-	: WavefrontObject("GeometryObjects/Icosahedron/icosahedron.obj", transform)
+	: Polyhedron(GetMeshData<ICOSAHEDRON_TABLE>(), transform)
 {
 }
@@ -1,9 +1,7 @@
 #pragma once
-#include "../../GeometryObject/GeometryObjectImpl.h"
-#include "../../TriangleMesh/TriangleMesh.h"
-#include "../WavefrontObject.h"
+#include "../Polyhedra/Polyhedron.h"
 
-class Icosahedron : public WavefrontObject
+class Icosahedron : public Polyhedron
 {
 public:
 	Icosahedron(CMatrix4d const& transform = CMatrix4d());
@@ -0,0 +1,6 @@
+﻿#include "Octahedron.h"
+
+Octahedron::Octahedron(CMatrix4d const& transform)
+	: Polyhedron(GetMeshData<OCTAHEDRON_TABLE>(), transform)
+{
+}
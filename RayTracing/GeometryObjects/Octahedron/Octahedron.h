@@ -0,0 +1,8 @@
+﻿#pragma once
+#include "../Polyhedra/Polyhedron.h"
+
+class Octahedron : public Polyhedron
+{
+public:
+	Octahedron(CMatrix4d const& transform = CMatrix4d());
+};
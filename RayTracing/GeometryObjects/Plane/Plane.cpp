@@ -2,6 +2,7 @@
 #include "../../Vector/VectorMath.h"
 #include "../../Ray/Ray.h"
 #include "../../Intersection/Intersection.h"
+#include "../../BoundingBox/BoundingBox.h"
 
 CPlane::CPlane(double a, double b, double c, double d, CMatrix4d const & transform)
 	: CGeometryObjectImpl(transform)
@@ -71,3 +72,8 @@ bool CPlane::Hit(CRay const& ray, CIntersection& intersection) const
 	// Точка столкновения есть, возвращаем true
 	return true;
 }
+
+CBoundingBox CPlane::GetBounds() const
+{
+	return CBoundingBox::GetInfinite();
+}
@@ -20,6 +20,11 @@ public:
 	*/
 	virtual bool Hit(CRay const& ray, CIntersection & intersection) const;
 
+	/*
+	Плоскость бесконечна, поэтому ее ограничивающий параллелепипед охватывает все пространство
+	*/
+	CBoundingBox GetBounds() const override;
+
 private:
 	// Четырехмерный вектор, хранящий коэффициенты уравнения плоскости
 	CVector4d m_planeEquation;
@@ -0,0 +1,28 @@
+﻿#include "Polyhedron.h"
+
+Polyhedron::Polyhedron(CTriangleMeshData const& meshData, CMatrix4d const& transform)
+	: CGeometryObjectImpl(transform)
+{
+	m_triangleMesh = std::make_unique<CTriangleMesh>(&meshData, transform);
+}
+
+bool Polyhedron::Hit(CRay const& ray, CIntersection& intersection) const
+{
+	return m_triangleMesh->Hit(ray, intersection);
+}
+
+CBoundingBox Polyhedron::GetBounds() const
+{
+	return m_triangleMesh->GetBounds();
+}
+
+void Polyhedron::OnUpdateTransform()
+{
+	CGeometryObjectImpl::OnUpdateTransform();
+
+	// Сетка может быть еще не создана, если трансформация задается в процессе конструирования
+	if (m_triangleMesh)
+	{
+		m_triangleMesh->SetTransform(GetTransform());
+	}
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+#include <memory>
+#include <vector>
+#include "../../GeometryObject/GeometryObjectImpl.h"
+#include "../../TriangleMesh/TriangleMesh.h"
+#include "PolyhedronTables.h"
+
+/*
+	Многогранник, данные сетки которого встроены в программу (см. PolyhedronTables.h)
+*/
+class Polyhedron : public CGeometryObjectImpl
+{
+public:
+	bool Hit(CRay const& ray, CIntersection& intersection) const override;
+
+	CBoundingBox GetBounds() const override;
+
+	// Создает данные сетки по таблице, используя вычисленные на этапе компиляции параметры треугольников
+	template <size_t VertexCount, size_t FaceCount>
+	static std::unique_ptr<CTriangleMeshData const> CreateMeshData(PolyhedronTable<VertexCount, FaceCount> const& table)
+	{
+		std::vector<Vertex> vertices;
+		vertices.reserve(VertexCount);
+		for (PolyhedronVertex const& vertex : table.vertices)
+		{
+			vertices.emplace_back(CVector3d(vertex.x, vertex.y, vertex.z));
+		}
+
+		std::vector<Face> faces;
+		faces.reserve(FaceCount);
+		for (PolyhedronFace const& face : table.faces)
+		{
+			faces.emplace_back(face.vertex0, face.vertex1, face.vertex2);
+		}
+
+		return std::make_unique<CTriangleMeshData const>(vertices, faces, table.triangles.data());
+	}
+
+	// Данные сетки многогранника с таблицей Table, общие для всех его экземпляров. Создаются при первом обращении
+	template <auto const& Table>
+	static CTriangleMeshData const& GetMeshData()
+	{
+		static const std::unique_ptr<CTriangleMeshData const> meshData = CreateMeshData(Table);
+		return *meshData;
+	}
+
+protected:
+	// meshData - данные сетки, общие для всех многогранников данного вида
+	Polyhedron(CTriangleMeshData const& meshData, CMatrix4d const& transform);
+
+	// Передаем новую матрицу трансформации сетке, выполняющей поиск пересечений
+	void OnUpdateTransform() override;
+
+private:
+	std::unique_ptr<CTriangleMesh> m_triangleMesh;
+};
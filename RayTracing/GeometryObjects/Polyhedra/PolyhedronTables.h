@@ -0,0 +1,289 @@
+﻿#pragma once
+#include <array>
+#include <cstddef>
+#include "../../TriangleMesh/TriangleMesh.h"
+
+/*
+	Таблицы вершин и треугольных граней многогранников, вычисляемые на этапе компиляции,
+	а также заранее вычисленные параметры их треугольников (TriangleSetup).
+	Грани ориентированы против часовой стрелки при взгляде снаружи, как в файлах OBJ
+*/
+
+struct PolyhedronVertex
+{
+	double x, y, z;
+};
+
+struct PolyhedronFace
+{
+	unsigned vertex0, vertex1, vertex2;
+};
+
+template <size_t VertexCount, size_t FaceCount>
+struct PolyhedronTable
+{
+	std::array<PolyhedronVertex, VertexCount> vertices;
+	std::array<PolyhedronFace, FaceCount> faces;
+	std::array<TriangleSetup, FaceCount> triangles;
+};
+
+/*
+	Вспомогательные функции, допускающие вычисление на этапе компиляции
+*/
+struct PolyhedronMath
+{
+	// Квадратный корень (метод Ньютона; приближения монотонно убывают до точного значения)
+	static constexpr double Sqrt(double value)
+	{
+		if (value <= 0)
+		{
+			return 0;
+		}
+		double root = (value > 1) ? value : 1;
+		while (true)
+		{
+			const double next = 0.5 * (root + value / root);
+			if (next >= root)
+			{
+				return root;
+			}
+			root = next;
+		}
+	}
+
+	static constexpr PolyhedronVertex Sub(PolyhedronVertex const& a, PolyhedronVertex const& b)
+	{
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	static constexpr PolyhedronVertex Scale(PolyhedronVertex const& v, double scale)
+	{
+		return { v.x * scale, v.y * scale, v.z * scale };
+	}
+
+	static constexpr double Dot(PolyhedronVertex const& a, PolyhedronVertex const& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	static constexpr PolyhedronVertex Cross(PolyhedronVertex const& a, PolyhedronVertex const& b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	static constexpr PolyhedronVertex Normalize(PolyhedronVertex const& v)
+	{
+		const double length = Sqrt(Dot(v, v));
+		return (length > 0) ? Scale(v, 1 / length) : v;
+	}
+
+	static constexpr double Max(double a, double b)
+	{
+		return (a > b) ? a : b;
+	}
+
+	/*
+		Параметры треугольника. Вычисляются так же, как в конструкторе CTriangle
+	*/
+	static constexpr TriangleSetup ComputeTriangleSetup(PolyhedronVertex const& p0, PolyhedronVertex const& p1, PolyhedronVertex const& p2)
+	{
+		constexpr double EPSILON = 1e-10;
+
+		// Ребра
+		const PolyhedronVertex e01 = Sub(p1, p0);
+		const PolyhedronVertex e12 = Sub(p2, p1);
+		const PolyhedronVertex e20 = Sub(p0, p2);
+
+		// Нормаль к плоскости треугольника и единичные нормали к ребрам, лежащие в его плоскости
+		const PolyhedronVertex normal = Cross(e20, e01);
+		const PolyhedronVertex edge01Normal = Normalize(Cross(normal, e01));
+		const PolyhedronVertex edge12Normal = Normalize(Cross(normal, e12));
+		const PolyhedronVertex edge20Normal = Normalize(Cross(normal, e20));
+
+		// Квадраты длин ребер и высот, опущенных на них
+		const double edge01Square = Dot(e01, e01);
+		const double edge12Square = Dot(e12, e12);
+		const double edge20Square = Dot(e20, e20);
+		const double edge01PerpSquare = (edge01Square > EPSILON)
+			? Max(0.0, (edge01Square * edge20Square - Dot(e01, e20) * Dot(e01, e20)) / edge01Square)
+			: 0.0;
+		const double edge12PerpSquare = (edge12Square > EPSILON)
+			? Max(0.0, (edge12Square * edge01Square - Dot(e12, e01) * Dot(e12, e01)) / edge12Square)
+			: 0.0;
+		const double edge20PerpSquare = (edge20Square > EPSILON)
+			? Max(0.0, (edge20Square * edge12Square - Dot(e20, e12) * Dot(e20, e12)) / edge20Square)
+			: 0.0;
+
+		const PolyhedronVertex edge01Perp = Scale(edge01Normal, Sqrt(edge01PerpSquare));
+		const PolyhedronVertex edge12Perp = Scale(edge12Normal, Sqrt(edge12PerpSquare));
+		const PolyhedronVertex edge20Perp = Scale(edge20Normal, Sqrt(edge20PerpSquare));
+
+		return TriangleSetup{
+			{ normal.x, normal.y, normal.z, -Dot(normal, p0) },
+			{ edge01Perp.x, edge01Perp.y, edge01Perp.z },
+			{ edge12Perp.x, edge12Perp.y, edge12Perp.z },
+			{ edge20Perp.x, edge20Perp.y, edge20Perp.z },
+			(edge01PerpSquare > EPSILON) ? (1.0 / edge01PerpSquare) : 0.0,
+			(edge12PerpSquare > EPSILON) ? (1.0 / edge12PerpSquare) : 0.0,
+			(edge20PerpSquare > EPSILON) ? (1.0 / edge20PerpSquare) : 0.0,
+		};
+	}
+
+	// Грань, ориентированная так, чтобы ее нормаль была направлена от центра многогранника (начала координат)
+	template <size_t VertexCount>
+	static constexpr PolyhedronFace MakeOutwardFace(std::array<PolyhedronVertex, VertexCount> const& vertices, unsigned i0, unsigned i1, unsigned i2)
+	{
+		const PolyhedronVertex normal = Cross(Sub(vertices[i1], vertices[i0]), Sub(vertices[i2], vertices[i0]));
+		return (Dot(normal, vertices[i0]) >= 0) ? PolyhedronFace{ i0, i1, i2 } : PolyhedronFace{ i0, i2, i1 };
+	}
+
+	// Дополняет вершины и грани параметрами треугольников
+	template <size_t VertexCount, size_t FaceCount>
+	static constexpr PolyhedronTable<VertexCount, FaceCount> MakeTable(
+		std::array<PolyhedronVertex, VertexCount> const& vertices, std::array<PolyhedronFace, FaceCount> const& faces)
+	{
+		PolyhedronTable<VertexCount, FaceCount> table{ vertices, faces, {} };
+		for (size_t i = 0; i < FaceCount; ++i)
+		{
+			PolyhedronFace const& face = faces[i];
+			table.triangles[i] = ComputeTriangleSetup(vertices[face.vertex0], vertices[face.vertex1], vertices[face.vertex2]);
+		}
+		return table;
+	}
+
+	/*
+		Правильный икосаэдр, вписанный в единичную сферу. Вершины - циклические перестановки (0, ±1, ±ф),
+		где ф - золотое сечение; гранями являются тройки вершин, попарно отстоящих на длину ребра
+	*/
+	static constexpr PolyhedronTable<12, 20> MakeIcosahedron()
+	{
+		const double phi = (1 + Sqrt(5)) / 2;
+		const double scale = 1 / Sqrt(1 + phi * phi);
+		const double a = scale;
+		const double b = phi * scale;
+
+		const std::array<PolyhedronVertex, 12> vertices = { {
+			{ 0, a, b }, { 0, a, -b }, { 0, -a, b }, { 0, -a, -b },
+			{ a, b, 0 }, { a, -b, 0 }, { -a, b, 0 }, { -a, -b, 0 },
+			{ b, 0, a }, { -b, 0, a }, { b, 0, -a }, { -b, 0, -a },
+		} };
+
+		// Квадрат длины ребра (2a)^2 с допуском на погрешность вычислений
+		const double edgeSquare = 4 * a * a;
+		auto isEdge = [&](unsigned i, unsigned j) {
+			const PolyhedronVertex d = Sub(vertices[i], vertices[j]);
+			const double distanceSquare = Dot(d, d);
+			return distanceSquare > edgeSquare * 0.99 && distanceSquare < edgeSquare * 1.01;
+		};
+
+		std::array<PolyhedronFace, 20> faces{};
+		size_t faceCount = 0;
+		for (unsigned i = 0; i < 12; ++i)
+		{
+			for (unsigned j = i + 1; j < 12; ++j)
+			{
+				for (unsigned k = j + 1; k < 12; ++k)
+				{
+					if (isEdge(i, j) && isEdge(j, k) && isEdge(i, k))
+					{
+						if (faceCount == faces.size())
+						{
+							throw "Icosahedron must have 20 faces";
+						}
+						faces[faceCount++] = MakeOutwardFace(vertices, i, j, k);
+					}
+				}
+			}
+		}
+		if (faceCount != faces.size())
+		{
+			throw "Icosahedron must have 20 faces";
+		}
+		return MakeTable(vertices, faces);
+	}
+
+	/*
+		Правильный додекаэдр, вписанный в единичную сферу, строится как многогранник, двойственный икосаэдру:
+		его вершины - направления на центры граней икосаэдра, а пятиугольные грани соответствуют вершинам
+		икосаэдра и разбиваются на три треугольника каждая
+	*/
+	static constexpr PolyhedronTable<20, 36> MakeDodecahedron()
+	{
+		const PolyhedronTable<12, 20> icosahedron = MakeIcosahedron();
+
+		std::array<PolyhedronVertex, 20> vertices{};
+		for (size_t i = 0; i < 20; ++i)
+		{
+			PolyhedronFace const& face = icosahedron.faces[i];
+			PolyhedronVertex const& v0 = icosahedron.vertices[face.vertex0];
+			PolyhedronVertex const& v1 = icosahedron.vertices[face.vertex1];
+			PolyhedronVertex const& v2 = icosahedron.vertices[face.vertex2];
+			vertices[i] = Normalize({ v0.x + v1.x + v2.x, v0.y + v1.y + v2.y, v0.z + v1.z + v2.z });
+		}
+
+		auto hasVertex = [](PolyhedronFace const& face, unsigned vertex) {
+			return face.vertex0 == vertex || face.vertex1 == vertex || face.vertex2 == vertex;
+		};
+		// Смежные грани икосаэдра имеют две общие вершины
+		auto areAdjacent = [&](PolyhedronFace const& a, PolyhedronFace const& b) {
+			return int(hasVertex(b, a.vertex0)) + int(hasVertex(b, a.vertex1)) + int(hasVertex(b, a.vertex2)) == 2;
+		};
+
+		std::array<PolyhedronFace, 36> faces{};
+		size_t faceCount = 0;
+		for (unsigned icosahedronVertex = 0; icosahedronVertex < 12; ++icosahedronVertex)
+		{
+			// Грани икосаэдра, сходящиеся в вершине
+			std::array<unsigned, 5> ring{};
+			size_t ringSize = 0;
+			for (unsigned i = 0; i < 20; ++i)
+			{
+				if (hasVertex(icosahedron.faces[i], icosahedronVertex))
+				{
+					if (ringSize == ring.size())
+					{
+						throw "Icosahedron vertex must have 5 adjacent faces";
+					}
+					ring[ringSize++] = i;
+				}
+			}
+
+			// Упорядочиваем их по обходу вокруг вершины: каждая следующая грань смежна с предыдущей
+			for (size_t i = 1; i + 1 < ring.size(); ++i)
+			{
+				for (size_t j = i; j < ring.size(); ++j)
+				{
+					if (areAdjacent(icosahedron.faces[ring[i - 1]], icosahedron.faces[ring[j]]))
+					{
+						const unsigned next = ring[j];
+						ring[j] = ring[i];
+						ring[i] = next;
+						break;
+					}
+				}
+			}
+
+			// Разбиваем пятиугольник на треугольники веером
+			for (size_t i = 1; i + 1 < ring.size(); ++i)
+			{
+				faces[faceCount++] = MakeOutwardFace(vertices, ring[0], ring[i], ring[i + 1]);
+			}
+		}
+		return MakeTable(vertices, faces);
+	}
+};
+
+/*
+	Тетраэдр и октаэдр демонстрационной сцены
+*/
+inline constexpr PolyhedronTable<4, 4> TETRAHEDRON_TABLE = PolyhedronMath::MakeTable(
+	std::array<PolyhedronVertex, 4>{ { { -1, 0, 1 }, { 1, 0, 1 }, { 0, 0, -1 }, { 0, 2, 0 } } },
+	std::array<PolyhedronFace, 4>{ { { 0, 2, 1 }, { 3, 0, 1 }, { 3, 1, 2 }, { 3, 2, 0 } } });
+
+inline constexpr PolyhedronTable<6, 8> OCTAHEDRON_TABLE = PolyhedronMath::MakeTable(
+	std::array<PolyhedronVertex, 6>{ { { 0, 1, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { -1, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 } } },
+	std::array<PolyhedronFace, 8>{ { { 2, 1, 4 }, { 1, 0, 4 }, { 0, 3, 4 }, { 3, 2, 4 }, { 2, 5, 1 }, { 1, 5, 0 }, { 0, 5, 3 }, { 3, 5, 2 } } });
+
+inline constexpr PolyhedronTable<12, 20> ICOSAHEDRON_TABLE = PolyhedronMath::MakeIcosahedron();
+
+inline constexpr PolyhedronTable<20, 36> DODECAHEDRON_TABLE = PolyhedronMath::MakeDodecahedron();
@@ -1,75 +1,573 @@
-﻿#include <sstream>
-#include <array>
+﻿#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include "PolytopeReader.h"
 
-PolytopeReader::PolytopeReader(const std::string& filename)
-	: m_inputStream(filename)
+namespace ipc = boost::interprocess;
+
+namespace
 {
+// Примерный размер фрагмента файла, разбираемого одним потоком
+constexpr size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+// Отсутствующий или ошибочный индекс
+constexpr std::uint32_t NO_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+// Вершина грани: индексы координат, текстурных координат и нормали (с нуля)
+struct Corner
+{
+	std::uint32_t position;
+	std::uint32_t textureCoord;
+	std::uint32_t normal;
+
+	bool operator==(Corner const& other) const
+	{
+		return position == other.position && textureCoord == other.textureCoord && normal == other.normal;
+	}
+};
+
+struct CornerHash
+{
+	size_t operator()(Corner const& corner) const
+	{
+		const std::uint64_t key = (std::uint64_t(corner.position) << 32) ^ (std::uint64_t(corner.normal) << 16) ^ corner.textureCoord;
+		return std::hash<std::uint64_t>()(key);
+	}
+};
+
+// Ошибка разбора строки (номер строки отсчитывается от начала фрагмента)
+struct ParseError
+{
+	unsigned line;
+	const char* message;
+};
+
+/*
+	Фрагмент файла, состоящий из целых строк. Первый проход подсчитывает количество элементов во фрагменте,
+	что позволяет заранее вычислить, с какого места общих массивов размещать элементы каждого фрагмента,
+	и разрешить относительные индексы при разборе фрагментов в произвольном порядке
+*/
+struct Chunk
+{
+	const char* begin = nullptr;
+	const char* end = nullptr;
+
+	unsigned lineCount = 0;
+	size_t positionCount = 0;
+	size_t textureCoordCount = 0;
+	size_t normalCount = 0;
+	size_t triangleCount = 0;
+
+	// Смещения элементов фрагмента в общих массивах
+	size_t firstLine = 0;
+	size_t firstPosition = 0;
+	size_t firstTextureCoord = 0;
+	size_t firstNormal = 0;
+	size_t firstTriangle = 0;
+
+	std::vector<ParseError> errors;
+};
+
+inline bool IsSpace(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\r';
 }
 
-void PolytopeReader::Read(std::vector<Vertex>& vertices, std::vector<Face>& faces)
+inline const char* SkipSpaces(const char* p, const char* end)
 {
-	vertices.clear();
-	faces.clear();
+	while (p < end && IsSpace(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+inline const char* SkipToken(const char* p, const char* end)
+{
+	while (p < end && !IsSpace(*p))
+	{
+		++p;
+	}
+	return p;
+}
 
-	std::string str;
-	std::istringstream strStream;
-	std::string token;
+inline const char* FindLineEnd(const char* p, const char* end)
+{
+	const void* newLine = std::memchr(p, '\n', size_t(end - p));
+	return newLine ? static_cast<const char*>(newLine) : end;
+}
+
+// Тип строки определяется по ключевому слову в ее начале
+enum class LineType
+{
+	Other,
+	Position,
+	TextureCoord,
+	Normal,
+	Face,
+};
+
+LineType GetLineType(const char*& p, const char* lineEnd)
+{
+	p = SkipSpaces(p, lineEnd);
+	const char* keywordEnd = SkipToken(p, lineEnd);
+	const std::string_view keyword(p, size_t(keywordEnd - p));
+	p = keywordEnd;
 
-	CVector3d currVector3d;
-	unsigned linePos = 0;
-	double x, y, z;
+	if (keyword == "v")
+	{
+		return LineType::Position;
+	}
+	if (keyword == "vt")
+	{
+		return LineType::TextureCoord;
+	}
+	if (keyword == "vn")
+	{
+		return LineType::Normal;
+	}
+	if (keyword == "f")
+	{
+		return LineType::Face;
+	}
+	return LineType::Other;
+}
 
-	std::istringstream faceStream;
-	std::vector<unsigned> indices;
-	while (std::getline(m_inputStream, str))
+// Количество вершин грани (количество лексем в строке)
+size_t CountFaceCorners(const char* p, const char* lineEnd)
+{
+	size_t count = 0;
+	for (p = SkipSpaces(p, lineEnd); p < lineEnd; p = SkipSpaces(p, lineEnd))
 	{
-		strStream.str(str);
-		strStream.clear();
-		++linePos;
+		p = SkipToken(p, lineEnd);
+		++count;
+	}
+	return count;
+}
 
-		strStream >> token;
-		if (token == "v")
+void CountChunkElements(Chunk& chunk)
+{
+	for (const char* lineStart = chunk.begin; lineStart < chunk.end;)
+	{
+		const char* lineEnd = FindLineEnd(lineStart, chunk.end);
+		const char* p = lineStart;
+		switch (GetLineType(p, lineEnd))
 		{
-			// обрабатываем данные для вершин
-			strStream >> x >> y >> z;
-			currVector3d.x = x;
-			currVector3d.y = y;
-			currVector3d.z = z;
+		case LineType::Position:
+			++chunk.positionCount;
+			break;
+		case LineType::TextureCoord:
+			++chunk.textureCoordCount;
+			break;
+		case LineType::Normal:
+			++chunk.normalCount;
+			break;
+		case LineType::Face:
+			chunk.triangleCount += std::max<size_t>(CountFaceCorners(p, lineEnd), 2) - 2;
+			break;
+		default:
+			break;
+		}
+		++chunk.lineCount;
+		lineStart = lineEnd + 1;
+	}
+}
+
+bool ParseNumber(const char*& p, const char* lineEnd, double& value)
+{
+	p = SkipSpaces(p, lineEnd);
+	if (p < lineEnd && *p == '+')
+	{
+		++p;
+	}
+	const auto [numberEnd, error] = std::from_chars(p, lineEnd, value);
+	if (error != std::errc())
+	{
+		return false;
+	}
+	p = numberEnd;
+	return true;
+}
+
+/*
+	Преобразует индекс OBJ в индекс массива: положительные индексы отсчитываются с единицы от начала файла,
+	отрицательные - от последнего элемента, прочитанного до текущей строки
+*/
+std::uint32_t ResolveIndex(long long index, size_t countBeforeLine)
+{
+	if (index > 0)
+	{
+		return std::uint32_t(index - 1);
+	}
+	if (index < 0 && size_t(-index) <= countBeforeLine)
+	{
+		return std::uint32_t(countBeforeLine - size_t(-index));
+	}
+	return NO_INDEX;
+}
+
+// Разбирает индекс элемента в составе вершины грани, перемещая указатель за его конец
+bool ParseIndex(const char*& p, const char* tokenEnd, size_t countBeforeLine, std::uint32_t& resolvedIndex)
+{
+	long long index = 0;
+	const auto [indexEnd, error] = std::from_chars(p, tokenEnd, index);
+	if (error != std::errc())
+	{
+		return false;
+	}
+	p = indexEnd;
+	resolvedIndex = ResolveIndex(index, countBeforeLine);
+	return resolvedIndex != NO_INDEX;
+}
 
-			if (!strStream.fail())
+// Разбирает вершину грани вида "v", "v/vt", "v//vn" или "v/vt/vn"
+bool ParseCorner(const char* p, const char* tokenEnd, size_t positionCount, size_t textureCoordCount, size_t normalCount,
+	Corner& corner)
+{
+	corner = Corner{ NO_INDEX, NO_INDEX, NO_INDEX };
+
+	if (!ParseIndex(p, tokenEnd, positionCount, corner.position))
+	{
+		return false;
+	}
+	if (p < tokenEnd && *p == '/')
+	{
+		++p;
+		if (p < tokenEnd && *p != '/' && !ParseIndex(p, tokenEnd, textureCoordCount, corner.textureCoord))
+		{
+			return false;
+		}
+		if (p < tokenEnd && *p == '/')
+		{
+			++p;
+			if (!ParseIndex(p, tokenEnd, normalCount, corner.normal))
 			{
-				vertices.push_back(Vertex(currVector3d));
+				return false;
 			}
-			else
+		}
+	}
+	return p == tokenEnd;
+}
+
+struct ObjData
+{
+	std::vector<CVector3d> positions;
+	std::vector<CVector2d> textureCoords;
+	std::vector<CVector3d> normals;
+	// Вершины треугольников (по три на треугольник)
+	std::vector<Corner> corners;
+};
+
+void ParseChunk(Chunk& chunk, ObjData& data)
+{
+	size_t positionIndex = chunk.firstPosition;
+	size_t textureCoordIndex = chunk.firstTextureCoord;
+	size_t normalIndex = chunk.firstNormal;
+	size_t cornerIndex = chunk.firstTriangle * 3;
+	unsigned lineNumber = 0;
+
+	std::vector<Corner> faceCorners;
+	for (const char* lineStart = chunk.begin; lineStart < chunk.end; lineStart = FindLineEnd(lineStart, chunk.end) + 1)
+	{
+		const char* lineEnd = FindLineEnd(lineStart, chunk.end);
+		const char* p = lineStart;
+		++lineNumber;
+
+		switch (GetLineType(p, lineEnd))
+		{
+		case LineType::Position:
+		{
+			// Ошибочные элементы остаются нулевыми, чтобы не сдвигать индексы последующих элементов
+			CVector3d& position = data.positions[positionIndex++];
+			if (!ParseNumber(p, lineEnd, position.x) || !ParseNumber(p, lineEnd, position.y) || !ParseNumber(p, lineEnd, position.z))
 			{
-				std::cout << "Error found in v string with position " << linePos << "\n";
+				chunk.errors.push_back({ lineNumber, "Error found in v string" });
 			}
+			break;
 		}
-		else if (token == "f")
+		case LineType::TextureCoord:
 		{
-			// обрабатываем грани
-			indices.clear();
-			while (strStream >> token)
+			CVector2d& textureCoord = data.textureCoords[textureCoordIndex++];
+			if (!ParseNumber(p, lineEnd, textureCoord.x))
 			{
-				faceStream.str(token);
-				faceStream.clear();
-				if (std::getline(faceStream, token, '/'))
-				{
-					indices.push_back(std::stoi(token));
-				}
-				else
-				{
-					indices.clear();
-					std::cout << "Error found in f string with position " << linePos << "\n";
-					break;
-				}
+				chunk.errors.push_back({ lineNumber, "Error found in vt string" });
 			}
-			if (indices.size() == 3)
+			// Вторая координата необязательна
+			ParseNumber(p, lineEnd, textureCoord.y);
+			break;
+		}
+		case LineType::Normal:
+		{
+			CVector3d& normal = data.normals[normalIndex++];
+			if (!ParseNumber(p, lineEnd, normal.x) || !ParseNumber(p, lineEnd, normal.y) || !ParseNumber(p, lineEnd, normal.z))
 			{
-				faces.push_back(Face(indices.at(0) - 1, indices.at(1) - 1, indices.at(2) - 1));
+				chunk.errors.push_back({ lineNumber, "Error found in vn string" });
 			}
+			break;
 		}
+		case LineType::Face:
+		{
+			faceCorners.clear();
+			bool faceIsValid = true;
+			for (p = SkipSpaces(p, lineEnd); p < lineEnd; p = SkipSpaces(p, lineEnd))
+			{
+				const char* tokenEnd = SkipToken(p, lineEnd);
+				Corner corner;
+				faceIsValid = ParseCorner(p, tokenEnd, positionIndex, textureCoordIndex, normalIndex, corner) && faceIsValid;
+				faceCorners.push_back(corner);
+				p = tokenEnd;
+			}
+			if (faceCorners.size() < 3)
+			{
+				faceIsValid = false;
+			}
+
+			// Многоугольник разбивается на треугольники веером из первой вершины.
+			// Треугольники ошибочной грани помечаются отсутствующим индексом и отбрасываются при сборке сетки
+			for (size_t i = 2; i < faceCorners.size(); ++i)
+			{
+				data.corners[cornerIndex++] = faceIsValid ? faceCorners[0] : Corner{ NO_INDEX, NO_INDEX, NO_INDEX };
+				data.corners[cornerIndex++] = faceCorners[i - 1];
+				data.corners[cornerIndex++] = faceCorners[i];
+			}
+			if (!faceIsValid)
+			{
+				chunk.errors.push_back({ lineNumber, "Error found in f string" });
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+/*
+	Делит содержимое файла на фрагменты, границы которых совпадают с концами строк
+*/
+std::vector<Chunk> SplitIntoChunks(const char* begin, const char* end)
+{
+	std::vector<Chunk> chunks;
+	for (const char* chunkStart = begin; chunkStart < end;)
+	{
+		const char* chunkEnd = end;
+		if (size_t(end - chunkStart) > CHUNK_SIZE)
+		{
+			chunkEnd = FindLineEnd(chunkStart + CHUNK_SIZE, end);
+			chunkEnd = std::min(chunkEnd + 1, end);
+		}
+		Chunk chunk;
+		chunk.begin = chunkStart;
+		chunk.end = chunkEnd;
+		chunks.push_back(std::move(chunk));
+		chunkStart = chunkEnd;
+	}
+	return chunks;
+}
+
+bool IsValidCorner(Corner const& corner, ObjData const& data, bool useTextureCoords)
+{
+	return corner.position < data.positions.size()
+		&& (corner.normal == NO_INDEX || corner.normal < data.normals.size())
+		&& (!useTextureCoords || corner.textureCoord == NO_INDEX || corner.textureCoord < data.textureCoords.size());
+}
+
+/*
+	Строит вершины и грани сетки. Вершина сетки соответствует сочетанию индексов координат, нормали
+	и (если они нужны) текстурных координат. Обычно каждая позиция используется с одной и той же нормалью,
+	поэтому вершины нумеруются так же, как позиции, а для редких других сочетаний создаются дополнительные вершины
+*/
+void BuildMesh(ObjData const& data, bool useTextureCoords, std::vector<Vertex>& vertices, std::vector<Face>& faces,
+	std::vector<CVector2d>* pTextureCoords, size_t& invalidTriangleCount)
+{
+	vertices.resize(data.positions.size());
+	if (pTextureCoords)
+	{
+		pTextureCoords->assign(data.positions.size(), CVector2d());
+	}
+
+	// Сочетание индексов, закрепленное за вершиной с индексом позиции (textureCoord == NO_INDEX - не назначено)
+	std::vector<Corner> assignedCorners(data.positions.size(), Corner{ NO_INDEX, NO_INDEX, NO_INDEX });
+	std::vector<bool> positionIsAssigned(data.positions.size(), false);
+	std::unordered_map<Corner, std::uint32_t, CornerHash> splitVertices;
+
+	// normalIsUsed == false для плоских граней: нормали их вершин не используются, и подходит любая вершина
+	// с нужной позицией (и текстурными координатами)
+	auto getVertexIndex = [&](Corner corner, bool normalIsUsed) -> std::uint32_t {
+		if (!useTextureCoords)
+		{
+			corner.textureCoord = NO_INDEX;
+		}
+		if (!positionIsAssigned[corner.position])
+		{
+			positionIsAssigned[corner.position] = true;
+			assignedCorners[corner.position] = corner;
+			if (corner.normal != NO_INDEX)
+			{
+				vertices[corner.position].normal = data.normals[corner.normal];
+			}
+			if (pTextureCoords && corner.textureCoord != NO_INDEX)
+			{
+				(*pTextureCoords)[corner.position] = data.textureCoords[corner.textureCoord];
+			}
+			return corner.position;
+		}
+
+		Corner const& assigned = assignedCorners[corner.position];
+		if ((assigned.normal == corner.normal || !normalIsUsed) && assigned.textureCoord == corner.textureCoord)
+		{
+			return corner.position;
+		}
+
+		// Позиция уже используется с другой нормалью или текстурными координатами - создаем отдельную вершину
+		const auto [it, inserted] = splitVertices.emplace(corner, std::uint32_t(vertices.size()));
+		if (inserted)
+		{
+			vertices.push_back(Vertex(data.positions[corner.position],
+				corner.normal == NO_INDEX ? CVector3d() : data.normals[corner.normal]));
+			if (pTextureCoords)
+			{
+				pTextureCoords->push_back(corner.textureCoord == NO_INDEX ? CVector2d() : data.textureCoords[corner.textureCoord]);
+			}
+		}
+		return it->second;
+	};
+
+	for (size_t i = 0; i < data.positions.size(); ++i)
+	{
+		vertices[i].position = data.positions[i];
+	}
+
+	faces.reserve(data.corners.size() / 3);
+	for (size_t i = 0; i + 2 < data.corners.size(); i += 3)
+	{
+		Corner const* corners = &data.corners[i];
+		if (corners[0].position == NO_INDEX)
+		{
+			// Треугольник ошибочной грани (об ошибке уже сообщено при разборе)
+			continue;
+		}
+		if (!IsValidCorner(corners[0], data, useTextureCoords) || !IsValidCorner(corners[1], data, useTextureCoords)
+			|| !IsValidCorner(corners[2], data, useTextureCoords))
+		{
+			++invalidTriangleCount;
+			continue;
+		}
+
+		// Нормали вершин интерполируются, только если они заданы для всех вершин грани
+		const bool isFlat = corners[0].normal == NO_INDEX || corners[1].normal == NO_INDEX || corners[2].normal == NO_INDEX;
+		const std::uint32_t vertex0 = getVertexIndex(corners[0], !isFlat);
+		const std::uint32_t vertex1 = getVertexIndex(corners[1], !isFlat);
+		const std::uint32_t vertex2 = getVertexIndex(corners[2], !isFlat);
+		faces.push_back(Face(vertex0, vertex1, vertex2, isFlat));
+	}
+}
+}
+
+PolytopeReader::PolytopeReader(const std::string& filename)
+	: m_fileName(filename)
+{
+}
+
+void PolytopeReader::Read(std::vector<Vertex>& vertices, std::vector<Face>& faces, std::vector<CVector2d>* pTextureCoords)
+{
+	vertices.clear();
+	faces.clear();
+	if (pTextureCoords)
+	{
+		pTextureCoords->clear();
+	}
+
+	// Отображение пустого файла в память невозможно, поэтому размер проверяется заранее
+	std::error_code errorCode;
+	const std::uintmax_t fileSize = std::filesystem::file_size(m_fileName, errorCode);
+	if (errorCode || fileSize == 0)
+	{
+		if (errorCode)
+		{
+			std::cout << "Failed to open " << m_fileName << ": " << errorCode.message() << "\n";
+		}
+		return;
+	}
+
+	ipc::mapped_region region;
+	try
+	{
+		ipc::file_mapping file(m_fileName.c_str(), ipc::read_only);
+		ipc::mapped_region(file, ipc::read_only).swap(region);
+	}
+	catch (ipc::interprocess_exception const& e)
+	{
+		std::cout << "Failed to map " << m_fileName << ": " << e.what() << "\n";
+		return;
+	}
+
+	const char* begin = static_cast<const char*>(region.get_address());
+	std::vector<Chunk> chunks = SplitIntoChunks(begin, begin + region.get_size());
+	const int chunkCount = int(chunks.size());
+
+	// Первый проход: подсчет элементов каждого фрагмента
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+	{
+		CountChunkElements(chunks[size_t(chunkIndex)]);
+	}
+
+	// Размещение элементов фрагментов в общих массивах
+	ObjData data;
+	size_t lineCount = 0, positionCount = 0, textureCoordCount = 0, normalCount = 0, triangleCount = 0;
+	for (Chunk& chunk : chunks)
+	{
+		chunk.firstLine = lineCount;
+		chunk.firstPosition = positionCount;
+		chunk.firstTextureCoord = textureCoordCount;
+		chunk.firstNormal = normalCount;
+		chunk.firstTriangle = triangleCount;
+		lineCount += chunk.lineCount;
+		positionCount += chunk.positionCount;
+		textureCoordCount += chunk.textureCoordCount;
+		normalCount += chunk.normalCount;
+		triangleCount += chunk.triangleCount;
+	}
+	if (positionCount >= NO_INDEX)
+	{
+		std::cout << "Too many vertices in " << m_fileName << "\n";
+		return;
+	}
+	data.positions.resize(positionCount);
+	data.textureCoords.resize(textureCoordCount);
+	data.normals.resize(normalCount);
+	data.corners.resize(triangleCount * 3);
+
+	// Второй проход: разбор фрагментов непосредственно в общие массивы
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+	{
+		ParseChunk(chunks[size_t(chunkIndex)], data);
+	}
+
+	for (Chunk const& chunk : chunks)
+	{
+		for (ParseError const& error : chunk.errors)
+		{
+			std::cout << error.message << " with position " << chunk.firstLine + error.line << "\n";
+		}
+	}
+
+	size_t invalidTriangleCount = 0;
+	BuildMesh(data, pTextureCoords != nullptr, vertices, faces, pTextureCoords, invalidTriangleCount);
+	if (invalidTriangleCount > 0)
+	{
+		std::cout << invalidTriangleCount << " triangles with out of range indices skipped in " << m_fileName << "\n";
 	}
 }
@@ -1,16 +1,28 @@
-﻿#pragma once
+#pragma once
 #include <string>
 #include <vector>
-#include <fstream>
 #include "../../TriangleMesh/TriangleMesh.h"
+#include "../../Vector/Vector2.h"
 
+/*
+	Чтение полигональной сетки из файла в формате Wavefront OBJ.
+
+	Файл отображается в память и делится на фрагменты по границам строк, которые разбираются параллельно.
+	Поддерживаются вершины (v), нормали (vn), текстурные координаты (vt) и грани (f) с произвольным количеством
+	вершин (разбиваются на треугольники веером), а также отрицательные (относительные) индексы
+*/
 class PolytopeReader
 {
 public:
 	PolytopeReader(std::string const& filename);
 
-	void Read(std::vector<Vertex>& vertices, std::vector<Face>& faces);
+	/*
+		Читает вершины и треугольные грани сетки.
+		Если для вершин граней заданы нормали, грани используют интерполяцию нормалей вершин (не являются плоскими).
+		Если задан pTextureCoords, в него помещаются текстурные координаты вершин (по одной паре на вершину)
+	*/
+	void Read(std::vector<Vertex>& vertices, std::vector<Face>& faces, std::vector<CVector2d>* pTextureCoords = nullptr);
 
 private:
-	std::ifstream m_inputStream;
+	std::string m_fileName;
 };
@@ -0,0 +1,6 @@
+﻿#include "Tetrahedron.h"
+
+Tetrahedron::Tetrahedron(CMatrix4d const& transform)
+	: Polyhedron(GetMeshData<TETRAHEDRON_TABLE>(), transform)
+{
+}
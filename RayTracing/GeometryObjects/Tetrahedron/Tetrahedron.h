@@ -0,0 +1,8 @@
+﻿#pragma once
+#include "../Polyhedra/Polyhedron.h"
+
+class Tetrahedron : public Polyhedron
+{
+public:
+	Tetrahedron(CMatrix4d const& transform = CMatrix4d());
+};
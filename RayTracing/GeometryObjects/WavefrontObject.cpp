@@ -1,17 +1,10 @@
 #include "WavefrontObject.h"
-#include "PolytopeReader/PolytopeReader.h"
+#include "../MeshCache/MeshCache.h"
 
 WavefrontObject::WavefrontObject(const std::string& filePath, CMatrix4d const& transform)
 {
-	PolytopeReader polytopeReader(filePath);
-
-	std::vector<Vertex> vertices;
-	std::vector<Face> faces;
-
-	polytopeReader.Read(vertices, faces);
-
-	//   
-	m_triangleMeshData = std::make_unique<CTriangleMeshData>(vertices, faces);
+	//    (     )
+	m_triangleMeshData = MeshCache::GetInstance().Load(filePath);
 
 	m_triangleMesh = std::make_unique<CTriangleMesh>(m_triangleMeshData.get(), transform);
 }
@@ -20,3 +13,19 @@ bool WavefrontObject::Hit(CRay const& ray, CIntersection& intersection) const
 {
 	return m_triangleMesh->Hit(ray, intersection);
 }
+
+CBoundingBox WavefrontObject::GetBounds() const
+{
+	return m_triangleMesh->GetBounds();
+}
+
+void WavefrontObject::OnUpdateTransform()
+{
+	CGeometryObjectImpl::OnUpdateTransform();
+
+	//      ,      
+	if (m_triangleMesh)
+	{
+		m_triangleMesh->SetTransform(GetTransform());
+	}
+}
@@ -10,7 +10,14 @@ public:
 
 	bool Hit(CRay const& ray, CIntersection& intersection) const override;
 
+	CBoundingBox GetBounds() const override;
+
+protected:
+	// Передаем новую матрицу трансформации сетке, выполняющей поиск пересечений
+	void OnUpdateTransform() override;
+
 private:
 	std::unique_ptr<CTriangleMesh> m_triangleMesh;
-	std::unique_ptr<CTriangleMeshData> m_triangleMeshData;
+	// Данные сетки, общие для всех объектов, загруженных из того же файла (см. MeshCache)
+	std::shared_ptr<CTriangleMeshData const> m_triangleMeshData;
 };
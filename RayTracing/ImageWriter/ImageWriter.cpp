@@ -0,0 +1,212 @@
+﻿#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "ImageWriter.h"
+
+namespace
+{
+// Таблица для вычисления CRC-32 (полином 0xEDB88320), используемой в блоках PNG
+std::array<std::uint32_t, 256> MakeCrcTable()
+{
+	std::array<std::uint32_t, 256> table{};
+	for (std::uint32_t n = 0; n < 256; ++n)
+	{
+		std::uint32_t c = n;
+		for (int k = 0; k < 8; ++k)
+		{
+			c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+		}
+		table[n] = c;
+	}
+	return table;
+}
+
+std::uint32_t UpdateCrc(std::uint32_t crc, const std::uint8_t* data, size_t size)
+{
+	static const std::array<std::uint32_t, 256> table = MakeCrcTable();
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+void AppendUint32BE(std::vector<std::uint8_t>& buffer, std::uint32_t value)
+{
+	buffer.push_back(std::uint8_t(value >> 24));
+	buffer.push_back(std::uint8_t(value >> 16));
+	buffer.push_back(std::uint8_t(value >> 8));
+	buffer.push_back(std::uint8_t(value));
+}
+
+// Записывает блок (chunk) PNG: длина, тип, данные и контрольная сумма типа и данных
+void WritePngChunk(std::ostream& output, const char* type, std::vector<std::uint8_t> const& data)
+{
+	std::vector<std::uint8_t> header;
+	AppendUint32BE(header, std::uint32_t(data.size()));
+	header.insert(header.end(), type, type + 4);
+
+	std::uint32_t crc = UpdateCrc(0xFFFFFFFFu, header.data() + 4, 4);
+	crc = UpdateCrc(crc, data.data(), data.size()) ^ 0xFFFFFFFFu;
+
+	std::vector<std::uint8_t> trailer;
+	AppendUint32BE(trailer, crc);
+
+	output.write(reinterpret_cast<const char*>(header.data()), std::streamsize(header.size()));
+	output.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+	output.write(reinterpret_cast<const char*>(trailer.data()), std::streamsize(trailer.size()));
+}
+}
+
+bool ImageWriter::GetFormatFromFileName(std::string const& fileName, Format& format)
+{
+	const size_t dotPos = fileName.find_last_of('.');
+	if (dotPos == std::string::npos)
+	{
+		return false;
+	}
+
+	std::string extension = fileName.substr(dotPos + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char ch) {
+		return char(std::tolower(ch));
+	});
+
+	if (extension == "ppm")
+	{
+		format = Format::PPM;
+		return true;
+	}
+	if (extension == "png")
+	{
+		format = Format::PNG;
+		return true;
+	}
+	return false;
+}
+
+bool ImageWriter::Write(FrameBuffer const& frameBuffer, std::string const& fileName)
+{
+	Format format;
+	if (!GetFormatFromFileName(fileName, format))
+	{
+		std::cerr << "Unsupported image format: " << fileName << "\n";
+		return false;
+	}
+	return Write(frameBuffer, fileName, format);
+}
+
+bool ImageWriter::Write(FrameBuffer const& frameBuffer, std::string const& fileName, Format format)
+{
+	std::ofstream output(fileName, std::ios::binary);
+	if (!output)
+	{
+		std::cerr << "Failed to open " << fileName << " for writing\n";
+		return false;
+	}
+
+	const bool written = (format == Format::PNG)
+		? WritePNG(frameBuffer, output)
+		: WritePPM(frameBuffer, output);
+
+	output.flush();
+	if (!written || !output)
+	{
+		std::cerr << "Failed to write " << fileName << "\n";
+		return false;
+	}
+	return true;
+}
+
+bool ImageWriter::WritePPM(FrameBuffer const& frameBuffer, std::ostream& output)
+{
+	const unsigned width = frameBuffer.GetWidth();
+	const unsigned height = frameBuffer.GetHeight();
+
+	output << "P6\n" << width << " " << height << "\n255\n";
+
+	// Строки записываются по одной: в буфере кадра они могут следовать не вплотную
+	std::vector<std::uint8_t> row(size_t(width) * 3);
+	for (unsigned y = 0; y < height; ++y)
+	{
+		const std::uint32_t* pixels = frameBuffer.GetPixels(y);
+		for (unsigned x = 0; x < width; ++x)
+		{
+			row[x * 3 + 0] = std::uint8_t(pixels[x] >> 16);
+			row[x * 3 + 1] = std::uint8_t(pixels[x] >> 8);
+			row[x * 3 + 2] = std::uint8_t(pixels[x]);
+		}
+		output.write(reinterpret_cast<const char*>(row.data()), std::streamsize(row.size()));
+	}
+	return bool(output);
+}
+
+bool ImageWriter::WritePNG(FrameBuffer const& frameBuffer, std::ostream& output)
+{
+	const unsigned width = frameBuffer.GetWidth();
+	const unsigned height = frameBuffer.GetHeight();
+
+	static const std::uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	output.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	// Заголовок: размеры, 8 бит на компонент, цветовой тип 2 (RGB), без чересстрочности
+	std::vector<std::uint8_t> header;
+	AppendUint32BE(header, width);
+	AppendUint32BE(header, height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });
+	WritePngChunk(output, "IHDR", header);
+
+	// Несжатые данные изображения: каждая строка предваряется байтом фильтра (0 - без фильтрации)
+	const size_t rowSize = size_t(width) * 3 + 1;
+	std::vector<std::uint8_t> raw(rowSize * height);
+	for (unsigned y = 0; y < height; ++y)
+	{
+		const std::uint32_t* pixels = frameBuffer.GetPixels(y);
+		std::uint8_t* row = raw.data() + rowSize * y;
+		row[0] = 0;
+		for (unsigned x = 0; x < width; ++x)
+		{
+			row[1 + x * 3 + 0] = std::uint8_t(pixels[x] >> 16);
+			row[1 + x * 3 + 1] = std::uint8_t(pixels[x] >> 8);
+			row[1 + x * 3 + 2] = std::uint8_t(pixels[x]);
+		}
+	}
+
+	// Поток zlib из deflate-блоков типа stored (не более 65535 байт в каждом)
+	constexpr size_t MAX_STORED_BLOCK_SIZE = 65535;
+	std::vector<std::uint8_t> data;
+	data.reserve(raw.size() + raw.size() / MAX_STORED_BLOCK_SIZE * 5 + 16);
+	data.push_back(0x78);
+	data.push_back(0x01);
+
+	size_t offset = 0;
+	do
+	{
+		const size_t blockSize = std::min(MAX_STORED_BLOCK_SIZE, raw.size() - offset);
+		const bool lastBlock = (offset + blockSize == raw.size());
+		data.push_back(lastBlock ? 1 : 0);
+		data.push_back(std::uint8_t(blockSize));
+		data.push_back(std::uint8_t(blockSize >> 8));
+		data.push_back(std::uint8_t(~blockSize));
+		data.push_back(std::uint8_t(~blockSize >> 8));
+		data.insert(data.end(), raw.begin() + std::ptrdiff_t(offset), raw.begin() + std::ptrdiff_t(offset + blockSize));
+		offset += blockSize;
+	} while (offset < raw.size());
+
+	// Контрольная сумма Adler-32 несжатых данных
+	std::uint32_t a = 1;
+	std::uint32_t b = 0;
+	for (std::uint8_t byte : raw)
+	{
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	AppendUint32BE(data, (b << 16) | a);
+
+	WritePngChunk(output, "IDAT", data);
+	WritePngChunk(output, "IEND", std::vector<std::uint8_t>());
+
+	return bool(output);
+}
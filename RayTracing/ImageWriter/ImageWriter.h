@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <string>
+#include "../FrameBuffer/FrameBuffer.h"
+
+/*
+	Запись содержимого буфера кадра (пиксели в формате 0xAARRGGBB) в файл изображения.
+	Формат выбирается по расширению имени файла: .ppm (binary PPM, P6) или .png.
+	PNG записывается без сжатия (deflate-блоки типа stored), поэтому не требует внешних библиотек
+*/
+class ImageWriter
+{
+public:
+	// Формат файла изображения
+	enum class Format
+	{
+		PPM,
+		PNG,
+	};
+
+	// Определяет формат по расширению имени файла. Возвращает false, если расширение не поддерживается
+	static bool GetFormatFromFileName(std::string const& fileName, Format& format);
+
+	// Записывает буфер кадра в файл. Возвращает false в случае ошибки
+	static bool Write(FrameBuffer const& frameBuffer, std::string const& fileName);
+	static bool Write(FrameBuffer const& frameBuffer, std::string const& fileName, Format format);
+
+private:
+	static bool WritePPM(FrameBuffer const& frameBuffer, std::ostream& output);
+	static bool WritePNG(FrameBuffer const& frameBuffer, std::ostream& output);
+};
@@ -24,6 +24,7 @@ public:
 		hitObject -  объект столкновения
 		hitPoint - точка столкновения в системе координатах сцены
 		hitPointInObjectSpace - точка столкновения в системе координат объекта
+		ambientOcclusion - заранее вычисленное фоновое затенение точки (1 - не затенена, см. AmbientOcclusionBaker)
 	*/
 	CHitInfo(
 		double hitTime,
@@ -31,7 +32,8 @@ public:
 		CVector3d const& hitPoint,
 		CVector3d const& hitPointInObjectSpace,
 		CVector3d const& normal,
-		CVector3d const& normalInObjectSpace
+		CVector3d const& normalInObjectSpace,
+		float ambientOcclusion = 1
 	)
 		: m_hitPoint(hitPoint)
 		, m_hitPointInObjectSpace(hitPointInObjectSpace)
@@ -39,6 +41,7 @@ public:
 		, m_normalInObjectSpace(Normalize(normalInObjectSpace))
 		, m_hitTime(hitTime)
 		, m_pHitObject(&hitObject)
+		, m_ambientOcclusion(ambientOcclusion)
 	{
 	}
 
@@ -87,6 +90,12 @@ public:
 	{
 		return m_normalInObjectSpace;
 	}
+
+	// Фоновое затенение в точке столкновения (1, если для объекта оно не вычислялось)
+	float GetAmbientOcclusion() const
+	{
+		return m_ambientOcclusion;
+	}
 private:
 	// Точка столкновения в системе координатах сцены
 	CVector3d m_hitPoint;
@@ -100,6 +109,8 @@ private:
 	CVector3d m_normal;
 	// Нормаль к поверхности в системе координат объекта
 	CVector3d m_normalInObjectSpace;
+	// Фоновое затенение в точке столкновения
+	float m_ambientOcclusion = 1;
 };
 
 /*
@@ -0,0 +1,206 @@
+﻿#include "IrradianceCache.h"
+#include <cmath>
+#include <mutex>
+#include "../Scene/Scene.h"
+#include "../Intersection/Intersection.h"
+#include "../PathTracer/PathTracer.h"
+#include "../PointRandom/PointRandom.h"
+#include "../Ray/Ray.h"
+#include "../SceneObject/SceneObject.h"
+#include "../Shader/IShader.h"
+#include "../Shader/ShadeContext.h"
+#include "../Vector/VectorMath.h"
+
+namespace
+{
+// Допустимое положение точки позади записи (в долях радиуса записи)
+constexpr double MAX_BEHIND_DISTANCE = 0.05;
+} // namespace
+
+void IrradianceCache::SetSettings(IrradianceCaching const& settings)
+{
+	m_settings = settings;
+	m_settings.hemisphereGrid = Max(m_settings.hemisphereGrid, 1u);
+	m_settings.maxRadius = Max(m_settings.maxRadius, m_settings.minRadius);
+	m_cellSize = Max(m_settings.accuracy * m_settings.maxRadius, 1e-6);
+	Clear();
+}
+
+IrradianceCaching const& IrradianceCache::GetSettings() const noexcept
+{
+	return m_settings;
+}
+
+CVector4f IrradianceCache::GetIrradiance(CScene const& scene, CVector3d const& point, CVector3d const& normal)
+{
+	m_lookups.fetch_add(1, std::memory_order_relaxed);
+
+	CVector4f irradiance;
+	if (Interpolate(point, normal, irradiance))
+	{
+		return irradiance;
+	}
+
+	// Запись вычисляется без блокировки: другие потоки тем временем продолжают пользоваться кэшем
+	const Record record = ComputeRecord(scene, point, normal);
+	AddRecord(record);
+	m_computedRecords.fetch_add(1, std::memory_order_relaxed);
+	return record.irradiance;
+}
+
+bool IrradianceCache::Interpolate(CVector3d const& point, CVector3d const& normal, CVector4f& irradiance) const
+{
+	std::shared_lock lock(m_mutex);
+
+	auto it = m_cells.find(GetCellKey(GetCellCoordinate(point.x), GetCellCoordinate(point.y), GetCellCoordinate(point.z)));
+	if (it == m_cells.end())
+	{
+		return false;
+	}
+
+	CVector4f weightedSum;
+	double weightSum = 0;
+	for (unsigned index : it->second)
+	{
+		Record const& record = m_records[index];
+		const CVector3d offset = point - record.position;
+
+		// Точки перед записью (например, на соседней ступеньке) освещены иначе
+		if (Dot(offset, normal + record.normal) < -2 * MAX_BEHIND_DISTANCE * record.radius)
+		{
+			continue;
+		}
+
+		// Оценка погрешности Уорда: расстояние в долях радиуса записи плюс разница нормалей
+		const double error = offset.GetLength() / record.radius + sqrt(Max(1 - Dot(normal, record.normal), 0.0));
+		if (error < m_settings.accuracy)
+		{
+			const double weight = 1 / Max(error, 1e-6);
+			weightedSum += static_cast<float>(weight) * record.irradiance;
+			weightSum += weight;
+		}
+	}
+
+	if (weightSum == 0)
+	{
+		return false;
+	}
+	irradiance = static_cast<float>(1 / weightSum) * weightedSum;
+	return true;
+}
+
+IrradianceCache::Record IrradianceCache::ComputeRecord(CScene const& scene, CVector3d const& point, CVector3d const& normal) const
+{
+	// Лучи, отраженные точками столкновения, не трассируются, а фоновая освещенность ими не учитывается
+	RayPath path;
+	path.depth = 1;
+	path.isPathTraced = true;
+
+	const double offset = GetRayOffset(point);
+	const CVector3d rayStart = point + offset * normal;
+
+	/*
+		Направления распределены с плотностью, пропорциональной косинусу угла с нормалью, поэтому освещенность,
+		деленная на pi, равна среднему значению яркости лучей. Выборки стратифицированы по сетке grid x grid
+	*/
+	const unsigned grid = m_settings.hemisphereGrid;
+	PointRandom random(point, PointRandomStream::IrradianceCache);
+	CVector4f radianceSum;
+	double inverseDistanceSum = 0;
+	for (unsigned i = 0; i < grid; ++i)
+	{
+		for (unsigned j = 0; j < grid; ++j)
+		{
+			const double u = (i + random.NextDouble()) / grid;
+			const double v = (j + random.NextDouble()) / grid;
+			const CRay ray(rayStart, PathTracer::SampleCosineHemisphere(normal, u, v));
+
+			CIntersection bestIntersection;
+			CSceneObject const* pSceneObject = NULL;
+			if (!scene.GetFirstHit(ray, bestIntersection, &pSceneObject))
+			{
+				radianceSum += scene.GetBackdropColor();
+				continue;
+			}
+
+			CHitInfo const& hit = bestIntersection.GetHit(0);
+			const CVector3d hitPoint = hit.GetHitPoint();
+			inverseDistanceSum += 1 / Max((hitPoint - rayStart).GetLength(), m_settings.minRadius);
+			if (pSceneObject->HasShader())
+			{
+				CShadeContext shadeContext(scene, hitPoint, hit.GetHitPointInObjectSpace(), hit.GetNormal(), ray.GetDirection(), path);
+				radianceSum += pSceneObject->GetShader().Shade(shadeContext);
+			}
+		}
+	}
+
+	const unsigned samples = grid * grid;
+	Record record;
+	record.position = point;
+	record.normal = normal;
+	record.irradiance = (1.0f / static_cast<float>(samples)) * radianceSum;
+	// Лучи, не столкнувшиеся с объектами, соответствуют бесконечному расстоянию
+	record.radius = (inverseDistanceSum > 0) ? samples / inverseDistanceSum : m_settings.maxRadius;
+	record.radius = Min(Max(record.radius, m_settings.minRadius), m_settings.maxRadius);
+	return record;
+}
+
+void IrradianceCache::AddRecord(Record const& record)
+{
+	std::unique_lock lock(m_mutex);
+
+	const unsigned index = unsigned(m_records.size());
+	m_records.push_back(record);
+
+	// Запись добавляется во все ячейки, пересекающие шар, в котором она может быть использована
+	const double influenceRadius = m_settings.accuracy * record.radius;
+	const CVector3d minPoint = record.position - CVector3d(influenceRadius, influenceRadius, influenceRadius);
+	const CVector3d maxPoint = record.position + CVector3d(influenceRadius, influenceRadius, influenceRadius);
+	for (std::int64_t z = GetCellCoordinate(minPoint.z); z <= GetCellCoordinate(maxPoint.z); ++z)
+	{
+		for (std::int64_t y = GetCellCoordinate(minPoint.y); y <= GetCellCoordinate(maxPoint.y); ++y)
+		{
+			for (std::int64_t x = GetCellCoordinate(minPoint.x); x <= GetCellCoordinate(maxPoint.x); ++x)
+			{
+				m_cells[GetCellKey(x, y, z)].push_back(index);
+			}
+		}
+	}
+}
+
+void IrradianceCache::Clear()
+{
+	std::unique_lock lock(m_mutex);
+	m_records.clear();
+	m_cells.clear();
+}
+
+IrradianceCacheStatistics IrradianceCache::GetStatistics() const
+{
+	IrradianceCacheStatistics statistics;
+	statistics.lookups = m_lookups.load(std::memory_order_relaxed);
+	statistics.computedRecords = m_computedRecords.load(std::memory_order_relaxed);
+
+	std::shared_lock lock(m_mutex);
+	statistics.records = m_records.size();
+	return statistics;
+}
+
+void IrradianceCache::ResetStatistics()
+{
+	m_lookups = 0;
+	m_computedRecords = 0;
+}
+
+std::uint64_t IrradianceCache::GetCellKey(std::int64_t x, std::int64_t y, std::int64_t z) noexcept
+{
+	// По 21 разряду на координату: совпадение ключей удаленных ячеек лишь добавляет ячейке лишние записи
+	constexpr std::uint64_t mask = (1ull << 21) - 1;
+	return (std::uint64_t(x) & mask) | ((std::uint64_t(y) & mask) << 21) | ((std::uint64_t(z) & mask) << 42);
+}
+
+std::int64_t IrradianceCache::GetCellCoordinate(double coordinate) const noexcept
+{
+	// Ограничение защищает от переполнения для очень удаленных точек
+	return std::int64_t(Min(Max(floor(coordinate / m_cellSize), -1e15), 1e15));
+}
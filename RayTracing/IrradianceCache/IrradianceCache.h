@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+
+class CScene;
+
+/*
+	Параметры кэша непрямой освещенности (см. IrradianceCache). Расстояния задаются в мировой системе координат
+*/
+struct IrradianceCaching
+{
+	// Использовать непрямую освещенность вместо постоянной фоновой интенсивности источников света
+	bool enabled = false;
+	// Количество лучей на сторону стратифицированной сетки направлений полусферы при вычислении записи
+	unsigned hemisphereGrid = 8;
+	/*
+		Допустимая погрешность интерполяции: запись используется в точках, для которых сумма расстояния до нее
+		(в долях ее радиуса) и разницы нормалей меньше accuracy. Чем меньше значение, тем плотнее записи
+	*/
+	double accuracy = 0.3;
+	// Ограничения радиуса записи (среднего гармонического расстояний до окружающих поверхностей)
+	double minRadius = 0.1;
+	double maxRadius = 4;
+};
+
+// Обращения к кэшу непрямой освещенности после вызова IrradianceCache::ResetStatistics
+struct IrradianceCacheStatistics
+{
+	// Количество запросов освещенности и количество вычисленных для них записей
+	std::uint64_t lookups = 0;
+	std::uint64_t computedRecords = 0;
+	// Общее количество записей в кэше
+	std::uint64_t records = 0;
+};
+
+/*
+	Кэш непрямой освещенности (irradiance caching, Уорд). Освещенность вычисляется не в каждой точке,
+	а в редких записях: из точки записи выпускаются лучи по полусфере вокруг нормали, и свет, рассеянный
+	точками их столкновения (освещенность источниками света) или пришедший от фона, усредняется.
+	В остальных точках освещенность интерполируется по записям с близкими положением и нормалью.
+	Радиус записи - среднее гармоническое расстояний до поверхностей, поэтому записи сгущаются в углах
+	и у близко расположенных объектов, где освещенность меняется быстро.
+	Записи хранятся в пространственном хеше и используются повторно в следующих кадрах, пока
+	сцена не изменится (см. Clear). Запросы и добавление записей возможны из нескольких потоков одновременно;
+	набор записей зависит от порядка обработки точек, поэтому изображения могут незначительно различаться
+*/
+class IrradianceCache
+{
+public:
+	IrradianceCache() = default;
+	IrradianceCache(IrradianceCache const&) = delete;
+	IrradianceCache& operator=(IrradianceCache const&) = delete;
+
+	// Устанавливает параметры кэша и удаляет записи
+	void SetSettings(IrradianceCaching const& settings);
+	IrradianceCaching const& GetSettings() const noexcept;
+
+	/*
+		Средняя яркость света, падающего на точку поверхности с единичной нормалью normal
+		(освещенность, деленная на pi), с учетом одного отражения. Если подходящих записей нет,
+		вычисляет новую запись в этой точке
+	*/
+	CVector4f GetIrradiance(CScene const& scene, CVector3d const& point, CVector3d const& normal);
+
+	// Удаляет записи (после изменения геометрии или освещения сцены)
+	void Clear();
+
+	IrradianceCacheStatistics GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	struct Record
+	{
+		CVector3d position;
+		CVector3d normal;
+		CVector4f irradiance;
+		double radius;
+	};
+
+	// Интерполирует освещенность по записям. Возвращает false, если подходящих записей нет
+	bool Interpolate(CVector3d const& point, CVector3d const& normal, CVector4f& irradiance) const;
+
+	// Вычисляет запись в точке трассировкой лучей по полусфере
+	Record ComputeRecord(CScene const& scene, CVector3d const& point, CVector3d const& normal) const;
+
+	void AddRecord(Record const& record);
+
+	// Ключ ячейки пространственного хеша, содержащей точку с заданными координатами в ячейках
+	static std::uint64_t GetCellKey(std::int64_t x, std::int64_t y, std::int64_t z) noexcept;
+
+	std::int64_t GetCellCoordinate(double coordinate) const noexcept;
+
+	IrradianceCaching m_settings;
+	// Размер ячейки - наибольший радиус области, в которой используется запись
+	double m_cellSize = 1;
+
+	// Блокировка записей: запросы читают их одновременно, а добавление выполняется монопольно
+	mutable std::shared_mutex m_mutex;
+	std::vector<Record> m_records;
+	// Индексы записей, области использования которых пересекают ячейку
+	std::unordered_map<std::uint64_t, std::vector<unsigned>> m_cells;
+
+	std::atomic<std::uint64_t> m_lookups{ 0 };
+	std::atomic<std::uint64_t> m_computedRecords{ 0 };
+};
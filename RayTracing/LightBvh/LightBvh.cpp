@@ -0,0 +1,70 @@
+﻿#include <algorithm>
+#include <cmath>
+#include "LightBvh.h"
+
+void LightBvh::Build(std::vector<ILightSourcePtr> const& lights)
+{
+	m_unboundedLights.clear();
+	m_boundedLights.clear();
+	m_nodes.clear();
+
+	for (size_t i = 0; i < lights.size(); ++i)
+	{
+		ILightSource const& light = *lights[i];
+		const double radius = light.GetInfluenceRadius();
+		if (std::isinf(radius))
+		{
+			m_unboundedLights.push_back(unsigned(i));
+		}
+		else
+		{
+			m_boundedLights.push_back({ light.GetPositionInWorldSpace(), radius, unsigned(i) });
+		}
+	}
+
+	if (!m_boundedLights.empty())
+	{
+		m_nodes.reserve(2 * (m_boundedLights.size() / MAX_LEAF_LIGHTS + 1));
+		BuildNode(0, m_boundedLights.size());
+	}
+}
+
+unsigned LightBvh::BuildNode(size_t first, size_t count)
+{
+	const unsigned nodeIndex = unsigned(m_nodes.size());
+	m_nodes.emplace_back();
+
+	auto begin = m_boundedLights.begin() + first;
+	auto end = begin + count;
+
+	// Границы сфер влияния и границы их центров
+	CBoundingBox bounds;
+	CBoundingBox centerBounds;
+	for (auto it = begin; it != end; ++it)
+	{
+		const CVector3d extent(it->radius, it->radius, it->radius);
+		bounds.Extend(CBoundingBox(it->center - extent, it->center + extent));
+		centerBounds.Extend(it->center);
+	}
+	m_nodes[nodeIndex].bounds = bounds;
+
+	if (count <= MAX_LEAF_LIGHTS)
+	{
+		m_nodes[nodeIndex].first = unsigned(first);
+		m_nodes[nodeIndex].count = unsigned(count);
+		return nodeIndex;
+	}
+
+	// Источники делятся пополам по медиане центров вдоль оси наибольшей протяженности
+	const CVector3d size = centerBounds.GetMax() - centerBounds.GetMin();
+	const int axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+	const size_t half = count / 2;
+	std::nth_element(begin, begin + half, end, [axis](BoundedLight const& a, BoundedLight const& b) {
+		return a.center[axis] < b.center[axis];
+	});
+
+	BuildNode(first, half);
+	const unsigned right = BuildNode(first + half, count - half);
+	m_nodes[nodeIndex].first = right;
+	return nodeIndex;
+}
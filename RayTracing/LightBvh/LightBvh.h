@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <vector>
+#include "../BoundingBox/BoundingBox.h"
+#include "../LightSource/ILightSource.h"
+
+/*
+	Иерархия ограничивающих объемов (BVH) по сферам влияния источников света (см. ILightSource::GetInfluenceRadius).
+	Позволяет найти источники, способные осветить заданную область сцены, не перебирая все источники:
+	в сценах с тысячами источников с ограниченным радиусом влияния каждую точку освещает лишь малая их часть.
+	Источники с бесконечным радиусом влияния хранятся отдельным списком и освещают любую область
+*/
+class LightBvh
+{
+public:
+	// Строит иерархию по текущим положениям и радиусам влияния источников света
+	void Build(std::vector<ILightSourcePtr> const& lights);
+
+	/*
+		Вызывает callback(индекс источника) для источников, которые могут осветить точки параллелепипеда bounds:
+		сначала для всех источников с бесконечным радиусом влияния в порядке возрастания индексов,
+		затем для источников, сфера влияния которых пересекает параллелепипед
+	*/
+	template <class Callback>
+	void ForEachLight(CBoundingBox const& bounds, Callback&& callback) const
+	{
+		for (unsigned index : m_unboundedLights)
+		{
+			callback(size_t(index));
+		}
+
+		if (m_nodes.empty())
+		{
+			return;
+		}
+
+		// Правые потомки узлов, которые предстоит обойти
+		unsigned stack[MAX_DEPTH];
+		size_t stackSize = 0;
+		unsigned nodeIndex = 0;
+		for (;;)
+		{
+			Node const& node = m_nodes[nodeIndex];
+			if (node.bounds.Intersects(bounds))
+			{
+				if (node.count == 0)
+				{
+					// Левый потомок узла следует сразу за ним
+					stack[stackSize++] = node.first;
+					++nodeIndex;
+					continue;
+				}
+
+				for (unsigned i = node.first; i < node.first + node.count; ++i)
+				{
+					BoundedLight const& light = m_boundedLights[i];
+					if (bounds.GetSquaredDistance(light.center) <= light.radius * light.radius)
+					{
+						callback(size_t(light.index));
+					}
+				}
+			}
+
+			if (stackSize == 0)
+			{
+				break;
+			}
+			nodeIndex = stack[--stackSize];
+		}
+	}
+
+private:
+	// Источник света с конечным радиусом влияния
+	struct BoundedLight
+	{
+		CVector3d center;
+		double radius;
+		unsigned index;
+	};
+
+	/*
+		Узел иерархии. Лист (count != 0) ссылается на count источников, начиная с first.
+		У внутреннего узла (count == 0) левый потомок хранится сразу за ним, а first - индекс правого потомка
+	*/
+	struct Node
+	{
+		CBoundingBox bounds;
+		unsigned first = 0;
+		unsigned count = 0;
+	};
+
+	// Максимальное количество источников в листе
+	static constexpr size_t MAX_LEAF_LIGHTS = 4;
+
+	// Глубина иерархии: узлы делятся пополам, поэтому она не превышает разрядности индексов
+	static constexpr size_t MAX_DEPTH = 64;
+
+	// Строит узел для источников [first; first + count) и возвращает его индекс
+	unsigned BuildNode(size_t first, size_t count);
+
+	std::vector<unsigned> m_unboundedLights;
+	std::vector<BoundedLight> m_boundedLights;
+	std::vector<Node> m_nodes;
+};
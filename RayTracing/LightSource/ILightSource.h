@@ -3,6 +3,8 @@
 #include "../Vector/Vector_fwd.h"
 #include "../Matrix/Matrix_fwd.h"
 
+class CBoundingBox;
+
 /*
 	Интерфейс "Источник света"
 */
@@ -50,4 +52,29 @@ public:
 
 	// Получение позиции источника света в мировых координатах
 	virtual CVector3d const& GetPositionInWorldSpace() const = 0;
+
+	/*
+		Радиус сферы с центром в позиции источника, за пределами которой вклад источника в освещенность
+		пренебрежимо мал и не учитывается шейдерами. Для источников, освещающих всю сцену, - бесконечность
+	*/
+	virtual double GetInfluenceRadius() const = 0;
+
+	/*
+		Протяженный источник света отбрасывает мягкие тени: его видимость из точки оценивается несколькими
+		теневыми лучами (см. CScene::GetLightVisibility)
+	*/
+	virtual bool IsAreaLight() const = 0;
+
+	/*
+		Точка источника света в мировых координатах, к которой выпускается теневой луч из точки point, для выборки
+		(u, v) из [0; 1)^2. Равномерно распределенные выборки равномерно покрывают видимую из точки поверхность
+		источника. Для точечных источников - положение источника
+	*/
+	virtual CVector3d GetShadowSamplePoint(CVector3d const& point, double u, double v) const = 0;
+
+	/*
+		Ограничивающий параллелепипед светящейся поверхности источника в мировых координатах: все точки,
+		к которым могут выпускаться теневые лучи. Для точечных источников вырождается в положение источника
+	*/
+	virtual CBoundingBox GetEmitterBounds() const = 0;
 };
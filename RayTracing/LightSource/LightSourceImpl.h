@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "ILightSource.h"
+#include "../BoundingBox/BoundingBox.h"
 #include "../Matrix/Matrix4.h"
 #include "../Vector/Vector4.h"
 #include "../Vector/VectorMath.h"
@@ -79,6 +80,24 @@ public:
 		return m_positionInWorldSpace;
 	}
 
+	/*
+	По умолчанию источник считается точечным
+	*/
+	virtual bool IsAreaLight() const
+	{
+		return false;
+	}
+
+	virtual CVector3d GetShadowSamplePoint(CVector3d const& /*point*/, double /*u*/, double /*v*/) const
+	{
+		return m_positionInWorldSpace;
+	}
+
+	virtual CBoundingBox GetEmitterBounds() const
+	{
+		return CBoundingBox(m_positionInWorldSpace, m_positionInWorldSpace);
+	}
+
 protected:
 	CLightSourceImpl(CMatrix4d const& transform = CMatrix4d(), const CVector3d& position = CVector3d())
 		: m_transform(transform)
@@ -1,5 +1,7 @@
 ﻿#include "OmniLightSource.h"
 #include "../Vector/VectorMath.h"
+#include <cmath>
+#include <limits>
 
 /*
 	Инициализация параметров источника света (положение и трансформация)
@@ -9,6 +11,8 @@ COmniLightSource::COmniLightSource(CVector3d const& position, CMatrix4d const& t
 	, m_constantAttenuation(1)
 	, m_linearAttenuation(0)
 	, m_quadraticAttenuation(0)
+	, m_influenceCutoff(0)
+	, m_influenceRadius(std::numeric_limits<double>::infinity())
 {
 	UpdatePositionInWorldSpace();
 }
@@ -24,6 +28,46 @@ void COmniLightSource::SetAttenuation(
 	m_constantAttenuation = constantAttenuation;
 	m_linearAttenuation = linearAttenuation;
 	m_quadraticAttenuation = quadraticAttenuation;
+	UpdateInfluenceRadius();
+}
+
+void COmniLightSource::SetInfluenceCutoff(double cutoff)
+{
+	m_influenceCutoff = cutoff;
+	UpdateInfluenceRadius();
+}
+
+double COmniLightSource::GetInfluenceRadius() const
+{
+	return m_influenceRadius;
+}
+
+void COmniLightSource::UpdateInfluenceRadius()
+{
+	/*
+		Радиус d - положительный корень уравнения q*d^2 + l*d + c = 1 / cutoff
+	*/
+	if (!(m_influenceCutoff > 0) || (m_linearAttenuation <= 0 && m_quadraticAttenuation <= 0))
+	{
+		m_influenceRadius = std::numeric_limits<double>::infinity();
+		return;
+	}
+
+	const double rest = 1.0 / m_influenceCutoff - m_constantAttenuation;
+	if (rest <= 0)
+	{
+		// Интенсивность ниже порога уже в самом источнике
+		m_influenceRadius = 0;
+	}
+	else if (m_quadraticAttenuation > 0)
+	{
+		const double linear = m_linearAttenuation;
+		m_influenceRadius = (std::sqrt(linear * linear + 4 * m_quadraticAttenuation * rest) - linear) / (2 * m_quadraticAttenuation);
+	}
+	else
+	{
+		m_influenceRadius = rest / m_linearAttenuation;
+	}
 }
 
 void COmniLightSource::SetTransform(CMatrix4d const& transform)
@@ -37,11 +37,29 @@ public:
 		double const& linearAttenuation,
 		double const& quadraticAttenuation);
 
+	/*
+	Установка порога ослабления: в точках, где интенсивность, вычисленная с учетом коэффициентов ослабления,
+	меньше cutoff, вклад источника не учитывается. При нулевом пороге (по умолчанию) источник освещает всю сцену
+	*/
+	void SetInfluenceCutoff(double cutoff);
+
+	/*
+	Расстояние, на котором интенсивность ослабевает до порога. Бесконечно, если порог не задан
+	или интенсивность не убывает с расстоянием
+	*/
+	virtual double GetInfluenceRadius() const;
+
 private:
+	void UpdateInfluenceRadius();
+
 	// Коэффициенты ослабления света в зависимосит от расстояния
 	double m_constantAttenuation;
 	double m_linearAttenuation;
 	double m_quadraticAttenuation;
+
+	// Порог ослабления и соответствующий ему радиус влияния источника
+	double m_influenceCutoff;
+	double m_influenceRadius;
 };
 
 using COmniLightPtr = std::shared_ptr<COmniLightSource>;
\ No newline at end of file
@@ -0,0 +1,61 @@
+﻿#include "RectangleLightSource.h"
+#include "../Vector/VectorMath.h"
+#include <cmath>
+
+CRectangleLightSource::CRectangleLightSource(
+	CVector3d const& position,
+	CVector3d const& edgeU,
+	CVector3d const& edgeV,
+	CMatrix4d const& transform)
+	: COmniLightSource(position, transform)
+	, m_edgeU(edgeU)
+	, m_edgeV(edgeV)
+{
+	UpdateEdgesInWorldSpace();
+}
+
+void CRectangleLightSource::SetTransform(CMatrix4d const& transform)
+{
+	COmniLightSource::SetTransform(transform);
+	UpdateEdgesInWorldSpace();
+}
+
+double CRectangleLightSource::GetIntensityInDirection(CVector3d const& direction) const
+{
+	/*
+		Видимая из точки площадь прямоугольника пропорциональна косинусу угла между направлением и нормалью
+	*/
+	const double length = direction.GetLength();
+	const double cosine = (length > 0) ? fabs(Dot(direction, m_normalInWorldSpace)) / length : 1.0;
+	return cosine * COmniLightSource::GetIntensityInDirection(direction);
+}
+
+bool CRectangleLightSource::IsAreaLight() const
+{
+	return true;
+}
+
+CVector3d CRectangleLightSource::GetShadowSamplePoint(CVector3d const& /*point*/, double u, double v) const
+{
+	return GetPositionInWorldSpace() + (u - 0.5) * m_edgeUInWorldSpace + (v - 0.5) * m_edgeVInWorldSpace;
+}
+
+CBoundingBox CRectangleLightSource::GetEmitterBounds() const
+{
+	CBoundingBox bounds;
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		bounds.Extend(GetShadowSamplePoint(CVector3d(), double(i & 1), double(i >> 1)));
+	}
+	return bounds;
+}
+
+void CRectangleLightSource::UpdateEdgesInWorldSpace()
+{
+	// Стороны - векторы, поэтому перенос на них не влияет
+	m_edgeUInWorldSpace = GetTransform() * CVector4d(m_edgeU, 0);
+	m_edgeVInWorldSpace = GetTransform() * CVector4d(m_edgeV, 0);
+
+	const CVector3d normal = Cross(m_edgeUInWorldSpace, m_edgeVInWorldSpace);
+	m_normalInWorldSpace = (normal.GetLength() > 0) ? Normalize(normal) : CVector3d();
+}
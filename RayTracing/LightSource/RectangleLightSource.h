@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "OmniLightSource.h"
+
+/*
+	Класс "Прямоугольный источник света" - светящийся прямоугольник с центром в позиции источника и сторонами,
+	заданными векторами edgeU и edgeV. Освещенность вычисляется, как для точечного источника в центре
+	прямоугольника (с теми же коэффициентами ослабления), с учетом косинуса угла между направлением
+	на точку и нормалью прямоугольника (светятся обе стороны). Отбрасывает мягкие тени
+*/
+class CRectangleLightSource : public COmniLightSource
+{
+public:
+	CRectangleLightSource(
+		CVector3d const& position = CVector3d(),
+		CVector3d const& edgeU = CVector3d(1, 0, 0),
+		CVector3d const& edgeV = CVector3d(0, 0, 1),
+		CMatrix4d const& transform = CMatrix4d());
+
+	/*
+	При установке матрицы трансформации стороны прямоугольника также переводятся в мировые координаты
+	*/
+	virtual void SetTransform(CMatrix4d const& transform);
+
+	/*
+	Интенсивность точечного источника, умноженная на косинус угла между направлением и нормалью прямоугольника
+	*/
+	virtual double GetIntensityInDirection(CVector3d const& direction) const;
+
+	virtual bool IsAreaLight() const;
+
+	/*
+	Точка прямоугольника, соответствующая выборке (u, v)
+	*/
+	virtual CVector3d GetShadowSamplePoint(CVector3d const& point, double u, double v) const;
+
+	/*
+	Параллелепипед, содержащий вершины прямоугольника
+	*/
+	virtual CBoundingBox GetEmitterBounds() const;
+
+private:
+	void UpdateEdgesInWorldSpace();
+
+	// Стороны прямоугольника в системе координат источника и в мировой системе координат
+	CVector3d m_edgeU;
+	CVector3d m_edgeV;
+	CVector3d m_edgeUInWorldSpace;
+	CVector3d m_edgeVInWorldSpace;
+	// Единичная нормаль прямоугольника в мировой системе координат
+	CVector3d m_normalInWorldSpace;
+};
+
+using CRectangleLightPtr = std::shared_ptr<CRectangleLightSource>;
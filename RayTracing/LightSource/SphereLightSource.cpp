@@ -0,0 +1,44 @@
+﻿#include "SphereLightSource.h"
+#include "../Vector/VectorMath.h"
+#include <cmath>
+
+CSphereLightSource::CSphereLightSource(CVector3d const& position, double radius, CMatrix4d const& transform)
+	: COmniLightSource(position, transform)
+	, m_radius(radius)
+{
+}
+
+bool CSphereLightSource::IsAreaLight() const
+{
+	return true;
+}
+
+CVector3d CSphereLightSource::GetShadowSamplePoint(CVector3d const& point, double u, double v) const
+{
+	CVector3d const& center = GetPositionInWorldSpace();
+	const CVector3d direction = center - point;
+	const double distance = direction.GetLength();
+	if (distance <= m_radius)
+	{
+		// Точка внутри сферы
+		return center;
+	}
+
+	// Ортонормированный базис плоскости диска
+	const CVector3d w = direction / distance;
+	const CVector3d helper = (fabs(w.x) < 0.9) ? CVector3d(1, 0, 0) : CVector3d(0, 1, 0);
+	const CVector3d tangent = Normalize(Cross(helper, w));
+	const CVector3d bitangent = Cross(w, tangent);
+
+	// Равномерное распределение точек по площади диска
+	const double r = m_radius * sqrt(u);
+	const double angle = 2 * PI * v;
+	return center + (r * cos(angle)) * tangent + (r * sin(angle)) * bitangent;
+}
+
+CBoundingBox CSphereLightSource::GetEmitterBounds() const
+{
+	CVector3d const& center = GetPositionInWorldSpace();
+	const CVector3d halfSize(m_radius, m_radius, m_radius);
+	return CBoundingBox(center - halfSize, center + halfSize);
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include "OmniLightSource.h"
+
+/*
+	Класс "Сферический источник света" - светящаяся сфера с центром в позиции источника.
+	Освещенность вычисляется, как для точечного источника в центре сферы (с теми же коэффициентами ослабления),
+	а тени - мягкие, с полутенью, размер которой определяется радиусом сферы
+*/
+class CSphereLightSource : public COmniLightSource
+{
+public:
+	CSphereLightSource(
+		CVector3d const& position = CVector3d(),
+		double radius = 1,
+		CMatrix4d const& transform = CMatrix4d());
+
+	virtual bool IsAreaLight() const;
+
+	/*
+	Точка диска, которым сфера видна из точки point (диск перпендикулярен направлению на центр сферы).
+	Радиус сферы задается в мировой системе координат
+	*/
+	virtual CVector3d GetShadowSamplePoint(CVector3d const& point, double u, double v) const;
+
+	/*
+	Куб, описанный вокруг сферы
+	*/
+	virtual CBoundingBox GetEmitterBounds() const;
+
+private:
+	double m_radius;
+};
+
+using CSphereLightPtr = std::shared_ptr<CSphereLightSource>;
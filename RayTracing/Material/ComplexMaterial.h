@@ -51,10 +51,58 @@ public:
 		m_specularCoefficient = coefficient;
 	}
 
+	/*
+		 :  ,    ,   
+	*/
+	CVector4f const& GetReflectionColor() const
+	{
+		return m_reflectionColor;
+	}
+
+	void SetReflectionColor(CVector4f const& reflectionColor)
+	{
+		m_reflectionColor = reflectionColor;
+	}
+
+	/*
+		 :  ,      .
+		       (  )
+	*/
+	CVector4f const& GetTransparencyColor() const
+	{
+		return m_transparencyColor;
+	}
+
+	void SetTransparencyColor(CVector4f const& transparencyColor)
+	{
+		m_transparencyColor = transparencyColor;
+	}
+
+	//    
+	float GetRefractiveIndex() const
+	{
+		return m_refractiveIndex;
+	}
+
+	void SetRefractiveIndex(float refractiveIndex)
+	{
+		m_refractiveIndex = refractiveIndex;
+	}
+
+	//       
+	bool HasSecondaryRays() const
+	{
+		return m_reflectionColor.x > 0 || m_reflectionColor.y > 0 || m_reflectionColor.z > 0
+			|| m_transparencyColor.x > 0 || m_transparencyColor.y > 0 || m_transparencyColor.z > 0;
+	}
+
 private:
 	CVector4f m_diffuseColor;
 	CVector4f m_ambientColor;
 	CVector4f m_specularColor;
-	
+	CVector4f m_reflectionColor;
+	CVector4f m_transparencyColor;
+
 	float m_specularCoefficient{128};
+	float m_refractiveIndex{1};
 };
\ No newline at end of file
@@ -469,6 +469,22 @@ public:
 		memcpy(data, identityMatrix, sizeof(identityMatrix));
 	}
 
+	// Является ли матрица единичной
+	bool IsIdentity() const noexcept
+	{
+		for (unsigned row = 0; row < 4; ++row)
+		{
+			for (unsigned column = 0; column < 4; ++column)
+			{
+				if (mat[row][column] != T(row == column ? 1 : 0))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
 	void Normalize() noexcept
 	{
 		/*
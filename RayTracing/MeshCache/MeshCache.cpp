@@ -0,0 +1,215 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <numeric>
+#include <vector>
+#include "MeshCache.h"
+#include "../AmbientOcclusionBaker/AmbientOcclusionBaker.h"
+#include "../GeometryObjects/PolytopeReader/PolytopeReader.h"
+#include "../MeshReorder/MeshReorder.h"
+#include "../MeshSimplifier/MeshSimplifier.h"
+
+namespace
+{
+// Во сколько раз количество треугольников каждого уровня детализации меньше, чем у предыдущего
+constexpr size_t LEVEL_OF_DETAIL_REDUCTION = 4;
+// Минимальное количество треугольников уровня детализации
+constexpr size_t MIN_LEVEL_OF_DETAIL_TRIANGLES = 256;
+} // namespace
+
+MeshCache& MeshCache::GetInstance()
+{
+	static MeshCache instance;
+	return instance;
+}
+
+std::shared_ptr<CTriangleMeshData const> MeshCache::Load(std::string const& filePath, MeshLoadOptions const& options)
+{
+	// Разные записи одного и того же пути (относительные, с "..", и т.п.) приводятся к одному ключу
+	std::error_code errorCode;
+	const std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(filePath, errorCode);
+	const Key key(errorCode ? filePath : canonicalPath.string(), options);
+
+	std::promise<MeshDataPtr> loadPromise;
+	std::shared_future<MeshDataPtr> data;
+	bool mustLoad = false;
+	{
+		std::lock_guard lock(m_mutex);
+		auto [it, inserted] = m_entries.try_emplace(key);
+		it->second.lastAccess = ++m_accessCounter;
+		if (inserted)
+		{
+			it->second.data = loadPromise.get_future().share();
+			mustLoad = true;
+		}
+		data = it->second.data;
+	}
+
+	if (!mustLoad)
+	{
+		// Сетка уже загружена либо загружается другим потоком
+		return data.get();
+	}
+
+	MeshDataPtr meshData;
+	try
+	{
+		meshData = LoadMeshData(key.first, options);
+	}
+	catch (...)
+	{
+		// Ожидающие потоки получат то же исключение, а следующее обращение повторит загрузку
+		loadPromise.set_exception(std::current_exception());
+		std::lock_guard lock(m_mutex);
+		m_entries.erase(key);
+		throw;
+	}
+	loadPromise.set_value(meshData);
+
+	std::lock_guard lock(m_mutex);
+	auto it = m_entries.find(key);
+	if (it != m_entries.end())
+	{
+		it->second.memoryUsage = meshData->GetMemoryUsage();
+		m_memoryUsage += it->second.memoryUsage;
+		if (m_memoryBudget > 0)
+		{
+			EvictUnusedLocked(m_memoryBudget);
+		}
+	}
+	return meshData;
+}
+
+size_t MeshCache::GetMeshCount() const
+{
+	std::lock_guard lock(m_mutex);
+	return m_entries.size();
+}
+
+size_t MeshCache::GetMemoryUsage() const
+{
+	std::lock_guard lock(m_mutex);
+	return m_memoryUsage;
+}
+
+void MeshCache::SetMemoryBudget(size_t budget)
+{
+	std::lock_guard lock(m_mutex);
+	m_memoryBudget = budget;
+	if (m_memoryBudget > 0)
+	{
+		EvictUnusedLocked(m_memoryBudget);
+	}
+}
+
+size_t MeshCache::EvictUnused()
+{
+	std::lock_guard lock(m_mutex);
+	return EvictUnusedLocked(0);
+}
+
+MeshCache::MeshDataPtr MeshCache::LoadMeshData(std::string const& filePath, MeshLoadOptions const& options)
+{
+	PolytopeReader polytopeReader(filePath);
+
+	std::vector<Vertex> vertices;
+	std::vector<Face> faces;
+	polytopeReader.Read(vertices, faces);
+
+	std::vector<unsigned> originalFaceIndices;
+	if (options.reorderTriangles)
+	{
+		MeshReorder::ReorderAlongHilbertCurve(vertices, faces, options.keepOriginalFaceIndices ? &originalFaceIndices : nullptr);
+	}
+
+	auto pMeshData = std::make_shared<CTriangleMeshData>(vertices, faces, options.normalizeNormals, originalFaceIndices);
+	if (options.bakeAmbientOcclusion)
+	{
+		pMeshData->SetVertexAmbientOcclusion(AmbientOcclusionBaker::Bake(*pMeshData));
+	}
+
+	if (options.buildLevelsOfDetail)
+	{
+		// Каждый уровень строится упрощением предыдущего. Упрощение сохраняет порядок оставшихся граней и вершин,
+		// поэтому повторное переупорядочивание не требуется
+		if (options.keepOriginalFaceIndices && originalFaceIndices.empty())
+		{
+			// Грани не переупорядочивались, но упрощение удаляет часть из них
+			originalFaceIndices.resize(faces.size());
+			std::iota(originalFaceIndices.begin(), originalFaceIndices.end(), 0u);
+		}
+
+		CTriangleMeshData* pLevel = pMeshData.get();
+		while (faces.size() / LEVEL_OF_DETAIL_REDUCTION >= MIN_LEVEL_OF_DETAIL_TRIANGLES)
+		{
+			const size_t previousFaceCount = faces.size();
+			MeshSimplifier::Simplify(vertices, faces, previousFaceCount / LEVEL_OF_DETAIL_REDUCTION,
+				originalFaceIndices.empty() ? nullptr : &originalFaceIndices);
+			if (faces.size() * 2 > previousFaceCount)
+			{
+				// Сетку не удается существенно упростить, не нарушая ее топологию
+				break;
+			}
+
+			auto pCoarserLevel = std::make_unique<CTriangleMeshData>(vertices, faces, options.normalizeNormals, originalFaceIndices);
+			if (options.bakeAmbientOcclusion)
+			{
+				// Вершины упрощенного уровня смещены, поэтому затенение вычисляется для каждого уровня отдельно
+				pCoarserLevel->SetVertexAmbientOcclusion(AmbientOcclusionBaker::Bake(*pCoarserLevel));
+			}
+			CTriangleMeshData* pNextLevel = pCoarserLevel.get();
+			pLevel->SetCoarserLevel(std::move(pCoarserLevel));
+			pLevel = pNextLevel;
+		}
+	}
+
+	return pMeshData;
+}
+
+size_t MeshCache::EvictUnusedLocked(size_t budget)
+{
+	// Неиспользуемые сетки в порядке давности последнего обращения
+	std::vector<std::map<Key, Entry>::iterator> candidates;
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		if (!IsUsed(it->second))
+		{
+			candidates.push_back(it);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](auto const& lhs, auto const& rhs) {
+		return lhs->second.lastAccess < rhs->second.lastAccess;
+	});
+
+	size_t freedMemory = 0;
+	for (auto const& it : candidates)
+	{
+		if (m_memoryUsage <= budget)
+		{
+			break;
+		}
+		m_memoryUsage -= it->second.memoryUsage;
+		freedMemory += it->second.memoryUsage;
+		m_entries.erase(it);
+	}
+	return freedMemory;
+}
+
+bool MeshCache::IsUsed(Entry const& entry)
+{
+	// Загружаемую сетку удалять нельзя: ее ожидают другие потоки
+	if (entry.data.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return true;
+	}
+
+	// Одна ссылка на данные хранится в самом кэше
+	try
+	{
+		return entry.data.get().use_count() > 1;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
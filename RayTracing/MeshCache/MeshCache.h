@@ -0,0 +1,101 @@
+﻿#pragma once
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include "../TriangleMesh/TriangleMesh.h"
+
+// Параметры загрузки сетки. Сетки одного файла, загруженные с разными параметрами, хранятся в кэше отдельно
+struct MeshLoadOptions
+{
+	// Выполнить ли нормализацию нормалей вершин
+	bool normalizeNormals = false;
+	// Переупорядочить ли треугольники и вершины для локальности обращений к памяти (см. MeshReorder)
+	bool reorderTriangles = true;
+	// Сохранить ли исходные индексы переупорядоченных граней (см. CTriangleMeshData::GetOriginalFaceIndex)
+	bool keepOriginalFaceIndices = false;
+	// Построить ли цепочку упрощенных уровней детализации (см. CTriangleMeshData::GetCoarserLevel)
+	bool buildLevelsOfDetail = false;
+	// Вычислить ли фоновое затенение вершин каждого уровня детализации (см. AmbientOcclusionBaker)
+	bool bakeAmbientOcclusion = false;
+
+	bool operator<(MeshLoadOptions const& other) const
+	{
+		return std::tie(normalizeNormals, reorderTriangles, keepOriginalFaceIndices, buildLevelsOfDetail, bakeAmbientOcclusion)
+			< std::tie(other.normalizeNormals, other.reorderTriangles, other.keepOriginalFaceIndices, other.buildLevelsOfDetail,
+				other.bakeAmbientOcclusion);
+	}
+};
+
+/*
+	Общий для всего процесса кэш полигональных сеток, загружаемых из файлов OBJ.
+	Каждый файл читается один раз, а его неизменяемые данные (вершины, треугольники с предвычисленными
+	параметрами, ограничивающий параллелепипед и, по запросу, фоновое затенение вершин) совместно используются
+	любым количеством объектов CTriangleMesh с различными трансформациями.
+
+	Методы класса потокобезопасны. Если одну и ту же сетку одновременно запрашивают несколько потоков,
+	файл читает только первый из них, а остальные дожидаются результата
+*/
+class MeshCache
+{
+public:
+	static MeshCache& GetInstance();
+
+	/*
+		Возвращает данные сетки из файла filePath, загружая их при первом обращении.
+		Ключом кэша служат канонический путь к файлу и параметры загрузки.
+		Если файл прочитать не удалось, возвращаются данные пустой сетки (GetTriangleCount() == 0)
+	*/
+	std::shared_ptr<CTriangleMeshData const> Load(std::string const& filePath, MeshLoadOptions const& options = MeshLoadOptions());
+
+	// Количество сеток в кэше
+	size_t GetMeshCount() const;
+
+	// Объем памяти, занимаемой данными сеток в кэше, в байтах
+	size_t GetMemoryUsage() const;
+
+	/*
+		Ограничение объема памяти (0 - без ограничения). При его превышении из кэша удаляются сетки,
+		не используемые за пределами кэша, начиная с тех, к которым дольше всего не обращались
+	*/
+	void SetMemoryBudget(size_t budget);
+
+	// Удаляет из кэша сетки, не используемые за пределами кэша. Возвращает объем освобожденной памяти
+	size_t EvictUnused();
+
+private:
+	MeshCache() = default;
+	MeshCache(MeshCache const&) = delete;
+	MeshCache& operator=(MeshCache const&) = delete;
+
+	using MeshDataPtr = std::shared_ptr<CTriangleMeshData const>;
+
+	struct Entry
+	{
+		// Результат загрузки (доступен после того, как загружающий поток прочитает файл)
+		std::shared_future<MeshDataPtr> data;
+		// Объем памяти сетки (0, пока сетка загружается)
+		size_t memoryUsage = 0;
+		// Номер последнего обращения
+		unsigned long long lastAccess = 0;
+	};
+
+	using Key = std::pair<std::string, MeshLoadOptions>;
+
+	static MeshDataPtr LoadMeshData(std::string const& filePath, MeshLoadOptions const& options);
+
+	// Удаляет неиспользуемые сетки до тех пор, пока объем памяти превышает budget. Вызывается под блокировкой
+	size_t EvictUnusedLocked(size_t budget);
+
+	// Используется ли загруженная сетка за пределами кэша. Вызывается под блокировкой
+	static bool IsUsed(Entry const& entry);
+
+private:
+	mutable std::mutex m_mutex;
+	std::map<Key, Entry> m_entries;
+	size_t m_memoryUsage = 0;
+	size_t m_memoryBudget = 0;
+	unsigned long long m_accessCounter = 0;
+};
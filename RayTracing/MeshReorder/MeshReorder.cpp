@@ -0,0 +1,146 @@
+﻿#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include "MeshReorder.h"
+
+namespace
+{
+// Количество бит на координату, используемое при вычислении индекса вдоль кривой Гильберта
+constexpr unsigned HILBERT_BITS = 10;
+} // namespace
+
+/*
+	Координаты преобразуются в "транспонированный" индекс Гильберта (алгоритм Дж. Скиллинга),
+	биты которого затем чередуются
+*/
+std::uint32_t MeshReorder::GetHilbertIndex(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+	std::uint32_t axes[3] = { x, y, z };
+	const std::uint32_t highBit = 1u << (HILBERT_BITS - 1);
+
+	// Обратное кодирование Грея
+	for (std::uint32_t q = highBit; q > 1; q >>= 1)
+	{
+		const std::uint32_t p = q - 1;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (axes[i] & q)
+			{
+				// Инвертируем младшие биты
+				axes[0] ^= p;
+			}
+			else
+			{
+				// Обмениваем младшие биты
+				const std::uint32_t t = (axes[0] ^ axes[i]) & p;
+				axes[0] ^= t;
+				axes[i] ^= t;
+			}
+		}
+	}
+
+	// Кодирование Грея
+	axes[1] ^= axes[0];
+	axes[2] ^= axes[1];
+	std::uint32_t t = 0;
+	for (std::uint32_t q = highBit; q > 1; q >>= 1)
+	{
+		if (axes[2] & q)
+		{
+			t ^= q - 1;
+		}
+	}
+	for (std::uint32_t& axis : axes)
+	{
+		axis ^= t;
+	}
+
+	// Чередуем биты координат, начиная со старших
+	std::uint32_t index = 0;
+	for (int bit = int(HILBERT_BITS) - 1; bit >= 0; --bit)
+	{
+		for (std::uint32_t axis : axes)
+		{
+			index = (index << 1) | ((axis >> bit) & 1);
+		}
+	}
+	return index;
+}
+
+void MeshReorder::ReorderAlongHilbertCurve(std::vector<Vertex>& vertices, std::vector<Face>& faces,
+	std::vector<unsigned>* pOriginalFaceIndices)
+{
+	const size_t numFaces = faces.size();
+	const size_t numVertices = vertices.size();
+
+	// Центры треугольников и их ограничивающий параллелепипед
+	std::vector<CVector3d> centroids(numFaces);
+	CBoundingBox centroidBounds;
+	for (size_t i = 0; i < numFaces; ++i)
+	{
+		Face const& face = faces[i];
+		centroids[i] = (vertices[face.vertex0].position + vertices[face.vertex1].position + vertices[face.vertex2].position) / 3.0;
+		centroidBounds.Extend(centroids[i]);
+	}
+
+	// Индексы центров вдоль кривой Гильберта в решетке 2^10 x 2^10 x 2^10, покрывающей параллелепипед
+	const double maxCoordinate = double((1u << HILBERT_BITS) - 1);
+	const CVector3d minPoint = centroidBounds.IsEmpty() ? CVector3d() : centroidBounds.GetMin();
+	const CVector3d size = centroidBounds.IsEmpty() ? CVector3d() : centroidBounds.GetMax() - centroidBounds.GetMin();
+	const CVector3d scale(
+		(size.x > 0) ? maxCoordinate / size.x : 0.0,
+		(size.y > 0) ? maxCoordinate / size.y : 0.0,
+		(size.z > 0) ? maxCoordinate / size.z : 0.0);
+
+	std::vector<std::uint32_t> keys(numFaces);
+	for (size_t i = 0; i < numFaces; ++i)
+	{
+		const CVector3d gridPoint = (centroids[i] - minPoint) * scale;
+		keys[i] = GetHilbertIndex(std::uint32_t(gridPoint.x), std::uint32_t(gridPoint.y), std::uint32_t(gridPoint.z));
+	}
+
+	// Устойчивая сортировка сохраняет исходный порядок треугольников с одинаковыми индексами
+	std::vector<unsigned> faceOrder(numFaces);
+	std::iota(faceOrder.begin(), faceOrder.end(), 0u);
+	std::stable_sort(faceOrder.begin(), faceOrder.end(), [&keys](unsigned a, unsigned b) {
+		return keys[a] < keys[b];
+	});
+
+	// Нумеруем вершины в порядке первого обращения к ним переупорядоченных граней
+	const unsigned NO_INDEX = std::numeric_limits<unsigned>::max();
+	std::vector<unsigned> newVertexIndices(numVertices, NO_INDEX);
+	std::vector<Vertex> newVertices;
+	newVertices.reserve(numVertices);
+	auto renumber = [&](unsigned vertexIndex) {
+		unsigned& newIndex = newVertexIndices[vertexIndex];
+		if (newIndex == NO_INDEX)
+		{
+			newIndex = unsigned(newVertices.size());
+			newVertices.push_back(vertices[vertexIndex]);
+		}
+		return newIndex;
+	};
+
+	std::vector<Face> newFaces;
+	newFaces.reserve(numFaces);
+	for (unsigned faceIndex : faceOrder)
+	{
+		Face const& face = faces[faceIndex];
+		newFaces.emplace_back(renumber(face.vertex0), renumber(face.vertex1), renumber(face.vertex2), face.isFlat);
+	}
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		if (newVertexIndices[i] == NO_INDEX)
+		{
+			newVertices.push_back(vertices[i]);
+		}
+	}
+
+	vertices.swap(newVertices);
+	faces.swap(newFaces);
+	if (pOriginalFaceIndices)
+	{
+		pOriginalFaceIndices->swap(faceOrder);
+	}
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+#include <vector>
+#include "../TriangleMesh/TriangleMesh.h"
+
+/*
+	Переупорядочивание треугольников и вершин полигональной сетки для улучшения локальности обращений к памяти.
+
+	В файлах, полученных сканированием или экспортом, соседние в пространстве треугольники часто
+	находятся далеко друг от друга в массиве граней. Треугольники сортируются вдоль кривой Гильберта,
+	проходящей через их центры, а вершины нумеруются заново в порядке первого обращения к ним,
+	поэтому близкие треугольники и их вершины оказываются в соседних участках памяти.
+	Выполняется до построения CTriangleMeshData (и вычисления параметров треугольников)
+*/
+class MeshReorder
+{
+public:
+	/*
+		Переупорядочивает грани и вершины. Вершины, не используемые гранями, помещаются в конец массива.
+		Если задан pOriginalFaceIndices, в него помещаются исходные индексы граней (по одному на грань)
+	*/
+	static void ReorderAlongHilbertCurve(std::vector<Vertex>& vertices, std::vector<Face>& faces,
+		std::vector<unsigned>* pOriginalFaceIndices = nullptr);
+
+	// Индекс точки с целочисленными координатами из [0; 2^10) вдоль трехмерной кривой Гильберта
+	static std::uint32_t GetHilbertIndex(std::uint32_t x, std::uint32_t y, std::uint32_t z);
+};
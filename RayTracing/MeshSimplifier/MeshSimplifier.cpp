@@ -0,0 +1,503 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include "MeshSimplifier.h"
+#include "../Vector/VectorMath.h"
+
+namespace
+{
+// Вес плоскостей, сохраняющих границы сетки, относительно плоскостей граней
+constexpr double BOUNDARY_WEIGHT = 100.0;
+
+const unsigned INVALID_INDEX = std::numeric_limits<unsigned>::max();
+
+/*
+	Квадрика - симметричная матрица 4x4, задающая сумму квадратов расстояний от точки до набора плоскостей.
+	Хранятся 10 коэффициентов верхнего треугольника матрицы
+*/
+struct Quadric
+{
+	double a2 = 0, ab = 0, ac = 0, ad = 0;
+	double b2 = 0, bc = 0, bd = 0;
+	double c2 = 0, cd = 0;
+	double d2 = 0;
+
+	// Добавляет плоскость ax + by + cz + d = 0 (нормаль единичной длины) с заданным весом
+	void AddPlane(CVector3d const& normal, double d, double weight)
+	{
+		const double a = normal.x, b = normal.y, c = normal.z;
+		a2 += weight * a * a;
+		ab += weight * a * b;
+		ac += weight * a * c;
+		ad += weight * a * d;
+		b2 += weight * b * b;
+		bc += weight * b * c;
+		bd += weight * b * d;
+		c2 += weight * c * c;
+		cd += weight * c * d;
+		d2 += weight * d * d;
+	}
+
+	Quadric& operator+=(Quadric const& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+		return *this;
+	}
+
+	// Значение квадрики в точке (сумма квадратов расстояний до плоскостей)
+	double Evaluate(CVector3d const& p) const
+	{
+		const double x = p.x, y = p.y, z = p.z;
+		return x * (a2 * x + 2 * (ab * y + ac * z + ad))
+			+ y * (b2 * y + 2 * (bc * z + bd))
+			+ z * (c2 * z + 2 * cd)
+			+ d2;
+	}
+
+	// Находит точку минимума квадрики. Возвращает false, если минимум не единственный (вырожденная матрица)
+	bool FindMinimum(CVector3d& p) const
+	{
+		// Решаем систему A * p = -b методом Крамера
+		const double m00 = b2 * c2 - bc * bc;
+		const double m01 = ac * bc - ab * c2;
+		const double m02 = ab * bc - ac * b2;
+		const double det = a2 * m00 + ab * m01 + ac * m02;
+		const double scale = std::max(a2, std::max(b2, c2));
+		if (std::abs(det) <= 1e-10 * scale * scale * scale)
+		{
+			return false;
+		}
+		const double m11 = a2 * c2 - ac * ac;
+		const double m12 = ab * ac - a2 * bc;
+		const double m22 = a2 * b2 - ab * ab;
+		const double invDet = -1.0 / det;
+		p = CVector3d(
+			(m00 * ad + m01 * bd + m02 * cd) * invDet,
+			(m01 * ad + m11 * bd + m12 * cd) * invDet,
+			(m02 * ad + m12 * bd + m22 * cd) * invDet);
+		return true;
+	}
+};
+
+// Кандидат на стягивание ребра
+struct Collapse
+{
+	double cost; // Ошибка стягивания
+	CVector3d position; // Положение вершины, получаемой стягиванием ребра
+	unsigned vertex0, vertex1; // Концы ребра
+	unsigned version0, version1; // Версии вершин на момент вычисления (см. Simplifier::m_versions)
+
+	bool operator>(Collapse const& other) const
+	{
+		return cost > other.cost;
+	}
+};
+
+class Simplifier
+{
+public:
+	Simplifier(std::vector<Vertex>& vertices, std::vector<Face>& faces)
+		: m_vertices(vertices)
+		, m_faces(faces)
+		, m_quadrics(vertices.size())
+		, m_vertexFaces(vertices.size())
+		, m_versions(vertices.size(), 0)
+		, m_vertexRemoved(vertices.size(), false)
+		, m_faceRemoved(faces.size(), false)
+		, m_faceCount(faces.size())
+	{
+	}
+
+	void Run(size_t targetFaceCount, std::vector<unsigned>* pFaceIndices)
+	{
+		InitQuadrics();
+
+		while (m_faceCount > targetFaceCount && !m_collapses.empty())
+		{
+			const Collapse collapse = m_collapses.top();
+			m_collapses.pop();
+
+			// Кандидат устарел, если один из концов ребра был удален или перемещен после его вычисления
+			if (m_vertexRemoved[collapse.vertex0] || m_vertexRemoved[collapse.vertex1]
+				|| m_versions[collapse.vertex0] != collapse.version0 || m_versions[collapse.vertex1] != collapse.version1)
+			{
+				continue;
+			}
+
+			if (CanCollapse(collapse))
+			{
+				ApplyCollapse(collapse);
+			}
+		}
+
+		Compact(pFaceIndices);
+	}
+
+private:
+	unsigned GetFaceVertex(Face const& face, int i) const
+	{
+		return (i == 0) ? face.vertex0 : (i == 1) ? face.vertex1 : face.vertex2;
+	}
+
+	CVector3d GetFaceNormal(Face const& face) const
+	{
+		CVector3d const& p0 = m_vertices[face.vertex0].position;
+		return Cross(m_vertices[face.vertex1].position - p0, m_vertices[face.vertex2].position - p0);
+	}
+
+	void InitQuadrics()
+	{
+		// Ребра граней в виде (ключ ребра, индекс грани) для поиска граничных ребер и кандидатов на стягивание
+		std::vector<std::pair<std::uint64_t, unsigned>> edges;
+		edges.reserve(m_faces.size() * 3);
+
+		for (size_t faceIndex = 0; faceIndex < m_faces.size(); ++faceIndex)
+		{
+			Face const& face = m_faces[faceIndex];
+			if (face.vertex0 == face.vertex1 || face.vertex1 == face.vertex2 || face.vertex2 == face.vertex0)
+			{
+				// Вырожденные грани удаляются сразу
+				m_faceRemoved[faceIndex] = true;
+				--m_faceCount;
+				continue;
+			}
+
+			CVector3d normal = GetFaceNormal(face);
+			const double doubleArea = normal.GetLength();
+			for (int i = 0; i < 3; ++i)
+			{
+				const unsigned v0 = GetFaceVertex(face, i);
+				const unsigned v1 = GetFaceVertex(face, (i + 1) % 3);
+				m_vertexFaces[v0].push_back(unsigned(faceIndex));
+				edges.emplace_back(GetEdgeKey(v0, v1), unsigned(faceIndex));
+			}
+
+			if (doubleArea > 0)
+			{
+				normal /= doubleArea;
+				const double d = -Dot(normal, m_vertices[face.vertex0].position);
+				for (int i = 0; i < 3; ++i)
+				{
+					m_quadrics[GetFaceVertex(face, i)].AddPlane(normal, d, doubleArea * 0.5);
+				}
+			}
+		}
+
+		std::sort(edges.begin(), edges.end());
+
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t next = i + 1;
+			while (next < edges.size() && edges[next].first == edges[i].first)
+			{
+				++next;
+			}
+
+			const unsigned v0 = unsigned(edges[i].first >> 32);
+			const unsigned v1 = unsigned(edges[i].first & 0xffffffffu);
+
+			if (next - i == 1)
+			{
+				// Граничное ребро: добавляем плоскость, проходящую через ребро перпендикулярно грани
+				CVector3d const& p0 = m_vertices[v0].position;
+				const CVector3d edge = m_vertices[v1].position - p0;
+				CVector3d normal = Cross(edge, GetFaceNormal(m_faces[edges[i].second]));
+				const double length = normal.GetLength();
+				if (length > 0)
+				{
+					normal /= length;
+					const double weight = BOUNDARY_WEIGHT * Dot(edge, edge);
+					m_quadrics[v0].AddPlane(normal, -Dot(normal, p0), weight);
+					m_quadrics[v1].AddPlane(normal, -Dot(normal, p0), weight);
+				}
+			}
+			i = next;
+		}
+
+		// Кандидаты вычисляются после того, как квадрики всех вершин построены
+		for (size_t i = 0; i < edges.size(); ++i)
+		{
+			if (i == 0 || edges[i].first != edges[i - 1].first)
+			{
+				AddCollapse(unsigned(edges[i].first >> 32), unsigned(edges[i].first & 0xffffffffu));
+			}
+		}
+	}
+
+	static std::uint64_t GetEdgeKey(unsigned v0, unsigned v1)
+	{
+		return (std::uint64_t(std::min(v0, v1)) << 32) | std::max(v0, v1);
+	}
+
+	void AddCollapse(unsigned v0, unsigned v1)
+	{
+		Quadric quadric = m_quadrics[v0];
+		quadric += m_quadrics[v1];
+
+		Collapse collapse;
+		collapse.vertex0 = v0;
+		collapse.vertex1 = v1;
+		collapse.version0 = m_versions[v0];
+		collapse.version1 = m_versions[v1];
+
+		if (quadric.FindMinimum(collapse.position))
+		{
+			collapse.cost = quadric.Evaluate(collapse.position);
+		}
+		else
+		{
+			// Минимум не единственный: выбираем лучшую из точек ребра (концы и середина)
+			CVector3d const& p0 = m_vertices[v0].position;
+			CVector3d const& p1 = m_vertices[v1].position;
+			const CVector3d candidates[3] = { p0, p1, (p0 + p1) * 0.5 };
+			collapse.cost = std::numeric_limits<double>::infinity();
+			for (CVector3d const& candidate : candidates)
+			{
+				const double cost = quadric.Evaluate(candidate);
+				if (cost < collapse.cost)
+				{
+					collapse.cost = cost;
+					collapse.position = candidate;
+				}
+			}
+		}
+		m_collapses.push(collapse);
+	}
+
+	// Собирает вершины, соседние с заданной, в упорядоченный массив без повторений
+	void GetNeighbors(unsigned vertex, std::vector<unsigned>& neighbors) const
+	{
+		neighbors.clear();
+		for (unsigned faceIndex : m_vertexFaces[vertex])
+		{
+			Face const& face = m_faces[faceIndex];
+			for (int i = 0; i < 3; ++i)
+			{
+				const unsigned v = GetFaceVertex(face, i);
+				if (v != vertex)
+				{
+					neighbors.push_back(v);
+				}
+			}
+		}
+		std::sort(neighbors.begin(), neighbors.end());
+		neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+	}
+
+	static bool FaceContains(Face const& face, unsigned vertex)
+	{
+		return face.vertex0 == vertex || face.vertex1 == vertex || face.vertex2 == vertex;
+	}
+
+	bool CanCollapse(Collapse const& collapse)
+	{
+		const unsigned v0 = collapse.vertex0;
+		const unsigned v1 = collapse.vertex1;
+
+		// Количество граней, содержащих ребро
+		size_t sharedFaces = 0;
+		for (unsigned faceIndex : m_vertexFaces[v0])
+		{
+			if (FaceContains(m_faces[faceIndex], v1))
+			{
+				++sharedFaces;
+			}
+		}
+
+		/*
+			Условие связности: общими соседями концов ребра могут быть только противолежащие ребру вершины
+			его граней. Иначе стягивание склеит две разные грани или создаст неплоский участок сетки
+		*/
+		GetNeighbors(v0, m_neighbors0);
+		GetNeighbors(v1, m_neighbors1);
+		m_commonNeighbors.clear();
+		std::set_intersection(m_neighbors0.begin(), m_neighbors0.end(), m_neighbors1.begin(), m_neighbors1.end(),
+			std::back_inserter(m_commonNeighbors));
+		if (sharedFaces == 0 || m_commonNeighbors.size() != sharedFaces)
+		{
+			return false;
+		}
+
+		// Грани, остающиеся после стягивания, не должны менять ориентацию
+		for (unsigned vertex : { v0, v1 })
+		{
+			for (unsigned faceIndex : m_vertexFaces[vertex])
+			{
+				Face const& face = m_faces[faceIndex];
+				if (FaceContains(face, v0) && FaceContains(face, v1))
+				{
+					continue;
+				}
+
+				CVector3d points[3];
+				for (int i = 0; i < 3; ++i)
+				{
+					const unsigned v = GetFaceVertex(face, i);
+					points[i] = (v == vertex) ? collapse.position : m_vertices[v].position;
+				}
+				const CVector3d newNormal = Cross(points[1] - points[0], points[2] - points[0]);
+				if (Dot(newNormal, GetFaceNormal(face)) <= 0)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	void ApplyCollapse(Collapse const& collapse)
+	{
+		const unsigned v0 = collapse.vertex0;
+		const unsigned v1 = collapse.vertex1;
+
+		// Вершина v1 сливается с вершиной v0
+		Vertex& vertex = m_vertices[v0];
+		vertex.position = collapse.position;
+		vertex.normal += m_vertices[v1].normal;
+		if (vertex.normal.GetLength() > 0)
+		{
+			vertex.normal.Normalize();
+		}
+		m_quadrics[v0] += m_quadrics[v1];
+		m_vertexRemoved[v1] = true;
+		++m_versions[v0];
+
+		// Грани, содержащие ребро, удаляются, а остальные грани вершины v1 переходят к вершине v0
+		std::vector<unsigned>& faces0 = m_vertexFaces[v0];
+		faces0.erase(std::remove_if(faces0.begin(), faces0.end(), [&](unsigned faceIndex) {
+			if (FaceContains(m_faces[faceIndex], v1))
+			{
+				m_faceRemoved[faceIndex] = true;
+				--m_faceCount;
+				return true;
+			}
+			return false;
+		}), faces0.end());
+
+		for (unsigned faceIndex : m_vertexFaces[v1])
+		{
+			if (m_faceRemoved[faceIndex])
+			{
+				continue;
+			}
+			Face& face = m_faces[faceIndex];
+			if (face.vertex0 == v1)
+			{
+				face.vertex0 = v0;
+			}
+			else if (face.vertex1 == v1)
+			{
+				face.vertex1 = v0;
+			}
+			else
+			{
+				face.vertex2 = v0;
+			}
+			faces0.push_back(faceIndex);
+		}
+		m_vertexFaces[v1].clear();
+		m_vertexFaces[v1].shrink_to_fit();
+
+		// Удаленные грани остаются в списках соседних вершин
+		for (unsigned neighbor : m_commonNeighbors)
+		{
+			std::vector<unsigned>& neighborFaces = m_vertexFaces[neighbor];
+			neighborFaces.erase(std::remove_if(neighborFaces.begin(), neighborFaces.end(), [&](unsigned faceIndex) {
+				return m_faceRemoved[faceIndex];
+			}), neighborFaces.end());
+		}
+
+		// Пересчитываем кандидатов для ребер, выходящих из новой вершины
+		GetNeighbors(v0, m_neighbors0);
+		for (unsigned neighbor : m_neighbors0)
+		{
+			AddCollapse(v0, neighbor);
+		}
+	}
+
+	void Compact(std::vector<unsigned>* pFaceIndices)
+	{
+		// Нумеруем вершины, используемые оставшимися гранями, сохраняя их порядок
+		std::vector<unsigned> newVertexIndices(m_vertices.size(), INVALID_INDEX);
+		for (size_t faceIndex = 0; faceIndex < m_faces.size(); ++faceIndex)
+		{
+			if (!m_faceRemoved[faceIndex])
+			{
+				Face const& face = m_faces[faceIndex];
+				newVertexIndices[face.vertex0] = newVertexIndices[face.vertex1] = newVertexIndices[face.vertex2] = 0;
+			}
+		}
+
+		size_t vertexCount = 0;
+		for (size_t i = 0; i < m_vertices.size(); ++i)
+		{
+			if (newVertexIndices[i] != INVALID_INDEX)
+			{
+				newVertexIndices[i] = unsigned(vertexCount);
+				m_vertices[vertexCount++] = m_vertices[i];
+			}
+		}
+		m_vertices.resize(vertexCount);
+
+		size_t faceCount = 0;
+		for (size_t faceIndex = 0; faceIndex < m_faces.size(); ++faceIndex)
+		{
+			if (m_faceRemoved[faceIndex])
+			{
+				continue;
+			}
+			Face face = m_faces[faceIndex];
+			face.vertex0 = newVertexIndices[face.vertex0];
+			face.vertex1 = newVertexIndices[face.vertex1];
+			face.vertex2 = newVertexIndices[face.vertex2];
+			if (pFaceIndices)
+			{
+				(*pFaceIndices)[faceCount] = (*pFaceIndices)[faceIndex];
+			}
+			m_faces[faceCount++] = face;
+		}
+		m_faces.erase(m_faces.begin() + faceCount, m_faces.end());
+		if (pFaceIndices)
+		{
+			pFaceIndices->resize(faceCount);
+		}
+	}
+
+private:
+	std::vector<Vertex>& m_vertices;
+	std::vector<Face>& m_faces;
+
+	std::vector<Quadric> m_quadrics;
+	// Индексы граней, прилегающих к вершине
+	std::vector<std::vector<unsigned>> m_vertexFaces;
+	// Версия вершины увеличивается при каждом ее перемещении, делая устаревшими вычисленные ранее кандидаты
+	std::vector<unsigned> m_versions;
+	std::vector<bool> m_vertexRemoved;
+	std::vector<bool> m_faceRemoved;
+	size_t m_faceCount;
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_collapses;
+
+	// Временные массивы соседних вершин (чтобы не выделять память при проверке каждого кандидата)
+	std::vector<unsigned> m_neighbors0;
+	std::vector<unsigned> m_neighbors1;
+	std::vector<unsigned> m_commonNeighbors;
+};
+} // namespace
+
+void MeshSimplifier::Simplify(std::vector<Vertex>& vertices, std::vector<Face>& faces, size_t targetFaceCount,
+	std::vector<unsigned>* pFaceIndices)
+{
+	if (faces.size() <= targetFaceCount)
+	{
+		return;
+	}
+	Simplifier(vertices, faces).Run(targetFaceCount, pFaceIndices);
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include <vector>
+#include "../TriangleMesh/TriangleMesh.h"
+
+/*
+	Упрощение полигональной сетки последовательным стягиванием ребер с квадратичной метрикой ошибки
+	(M. Garland, P. Heckbert, "Surface Simplification Using Quadric Error Metrics").
+
+	Каждой вершине сопоставляется квадрика - сумма квадратов расстояний до плоскостей прилегающих
+	граней (с весом, равным площади грани). Ребра стягиваются в порядке возрастания ошибки, а новая
+	вершина помещается в точку, минимизирующую суммарную квадрику концов ребра. Границы сетки
+	сохраняются с помощью дополнительных плоскостей, перпендикулярных граничным граням.
+	Стягивания, выворачивающие грани или нарушающие топологию сетки, не выполняются.
+	Используется для построения уровней детализации сеток (см. MeshCache)
+*/
+class MeshSimplifier
+{
+public:
+	/*
+		Упрощает сетку, пока количество граней превышает targetFaceCount (либо пока остаются ребра,
+		которые можно стянуть). Вершины, не используемые оставшимися гранями, удаляются.
+		Порядок оставшихся граней и вершин сохраняется.
+		Если задан pFaceIndices (по одному значению на грань), его элементы удаляются вместе с гранями
+	*/
+	static void Simplify(std::vector<Vertex>& vertices, std::vector<Face>& faces, size_t targetFaceCount,
+		std::vector<unsigned>* pFaceIndices = nullptr);
+};
@@ -0,0 +1,529 @@
+﻿#include "NetworkRenderCoordinator.h"
+#include <algorithm>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include "../Renderer/Renderer.h"
+#include "../SceneFile/SceneFile.h"
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+namespace
+{
+// Количество блоков, одновременно назначаемых одному исполнителю.
+// Позволяет исполнителю приступать к следующему блоку, не дожидаясь, пока координатор получит предыдущий
+constexpr size_t MAX_TILES_IN_FLIGHT_PER_WORKER = 4;
+
+std::string ReadMeshFile(std::string const& path)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+	{
+		throw std::runtime_error("Failed to read mesh file " + path);
+	}
+	return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+}
+
+NetworkRenderCoordinator::NetworkRenderCoordinator(std::vector<std::string> const& workerAddresses,
+	unsigned width, unsigned height, std::chrono::milliseconds tileTimeout)
+	: m_frameBuffer(width, height)
+	, m_tileTimeout(tileTimeout)
+	, m_workGuard(asio::make_work_guard(m_ioContext))
+{
+	m_completedTiles.SetFrameSize(width, height);
+
+	for (std::string const& address : workerAddresses)
+	{
+		const size_t colonPos = address.rfind(':');
+		if (colonPos == std::string::npos)
+		{
+			throw std::invalid_argument("Render worker address must be in host:port format: " + address);
+		}
+
+		auto pSession = std::make_unique<WorkerSession>(m_ioContext);
+		pSession->host = address.substr(0, colonPos);
+		pSession->port = address.substr(colonPos + 1);
+		m_sessions.push_back(std::move(pSession));
+	}
+
+	m_thread = std::jthread([this] {
+		m_ioContext.run();
+	});
+}
+
+NetworkRenderCoordinator::~NetworkRenderCoordinator()
+{
+	Stop();
+
+	m_workGuard.reset();
+	m_ioContext.stop();
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+FrameBuffer& NetworkRenderCoordinator::GetFrameBuffer()
+{
+	return m_frameBuffer;
+}
+
+bool NetworkRenderCoordinator::IsRendering() const
+{
+	return m_rendering;
+}
+
+bool NetworkRenderCoordinator::GetProgress(unsigned& renderedChunks, unsigned& totalChunks) const
+{
+	renderedChunks = m_renderedChunks;
+	totalChunks = m_totalChunks;
+
+	return (totalChunks > 0) && (renderedChunks == totalChunks);
+}
+
+void NetworkRenderCoordinator::SetProgressCallback(TileCompletionTracker::ProgressCallback callback)
+{
+	m_completedTiles.SetProgressCallback(std::move(callback));
+}
+
+bool NetworkRenderCoordinator::TakeChangedRegions(std::vector<CScreenRect>& regions)
+{
+	return m_completedTiles.TakeChangedRegions(regions);
+}
+
+unsigned NetworkRenderCoordinator::GetConnectedWorkerCount() const
+{
+	return m_connectedWorkers;
+}
+
+bool NetworkRenderCoordinator::Render(DemoSceneState const& sceneState)
+{
+	bool expected = false;
+	if (!m_rendering.compare_exchange_strong(expected, true))
+	{
+		// Построение предыдущего кадра еще не завершено
+		return false;
+	}
+
+	m_renderedChunks = 0;
+	m_totalChunks = Renderer::GetTileCount(m_frameBuffer.GetWidth(), m_frameBuffer.GetHeight());
+
+	asio::post(m_ioContext, [this, sceneState] {
+		StartFrame([this, &sceneState](std::uint32_t frameId) {
+			return MakeSceneDescriptionMessage(frameId, m_frameBuffer.GetWidth(), m_frameBuffer.GetHeight(), sceneState);
+		}, nullptr);
+	});
+	return true;
+}
+
+bool NetworkRenderCoordinator::Render(SceneDescription const& description, std::string const& baseDirectory)
+{
+	if (IsRendering())
+	{
+		return false;
+	}
+
+	// Исполнители сохраняют файлы сеток под именами из номера файла и исходного расширения (по нему выбирается
+	// формат файла), поэтому абсолютные пути и пути за пределами каталога сцены не попадают в их файловую систему
+	SceneDescription workerDescription = description;
+	std::vector<std::string> meshFilePaths;
+	for (size_t meshIndex = 0; meshIndex < description.meshFiles.size(); ++meshIndex)
+	{
+		const std::filesystem::path meshPath = std::filesystem::path(baseDirectory) / description.meshFiles[meshIndex];
+		meshFilePaths.push_back(meshPath.string());
+		workerDescription.meshFiles[meshIndex] = std::to_string(meshIndex) + meshPath.extension().string();
+	}
+
+	if (!m_pPreparedMeshFileMessages || meshFilePaths != m_preparedMeshFilePaths)
+	{
+		auto pMessages = std::make_shared<MeshFileMessages>();
+		for (size_t meshIndex = 0; meshIndex < meshFilePaths.size(); ++meshIndex)
+		{
+			for (std::vector<char>& message : MakeMeshFileMessages(workerDescription.meshFiles[meshIndex], ReadMeshFile(meshFilePaths[meshIndex])))
+			{
+				pMessages->push_back(std::move(message));
+			}
+		}
+		m_pPreparedMeshFileMessages = std::move(pMessages);
+		m_preparedMeshFilePaths = std::move(meshFilePaths);
+	}
+
+	std::ostringstream sceneStream;
+	SceneFile::WriteBinary(workerDescription, sceneStream);
+	std::string sceneData = sceneStream.str();
+	if (sceneData.size() + 3 * sizeof(std::uint32_t) > MAX_NETWORK_MESSAGE_SIZE)
+	{
+		throw std::runtime_error("Scene description is too large to be sent to render workers");
+	}
+
+	bool expected = false;
+	if (!m_rendering.compare_exchange_strong(expected, true))
+	{
+		return false;
+	}
+
+	m_renderedChunks = 0;
+	m_totalChunks = Renderer::GetTileCount(m_frameBuffer.GetWidth(), m_frameBuffer.GetHeight());
+
+	asio::post(m_ioContext, [this, sceneData = std::move(sceneData), pMeshFileMessages = m_pPreparedMeshFileMessages] {
+		StartFrame([this, &sceneData](std::uint32_t frameId) {
+			return MakeSceneFileMessage(frameId, m_frameBuffer.GetWidth(), m_frameBuffer.GetHeight(), sceneData);
+		}, pMeshFileMessages);
+	});
+	return true;
+}
+
+void NetworkRenderCoordinator::Stop()
+{
+	if (!IsRendering())
+	{
+		return;
+	}
+
+	// Состояние кадра принадлежит фоновому потоку, поэтому прерываем кадр в нем и дожидаемся этого
+	std::promise<void> stopped;
+	asio::post(m_ioContext, [this, &stopped] {
+		if (m_frameActive)
+		{
+			// Блоки, присланные исполнителями позже, не будут учтены, т.к. кадр уже не активен
+			m_frameActive = false;
+			m_pendingTiles.clear();
+			for (auto& pSession : m_sessions)
+			{
+				pSession->tilesInFlight.clear();
+			}
+		}
+		m_rendering = false;
+		stopped.set_value();
+	});
+	stopped.get_future().wait();
+}
+
+void NetworkRenderCoordinator::StartFrame(SceneMessageFactory const& makeSceneMessage,
+	std::shared_ptr<MeshFileMessages const> pMeshFileMessages)
+{
+	// Новый номер кадра позволяет исполнителям и координатору отличать блоки прерванных кадров
+	++m_frameId;
+	m_frameActive = true;
+	m_sceneDescriptionMessage = makeSceneMessage(m_frameId);
+	if (pMeshFileMessages != m_pMeshFileMessages)
+	{
+		m_pMeshFileMessages = std::move(pMeshFileMessages);
+		++m_meshSetVersion;
+	}
+
+	m_pendingTiles.clear();
+	for (std::uint32_t tileIndex = 0; tileIndex < m_totalChunks; ++tileIndex)
+	{
+		m_pendingTiles.push_back(tileIndex);
+	}
+
+	for (auto& pSession : m_sessions)
+	{
+		WorkerSession& session = *pSession;
+		session.tilesInFlight.clear();
+		if (session.connected)
+		{
+			SendScene(session);
+			DispatchTiles(session);
+		}
+		else if (!session.connecting)
+		{
+			// Повторяем подключение к исполнителям, недоступным при построении предыдущих кадров
+			Connect(session);
+		}
+	}
+
+	CheckFrameCompletion();
+}
+
+void NetworkRenderCoordinator::SendScene(WorkerSession& session)
+{
+	// Файлы сеток передаются исполнителю один раз после подключения и после каждой смены их набора
+	if (m_pMeshFileMessages && session.meshSetVersion != m_meshSetVersion)
+	{
+		for (std::vector<char> const& message : *m_pMeshFileMessages)
+		{
+			Send(session, message);
+		}
+		session.meshSetVersion = m_meshSetVersion;
+	}
+	Send(session, m_sceneDescriptionMessage);
+}
+
+void NetworkRenderCoordinator::Connect(WorkerSession& session)
+{
+	session.connecting = true;
+	const unsigned generation = ++session.generation;
+
+	session.timer.expires_after(m_tileTimeout);
+	session.timer.async_wait([this, &session, generation](boost::system::error_code const& error) {
+		if (!error && session.generation == generation && session.connecting)
+		{
+			std::cerr << "Render worker " << session.host << ":" << session.port << ": connection timed out\n";
+			Disconnect(session);
+		}
+	});
+
+	session.resolver.async_resolve(session.host, session.port,
+		[this, &session, generation](boost::system::error_code const& error, tcp::resolver::results_type const& endpoints) {
+			if (session.generation != generation)
+			{
+				return;
+			}
+			if (error)
+			{
+				std::cerr << "Render worker " << session.host << ":" << session.port << ": " << error.message() << "\n";
+				Disconnect(session);
+				return;
+			}
+
+			asio::async_connect(session.socket, endpoints,
+				[this, &session, generation](boost::system::error_code const& error, tcp::endpoint const&) {
+					if (session.generation != generation)
+					{
+						return;
+					}
+					if (error)
+					{
+						std::cerr << "Render worker " << session.host << ":" << session.port << ": " << error.message() << "\n";
+						Disconnect(session);
+						return;
+					}
+
+					session.connecting = false;
+					session.connected = true;
+					++m_connectedWorkers;
+					session.timer.cancel();
+
+					// Сообщения небольшие и отправляются по одному, поэтому отключаем алгоритм Нейгла
+					boost::system::error_code optionError;
+					session.socket.set_option(tcp::no_delay(true), optionError);
+
+					ReadNextMessage(session);
+					if (m_frameActive)
+					{
+						SendScene(session);
+						DispatchTiles(session);
+					}
+				});
+		});
+}
+
+void NetworkRenderCoordinator::Disconnect(WorkerSession& session)
+{
+	// Обработчики незавершенных операций этого соединения будут проигнорированы
+	++session.generation;
+	if (session.connected)
+	{
+		--m_connectedWorkers;
+	}
+	session.connected = false;
+	session.connecting = false;
+	session.meshSetVersion = 0;
+
+	boost::system::error_code error;
+	session.socket.close(error);
+	session.timer.cancel();
+	session.resolver.cancel();
+	session.outgoing.clear();
+
+	// Блоки исполнителя передаем другим исполнителям в первую очередь
+	m_pendingTiles.insert(m_pendingTiles.begin(), session.tilesInFlight.begin(), session.tilesInFlight.end());
+	session.tilesInFlight.clear();
+	for (auto& pSession : m_sessions)
+	{
+		DispatchTiles(*pSession);
+	}
+
+	CheckFrameCompletion();
+}
+
+void NetworkRenderCoordinator::Send(WorkerSession& session, std::vector<char> message)
+{
+	session.outgoing.push_back(std::move(message));
+	if (session.outgoing.size() == 1)
+	{
+		WriteNextMessage(session);
+	}
+}
+
+void NetworkRenderCoordinator::WriteNextMessage(WorkerSession& session)
+{
+	const unsigned generation = session.generation;
+	asio::async_write(session.socket, asio::buffer(session.outgoing.front()),
+		[this, &session, generation](boost::system::error_code const& error, size_t /*bytesTransferred*/) {
+			if (session.generation != generation)
+			{
+				return;
+			}
+			if (error)
+			{
+				std::cerr << "Render worker " << session.host << ":" << session.port << ": " << error.message() << "\n";
+				Disconnect(session);
+				return;
+			}
+
+			session.outgoing.pop_front();
+			if (!session.outgoing.empty())
+			{
+				WriteNextMessage(session);
+			}
+		});
+}
+
+void NetworkRenderCoordinator::ReadNextMessage(WorkerSession& session)
+{
+	const unsigned generation = session.generation;
+	asio::async_read(session.socket, asio::buffer(&session.incomingHeader, sizeof(session.incomingHeader)),
+		[this, &session, generation](boost::system::error_code const& error, size_t /*bytesTransferred*/) {
+			if (session.generation != generation)
+			{
+				return;
+			}
+			if (error || session.incomingHeader.size > MAX_NETWORK_MESSAGE_SIZE)
+			{
+				std::cerr << "Render worker " << session.host << ":" << session.port << ": "
+						  << (error ? error.message() : "message is too large") << "\n";
+				Disconnect(session);
+				return;
+			}
+
+			session.incomingPayload.resize(session.incomingHeader.size);
+			asio::async_read(session.socket, asio::buffer(session.incomingPayload),
+				[this, &session, generation](boost::system::error_code const& error, size_t /*bytesTransferred*/) {
+					if (session.generation != generation)
+					{
+						return;
+					}
+					if (error)
+					{
+						std::cerr << "Render worker " << session.host << ":" << session.port << ": " << error.message() << "\n";
+						Disconnect(session);
+						return;
+					}
+
+					HandleMessage(session);
+					// Обработка сообщения могла закрыть соединение
+					if (session.generation == generation)
+					{
+						ReadNextMessage(session);
+					}
+				});
+		});
+}
+
+void NetworkRenderCoordinator::HandleMessage(WorkerSession& session)
+{
+	std::uint32_t frameId = 0;
+	std::uint32_t tileIndex = 0;
+	if (session.incomingHeader.type != NetworkMessageType::TileResult
+		|| !ParseTileResultHeader(session.incomingPayload, frameId, tileIndex))
+	{
+		std::cerr << "Render worker " << session.host << ":" << session.port << ": unexpected message\n";
+		Disconnect(session);
+		return;
+	}
+
+	// Блоки прерванных кадров и блоки, уже переданные другим исполнителям, не учитываем
+	if (!m_frameActive || frameId != m_frameId)
+	{
+		return;
+	}
+	auto it = std::find(session.tilesInFlight.begin(), session.tilesInFlight.end(), tileIndex);
+	if (it == session.tilesInFlight.end())
+	{
+		return;
+	}
+
+	CScreenRect tile = Renderer::GetTileRect(tileIndex, m_frameBuffer.GetWidth(), m_frameBuffer.GetHeight());
+	if (!CopyTileResultPixels(session.incomingPayload, tile, m_frameBuffer))
+	{
+		std::cerr << "Render worker " << session.host << ":" << session.port << ": invalid tile size\n";
+		Disconnect(session);
+		return;
+	}
+	session.tilesInFlight.erase(it);
+	const unsigned renderedChunks = ++m_renderedChunks;
+	m_completedTiles.MarkTileCompleted(tileIndex, renderedChunks == m_totalChunks);
+
+	// Исполнитель подает признаки жизни, поэтому ожидание его ответа начинаем заново
+	if (!session.tilesInFlight.empty())
+	{
+		RestartTimeout(session);
+	}
+	DispatchTiles(session);
+
+	CheckFrameCompletion();
+}
+
+void NetworkRenderCoordinator::DispatchTiles(WorkerSession& session)
+{
+	if (!session.connected || !m_frameActive)
+	{
+		return;
+	}
+
+	const bool wasIdle = session.tilesInFlight.empty();
+	while (session.tilesInFlight.size() < MAX_TILES_IN_FLIGHT_PER_WORKER && !m_pendingTiles.empty())
+	{
+		const std::uint32_t tileIndex = m_pendingTiles.front();
+		m_pendingTiles.pop_front();
+		session.tilesInFlight.push_back(tileIndex);
+		Send(session, MakeTileJobMessage(m_frameId, tileIndex));
+	}
+
+	if (wasIdle && !session.tilesInFlight.empty())
+	{
+		RestartTimeout(session);
+	}
+}
+
+void NetworkRenderCoordinator::RestartTimeout(WorkerSession& session)
+{
+	const unsigned generation = session.generation;
+	session.timer.expires_after(m_tileTimeout);
+	session.timer.async_wait([this, &session, generation](boost::system::error_code const& error) {
+		if (error || session.generation != generation || session.tilesInFlight.empty())
+		{
+			return;
+		}
+		std::cerr << "Render worker " << session.host << ":" << session.port << ": tile timed out\n";
+		Disconnect(session);
+	});
+}
+
+void NetworkRenderCoordinator::CheckFrameCompletion()
+{
+	if (!m_frameActive)
+	{
+		return;
+	}
+
+	if (m_renderedChunks == m_totalChunks)
+	{
+		m_frameActive = false;
+		m_rendering = false;
+		return;
+	}
+
+	const bool anyWorkerAvailable = std::any_of(m_sessions.begin(), m_sessions.end(), [](auto const& pSession) {
+		return pSession->connected || pSession->connecting;
+	});
+	if (!anyWorkerAvailable)
+	{
+		std::cerr << "No render workers available\n";
+		m_frameActive = false;
+		m_rendering = false;
+	}
+}
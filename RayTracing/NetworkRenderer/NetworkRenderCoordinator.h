@@ -0,0 +1,181 @@
+﻿#pragma once
+#include <atomic>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "NetworkRenderProtocol.h"
+#include "../DemoScene/DemoScene.h"
+#include "../FrameBuffer/FrameBuffer.h"
+#include "../SceneFile/SceneDescription.h"
+#include "../TileCompletionTracker/TileCompletionTracker.h"
+
+/*
+	Координатор фермы визуализации.
+
+	Подключается по TCP к узлам-исполнителям (см. NetworkRenderWorker), отправляет им состояние
+	демонстрационной сцены либо описание сцены из файла вместе с файлами ее сеток и раздает блоки изображения,
+	собирая присланные пиксели в собственный буфер кадра.
+	Блоки исполнителя, не ответившего в течение заданного времени или разорвавшего соединение,
+	передаются другим исполнителям. Подключение к таким исполнителям повторяется при построении следующего кадра.
+
+	Весь сетевой обмен выполняется асинхронно в одном фоновом потоке
+*/
+class NetworkRenderCoordinator
+{
+public:
+	/*
+		workerAddresses - адреса исполнителей в виде "хост:порт"
+		width, height - размеры буфера кадра
+		tileTimeout - время ожидания ответа исполнителя, по истечении которого его блоки передаются другим исполнителям.
+			Включает время получения исполнителем файлов сеток и построения им сцены
+	*/
+	NetworkRenderCoordinator(std::vector<std::string> const& workerAddresses, unsigned width, unsigned height,
+		std::chrono::milliseconds tileTimeout = std::chrono::seconds(10));
+
+	~NetworkRenderCoordinator();
+
+	NetworkRenderCoordinator(NetworkRenderCoordinator const&) = delete;
+	NetworkRenderCoordinator& operator=(NetworkRenderCoordinator const&) = delete;
+
+	// Буфер кадра, в который собираются блоки изображения
+	FrameBuffer& GetFrameBuffer();
+
+	/*
+		Запускает построение кадра для заданного состояния сцены.
+		Возвращает false, если построение предыдущего кадра не завершено
+	*/
+	bool Render(DemoSceneState const& sceneState);
+
+	/*
+		Запускает построение кадра сцены, построенной по описанию (см. SceneFile).
+		Пути к файлам сеток задаются относительно каталога baseDirectory. Файлы сеток читаются и передаются
+		исполнителям только при изменении их списка.
+		Возвращает false, если построение предыдущего кадра не завершено.
+		Если файл сетки прочитать не удалось, выбрасывает исключение std::runtime_error
+	*/
+	bool Render(SceneDescription const& description, std::string const& baseDirectory);
+
+	// Прерывает построение кадра
+	void Stop();
+
+	// Выполняется ли в данный момент построение изображения?
+	bool IsRendering() const;
+
+	/*
+		Сообщает о прогрессе выполнения работы аналогично Renderer::GetProgress
+	*/
+	bool GetProgress(unsigned& renderedChunks, unsigned& totalChunks) const;
+
+	/*
+		Функция, вызываемая после получения каждого построенного блока (см. Renderer::SetProgressCallback)
+	*/
+	void SetProgressCallback(TileCompletionTracker::ProgressCallback callback);
+
+	// Области буфера кадра, изменившиеся с момента предыдущего вызова (см. Renderer::TakeChangedRegions)
+	bool TakeChangedRegions(std::vector<CScreenRect>& regions);
+
+	// Количество исполнителей, с которыми установлено соединение
+	unsigned GetConnectedWorkerCount() const;
+
+private:
+	// Соединение с исполнителем. Все поля используются только в фоновом потоке
+	struct WorkerSession
+	{
+		explicit WorkerSession(boost::asio::io_context& ioContext)
+			: resolver(ioContext)
+			, socket(ioContext)
+			, timer(ioContext)
+		{
+		}
+
+		std::string host;
+		std::string port;
+		boost::asio::ip::tcp::resolver resolver;
+		boost::asio::ip::tcp::socket socket;
+		// Таймер ожидания подключения или ответа исполнителя
+		boost::asio::steady_timer timer;
+		bool connecting = false;
+		bool connected = false;
+		// Номер соединения. Обработчики операций, начатых в уже закрытом соединении, игнорируются
+		unsigned generation = 0;
+		// Версия набора файлов сеток, переданного исполнителю в этом соединении (0 - не передавался)
+		unsigned meshSetVersion = 0;
+		// Назначенные исполнителю, но еще не полученные блоки
+		std::vector<std::uint32_t> tilesInFlight;
+		// Сообщения, ожидающие отправки (отправляется первое из них)
+		std::deque<std::vector<char>> outgoing;
+		NetworkMessageHeader incomingHeader{};
+		std::vector<char> incomingPayload;
+	};
+
+	using MeshFileMessages = std::vector<std::vector<char>>;
+	using SceneMessageFactory = std::function<std::vector<char>(std::uint32_t frameId)>;
+
+	/*
+		Начинает построение кадра (выполняется в фоновом потоке).
+		makeSceneMessage формирует описание сцены для кадра с заданным номером,
+		pMeshFileMessages - сообщения с файлами сеток сцены (nullptr, если сцене не нужны файлы сеток)
+	*/
+	void StartFrame(SceneMessageFactory const& makeSceneMessage, std::shared_ptr<MeshFileMessages const> pMeshFileMessages);
+
+	// Отправляет исполнителю описание сцены текущего кадра, предваряя его файлами сеток, если исполнитель их еще не получил
+	void SendScene(WorkerSession& session);
+
+	void Connect(WorkerSession& session);
+	void Disconnect(WorkerSession& session);
+
+	// Отправляет сообщение исполнителю после ранее поставленных в очередь сообщений
+	void Send(WorkerSession& session, std::vector<char> message);
+	void WriteNextMessage(WorkerSession& session);
+
+	void ReadNextMessage(WorkerSession& session);
+	void HandleMessage(WorkerSession& session);
+
+	// Назначает исполнителю новые блоки из очереди m_pendingTiles
+	void DispatchTiles(WorkerSession& session);
+
+	// Перезапускает ожидание ответа исполнителя
+	void RestartTimeout(WorkerSession& session);
+
+	// Завершает построение кадра, если все блоки получены или не осталось исполнителей
+	void CheckFrameCompletion();
+
+private:
+	FrameBuffer m_frameBuffer;
+	// Полученные, но еще не перенесенные на экран блоки
+	TileCompletionTracker m_completedTiles;
+	std::chrono::milliseconds m_tileTimeout;
+
+	boost::asio::io_context m_ioContext;
+	boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_workGuard;
+	std::vector<std::unique_ptr<WorkerSession>> m_sessions;
+
+	// Состояние текущего кадра (используется только в фоновом потоке)
+	bool m_frameActive = false;
+	std::uint32_t m_frameId = 0;
+	std::vector<char> m_sceneDescriptionMessage;
+	std::deque<std::uint32_t> m_pendingTiles;
+	// Файлы сеток сцены текущего кадра и версия их набора, увеличивающаяся при каждой смене набора
+	std::shared_ptr<MeshFileMessages const> m_pMeshFileMessages;
+	unsigned m_meshSetVersion = 0;
+
+	// Прочитанные файлы сеток последней сцены из файла (используются только в потоке, вызывающем Render)
+	std::vector<std::string> m_preparedMeshFilePaths;
+	std::shared_ptr<MeshFileMessages const> m_pPreparedMeshFileMessages;
+
+	std::atomic_bool m_rendering{ false };
+	std::atomic_uint32_t m_totalChunks{ 0 };
+	std::atomic_uint32_t m_renderedChunks{ 0 };
+	std::atomic_uint32_t m_connectedWorkers{ 0 };
+
+	// Поток, выполняющий сетевой обмен
+	std::jthread m_thread;
+};
@@ -0,0 +1,273 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "../DemoScene/DemoScene.h"
+#include "../FrameBuffer/FrameBuffer.h"
+#include "../ScreenRect/ScreenRect.h"
+
+/*
+	Протокол обмена сообщениями между координатором фермы визуализации и узлами-исполнителями по TCP.
+
+	Каждое сообщение состоит из заголовка NetworkMessageHeader и данных размером header.size байт.
+	Координатор отправляет исполнителю описание сцены, после чего - задания на построение блоков
+	изображения (TileJob). Сцена задается либо состоянием демонстрационной сцены (SceneDescription),
+	либо описанием сцены в двоичном формате SceneFile (SceneFile), которому предшествует содержимое
+	файлов сеток сцены (MeshFileChunk). Файлы сеток передаются только при изменении их набора. Исполнитель отвечает на каждое задание сообщением TileResult,
+	содержащим пиксели блока. Числа передаются в машинном представлении, поэтому узлы фермы должны
+	иметь одинаковый порядок байтов
+*/
+
+enum class NetworkMessageType : std::uint32_t
+{
+	// frameId, width, height, lightCount, матрица камеры, матрица объекта, матрицы источников света
+	SceneDescription = 1,
+	// frameId, tileIndex
+	TileJob = 2,
+	// frameId, tileIndex, пиксели блока построчно
+	TileResult = 3,
+	// frameId, width, height, описание сцены в двоичном формате SceneFile
+	SceneFile = 4,
+	// длина имени файла, имя файла сетки, смещение части в файле, часть содержимого файла
+	MeshFileChunk = 5,
+};
+
+struct NetworkMessageHeader
+{
+	NetworkMessageType type;
+	std::uint32_t size;
+};
+
+// Максимальный размер данных сообщения. Сообщения большего размера считаются ошибкой протокола
+constexpr std::uint32_t MAX_NETWORK_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+// Максимальный размер части файла сетки, передаваемой одним сообщением MeshFileChunk
+constexpr size_t MESH_FILE_CHUNK_SIZE = 16 * 1024 * 1024;
+
+// Добавляет значение в конец буфера сообщения
+template <typename T>
+void AppendToMessage(std::vector<char>& message, T const& value)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	const char* bytes = reinterpret_cast<const char*>(&value);
+	message.insert(message.end(), bytes, bytes + sizeof(T));
+}
+
+/*
+	Считывает значение из буфера сообщения, сдвигая текущую позицию.
+	Возвращает false, если данных недостаточно
+*/
+template <typename T>
+bool ReadFromMessage(const char*& pos, const char* end, T& value)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	if (end - pos < std::ptrdiff_t(sizeof(T)))
+	{
+		return false;
+	}
+	std::memcpy(&value, pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+// Формирует сообщение с заголовком: заголовок записывается в начало буфера после заполнения данных
+inline std::vector<char> BeginMessage(NetworkMessageType type)
+{
+	std::vector<char> message;
+	AppendToMessage(message, NetworkMessageHeader{ type, 0 });
+	return message;
+}
+
+inline void EndMessage(std::vector<char>& message)
+{
+	const std::uint32_t size = std::uint32_t(message.size() - sizeof(NetworkMessageHeader));
+	std::memcpy(message.data() + offsetof(NetworkMessageHeader, size), &size, sizeof(size));
+}
+
+inline std::vector<char> MakeSceneDescriptionMessage(std::uint32_t frameId, unsigned width, unsigned height,
+	DemoSceneState const& state)
+{
+	std::vector<char> message = BeginMessage(NetworkMessageType::SceneDescription);
+	AppendToMessage(message, frameId);
+	AppendToMessage(message, std::uint32_t(width));
+	AppendToMessage(message, std::uint32_t(height));
+	AppendToMessage(message, std::uint32_t(state.lightTransforms.size()));
+	AppendToMessage(message, state.modelViewMatrix.data);
+	AppendToMessage(message, state.movableObjectTransform.data);
+	for (CMatrix4d const& lightTransform : state.lightTransforms)
+	{
+		AppendToMessage(message, lightTransform.data);
+	}
+	EndMessage(message);
+	return message;
+}
+
+inline bool ParseSceneDescription(std::vector<char> const& payload,
+	std::uint32_t& frameId, unsigned& width, unsigned& height, DemoSceneState& state)
+{
+	const char* pos = payload.data();
+	const char* end = pos + payload.size();
+	std::uint32_t w = 0;
+	std::uint32_t h = 0;
+	std::uint32_t lightCount = 0;
+	if (!ReadFromMessage(pos, end, frameId) || !ReadFromMessage(pos, end, w) || !ReadFromMessage(pos, end, h)
+		|| !ReadFromMessage(pos, end, lightCount)
+		|| !ReadFromMessage(pos, end, state.modelViewMatrix.data)
+		|| !ReadFromMessage(pos, end, state.movableObjectTransform.data))
+	{
+		return false;
+	}
+	state.lightTransforms.clear();
+	for (std::uint32_t i = 0; i < lightCount; ++i)
+	{
+		CMatrix4d lightTransform;
+		if (!ReadFromMessage(pos, end, lightTransform.data))
+		{
+			return false;
+		}
+		state.lightTransforms.push_back(lightTransform);
+	}
+	width = w;
+	height = h;
+	return pos == end;
+}
+
+// Сообщение с описанием сцены в двоичном формате SceneFile (см. SceneFile::WriteBinary)
+inline std::vector<char> MakeSceneFileMessage(std::uint32_t frameId, unsigned width, unsigned height,
+	std::string const& sceneData)
+{
+	std::vector<char> message = BeginMessage(NetworkMessageType::SceneFile);
+	message.reserve(message.size() + 3 * sizeof(std::uint32_t) + sceneData.size());
+	AppendToMessage(message, frameId);
+	AppendToMessage(message, std::uint32_t(width));
+	AppendToMessage(message, std::uint32_t(height));
+	message.insert(message.end(), sceneData.begin(), sceneData.end());
+	EndMessage(message);
+	return message;
+}
+
+// sceneData указывает на данные внутри payload
+inline bool ParseSceneFileMessage(std::vector<char> const& payload,
+	std::uint32_t& frameId, unsigned& width, unsigned& height, std::string_view& sceneData)
+{
+	const char* pos = payload.data();
+	const char* end = pos + payload.size();
+	std::uint32_t w = 0;
+	std::uint32_t h = 0;
+	if (!ReadFromMessage(pos, end, frameId) || !ReadFromMessage(pos, end, w) || !ReadFromMessage(pos, end, h))
+	{
+		return false;
+	}
+	width = w;
+	height = h;
+	sceneData = std::string_view(pos, size_t(end - pos));
+	return true;
+}
+
+/*
+	Сообщения с содержимым файла сетки, разбитым на части размером не более MESH_FILE_CHUNK_SIZE.
+	Для пустого файла формируется одно сообщение без данных
+*/
+inline std::vector<std::vector<char>> MakeMeshFileMessages(std::string const& name, std::string const& contents)
+{
+	std::vector<std::vector<char>> messages;
+	std::uint64_t offset = 0;
+	do
+	{
+		const size_t chunkSize = std::min(MESH_FILE_CHUNK_SIZE, size_t(contents.size() - offset));
+		std::vector<char> message = BeginMessage(NetworkMessageType::MeshFileChunk);
+		AppendToMessage(message, std::uint32_t(name.size()));
+		message.insert(message.end(), name.begin(), name.end());
+		AppendToMessage(message, offset);
+		message.insert(message.end(), contents.begin() + offset, contents.begin() + offset + chunkSize);
+		EndMessage(message);
+		messages.push_back(std::move(message));
+		offset += chunkSize;
+	} while (offset < contents.size());
+	return messages;
+}
+
+// name и data указывают на данные внутри payload
+inline bool ParseMeshFileChunk(std::vector<char> const& payload,
+	std::string_view& name, std::uint64_t& offset, std::string_view& data)
+{
+	const char* pos = payload.data();
+	const char* end = pos + payload.size();
+	std::uint32_t nameLength = 0;
+	if (!ReadFromMessage(pos, end, nameLength) || end - pos < std::ptrdiff_t(nameLength))
+	{
+		return false;
+	}
+	name = std::string_view(pos, nameLength);
+	pos += nameLength;
+	if (!ReadFromMessage(pos, end, offset))
+	{
+		return false;
+	}
+	data = std::string_view(pos, size_t(end - pos));
+	return true;
+}
+
+inline std::vector<char> MakeTileJobMessage(std::uint32_t frameId, std::uint32_t tileIndex)
+{
+	std::vector<char> message = BeginMessage(NetworkMessageType::TileJob);
+	AppendToMessage(message, frameId);
+	AppendToMessage(message, tileIndex);
+	EndMessage(message);
+	return message;
+}
+
+inline bool ParseTileJob(std::vector<char> const& payload, std::uint32_t& frameId, std::uint32_t& tileIndex)
+{
+	const char* pos = payload.data();
+	const char* end = pos + payload.size();
+	return ReadFromMessage(pos, end, frameId) && ReadFromMessage(pos, end, tileIndex) && pos == end;
+}
+
+// Сообщение с пикселями блока изображения tile из буфера кадра
+inline std::vector<char> MakeTileResultMessage(std::uint32_t frameId, std::uint32_t tileIndex,
+	FrameBuffer const& frameBuffer, CScreenRect const& tile)
+{
+	std::vector<char> message = BeginMessage(NetworkMessageType::TileResult);
+	message.reserve(message.size() + 2 * sizeof(std::uint32_t) + size_t(tile.GetWidth()) * tile.GetHeight() * sizeof(std::uint32_t));
+	AppendToMessage(message, frameId);
+	AppendToMessage(message, tileIndex);
+	for (unsigned y = tile.top; y < tile.bottom; ++y)
+	{
+		const char* row = reinterpret_cast<const char*>(frameBuffer.GetPixels(y) + tile.left);
+		message.insert(message.end(), row, row + tile.GetWidth() * sizeof(std::uint32_t));
+	}
+	EndMessage(message);
+	return message;
+}
+
+inline bool ParseTileResultHeader(std::vector<char> const& payload, std::uint32_t& frameId, std::uint32_t& tileIndex)
+{
+	const char* pos = payload.data();
+	const char* end = pos + payload.size();
+	return ReadFromMessage(pos, end, frameId) && ReadFromMessage(pos, end, tileIndex);
+}
+
+/*
+	Копирует пиксели блока изображения tile из сообщения TileResult в буфер кадра.
+	Возвращает false, если размер сообщения не соответствует размеру блока
+*/
+inline bool CopyTileResultPixels(std::vector<char> const& payload, CScreenRect const& tile, FrameBuffer& frameBuffer)
+{
+	const size_t rowSize = tile.GetWidth() * sizeof(std::uint32_t);
+	if (payload.size() != 2 * sizeof(std::uint32_t) + rowSize * tile.GetHeight())
+	{
+		return false;
+	}
+	const char* pixels = payload.data() + 2 * sizeof(std::uint32_t);
+	for (unsigned y = tile.top; y < tile.bottom; ++y, pixels += rowSize)
+	{
+		std::memcpy(frameBuffer.GetPixels(y) + tile.left, pixels, rowSize);
+	}
+	return true;
+}
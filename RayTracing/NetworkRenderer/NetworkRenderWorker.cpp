@@ -0,0 +1,271 @@
+﻿#include "NetworkRenderWorker.h"
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "NetworkRenderProtocol.h"
+#include "../MeshCache/MeshCache.h"
+#include "../Renderer/Renderer.h"
+#include "../SceneFile/SceneFile.h"
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+namespace
+{
+
+// Имя файла сетки должно задавать путь внутри каталога файлов сеток исполнителя
+bool IsMeshFileNameValid(std::filesystem::path const& name)
+{
+	if (name.empty() || name.has_root_name() || name.has_root_directory())
+	{
+		return false;
+	}
+	for (std::filesystem::path const& part : name)
+	{
+		if (part == "..")
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+NetworkRenderWorker::NetworkRenderWorker(unsigned short port, unsigned threadCount)
+	: m_port(port)
+	, m_threadCount(threadCount)
+	, m_meshDirectory(std::filesystem::temp_directory_path() / ("RayTracingWorker_" + std::to_string(port)))
+{
+}
+
+int NetworkRenderWorker::Run()
+{
+#ifdef _OPENMP
+	if (m_threadCount > 0)
+	{
+		omp_set_num_threads(int(m_threadCount));
+	}
+#endif
+
+	try
+	{
+		asio::io_context ioContext;
+		tcp::acceptor acceptor(ioContext, tcp::endpoint(tcp::v4(), m_port));
+		std::cout << "Render worker is listening on port " << acceptor.local_endpoint().port() << "\n";
+
+		for (;;)
+		{
+			tcp::socket socket(ioContext);
+			acceptor.accept(socket);
+			socket.set_option(tcp::no_delay(true));
+
+			// Ошибки соединения не завершают работу исполнителя: координатор может подключиться снова
+			try
+			{
+				ServeConnection(socket);
+			}
+			catch (boost::system::system_error const& e)
+			{
+				// Разрыв соединения координатором (например, после истечения времени ожидания) ошибкой не считаем
+				if (e.code() != asio::error::eof && e.code() != asio::error::broken_pipe
+					&& e.code() != asio::error::connection_reset)
+				{
+					std::cerr << "Render worker connection error: " << e.what() << "\n";
+				}
+			}
+		}
+	}
+	catch (boost::system::system_error const& e)
+	{
+		std::cerr << "Render worker: " << e.what() << "\n";
+		return 1;
+	}
+}
+
+void NetworkRenderWorker::ServeConnection(tcp::socket& socket)
+{
+	std::vector<char> payload;
+	for (;;)
+	{
+		NetworkMessageHeader header;
+		asio::read(socket, asio::buffer(&header, sizeof(header)));
+		if (header.size > MAX_NETWORK_MESSAGE_SIZE)
+		{
+			std::cerr << "Render worker: message is too large\n";
+			return;
+		}
+		payload.resize(header.size);
+		asio::read(socket, asio::buffer(payload));
+
+		switch (header.type)
+		{
+		case NetworkMessageType::SceneDescription:
+			if (!ApplySceneDescription(payload))
+			{
+				std::cerr << "Render worker: invalid scene description\n";
+				return;
+			}
+			break;
+		case NetworkMessageType::SceneFile:
+			if (!ApplySceneFile(payload))
+			{
+				std::cerr << "Render worker: invalid scene file\n";
+				return;
+			}
+			break;
+		case NetworkMessageType::MeshFileChunk:
+			if (!ApplyMeshFileChunk(payload))
+			{
+				std::cerr << "Render worker: failed to store mesh file\n";
+				return;
+			}
+			break;
+		case NetworkMessageType::TileJob:
+		{
+			std::uint32_t frameId = 0;
+			std::uint32_t tileIndex = 0;
+			if (!ParseTileJob(payload, frameId, tileIndex) || (!m_pDemoScene && !m_pFileScene))
+			{
+				std::cerr << "Render worker: invalid tile job\n";
+				return;
+			}
+
+			// Задания кадров, для которых уже получено новое описание сцены, пропускаем
+			const unsigned width = m_pFrameBuffer->GetWidth();
+			const unsigned height = m_pFrameBuffer->GetHeight();
+			if (frameId != m_frameId || tileIndex >= Renderer::GetTileCount(width, height))
+			{
+				break;
+			}
+
+			CScreenRect tile = Renderer::GetTileRect(tileIndex, width, height);
+			if (m_pFileScene)
+			{
+				Renderer::RenderTile(m_pFileScene->GetScene(), m_pFileScene->GetContext(), *m_pFrameBuffer, tile);
+			}
+			else
+			{
+				Renderer::RenderTile(m_pDemoScene->GetScene(), m_pDemoScene->GetContext(), *m_pFrameBuffer, tile);
+			}
+			asio::write(socket, asio::buffer(MakeTileResultMessage(frameId, tileIndex, *m_pFrameBuffer, tile)));
+			break;
+		}
+		default:
+			std::cerr << "Render worker: unexpected message\n";
+			return;
+		}
+	}
+}
+
+bool NetworkRenderWorker::ApplySceneDescription(std::vector<char> const& payload)
+{
+	std::uint32_t frameId = 0;
+	unsigned width = 0;
+	unsigned height = 0;
+	DemoSceneState state;
+	if (!ParseSceneDescription(payload, frameId, width, height, state) || width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	// Построение сцены - самая дорогая часть подготовки, поэтому сцена пересоздается только при изменении размеров кадра
+	m_pFileScene.reset();
+	m_sceneFileData.clear();
+	if (!m_pDemoScene || m_pFrameBuffer->GetWidth() != width || m_pFrameBuffer->GetHeight() != height)
+	{
+		m_pDemoScene = std::make_unique<DemoScene>(width, height);
+		ResizeFrameBuffer(width, height);
+	}
+	m_pDemoScene->SetState(state);
+	m_pDemoScene->GetScene().ResetChanges();
+	m_frameId = frameId;
+
+	return true;
+}
+
+bool NetworkRenderWorker::ApplySceneFile(std::vector<char> const& payload)
+{
+	std::uint32_t frameId = 0;
+	unsigned width = 0;
+	unsigned height = 0;
+	std::string_view sceneData;
+	if (!ParseSceneFileMessage(payload, frameId, width, height, sceneData) || width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	// Координатор присылает описание сцены с каждым кадром, а сцена строится заново только при его изменении
+	if (!m_pFileScene || sceneData != m_sceneFileData
+		|| m_pFrameBuffer->GetWidth() != width || m_pFrameBuffer->GetHeight() != height)
+	{
+		m_pDemoScene.reset();
+		m_pFileScene.reset();
+		m_sceneFileData.clear();
+		try
+		{
+			std::istringstream input{ std::string(sceneData) };
+			const SceneDescription description = SceneFile::ReadBinary(input);
+			for (std::string const& meshFile : description.meshFiles)
+			{
+				if (!IsMeshFileNameValid(meshFile))
+				{
+					std::cerr << "Render worker: invalid mesh file name " << meshFile << "\n";
+					return false;
+				}
+			}
+			m_pFileScene = std::make_unique<FileScene>(description, m_meshDirectory.string(), width, height);
+		}
+		catch (std::runtime_error const& e)
+		{
+			std::cerr << "Render worker: " << e.what() << "\n";
+			return false;
+		}
+		m_sceneFileData = sceneData;
+		ResizeFrameBuffer(width, height);
+	}
+	m_frameId = frameId;
+
+	return true;
+}
+
+bool NetworkRenderWorker::ApplyMeshFileChunk(std::vector<char> const& payload)
+{
+	std::string_view name;
+	std::uint64_t offset = 0;
+	std::string_view data;
+	if (!ParseMeshFileChunk(payload, name, offset, data) || !IsMeshFileNameValid(name))
+	{
+		return false;
+	}
+
+	// Начало передачи файла означает смену набора файлов сеток: сцена, построенная по прежним файлам,
+	// и их данные в кэше сеток больше не нужны (новые файлы могут иметь те же имена)
+	if (offset == 0)
+	{
+		m_pFileScene.reset();
+		m_sceneFileData.clear();
+		MeshCache::GetInstance().EvictUnused();
+	}
+
+	const std::filesystem::path path = m_meshDirectory / name;
+	std::error_code error;
+	std::filesystem::create_directories(path.parent_path(), error);
+	std::ofstream output(path, std::ios::binary | (offset == 0 ? std::ios::trunc : std::ios::app));
+	output.write(data.data(), std::streamsize(data.size()));
+	return bool(output);
+}
+
+void NetworkRenderWorker::ResizeFrameBuffer(unsigned width, unsigned height)
+{
+	if (!m_pFrameBuffer || m_pFrameBuffer->GetWidth() != width || m_pFrameBuffer->GetHeight() != height)
+	{
+		m_pFrameBuffer = std::make_unique<FrameBuffer>(width, height);
+	}
+}
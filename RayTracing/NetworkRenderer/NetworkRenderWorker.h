@@ -0,0 +1,66 @@
+﻿#pragma once
+#include <boost/asio/ip/tcp.hpp>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "../DemoScene/DemoScene.h"
+#include "../FileScene/FileScene.h"
+#include "../FrameBuffer/FrameBuffer.h"
+
+/*
+	Узел фермы визуализации. Принимает TCP-подключения координатора (по одному за раз),
+	воспроизводит присланное состояние демонстрационной сцены либо строит сцену по присланному описанию
+	и строит блоки изображения по заданиям координатора, отправляя ему пиксели каждого построенного блока.
+	Присланные файлы сеток сохраняются во временном каталоге исполнителя и используются, пока координатор
+	не пришлет другой набор файлов
+*/
+class NetworkRenderWorker
+{
+public:
+	/*
+		port - TCP-порт, на котором исполнитель ожидает подключений
+		threadCount - количество потоков, между которыми распределяются строки блока (0 - по умолчанию)
+	*/
+	NetworkRenderWorker(unsigned short port, unsigned threadCount = 0);
+
+	/*
+		Обслуживает подключения координаторов до завершения процесса.
+		Возвращает код завершения процесса
+	*/
+	int Run();
+
+private:
+	// Обрабатывает сообщения координатора до разрыва соединения
+	void ServeConnection(boost::asio::ip::tcp::socket& socket);
+
+	// Применяет описание сцены. Возвращает false, если описание некорректно
+	bool ApplySceneDescription(std::vector<char> const& payload);
+
+	// Строит сцену по описанию в формате SceneFile. Возвращает false, если описание некорректно или сцену построить не удалось
+	bool ApplySceneFile(std::vector<char> const& payload);
+
+	// Сохраняет часть файла сетки в каталог файлов сеток. Возвращает false при некорректном имени файла или ошибке записи
+	bool ApplyMeshFileChunk(std::vector<char> const& payload);
+
+	// Создает буфер кадра заново, если его размеры отличаются от заданных
+	void ResizeFrameBuffer(unsigned width, unsigned height);
+
+private:
+	unsigned short m_port;
+	unsigned m_threadCount;
+
+	// Сцена и буфер кадра создаются заново только при изменении размеров кадра.
+	// Существует не более одной из сцен: демонстрационная либо построенная по описанию
+	std::unique_ptr<DemoScene> m_pDemoScene;
+	std::unique_ptr<FileScene> m_pFileScene;
+	std::unique_ptr<FrameBuffer> m_pFrameBuffer;
+
+	// Описание сцены m_pFileScene в формате SceneFile: сцена строится заново только при его изменении
+	std::string m_sceneFileData;
+	// Каталог, в котором сохраняются присланные файлы сеток
+	std::filesystem::path m_meshDirectory;
+
+	// Номер кадра, к которому относится текущее описание сцены
+	std::uint32_t m_frameId = 0;
+};
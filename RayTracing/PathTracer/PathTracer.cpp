@@ -0,0 +1,138 @@
+﻿#include "PathTracer.h"
+#include <cmath>
+#include "../AccumulationBuffer/AccumulationBuffer.h"
+#include "../Scene/Scene.h"
+#include "../Intersection/Intersection.h"
+#include "../Ray/Ray.h"
+#include "../Sampler/ISampler.h"
+#include "../SceneObject/SceneObject.h"
+#include "../Shader/IShader.h"
+#include "../Shader/ShadeContext.h"
+#include "../Vector/VectorMath.h"
+
+namespace
+{
+// Наибольшая из цветовых компонент (альфа-канал не учитывается)
+double GetMaxComponent(CVector4f const& color) noexcept
+{
+	return Max(Max(Max(color.x, color.y), color.z), 0.0f);
+}
+} // namespace
+
+CVector4f PathTracer::TracePath(CScene const& scene, CRay const& ray, ISampler& sampler, PixelFeatures* pFeatures)
+{
+	SecondaryRayLimits const& limits = scene.GetSecondaryRayLimits();
+
+	CVector4f radiance;
+	// Произведение долей рассеянного света вдоль пути, деленных на вероятности выбора направлений
+	CVector4f throughput(1, 1, 1, 1);
+	RayPath path;
+	path.isPathTraced = true;
+
+	CRay pathRay = ray;
+	for (;;)
+	{
+		CIntersection bestIntersection;
+		CSceneObject const* pSceneObject = NULL;
+		if (!scene.GetFirstHit(pathRay, bestIntersection, &pSceneObject))
+		{
+			radiance += throughput * scene.GetBackdropColor();
+			break;
+		}
+		if (!pSceneObject->HasShader())
+		{
+			break;
+		}
+
+		IShader const& shader = pSceneObject->GetShader();
+		CHitInfo const& hit = bestIntersection.GetHit(0);
+		const CVector3d hitPoint = hit.GetHitPoint();
+		const CVector3d hitPointInObjectSpace = hit.GetHitPointInObjectSpace();
+		const CVector3d normal = hit.GetNormal();
+		const CVector3d rayDirection = pathRay.GetDirection();
+		CShadeContext shadeContext(scene, hitPoint, hitPointInObjectSpace, normal, rayDirection, path);
+
+		// Свет источников, рассеянный точкой в направлении пути
+		radiance += throughput * shader.Shade(shadeContext);
+
+		/*
+			Путь продолжается одним из лучей с вероятностью, пропорциональной доле рассеянного им света.
+			Доля делится на вероятность выбора, поэтому математическое ожидание вклада равно сумме вкладов всех лучей
+		*/
+		const SurfaceScattering scattering = shader.GetScattering(shadeContext);
+		if (path.depth == 0 && pFeatures != nullptr)
+		{
+			pFeatures->normal = scattering.normal;
+			pFeatures->albedo = scattering.diffuse + scattering.reflection + scattering.refraction;
+			pFeatures->depth = (hitPoint - ray.GetStart()).GetLength();
+		}
+		const double diffuseWeight = GetMaxComponent(scattering.diffuse);
+		const double reflectionWeight = GetMaxComponent(scattering.reflection);
+		const double refractionWeight = GetMaxComponent(scattering.refraction);
+		const double totalWeight = diffuseWeight + reflectionWeight + refractionWeight;
+		if (path.depth >= limits.maxDepth || !(totalWeight > 0))
+		{
+			break;
+		}
+
+		/*
+			Измерения выборки запрашиваются в одном и том же порядке независимо от выбранного луча,
+			чтобы одинаковые измерения разных выборок пикселя относились к одним и тем же решениям
+		*/
+		const double choice = sampler.Get1D() * totalWeight;
+		const CVector2d directionSample = sampler.Get2D();
+		const double rouletteSample = sampler.Get1D();
+
+		const double offset = GetRayOffset(hitPoint);
+		if (choice < diffuseWeight)
+		{
+			/*
+				Направления диффузно рассеянного света выбираются с плотностью cos / pi, поэтому косинус
+				и деление на плотность сокращаются с коэффициентом ламбертовского отражения (альбедо / pi)
+			*/
+			pathRay = CRay(hitPoint + offset * scattering.normal,
+				SampleCosineHemisphere(scattering.normal, directionSample.x, directionSample.y));
+			throughput *= static_cast<float>(totalWeight / diffuseWeight) * scattering.diffuse;
+		}
+		else if (choice < diffuseWeight + reflectionWeight)
+		{
+			pathRay = CRay(hitPoint + offset * scattering.normal, Reflect(rayDirection, scattering.normal));
+			throughput *= static_cast<float>(totalWeight / reflectionWeight) * scattering.reflection;
+		}
+		else
+		{
+			pathRay = CRay(hitPoint - offset * scattering.normal, scattering.refractedDirection);
+			throughput *= static_cast<float>(totalWeight / refractionWeight) * scattering.refraction;
+		}
+		++path.depth;
+
+		// Русская рулетка для путей с малым вкладом в цвет пикселя
+		path.throughput = GetMaxComponent(throughput);
+		if (path.throughput < limits.rouletteThroughput)
+		{
+			const double survivalProbability = path.throughput / limits.rouletteThroughput;
+			if (rouletteSample >= survivalProbability)
+			{
+				break;
+			}
+			throughput = static_cast<float>(1 / survivalProbability) * throughput;
+			path.throughput = limits.rouletteThroughput;
+		}
+	}
+	return radiance;
+}
+
+CVector3d PathTracer::SampleCosineHemisphere(CVector3d const& normal, double u, double v)
+{
+	// Ортонормированный базис с осью, направленной вдоль нормали
+	const CVector3d helper = (fabs(normal.x) < 0.9) ? CVector3d(1, 0, 0) : CVector3d(0, 1, 0);
+	const CVector3d tangent = Normalize(Cross(helper, normal));
+	const CVector3d bitangent = Cross(normal, tangent);
+
+	// Точка, равномерно распределенная по площади единичного круга, проецируется на полусферу
+	const double r = sqrt(u);
+	const double angle = 2 * PI * v;
+	const double x = r * cos(angle);
+	const double y = r * sin(angle);
+	return x * tangent + y * bitangent + sqrt(Max(1 - u, 0.0)) * normal;
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+
+class CRay;
+class CScene;
+class ISampler;
+struct PixelFeatures;
+
+/*
+	Трассировка путей (path tracing) - альтернатива рекурсивной трассировке лучей CScene::Shade,
+	учитывающая непрямое освещение. В каждой точке пути шейдер вычисляет освещенность источниками света
+	(с тенями), а путь продолжается одним лучом, выбранным случайно среди диффузно рассеянного, зеркально
+	отраженного и преломленного света пропорционально их долям (см. IShader::GetScattering).
+	Лучи, покинувшие сцену, приносят цвет фона сцены, поэтому фон освещает сцену как небо.
+	Каждый путь - несмещенная оценка цвета пикселя, а изображение получается усреднением многих путей
+	(см. AccumulationBuffer, Renderer::RenderProgressive).
+	Длина пути и русская рулетка задаются параметрами SecondaryRayLimits сцены
+*/
+class PathTracer
+{
+public:
+	/*
+		Трассирует путь, начинающийся лучом ray, и возвращает принесенный им цвет. Решения на каждом отскоке
+		принимаются по очередным измерениям текущей выборки sampler (по 4 измерения на отскок).
+		Если pFeatures != nullptr, в него записываются признаки первой точки пути
+	*/
+	static CVector4f TracePath(CScene const& scene, CRay const& ray, ISampler& sampler, PixelFeatures* pFeatures = nullptr);
+
+	/*
+		Направление в полусфере вокруг единичной нормали normal, распределенное с плотностью,
+		пропорциональной косинусу угла с нормалью. u, v - равномерно распределенные числа из [0; 1)
+	*/
+	static CVector3d SampleCosineHemisphere(CVector3d const& normal, double u, double v);
+};
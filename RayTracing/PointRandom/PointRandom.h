@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "../Vector/Vector3.h"
+#include "../Vector/VectorMath.h"
+
+/*
+	Номера последовательностей случайных чисел для решений, принимаемых в одной и той же точке
+*/
+enum class PointRandomStream : std::uint64_t
+{
+	// Стохастический выбор источников света (PhongShader)
+	LightSampling = 0,
+	// Русская рулетка для отраженных и преломленных лучей (PhongShader)
+	SecondaryRays = 1,
+	// Выборки на поверхности протяженных источников света (CScene::GetLightVisibility)
+	SoftShadows = 2,
+	// Независимые выборки пикселя и направления путей (IndependentSampler). Точкой служит (x, y, номер выборки) пикселя
+	PathTracing = 3,
+	// Направления лучей при вычислении записей кэша непрямой освещенности (IrradianceCache)
+	IrradianceCache = 4,
+	// Направления лучей при вычислении фонового затенения вершин сеток (AmbientOcclusionBaker)
+	AmbientOcclusion = 5,
+};
+
+/*
+	Генератор псевдослучайных чисел (SplitMix64), начальное состояние которого определяется координатами
+	точки сцены: результат не зависит от того, каким потоком и в каком порядке обрабатываются точки.
+	Разные номера последовательности дают независимые последовательности для одной и той же точки
+*/
+class PointRandom
+{
+public:
+	PointRandom(CVector3d const& point, PointRandomStream stream) noexcept
+		: m_state(std::uint64_t(stream))
+	{
+		double const* coordinates = point;
+		for (int i = 0; i < 3; ++i)
+		{
+			std::uint64_t bits;
+			std::memcpy(&bits, &coordinates[i], sizeof(bits));
+			m_state = Mix(m_state ^ bits) + GOLDEN_GAMMA;
+		}
+	}
+
+	// Равномерно распределенное число из [0; 1)
+	double NextDouble() noexcept
+	{
+		m_state += GOLDEN_GAMMA;
+		return double(Mix(m_state) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// Равномерно распределенное целое число из [0; count)
+	size_t NextIndex(size_t count) noexcept
+	{
+		return Min(size_t(NextDouble() * double(count)), count - 1);
+	}
+
+private:
+	static constexpr std::uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+	static std::uint64_t Mix(std::uint64_t z) noexcept
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	std::uint64_t m_state;
+};
@@ -0,0 +1,411 @@
+﻿#include "ProcessRenderCoordinator.h"
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/process/env.hpp>
+#include <boost/process/environment.hpp>
+#include <deque>
+#include <iostream>
+#include <new>
+#include "../Renderer/Renderer.h"
+
+namespace ipc = boost::interprocess;
+namespace bp = boost::process;
+
+namespace
+{
+// Количество блоков, одновременно назначаемых одному исполнителю.
+// Небольшая очередь позволяет исполнителю не простаивать, но не мешает перераспределять работу
+constexpr size_t MAX_TILES_IN_FLIGHT_PER_WORKER = 2;
+
+// Исполнитель, ожидающий задания и не подававший признаков жизни дольше этого времени, считается зависшим
+constexpr std::chrono::seconds WORKER_HEARTBEAT_TIMEOUT(10);
+
+// Время, за которое строящийся блок должен продвинуться хотя бы на одну строку. Оно больше WORKER_HEARTBEAT_TIMEOUT:
+// строка блока, построенного трассировкой путей с большим количеством выборок, может строиться долго
+constexpr std::chrono::seconds TILE_ROW_TIMEOUT(60);
+
+// Время ожидания сообщений о завершении блоков в одной итерации цикла раздачи заданий
+constexpr long DONE_QUEUE_WAIT_MS = 20;
+
+// Наибольшее количество перезапусков каждого исполнителя при построении одного кадра: исполнители,
+// аварийно завершающиеся на каждом блоке (или не запускающиеся), не должны перезапускаться бесконечно
+constexpr unsigned MAX_WORKER_RESTARTS_PER_FRAME = 2;
+}
+
+ProcessRenderCoordinator::ProcessRenderCoordinator(std::string const& workerExecutable, unsigned workerCount,
+	unsigned width, unsigned height, unsigned threadsPerWorker)
+	: m_workerExecutable(workerExecutable)
+	, m_segmentName("RayTracingFrame_" + std::to_string(boost::this_process::get_id()))
+	, m_threadsPerWorker(threadsPerWorker)
+{
+	// Удаляем объекты, которые могли остаться от аварийно завершившегося процесса с тем же идентификатором
+	RemoveIpcObjects();
+
+	// Создаем сегмент разделяемой памяти, вмещающий заголовок и пиксели буфера кадра
+	m_sharedMemory = ipc::shared_memory_object(ipc::create_only, m_segmentName.c_str(), ipc::read_write);
+	m_sharedMemory.truncate(ipc::offset_t(SHARED_FRAME_PIXELS_OFFSET + size_t(width) * height * sizeof(std::uint32_t)));
+	m_region = ipc::mapped_region(m_sharedMemory, ipc::read_write);
+
+	m_pHeader = new (m_region.get_address()) SharedFrameHeader();
+	m_pHeader->width = width;
+	m_pHeader->height = height;
+	m_pHeader->frameId.store(0);
+	m_pHeader->shutdown.store(0);
+	for (RenderWorkerSlot& slot : m_pHeader->workers)
+	{
+		slot.heartbeat.store(0);
+		slot.renderedRows.store(0);
+		slot.renderingTile.store(0);
+		slot.ready.store(0);
+	}
+
+	m_pFrameBuffer = std::make_unique<FrameBuffer>(width, height,
+		reinterpret_cast<std::uint32_t*>(static_cast<char*>(m_region.get_address()) + SHARED_FRAME_PIXELS_OFFSET));
+	m_pFrameBuffer->Clear();
+	m_completedTiles.SetFrameSize(width, height);
+
+	m_doneQueue = std::make_unique<ipc::message_queue>(ipc::create_only,
+		GetTileDoneQueueName(m_segmentName).c_str(), RENDER_QUEUE_CAPACITY, sizeof(TileDoneMessage));
+
+	// Создаем очереди заданий и запускаем исполнителей
+	m_workers.resize(std::min(workerCount, MAX_RENDER_WORKERS));
+	for (unsigned i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i].jobQueue = std::make_unique<ipc::message_queue>(ipc::create_only,
+			GetTileJobQueueName(m_segmentName, i).c_str(), RENDER_QUEUE_CAPACITY, sizeof(TileJobMessage));
+		LaunchWorker(i);
+	}
+}
+
+ProcessRenderCoordinator::~ProcessRenderCoordinator()
+{
+	Stop();
+
+	// Просим исполнителей завершить работу и даем им время на это
+	m_pHeader->shutdown.store(1);
+	for (Worker& worker : m_workers)
+	{
+		std::error_code error;
+		if (worker.process.valid() && !worker.process.wait_for(std::chrono::seconds(2), error))
+		{
+			worker.process.terminate(error);
+		}
+	}
+
+	m_doneQueue.reset();
+	for (Worker& worker : m_workers)
+	{
+		worker.jobQueue.reset();
+	}
+	RemoveIpcObjects();
+}
+
+FrameBuffer& ProcessRenderCoordinator::GetFrameBuffer()
+{
+	return *m_pFrameBuffer;
+}
+
+bool ProcessRenderCoordinator::IsRendering() const
+{
+	return m_rendering;
+}
+
+bool ProcessRenderCoordinator::GetProgress(unsigned& renderedChunks, unsigned& totalChunks) const
+{
+	renderedChunks = m_renderedChunks;
+	totalChunks = m_totalChunks;
+
+	return (totalChunks > 0) && (renderedChunks == totalChunks);
+}
+
+void ProcessRenderCoordinator::SetProgressCallback(TileCompletionTracker::ProgressCallback callback)
+{
+	m_completedTiles.SetProgressCallback(std::move(callback));
+}
+
+bool ProcessRenderCoordinator::TakeChangedRegions(std::vector<CScreenRect>& regions)
+{
+	return m_completedTiles.TakeChangedRegions(regions);
+}
+
+unsigned ProcessRenderCoordinator::GetAliveWorkerCount() const
+{
+	std::lock_guard lock(m_mutex);
+	return unsigned(std::count_if(m_workers.begin(), m_workers.end(), [](Worker const& worker) {
+		return worker.alive;
+	}));
+}
+
+bool ProcessRenderCoordinator::Render()
+{
+	bool expected = false;
+	if (!m_rendering.compare_exchange_strong(expected, true))
+	{
+		// Построение предыдущего кадра еще не завершено
+		return false;
+	}
+
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+	{
+		std::lock_guard lock(m_mutex);
+
+		// Перезапускаем исполнителей, вышедших из строя при построении предыдущих кадров
+		for (unsigned i = 0; i < m_workers.size(); ++i)
+		{
+			if (!m_workers[i].alive)
+			{
+				LaunchWorker(i);
+			}
+		}
+	}
+
+	// Новый номер кадра заставляет исполнителей пропускать задания прерванных кадров
+	std::uint32_t frameId = m_pHeader->frameId.load() + 1;
+	m_pHeader->frameId.store(frameId);
+
+	// Буфер кадра не очищаем: предыдущее изображение остается на экране, пока его не заменят блоки нового кадра
+	m_renderedChunks = 0;
+	m_totalChunks = Renderer::GetTileCount(m_pFrameBuffer->GetWidth(), m_pFrameBuffer->GetHeight());
+	m_stopping = false;
+
+	m_thread = std::jthread(&ProcessRenderCoordinator::DispatchFrame, this, frameId);
+	return true;
+}
+
+void ProcessRenderCoordinator::Stop()
+{
+	if (IsRendering())
+	{
+		m_stopping = true;
+		if (m_thread.joinable())
+		{
+			m_thread.join();
+		}
+		m_stopping = false;
+	}
+}
+
+void ProcessRenderCoordinator::LaunchWorker(unsigned workerId)
+{
+	Worker& worker = m_workers[workerId];
+	RenderWorkerSlot& slot = m_pHeader->workers[workerId];
+
+	// Завершаем процесс, если он завис, и удаляем из его очереди задания, которые он не успел получить
+	std::error_code error;
+	if (worker.process.valid() && worker.process.running(error))
+	{
+		worker.process.terminate(error);
+	}
+	TileJobMessage staleJob;
+	ipc::message_queue::size_type receivedSize = 0;
+	unsigned priority = 0;
+	while (worker.jobQueue->try_receive(&staleJob, sizeof(staleJob), receivedSize, priority))
+	{
+	}
+
+	slot.ready.store(0);
+	slot.renderingTile.store(0);
+	worker.tilesInFlight.clear();
+	worker.lastHeartbeat = slot.heartbeat.load();
+	worker.lastRenderedRows = slot.renderedRows.load();
+	worker.lastProgressChange = std::chrono::steady_clock::now();
+
+	bp::environment environment = boost::this_process::environment();
+	if (m_threadsPerWorker > 0)
+	{
+		// Исполнители занимают соседние диапазоны логических процессоров, при нехватке процессоров - с начала.
+		// Переменные окружения учитываются средами выполнения OpenMP 4.0 и новее
+		const unsigned processorCount = std::max(std::thread::hardware_concurrency(), 1u);
+		const unsigned firstProcessor = (workerId * m_threadsPerWorker) % processorCount;
+		const unsigned placeCount = std::min(m_threadsPerWorker, processorCount - firstProcessor);
+		environment["OMP_PLACES"] = "{" + std::to_string(firstProcessor) + "}:" + std::to_string(placeCount);
+		environment["OMP_PROC_BIND"] = "close";
+	}
+
+	try
+	{
+		worker.process = bp::child(m_workerExecutable,
+			"--render-worker", m_segmentName, std::to_string(workerId), std::to_string(m_threadsPerWorker), environment);
+		worker.alive = true;
+	}
+	catch (bp::process_error const& e)
+	{
+		std::cerr << "Failed to launch render worker " << workerId << ": " << e.what() << "\n";
+		worker.alive = false;
+	}
+}
+
+bool ProcessRenderCoordinator::CheckWorkerAlive(Worker& worker, unsigned workerId)
+{
+	if (!worker.alive)
+	{
+		return false;
+	}
+
+	// Процесс завершился (например, аварийно)
+	std::error_code error;
+	if (!worker.process.running(error))
+	{
+		std::cerr << "Render worker " << workerId << " exited\n";
+		worker.alive = false;
+		return false;
+	}
+
+	/*
+		Ожидающий задания исполнитель увеличивает счетчик жизни, а строящий блок - счетчик построенных строк.
+		Пока исполнитель загружает сцену, счетчики не меняются, поэтому проверяем их только у готовых исполнителей
+	*/
+	RenderWorkerSlot const& slot = m_pHeader->workers[workerId];
+	const std::uint64_t heartbeat = slot.heartbeat.load();
+	const std::uint64_t renderedRows = slot.renderedRows.load();
+	const auto now = std::chrono::steady_clock::now();
+	if (heartbeat != worker.lastHeartbeat || renderedRows != worker.lastRenderedRows)
+	{
+		worker.lastHeartbeat = heartbeat;
+		worker.lastRenderedRows = renderedRows;
+		worker.lastProgressChange = now;
+	}
+	else if (slot.ready.load() != 0)
+	{
+		const std::uint32_t renderingTile = slot.renderingTile.load();
+		if (now - worker.lastProgressChange > (renderingTile != 0 ? TILE_ROW_TIMEOUT : WORKER_HEARTBEAT_TIMEOUT))
+		{
+			if (renderingTile != 0)
+			{
+				std::cerr << "Render worker " << workerId << " stopped making progress on tile " << renderingTile - 1 << "\n";
+			}
+			else
+			{
+				std::cerr << "Render worker " << workerId << " stopped responding\n";
+			}
+			worker.process.terminate(error);
+			worker.alive = false;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ProcessRenderCoordinator::DispatchFrame(std::uint32_t frameId)
+{
+	// Блоки, которые еще не назначены ни одному исполнителю
+	std::deque<std::uint32_t> pendingTiles;
+	for (std::uint32_t tileIndex = 0; tileIndex < m_totalChunks; ++tileIndex)
+	{
+		pendingTiles.push_back(tileIndex);
+	}
+
+	unsigned restartCount = 0;
+	const unsigned maxRestartCount = unsigned(m_workers.size()) * MAX_WORKER_RESTARTS_PER_FRAME;
+
+	while (!m_stopping)
+	{
+		bool anyWorkerAlive = false;
+		bool anyTileInFlight = false;
+		{
+			std::lock_guard lock(m_mutex);
+			for (unsigned i = 0; i < m_workers.size(); ++i)
+			{
+				Worker& worker = m_workers[i];
+				if (!CheckWorkerAlive(worker, i))
+				{
+					// Блоки вышедшего из строя исполнителя передаем другим исполнителям в первую очередь
+					pendingTiles.insert(pendingTiles.begin(), worker.tilesInFlight.begin(), worker.tilesInFlight.end());
+					worker.tilesInFlight.clear();
+
+					// Исполнитель перезапускается сразу, иначе кадр, все исполнители которого вышли из строя,
+					// так и остался бы недостроенным. Новый исполнитель получит задания после загрузки сцены
+					if (restartCount >= maxRestartCount)
+					{
+						continue;
+					}
+					++restartCount;
+					LaunchWorker(i);
+					if (!worker.alive)
+					{
+						continue;
+					}
+				}
+				anyWorkerAlive = true;
+
+				// Назначаем исполнителю новые блоки
+				while (worker.tilesInFlight.size() < MAX_TILES_IN_FLIGHT_PER_WORKER && !pendingTiles.empty())
+				{
+					TileJobMessage job{ frameId, pendingTiles.front() };
+					if (!worker.jobQueue->try_send(&job, sizeof(job), 0))
+					{
+						break;
+					}
+					worker.tilesInFlight.push_back(job.tileIndex);
+					pendingTiles.pop_front();
+				}
+				anyTileInFlight = anyTileInFlight || !worker.tilesInFlight.empty();
+			}
+		}
+
+		if (!anyWorkerAlive)
+		{
+			// Исполнители не запускаются либо снова и снова завершаются аварийно
+			std::cerr << "No render workers available after " << restartCount << " restarts\n";
+			break;
+		}
+		if (pendingTiles.empty() && !anyTileInFlight)
+		{
+			// Все блоки построены
+			break;
+		}
+
+		// Собираем сообщения о завершенных блоках: ждем первое ограниченное время, остальные забираем без ожидания
+		TileDoneMessage done;
+		ipc::message_queue::size_type receivedSize = 0;
+		unsigned priority = 0;
+		auto timeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(DONE_QUEUE_WAIT_MS);
+		bool received = m_doneQueue->timed_receive(&done, sizeof(done), receivedSize, priority, timeout);
+		while (received)
+		{
+			// Сообщения прерванных кадров и сообщения о блоках, уже переданных другому исполнителю, не учитываем
+			if (receivedSize == sizeof(done) && done.frameId == frameId && done.workerId < m_workers.size())
+			{
+				std::lock_guard lock(m_mutex);
+				auto& tilesInFlight = m_workers[done.workerId].tilesInFlight;
+				auto it = std::find(tilesInFlight.begin(), tilesInFlight.end(), done.tileIndex);
+				if (it != tilesInFlight.end())
+				{
+					tilesInFlight.erase(it);
+					const unsigned renderedChunks = ++m_renderedChunks;
+					m_completedTiles.MarkTileCompleted(done.tileIndex, renderedChunks == m_totalChunks);
+				}
+			}
+			received = m_doneQueue->try_receive(&done, sizeof(done), receivedSize, priority);
+		}
+	}
+
+	if (m_stopping)
+	{
+		// Исполнители пропустят оставшиеся задания прерванного кадра
+		m_pHeader->frameId.store(frameId + 1);
+
+		std::lock_guard lock(m_mutex);
+		for (Worker& worker : m_workers)
+		{
+			worker.tilesInFlight.clear();
+		}
+	}
+
+	m_rendering = false;
+}
+
+void ProcessRenderCoordinator::RemoveIpcObjects()
+{
+	ipc::shared_memory_object::remove(m_segmentName.c_str());
+	ipc::message_queue::remove(GetTileDoneQueueName(m_segmentName).c_str());
+	for (unsigned i = 0; i < MAX_RENDER_WORKERS; ++i)
+	{
+		ipc::message_queue::remove(GetTileJobQueueName(m_segmentName, i).c_str());
+	}
+}
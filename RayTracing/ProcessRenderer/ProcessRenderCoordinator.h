@@ -0,0 +1,133 @@
+﻿#pragma once
+#include <atomic>
+#include <boost/interprocess/ipc/message_queue.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/process/child.hpp>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ProcessRenderProtocol.h"
+#include "../FrameBuffer/FrameBuffer.h"
+#include "../TileCompletionTracker/TileCompletionTracker.h"
+
+/*
+	Координатор многопроцессного построения изображения.
+
+	Буфер кадра размещается в именованном сегменте разделяемой памяти, к которому подключаются
+	процессы-исполнители (см. ProcessRenderWorker). Каждый исполнитель загружает сцену один раз,
+	после чего строит назначенные ему блоки изображения. Координатор в фоновом потоке раздает задания,
+	собирает сообщения о завершенных блоках и следит за исполнителями: блоки исполнителя, завершившегося
+	аварийно или переставшего подавать признаки жизни (в том числе зависшего при построении блока),
+	передаются другим исполнителям.
+	Исполнители, вышедшие из строя, перезапускаются, не дожидаясь завершения кадра
+	(количество перезапусков за кадр ограничено), а также перед построением следующего кадра
+*/
+class ProcessRenderCoordinator
+{
+public:
+	/*
+		workerExecutable - исполняемый файл, запускаемый в режиме исполнителя (--render-worker)
+		workerCount - количество процессов-исполнителей
+		width, height - размеры буфера кадра
+		threadsPerWorker - количество потоков каждого исполнителя (0 - по умолчанию). Если оно задано, потоки
+			каждого исполнителя привязываются к собственному диапазону логических процессоров (см. LaunchWorker)
+	*/
+	ProcessRenderCoordinator(std::string const& workerExecutable, unsigned workerCount,
+		unsigned width, unsigned height, unsigned threadsPerWorker = 0);
+
+	// Завершает работу исполнителей и удаляет разделяемую память и очереди
+	~ProcessRenderCoordinator();
+
+	ProcessRenderCoordinator(ProcessRenderCoordinator const&) = delete;
+	ProcessRenderCoordinator& operator=(ProcessRenderCoordinator const&) = delete;
+
+	// Буфер кадра, размещенный в разделяемой памяти
+	FrameBuffer& GetFrameBuffer();
+
+	/*
+		Запускает построение кадра. Возвращает false, если построение предыдущего кадра не завершено
+	*/
+	bool Render();
+
+	// Прерывает построение кадра
+	void Stop();
+
+	// Выполняется ли в данный момент построение изображения?
+	bool IsRendering() const;
+
+	/*
+		Сообщает о прогрессе выполнения работы аналогично Renderer::GetProgress
+	*/
+	bool GetProgress(unsigned& renderedChunks, unsigned& totalChunks) const;
+
+	/*
+		Функция, вызываемая после получения каждого построенного блока (см. Renderer::SetProgressCallback)
+	*/
+	void SetProgressCallback(TileCompletionTracker::ProgressCallback callback);
+
+	// Области буфера кадра, изменившиеся с момента предыдущего вызова (см. Renderer::TakeChangedRegions)
+	bool TakeChangedRegions(std::vector<CScreenRect>& regions);
+
+	// Количество работающих исполнителей
+	unsigned GetAliveWorkerCount() const;
+
+private:
+	// Состояние исполнителя с точки зрения координатора
+	struct Worker
+	{
+		boost::process::child process;
+		std::unique_ptr<boost::interprocess::message_queue> jobQueue;
+		// Назначенные исполнителю, но еще не завершенные блоки
+		std::vector<std::uint32_t> tilesInFlight;
+		// Последние известные значения счетчика жизни и счетчика построенных строк и момент изменения одного из них
+		std::uint64_t lastHeartbeat = 0;
+		std::uint64_t lastRenderedRows = 0;
+		std::chrono::steady_clock::time_point lastProgressChange;
+		bool alive = false;
+	};
+
+	/*
+		Запускает процесс-исполнитель с заданным номером. При заданном количестве потоков исполнителя его потоки
+		привязываются к threadsPerWorker логическим процессорам, начиная с workerId * threadsPerWorker (см. OMP_PLACES)
+	*/
+	void LaunchWorker(unsigned workerId);
+
+	// Проверяет, что исполнитель работает и продвигается в построении блока либо ожидает задания
+	bool CheckWorkerAlive(Worker& worker, unsigned workerId);
+
+	// Раздача заданий и сбор результатов, выполняемые в фоновом потоке
+	void DispatchFrame(std::uint32_t frameId);
+
+	// Удаляет именованные объекты межпроцессного взаимодействия
+	void RemoveIpcObjects();
+
+private:
+	std::string m_workerExecutable;
+	std::string m_segmentName;
+	unsigned m_threadsPerWorker;
+
+	boost::interprocess::shared_memory_object m_sharedMemory;
+	boost::interprocess::mapped_region m_region;
+	SharedFrameHeader* m_pHeader = nullptr;
+	std::unique_ptr<FrameBuffer> m_pFrameBuffer;
+	// Полученные, но еще не перенесенные на экран блоки
+	TileCompletionTracker m_completedTiles;
+	std::unique_ptr<boost::interprocess::message_queue> m_doneQueue;
+
+	std::vector<Worker> m_workers;
+
+	// Поток, раздающий задания исполнителям
+	std::jthread m_thread;
+
+	// Мьютекс, защищающий состояние исполнителей
+	mutable std::mutex m_mutex;
+
+	std::atomic_bool m_rendering{ false };
+	std::atomic_bool m_stopping{ false };
+	std::atomic_uint32_t m_totalChunks{ 0 };
+	std::atomic_uint32_t m_renderedChunks{ 0 };
+};
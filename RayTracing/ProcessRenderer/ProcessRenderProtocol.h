@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/*
+	Общие для координатора и процессов-исполнителей структуры данных.
+
+	Буфер кадра размещается в именованном сегменте разделяемой памяти сразу после заголовка
+	SharedFrameHeader. Задания на построение блоков изображения передаются каждому исполнителю
+	через его собственную очередь сообщений, а сообщения о завершении блоков - через общую очередь
+*/
+
+// Максимальное количество процессов-исполнителей
+constexpr unsigned MAX_RENDER_WORKERS = 64;
+
+// Максимальное количество сообщений в очереди
+constexpr unsigned RENDER_QUEUE_CAPACITY = 1024;
+
+// Атомарные переменные размещаются в разделяемой памяти, поэтому должны обходиться без блокировок
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+/*
+	Состояние процесса-исполнителя, видимое координатору
+*/
+struct RenderWorkerSlot
+{
+	// Счетчик, который исполнитель периодически увеличивает, пока ожидает задания
+	std::atomic<std::uint64_t> heartbeat;
+
+	// Количество построенных исполнителем строк блоков: по нему координатор видит, что построение блока продвигается
+	std::atomic<std::uint64_t> renderedRows;
+
+	// Номер строящегося блока, увеличенный на 1 (0 - исполнитель ожидает задания)
+	std::atomic<std::uint32_t> renderingTile;
+
+	// Исполнитель загрузил сцену и готов принимать задания (1 - да, 0 - нет)
+	std::atomic<std::uint32_t> ready;
+};
+
+/*
+	Заголовок сегмента разделяемой памяти
+*/
+struct SharedFrameHeader
+{
+	// Размеры буфера кадра
+	std::uint32_t width;
+	std::uint32_t height;
+
+	// Номер строящегося кадра. Задания, относящиеся к другим кадрам, исполнители пропускают
+	std::atomic<std::uint32_t> frameId;
+
+	// Запрос на завершение работы всех исполнителей (1 - да, 0 - нет)
+	std::atomic<std::uint32_t> shutdown;
+
+	RenderWorkerSlot workers[MAX_RENDER_WORKERS];
+};
+
+// Смещение пикселей буфера кадра от начала сегмента (выровнено на 64 байта)
+constexpr size_t SHARED_FRAME_PIXELS_OFFSET = (sizeof(SharedFrameHeader) + 63) / 64 * 64;
+
+// Задание на построение блока изображения
+struct TileJobMessage
+{
+	std::uint32_t frameId;
+	std::uint32_t tileIndex;
+};
+
+// Сообщение о завершении построения блока изображения
+struct TileDoneMessage
+{
+	std::uint32_t workerId;
+	std::uint32_t frameId;
+	std::uint32_t tileIndex;
+};
+
+// Имя очереди заданий исполнителя с заданным номером
+inline std::string GetTileJobQueueName(std::string const& segmentName, unsigned workerId)
+{
+	return segmentName + "_jobs_" + std::to_string(workerId);
+}
+
+// Имя общей очереди сообщений о завершении блоков
+inline std::string GetTileDoneQueueName(std::string const& segmentName)
+{
+	return segmentName + "_done";
+}
@@ -0,0 +1,97 @@
+﻿#include "ProcessRenderWorker.h"
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/interprocess/ipc/message_queue.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "ProcessRenderProtocol.h"
+#include "../DemoScene/DemoScene.h"
+#include "../FrameBuffer/FrameBuffer.h"
+#include "../Renderer/Renderer.h"
+
+namespace ipc = boost::interprocess;
+
+ProcessRenderWorker::ProcessRenderWorker(std::string const& segmentName, unsigned workerId, unsigned threadCount)
+	: m_segmentName(segmentName)
+	, m_workerId(workerId)
+	, m_threadCount(threadCount)
+{
+}
+
+int ProcessRenderWorker::Run()
+{
+	if (m_workerId >= MAX_RENDER_WORKERS)
+	{
+		std::cerr << "Invalid render worker id " << m_workerId << "\n";
+		return 1;
+	}
+
+#ifdef _OPENMP
+	if (m_threadCount > 0)
+	{
+		omp_set_num_threads(int(m_threadCount));
+	}
+#endif
+
+	try
+	{
+		// Подключаемся к сегменту разделяемой памяти и очередям, созданным координатором
+		ipc::shared_memory_object sharedMemory(ipc::open_only, m_segmentName.c_str(), ipc::read_write);
+		ipc::mapped_region region(sharedMemory, ipc::read_write);
+		auto* pHeader = static_cast<SharedFrameHeader*>(region.get_address());
+		RenderWorkerSlot& slot = pHeader->workers[m_workerId];
+
+		FrameBuffer frameBuffer(pHeader->width, pHeader->height,
+			reinterpret_cast<std::uint32_t*>(static_cast<char*>(region.get_address()) + SHARED_FRAME_PIXELS_OFFSET));
+
+		ipc::message_queue jobQueue(ipc::open_only, GetTileJobQueueName(m_segmentName, m_workerId).c_str());
+		ipc::message_queue doneQueue(ipc::open_only, GetTileDoneQueueName(m_segmentName).c_str());
+
+		// Сцена строится один раз на все время работы процесса
+		DemoScene demoScene(pHeader->width, pHeader->height);
+		slot.ready.store(1);
+
+		while (pHeader->shutdown.load() == 0)
+		{
+			/*
+				Ожидая задания, исполнитель подает признаки жизни счетчиком heartbeat, а при построении блока -
+				счетчиком построенных строк. Исполнитель, зависший внутри построения блока, перестает их увеличивать
+			*/
+			++slot.heartbeat;
+
+			// Ожидаем задание ограниченное время, чтобы регулярно проверять запрос на завершение работы
+			TileJobMessage job;
+			ipc::message_queue::size_type receivedSize = 0;
+			unsigned priority = 0;
+			auto timeout = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100);
+			if (!jobQueue.timed_receive(&job, sizeof(job), receivedSize, priority, timeout) || receivedSize != sizeof(job))
+			{
+				continue;
+			}
+
+			// Задания кадров, построение которых было прервано, пропускаем
+			if (job.frameId != pHeader->frameId.load())
+			{
+				continue;
+			}
+
+			slot.renderingTile.store(job.tileIndex + 1);
+			Renderer::RenderTile(demoScene.GetScene(), demoScene.GetContext(), frameBuffer,
+				Renderer::GetTileRect(job.tileIndex, pHeader->width, pHeader->height), &slot.renderedRows);
+			slot.renderingTile.store(0);
+
+			TileDoneMessage done{ m_workerId, job.frameId, job.tileIndex };
+			doneQueue.send(&done, sizeof(done), 0);
+		}
+	}
+	catch (ipc::interprocess_exception const& e)
+	{
+		std::cerr << "Render worker " << m_workerId << ": " << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
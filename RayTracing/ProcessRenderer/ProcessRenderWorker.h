@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <string>
+
+/*
+	Процесс-исполнитель, выполняющий построение блоков изображения по заданиям координатора.
+	Сцена загружается один раз при запуске, пиксели записываются непосредственно в буфер кадра,
+	размещенный в разделяемой памяти
+*/
+class ProcessRenderWorker
+{
+public:
+	/*
+		segmentName - имя сегмента разделяемой памяти, созданного координатором
+		workerId - номер исполнителя (определяет очередь заданий и ячейку состояния)
+		threadCount - количество потоков, между которыми распределяются строки блока (0 - по умолчанию)
+	*/
+	ProcessRenderWorker(std::string const& segmentName, unsigned workerId, unsigned threadCount = 0);
+
+	/*
+		Обрабатывает задания до получения запроса на завершение работы.
+		Возвращает код завершения процесса
+	*/
+	int Run();
+
+private:
+	std::string m_segmentName;
+	unsigned m_workerId;
+	unsigned m_threadCount;
+};
@@ -0,0 +1,141 @@
+﻿#include <algorithm>
+#include <cmath>
+#include "QuantizedMesh.h"
+#include "../Intersection/Intersection.h"
+#include "../Ray/Ray.h"
+#include "../Vector/VectorMath.h"
+
+namespace
+{
+/*
+	Проверка пересечения луча с треугольником (алгоритм Моллера-Трумбора).
+	Треугольник виден с обеих сторон, как и в CTriangle::HitTest
+*/
+bool HitTriangle(CVector3d const& rayStart, CVector3d const& rayDirection,
+	CVector3d const& p0, CVector3d const& p1, CVector3d const& p2,
+	double& hitTime, double& vertex1Weight, double& vertex2Weight)
+{
+	const double EPSILON = 1e-10;
+
+	CVector3d const e01 = p1 - p0;
+	CVector3d const e02 = p2 - p0;
+	CVector3d const directionCrossE02 = Cross(rayDirection, e02);
+	const double determinant = Dot(e01, directionCrossE02);
+
+	// Луч параллелен плоскости треугольника
+	if (std::abs(determinant) < EPSILON)
+	{
+		return false;
+	}
+	const double invDeterminant = 1 / determinant;
+
+	CVector3d const p0Start = rayStart - p0;
+	vertex1Weight = Dot(p0Start, directionCrossE02) * invDeterminant;
+	if (vertex1Weight < 0 || vertex1Weight > 1)
+	{
+		return false;
+	}
+
+	CVector3d const p0StartCrossE01 = Cross(p0Start, e01);
+	vertex2Weight = Dot(rayDirection, p0StartCrossE01) * invDeterminant;
+	if (vertex2Weight < 0 || vertex1Weight + vertex2Weight > 1)
+	{
+		return false;
+	}
+
+	// Если время соударения в прошлом, то столкновения нет
+	hitTime = Dot(e02, p0StartCrossE01) * invDeterminant;
+	return hitTime >= EPSILON;
+}
+} // namespace
+
+QuantizedMesh::QuantizedMesh(QuantizedMeshData const* pMeshData, CMatrix4d const& transform)
+	: CGeometryObjectImpl(transform)
+	, m_pMeshData(pMeshData)
+{
+}
+
+bool QuantizedMesh::Hit(CRay const& ray, CIntersection& intersection) const
+{
+	// Вычисляем обратно преобразованный луч (вместо вполнения прямого преобразования объекта)
+	CRay invRay = Transform(ray, GetInverseTransform());
+	CVector3d const& invRayStart = invRay.GetStart();
+	CVector3d const& invRayDirection = invRay.GetDirection();
+
+	// Информация о пересечении луча с гранью сетки
+	struct FaceHit
+	{
+		double w1, w2; // Весовые коэффициенты вершин 1 и 2 в точке пересечения
+		double hitTime; // Время пересечения
+		size_t faceIndex; // Индекс грани
+	};
+	std::vector<FaceHit> faceHits;
+
+	// Как и CTriangleMesh, проверяем пересечение луча со всеми гранями сетки
+	const size_t numTriangles = m_pMeshData->GetTriangleCount();
+	FaceHit hit;
+	for (size_t i = 0; i < numTriangles; ++i)
+	{
+		std::uint32_t const* triangleVertices = m_pMeshData->GetTriangleVertices(i);
+		if (HitTriangle(invRayStart, invRayDirection,
+				m_pMeshData->GetVertexPosition(triangleVertices[0]),
+				m_pMeshData->GetVertexPosition(triangleVertices[1]),
+				m_pMeshData->GetVertexPosition(triangleVertices[2]),
+				hit.hitTime, hit.w1, hit.w2))
+		{
+			hit.faceIndex = i;
+			if (faceHits.empty())
+			{
+				faceHits.reserve(8);
+			}
+			faceHits.push_back(hit);
+		}
+	}
+
+	// При отсутствии пересечений выходим
+	if (faceHits.empty())
+	{
+		return false;
+	}
+
+	// Возвращаем найденные пересечения в порядке возрастания времени столкновения
+	std::sort(faceHits.begin(), faceHits.end(), [](FaceHit const& a, FaceHit const& b) {
+		return a.hitTime < b.hitTime;
+	});
+	for (FaceHit const& faceHit : faceHits)
+	{
+		std::uint32_t const* triangleVertices = m_pMeshData->GetTriangleVertices(faceHit.faceIndex);
+
+		CVector3d normalInObjectSpace;
+		if (m_pMeshData->IsTriangleFlatShaded(faceHit.faceIndex))
+		{
+			// Нормаль "плоской грани" вычисляется по распакованным вершинам так же, как в CTriangle
+			CVector3d const p0 = m_pMeshData->GetVertexPosition(triangleVertices[0]);
+			normalInObjectSpace = Cross(
+				m_pMeshData->GetVertexPosition(triangleVertices[1]) - p0,
+				m_pMeshData->GetVertexPosition(triangleVertices[2]) - p0);
+		}
+		else
+		{
+			// Для неплоских граней выполняется интерполяция распакованных нормалей вершин
+			const double w0 = 1 - faceHit.w1 - faceHit.w2;
+			normalInObjectSpace = w0 * m_pMeshData->GetVertexNormal(triangleVertices[0])
+				+ faceHit.w1 * m_pMeshData->GetVertexNormal(triangleVertices[1])
+				+ faceHit.w2 * m_pMeshData->GetVertexNormal(triangleVertices[2]);
+		}
+
+		intersection.AddHit(
+			CHitInfo(
+				faceHit.hitTime, *this,
+				ray.GetPointAtTime(faceHit.hitTime),
+				invRay.GetPointAtTime(faceHit.hitTime),
+				GetNormalMatrix() * normalInObjectSpace, normalInObjectSpace));
+	}
+
+	return true;
+}
+
+CBoundingBox QuantizedMesh::GetBounds() const
+{
+	return m_pMeshData->GetBounds().GetTransformed(GetTransform());
+}
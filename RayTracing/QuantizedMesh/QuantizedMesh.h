@@ -0,0 +1,23 @@
+﻿#pragma once
+#include "../GeometryObject/GeometryObjectImpl.h"
+#include "QuantizedMeshData.h"
+
+/*
+	Сетка из треугольников со сжатыми данными (см. QuantizedMeshData).
+	Параметры треугольников не хранятся, а вычисляются по распакованным вершинам при проверке пересечения
+*/
+class QuantizedMesh : public CGeometryObjectImpl
+{
+public:
+	QuantizedMesh(QuantizedMeshData const* pMeshData, CMatrix4d const& transform = CMatrix4d());
+
+	// Поиск пересечения луча с полигональной сеткой
+	bool Hit(CRay const& ray, CIntersection& intersection) const override;
+
+	// Ограничивающий параллелепипед сетки в мировой системе координат
+	CBoundingBox GetBounds() const override;
+
+private:
+	// Адрес данных полигональной сетки
+	QuantizedMeshData const* m_pMeshData;
+};
@@ -0,0 +1,139 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "QuantizedMeshData.h"
+
+namespace
+{
+// Квантует значение из диапазона [-1; 1] в 16-битное целое со знаком
+std::uint16_t QuantizeSignedUnit(double value)
+{
+	const double clamped = std::clamp(value, -1.0, 1.0);
+	return std::uint16_t(std::int16_t(std::lround(clamped * 32767.0)));
+}
+
+double DequantizeSignedUnit(std::uint16_t value)
+{
+	return std::max(double(std::int16_t(value)) / 32767.0, -1.0);
+}
+
+double SignNotZero(double value)
+{
+	return (value >= 0) ? 1.0 : -1.0;
+}
+} // namespace
+
+QuantizedMeshData::QuantizedMeshData(std::vector<Vertex> const& vertices, std::vector<Face> const& faces, PositionPrecision precision)
+	: m_precision(precision)
+{
+	const size_t numVertices = vertices.size();
+	for (Vertex const& vertex : vertices)
+	{
+		m_bounds.Extend(vertex.position);
+	}
+
+	// Шаг квантования по каждой оси. Сетка, плоская вдоль оси, хранит по ней нулевые значения
+	const std::uint32_t maxQuantizedValue = (1u << unsigned(precision)) - 1;
+	m_positionOffset = m_bounds.IsEmpty() ? CVector3d() : m_bounds.GetMin();
+	const CVector3d size = m_bounds.IsEmpty() ? CVector3d() : m_bounds.GetMax() - m_bounds.GetMin();
+	m_positionScale = size / double(maxQuantizedValue);
+	const CVector3d invScale(
+		(size.x > 0) ? maxQuantizedValue / size.x : 0.0,
+		(size.y > 0) ? maxQuantizedValue / size.y : 0.0,
+		(size.z > 0) ? maxQuantizedValue / size.z : 0.0);
+
+	if (precision == PositionPrecision::Bits16)
+	{
+		m_positions16.reserve(numVertices * 3);
+	}
+	else
+	{
+		m_positions21.reserve(numVertices);
+	}
+	m_normals.reserve(numVertices);
+
+	for (Vertex const& vertex : vertices)
+	{
+		const CVector3d relative = vertex.position - m_positionOffset;
+		const std::uint32_t qx = std::min(std::uint32_t(std::lround(relative.x * invScale.x)), maxQuantizedValue);
+		const std::uint32_t qy = std::min(std::uint32_t(std::lround(relative.y * invScale.y)), maxQuantizedValue);
+		const std::uint32_t qz = std::min(std::uint32_t(std::lround(relative.z * invScale.z)), maxQuantizedValue);
+		if (precision == PositionPrecision::Bits16)
+		{
+			m_positions16.push_back(std::uint16_t(qx));
+			m_positions16.push_back(std::uint16_t(qy));
+			m_positions16.push_back(std::uint16_t(qz));
+		}
+		else
+		{
+			m_positions21.push_back(std::uint64_t(qx) | (std::uint64_t(qy) << 21) | (std::uint64_t(qz) << 42));
+		}
+
+		m_normals.push_back(EncodeNormal(vertex.normal));
+	}
+
+	// Ограничивающий параллелепипед распакованных вершин (может немного отличаться от исходного)
+	m_bounds = CBoundingBox();
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		m_bounds.Extend(GetVertexPosition(i));
+	}
+
+	m_indices.reserve(faces.size() * 3);
+	m_flatFlags.reserve(faces.size());
+	for (Face const& face : faces)
+	{
+		if (face.vertex0 >= numVertices || face.vertex1 >= numVertices || face.vertex2 >= numVertices)
+		{
+			throw std::runtime_error("Face refers to a missing vertex");
+		}
+		m_indices.push_back(face.vertex0);
+		m_indices.push_back(face.vertex1);
+		m_indices.push_back(face.vertex2);
+		m_flatFlags.push_back(face.isFlat ? 1 : 0);
+	}
+}
+
+/*
+	Нормаль проецируется на октаэдр |x| + |y| + |z| = 1, нижняя половина которого отражается
+	на верхнюю, после чего координаты x и y квантуются
+*/
+std::uint32_t QuantizedMeshData::EncodeNormal(CVector3d const& normal)
+{
+	const double sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (sum == 0)
+	{
+		// Нулевая нормаль (у вершин, используемых только плоскими гранями)
+		return 0x80008000u;
+	}
+
+	double x = normal.x / sum;
+	double y = normal.y / sum;
+	if (normal.z < 0)
+	{
+		const double reflectedX = (1 - std::abs(y)) * SignNotZero(x);
+		const double reflectedY = (1 - std::abs(x)) * SignNotZero(y);
+		x = reflectedX;
+		y = reflectedY;
+	}
+	return std::uint32_t(QuantizeSignedUnit(x)) | (std::uint32_t(QuantizeSignedUnit(y)) << 16);
+}
+
+CVector3d QuantizedMeshData::DecodeNormal(std::uint32_t encodedNormal)
+{
+	if (encodedNormal == 0x80008000u)
+	{
+		return CVector3d();
+	}
+
+	double x = DequantizeSignedUnit(std::uint16_t(encodedNormal & 0xffff));
+	double y = DequantizeSignedUnit(std::uint16_t(encodedNormal >> 16));
+	const double z = 1 - std::abs(x) - std::abs(y);
+	if (z < 0)
+	{
+		const double t = -z;
+		x += (x >= 0) ? -t : t;
+		y += (y >= 0) ? -t : t;
+	}
+	return Normalize(CVector3d(x, y, z));
+}
@@ -0,0 +1,117 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include "../BoundingBox/BoundingBox.h"
+#include "../TriangleMesh/TriangleMesh.h"
+
+// Количество бит на каждую координату вершины в квантованной сетке
+enum class PositionPrecision
+{
+	// 16 бит на координату (6 байт на вершину)
+	Bits16 = 16,
+	// 21 бит на координату (3 координаты упакованы в 8 байт)
+	Bits21 = 21,
+};
+
+/*
+	Сжатое представление данных полигональной сетки для сеток из десятков миллионов вершин.
+
+	Координаты вершин квантуются относительно ограничивающего параллелепипеда сетки (16 или 21 бит
+	на координату), нормали вершин кодируются октаэдрическим отображением в 32 бита (по 16 бит на две
+	координаты). Вместо объектов CTriangle с вычисленными параметрами хранятся только индексы вершин
+	треугольников: вершины распаковываются при каждой проверке пересечения и вычислении нормали.
+	Общие для соседних треугольников вершины распаковываются одинаково, поэтому сетка остается без щелей
+*/
+class QuantizedMeshData
+{
+public:
+	QuantizedMeshData(
+		std::vector<Vertex> const& vertices, // Вершины
+		std::vector<Face> const& faces, // Грани
+		PositionPrecision precision = PositionPrecision::Bits16 // Точность хранения координат
+	);
+
+	QuantizedMeshData(QuantizedMeshData const&) = delete;
+	QuantizedMeshData& operator=(QuantizedMeshData const&) = delete;
+
+	size_t GetVertexCount() const { return m_normals.size(); }
+
+	size_t GetTriangleCount() const { return m_flatFlags.size(); }
+
+	PositionPrecision GetPrecision() const { return m_precision; }
+
+	// Распакованные координаты вершины
+	CVector3d GetVertexPosition(size_t vertexIndex) const
+	{
+		std::uint32_t qx, qy, qz;
+		if (m_precision == PositionPrecision::Bits16)
+		{
+			const std::uint16_t* p = &m_positions16[vertexIndex * 3];
+			qx = p[0];
+			qy = p[1];
+			qz = p[2];
+		}
+		else
+		{
+			const std::uint64_t packed = m_positions21[vertexIndex];
+			qx = std::uint32_t(packed & COMPONENT_MASK_21);
+			qy = std::uint32_t((packed >> 21) & COMPONENT_MASK_21);
+			qz = std::uint32_t((packed >> 42) & COMPONENT_MASK_21);
+		}
+		return CVector3d(
+			m_positionOffset.x + qx * m_positionScale.x,
+			m_positionOffset.y + qy * m_positionScale.y,
+			m_positionOffset.z + qz * m_positionScale.z);
+	}
+
+	// Распакованная нормаль вершины (единичной длины либо нулевая)
+	CVector3d GetVertexNormal(size_t vertexIndex) const
+	{
+		return DecodeNormal(m_normals[vertexIndex]);
+	}
+
+	// Индексы вершин треугольника
+	std::uint32_t const* GetTriangleVertices(size_t triangleIndex) const
+	{
+		return &m_indices[triangleIndex * 3];
+	}
+
+	// Использует ли треугольник плоское освещение
+	bool IsTriangleFlatShaded(size_t triangleIndex) const
+	{
+		return m_flatFlags[triangleIndex] != 0;
+	}
+
+	// Ограничивающий параллелепипед вершин сетки (в системе координат сетки)
+	CBoundingBox const& GetBounds() const { return m_bounds; }
+
+	// Объем памяти, занимаемой данными сетки, в байтах
+	size_t GetMemoryUsage() const
+	{
+		return sizeof(*this) + m_positions16.capacity() * sizeof(std::uint16_t) + m_positions21.capacity() * sizeof(std::uint64_t)
+			+ m_normals.capacity() * sizeof(std::uint32_t) + m_indices.capacity() * sizeof(std::uint32_t) + m_flatFlags.capacity();
+	}
+
+	// Октаэдрическое кодирование и декодирование вектора нормали (по 16 бит на координату)
+	static std::uint32_t EncodeNormal(CVector3d const& normal);
+	static CVector3d DecodeNormal(std::uint32_t encodedNormal);
+
+private:
+	static constexpr std::uint64_t COMPONENT_MASK_21 = (std::uint64_t(1) << 21) - 1;
+
+	PositionPrecision m_precision;
+	// Распакованная координата = m_positionOffset + квантованная координата * m_positionScale
+	CVector3d m_positionOffset;
+	CVector3d m_positionScale;
+
+	// Квантованные координаты: по 3 значения на вершину (16 бит) либо упакованные в одно 64-битное значение (21 бит)
+	std::vector<std::uint16_t> m_positions16;
+	std::vector<std::uint64_t> m_positions21;
+	// Нормали вершин
+	std::vector<std::uint32_t> m_normals;
+	// Индексы вершин треугольников (по 3 на треугольник)
+	std::vector<std::uint32_t> m_indices;
+	// Признаки плоских граней (1 - плоская)
+	std::vector<std::uint8_t> m_flatFlags;
+	CBoundingBox m_bounds;
+};
@@ -1,6 +1,12 @@
 ﻿#include "RenderContext.h"
+#include <cmath>
+#include <vector>
+#include "../AccumulationBuffer/AccumulationBuffer.h"
+#include "../BoundingBox/BoundingBox.h"
 #include "../Intersection/Intersection.h"
+#include "../PathTracer/PathTracer.h"
 #include "../Ray/Ray.h"
+#include "../Sampler/ISampler.h"
 #include "../Scene/Scene.h"
 #include "../Vector/Vector2.h"
 #include "../Vector/VectorMath.h"
@@ -18,19 +24,84 @@ std::uint32_t CRenderContext::CalculatePixelColor(CScene const& scene, int x, in
 		return 0x000000;
 	}
 
-	// Вычисляем координаты центра пикселя в нормализованных координатах видового порта
-	CVector2d pixelCenter = GetNormalizedViewportCoord(x + 0.5, y + 0.5);
+	// Трассируем луч вглубь сцены, получая цвет объекта, с которым произошло столкновеине
+	return ToPixelColor(scene.Shade(GetPixelRay(x, y)));
+}
+
+void CRenderContext::CalculatePixelColors(CScene const& scene, int y, int left, int right, std::uint32_t* pixels) const
+{
+	std::vector<CRay> rays;
+	std::vector<int> rayPixels;
+	rays.reserve(size_t(Max(right - left, 0)));
+	for (int x = left; x < right; ++x)
+	{
+		if (m_viewPort.TestPoint(x, y))
+		{
+			rays.push_back(GetPixelRay(x, y));
+			rayPixels.push_back(x);
+		}
+		else
+		{
+			// Точка за пределами видового порта
+			pixels[x] = 0x000000;
+		}
+	}
 
-	// Вычисляем начальную и конечную точки луча, проходящего через центр данного пикселя
-	CVector3d rayStart = UnProject(pixelCenter.x, pixelCenter.y, 0);
-	CVector3d rayEnd = UnProject(pixelCenter.x, pixelCenter.y, 1);
+	std::vector<CVector4f> colors(rays.size());
+	scene.Shade(rays.data(), rays.size(), colors.data());
+
+	for (size_t i = 0; i < rays.size(); ++i)
+	{
+		pixels[rayPixels[i]] = ToPixelColor(colors[i]);
+	}
+}
+
+void CRenderContext::AccumulatePathSamples(CScene const& scene, int y, int left, int right,
+	AccumulationBuffer& accumulationBuffer, std::uint32_t* pixels) const
+{
+	const ISamplerPtr sampler = CreateSampler(scene.GetSamplerType());
+	for (int x = left; x < right; ++x)
+	{
+		if (!m_viewPort.TestPoint(x, y))
+		{
+			// Точка за пределами видового порта
+			if (pixels != nullptr)
+			{
+				pixels[x] = 0x000000;
+			}
+			continue;
+		}
+
+		const unsigned sampleIndex = accumulationBuffer.GetSampleCount(unsigned(x), unsigned(y));
+		sampler->StartPixelSample(unsigned(x), unsigned(y), sampleIndex);
+		// Первые два измерения выборки - точка внутри пикселя
+		const CVector2d offset = sampler->Get2D();
+		PixelFeatures features;
+		const CVector4f color = PathTracer::TracePath(scene, GetPixelRay(x, y, offset.x, offset.y), *sampler, &features);
+
+		accumulationBuffer.AddSample(unsigned(x), unsigned(y), color, features);
+		if (pixels != nullptr)
+		{
+			pixels[x] = ToPixelColor(accumulationBuffer.GetAverage(unsigned(x), unsigned(y)));
+		}
+	}
+}
+
+CRay CRenderContext::GetPixelRay(int x, int y, double offsetX, double offsetY) const
+{
+	// Вычисляем координаты точки пикселя в нормализованных координатах видового порта
+	CVector2d pixelPoint = GetNormalizedViewportCoord(x + offsetX, y + offsetY);
+
+	// Вычисляем начальную и конечную точки луча, проходящего через данную точку пикселя
+	CVector3d rayStart = UnProject(pixelPoint.x, pixelPoint.y, 0);
+	CVector3d rayEnd = UnProject(pixelPoint.x, pixelPoint.y, 1);
 
 	// Направление трассируемого луча
-	CVector3d rayDirection = rayEnd - rayStart;
-	
-	// Трассируем луч вглубь сцены, получая цвет объекта, с которым произошло столкновеине
-	CVector4f color = scene.Shade(CRay(rayStart, rayDirection));
-	
+	return CRay(rayStart, rayEnd - rayStart);
+}
+
+std::uint32_t CRenderContext::ToPixelColor(CVector4f const& color)
+{
 	// Приводим компоненты цвета к диапазону 0 до 1
 	CVector4f clampedColor = Clamp(color, 0.0f, 1.0f);
 
@@ -62,7 +133,8 @@ void CRenderContext::SetProjectionMatrix(CMatrix4d const& projectionMatrix)
 
 void CRenderContext::UpdateInverseModelViewProjectionMatrix()
 {
-	m_inverseModelViewProjectionMatrix = (m_projectionMatrix * m_modelViewMatrix).GetInverseMatrix();
+	m_modelViewProjectionMatrix = m_projectionMatrix * m_modelViewMatrix;
+	m_inverseModelViewProjectionMatrix = m_modelViewProjectionMatrix.GetInverseMatrix();
 }
 
 /*
@@ -85,6 +157,161 @@ CMatrix4d CRenderContext::GetProjectionMatrix() const
 	return m_projectionMatrix;
 }
 
+CViewPort const& CRenderContext::GetViewPort() const
+{
+	return m_viewPort;
+}
+
+bool CRenderContext::ProjectBounds(CBoundingBox const& bounds, CScreenRect& rect) const
+{
+	if (bounds.IsEmpty())
+	{
+		rect = CScreenRect();
+		return true;
+	}
+	if (bounds.IsInfinite())
+	{
+		return false;
+	}
+
+	CVector4d corners[8];
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		corners[i] = CVector4d(bounds.GetCorner(i), 1);
+	}
+	return ProjectHomogeneousPoints(corners, 8, rect);
+}
+
+bool CRenderContext::GetProjectedSize(CBoundingBox const& bounds, double& width, double& height) const
+{
+	if (bounds.IsEmpty())
+	{
+		width = height = 0;
+		return true;
+	}
+	if (bounds.IsInfinite())
+	{
+		return false;
+	}
+
+	double minX = INFINITY, minY = INFINITY;
+	double maxX = -INFINITY, maxY = -INFINITY;
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		CVector4d clip = m_modelViewProjectionMatrix * CVector4d(bounds.GetCorner(i), 1);
+		if (clip.w <= 0)
+		{
+			return false;
+		}
+
+		double invW = 1.0 / clip.w;
+		minX = Min(minX, clip.x * invW);
+		maxX = Max(maxX, clip.x * invW);
+		minY = Min(minY, clip.y * invW);
+		maxY = Max(maxY, clip.y * invW);
+	}
+
+	// Нормализованные координаты видового порта лежат в диапазоне [-1; +1]
+	width = (maxX - minX) * m_viewPort.GetWidth() * 0.5;
+	height = (maxY - minY) * m_viewPort.GetHeight() * 0.5;
+	return true;
+}
+
+bool CRenderContext::ProjectShadowVolume(CBoundingBox const& bounds, CBoundingBox const& lightBounds, CScreenRect& rect) const
+{
+	if (bounds.IsEmpty())
+	{
+		rect = CScreenRect();
+		return true;
+	}
+	if (bounds.IsInfinite() || lightBounds.IsEmpty() || lightBounds.IsInfinite())
+	{
+		return false;
+	}
+
+	// Если источник света пересекается с параллелепипедом, тень может падать в любом направлении
+	if (bounds.Intersects(lightBounds))
+	{
+		return false;
+	}
+
+	/*
+		Любая точка тени представима в виде выпуклой комбинации вершин параллелепипеда
+		и неотрицательной комбинации направлений от точки источника света на вершины. Направление от любой
+		точки lightBounds - выпуклая комбинация направлений от вершин lightBounds, поэтому достаточно их.
+		Если все эти точки (включая бесконечно удаленные) находятся перед наблюдателем,
+		проекция тени лежит внутри выпуклой оболочки их проекций
+	*/
+	const CVector3d lightExtent = lightBounds.GetMax() - lightBounds.GetMin();
+	const bool pointLight = (lightExtent.x == 0 && lightExtent.y == 0 && lightExtent.z == 0);
+	const unsigned lightCornerCount = pointLight ? 1 : 8;
+
+	CVector4d points[8 + 8 * 8];
+	size_t count = 0;
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		const CVector3d corner = bounds.GetCorner(i);
+		points[count++] = CVector4d(corner, 1);
+		for (unsigned j = 0; j < lightCornerCount; ++j)
+		{
+			points[count++] = CVector4d(corner - lightBounds.GetCorner(j), 0);
+		}
+	}
+	return ProjectHomogeneousPoints(points, count, rect);
+}
+
+bool CRenderContext::ProjectHomogeneousPoints(CVector4d const* points, size_t count, CScreenRect& rect) const
+{
+	double minX = INFINITY, minY = INFINITY;
+	double maxX = -INFINITY, maxY = -INFINITY;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		CVector4d clip = m_modelViewProjectionMatrix * points[i];
+
+		// Точка позади наблюдателя (или в его плоскости) проецируется неограниченно
+		if (clip.w <= 0)
+		{
+			return false;
+		}
+
+		double invW = 1.0 / clip.w;
+		minX = Min(minX, clip.x * invW);
+		maxX = Max(maxX, clip.x * invW);
+		minY = Min(minY, clip.y * invW);
+		maxY = Max(maxY, clip.y * invW);
+	}
+
+	// Переводим нормализованные координаты в пиксели (преобразование, обратное GetNormalizedViewportCoord)
+	double viewportCenterX = (m_viewPort.GetLeft() + m_viewPort.GetRight()) * 0.5;
+	double viewportCenterY = (m_viewPort.GetTop() + m_viewPort.GetBottom()) * 0.5;
+	double halfWidth = m_viewPort.GetWidth() * 0.5;
+	double halfHeight = m_viewPort.GetHeight() * 0.5;
+
+	// Ось Y видового порта направлена вниз, поэтому maxY соответствует верхней границе.
+	// Расширяем область на пиксель с каждой стороны, чтобы учесть округление
+	double left = floor(viewportCenterX + minX * halfWidth) - 1;
+	double right = ceil(viewportCenterX + maxX * halfWidth) + 1;
+	double top = floor(viewportCenterY - maxY * halfHeight) - 1;
+	double bottom = ceil(viewportCenterY - minY * halfHeight) + 1;
+
+	// Ограничиваем область видовым портом
+	left = Max(left, double(m_viewPort.GetLeft()));
+	top = Max(top, double(m_viewPort.GetTop()));
+	right = Min(right, double(m_viewPort.GetRight()));
+	bottom = Min(bottom, double(m_viewPort.GetBottom()));
+
+	if (left >= right || top >= bottom)
+	{
+		rect = CScreenRect();
+	}
+	else
+	{
+		rect = CScreenRect(unsigned(left), unsigned(top), unsigned(right), unsigned(bottom));
+	}
+	return true;
+}
+
 /*
 	Вычисление нормализованных координат внутри видового порта
 */
@@ -1,8 +1,12 @@
 ﻿#pragma once
 #include "../Matrix/Matrix4.h"
 #include "../ViewPort/ViewPort.h"
+#include "../ScreenRect/ScreenRect.h"
 
+class AccumulationBuffer;
+class CRay;
 class CScene;
+class CBoundingBox;
 
 /*
 	Класс CRenderContext - контекст визуализации
@@ -22,6 +26,27 @@ public:
 	*/
 	std::uint32_t CalculatePixelColor(CScene const& scene, int x, int y) const;
 
+	/*
+		Вычисляет цвета пикселей [left; right) строки y, записывая их в pixels[left]..pixels[right - 1].
+		Лучи пикселей трассируются вместе, а точки их столкновения с объектами закрашиваются
+		пакетами по шейдерам (см. CScene::Shade)
+	*/
+	void CalculatePixelColors(CScene const& scene, int y, int left, int right, std::uint32_t* pixels) const;
+
+	/*
+		Добавляет к пикселям [left; right) строки y буфера накопления по одной выборке, трассируя путь
+		через точку пикселя, заданную генератором выборок сцены (см. PathTracer, CScene::GetSamplerType),
+		и записывает в pixels[left]..pixels[right - 1] средние значения накопленных выборок
+		(при pixels == nullptr выборки только накапливаются).
+		Выборка определяется координатами пикселя и ее номером, поэтому результат не зависит
+		от распределения пикселей между потоками
+	*/
+	void AccumulatePathSamples(CScene const& scene, int y, int left, int right,
+		AccumulationBuffer& accumulationBuffer, std::uint32_t* pixels) const;
+
+	// Приводит компоненты цвета к диапазону от 0 до 1 и возвращает цвет в формате 0xAARRGGBB
+	static std::uint32_t ToPixelColor(CVector4f const& color);
+
 	/*
 		Задает параметры видового порта
 	*/
@@ -40,7 +65,36 @@ public:
 	CMatrix4d GetModelViewMatrix() const;
 	CMatrix4d GetProjectionMatrix() const;
 
+	CViewPort const& GetViewPort() const;
+
+	/*
+		Вычисляет область видового порта, на которую проецируется ограничивающий параллелепипед.
+		Возвращает false, если область невозможно ограничить (параллелепипед бесконечен,
+		либо частично находится позади наблюдателя). Пустой параллелепипед дает пустую область
+	*/
+	bool ProjectBounds(CBoundingBox const& bounds, CScreenRect& rect) const;
+
+	/*
+		Вычисляет область видового порта, на которую проецируется тень (вместе с полутенью), отбрасываемая
+		ограничивающим параллелепипедом при освещении источником света, светящаяся поверхность которого
+		лежит внутри параллелепипеда lightBounds (для точечного источника - вырожденного в точку).
+		Тень от каждой точки источника - бесконечная пирамида за параллелепипедом, поэтому вместе с вершинами
+		параллелепипеда проецируются и бесконечно удаленные точки на лучах от вершин lightBounds через его вершины.
+		Возвращает false, если область невозможно ограничить
+	*/
+	bool ProjectShadowVolume(CBoundingBox const& bounds, CBoundingBox const& lightBounds, CScreenRect& rect) const;
+
+	/*
+		Вычисляет ширину и высоту (в пикселях) проекции ограничивающего параллелепипеда. В отличие от ProjectBounds
+		проекция не ограничивается видовым портом: объекты за пределами кадра видны в отражениях и отбрасывают тени.
+		Возвращает false, если параллелепипед бесконечен, либо частично находится позади наблюдателя
+	*/
+	bool GetProjectedSize(CBoundingBox const& bounds, double& width, double& height) const;
+
 private:
+	// Луч, проходящий через точку пикселя с заданными координатами (смещение от левого верхнего угла пикселя)
+	CRay GetPixelRay(int x, int y, double offsetX = 0.5, double offsetY = 0.5) const;
+
 	/*
 		Преобразовывает экранные координаты пикселя в нормализованные экранные координаты
 		В нормализованных координатах верхний левый угол видового порта имеет координаты (-1, +1), 
@@ -66,12 +120,22 @@ private:
 	*/
 	void UpdateInverseModelViewProjectionMatrix();
 
+	/*
+		Вычисляет область видового порта, охватывающую проекции заданных однородных точек.
+		Точки с w = 0 задают бесконечно удаленные точки в заданном направлении.
+		Возвращает false, если хотя бы одна из точек не находится перед наблюдателем
+	*/
+	bool ProjectHomogeneousPoints(CVector4d const* points, size_t count, CScreenRect& rect) const;
+
 private:
 	// Матрица проецирования
 	CMatrix4d m_projectionMatrix;
 	// Матрица моделирования-вида
 	CMatrix4d m_modelViewMatrix;
 
+	// Произведение матриц проецирования и моделирования-вида
+	CMatrix4d m_modelViewProjectionMatrix;
+
 	// Матрица обратная произведению матриц проецирования и моделирования-вида
 	CMatrix4d m_inverseModelViewProjectionMatrix;
 
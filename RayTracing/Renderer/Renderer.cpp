@@ -1,5 +1,5 @@
-﻿#include <boost/interprocess/ipc/message_queue.hpp>
-#include "Renderer.h"
+﻿#include "Renderer.h"
+#include <cassert>
 #include "../RenderContext/RenderContext.h"
 #include "../Scene/Scene.h"
 
@@ -38,73 +38,111 @@ bool Renderer::SetStopping(bool stopping)
 
 bool Renderer::GetProgress(unsigned& renderedChunks, unsigned& totalChunks) const
 {
-	// Захватываем мьютекс на время работы данного метода
-	std::lock_guard lock(m_mutex);
-
-	// Получаем потокобезопасным образом значения переменных
-	// m_renderedChunks и m_totalChunks
-	renderedChunks = m_renderedChunks;
+	// Счетчики считываются без блокировки. Общее количество блоков считываем первым:
+	// при запуске нового кадра оно обнуляется раньше количества обработанных блоков,
+	// поэтому незавершенный кадр не может быть ошибочно принят за завершенный
 	totalChunks = m_totalChunks;
+	renderedChunks = m_renderedChunks;
 
 	// Сообщаем, все ли блоки изображения были обработаны
 	return (totalChunks > 0) && (renderedChunks == totalChunks);
 }
 
+void Renderer::SetProgressCallback(TileCompletionTracker::ProgressCallback callback)
+{
+	m_completedTiles.SetProgressCallback(std::move(callback));
+}
+
+bool Renderer::TakeChangedRegions(std::vector<CScreenRect>& regions)
+{
+	return m_completedTiles.TakeChangedRegions(regions);
+}
+
 /*
 Выполняет основную работу по построению изображения в буфере кадра
 */
 void Renderer::RenderFrame(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer)
 {
-	// Запоминаем ширину и высоту буфера кадра, чтобы каждый раз не вызывать
-	// методы класса CFrameBuffer
-	const int width = frameBuffer.GetWidth();
-	const int height = frameBuffer.GetHeight();
+	const unsigned width = frameBuffer.GetWidth();
+	const unsigned height = frameBuffer.GetHeight();
+
+	if (m_pAccumulationBuffer != nullptr)
+	{
+		// Каждый проход прогрессивной трассировки путей добавляет к пикселям всех блоков по одной выборке
+		AccumulationBuffer& accumulationBuffer = *m_pAccumulationBuffer;
+		for (unsigned pass = 0; !IsStopping() && (m_maxPasses == 0 || pass < m_maxPasses); ++pass)
+		{
+			m_renderedChunks = 0;
+			const bool finalPass = (m_maxPasses != 0 && pass + 1 == m_maxPasses);
+
+			/*
+				При подавлении шума буфер кадра заполняется фильтром по окончании прохода, а блоки прохода
+				буфер кадра не изменяют, поэтому на экран не переносятся
+			*/
+			FrameBuffer* pFrameBuffer = m_denoising ? nullptr : &frameBuffer;
+			RenderTiles(width, height, [&](CScreenRect const& tile) {
+				AccumulateTile(scene, context, accumulationBuffer, pFrameBuffer, tile);
+			}, pFrameBuffer != nullptr, finalPass);
+
+			if (m_denoising && !IsStopping() && (m_maxPasses == 0 || finalPass))
+			{
+				m_denoiser.Denoise(accumulationBuffer, frameBuffer);
 
+				// Фильтр изменил все пиксели, поэтому на экран переносятся все блоки
+				const unsigned tileCount = unsigned(m_tiles.size());
+				for (unsigned tileIndex = 0; tileIndex < tileCount; ++tileIndex)
+				{
+					m_completedTiles.MarkTileCompleted(m_tiles[tileIndex], finalPass && tileIndex + 1 == tileCount);
+				}
+			}
+		}
+	}
+	else
+	{
+		RenderTiles(width, height, [&](CScreenRect const& tile) {
+			RenderTile(scene, context, frameBuffer, tile);
+		}, true, true);
+	}
+
+	// Сбрасываем флаг остановки
+	SetStopping(false);
+	// Сообщаем об окончании построения изображения
+	SetRendering(false);
+}
+
+template <class RenderTileFunction>
+void Renderer::RenderTiles(unsigned width, unsigned height, RenderTileFunction const& renderTile, bool markTiles, bool finalPass)
+{
 	/*
 	Задаем общее количество блоков изображения
-	Под блоком изображения здесь понимается 1 строка буфера кадра
+	Под блоком изображения здесь понимается квадратная область буфера кадра размером TILE_SIZE x TILE_SIZE
 	*/
-	m_totalChunks = height;
+	const int tileCount = int(m_tiles.size());
+	m_totalChunks = tileCount;
 
-	// Пробегаем все строки буфера кадра
-	// При включенной поддержке OpenMP итерации цикла по строкам изображения
+	// Пробегаем все блоки изображения
+	// При включенной поддержке OpenMP итерации цикла по блокам изображения
 	// будут выполняться в параллельных потоках
 #ifdef _OPENMP
 #pragma omp parallel for schedule(dynamic)
 #endif
-	for (int y = 0; y < height; ++y)
+	for (int tileIndex = 0; tileIndex < tileCount; ++tileIndex)
 	{
-		std::uint32_t* rowPixels = nullptr;
-
-		// Синхронизируем доступ к frameBuffer из вспомогательных потоков
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-		{
-			// Получаем адрес начала y-й строки в буфере кадра
-			rowPixels = frameBuffer.GetPixels(y);
-		}
-
-		// Цикл по строкам выполняется только, если поступил запрос от пользователя
+		// Цикл по блокам выполняется только, если поступил запрос от пользователя
 		// об остановке построения изображения
 		// Инструкцию break для выхода из цикла здесь использовать нельзя (ограничение OpenMP)
 		if (!IsStopping())
 		{
-			// Пробегаем все пиксели в строке
-			for (int x = 0; x < width; ++x)
+			const unsigned frameTileIndex = m_tiles[size_t(tileIndex)];
+			renderTile(GetTileRect(frameTileIndex, width, height));
+
+			const unsigned renderedChunks = ++m_renderedChunks;
+			if (markTiles)
 			{
-				// Вычисляем цвет текущего пикселя и записываем его в буфер кадра
-				rowPixels[size_t(x)] = context.CalculatePixelColor(scene, x, y);
+				m_completedTiles.MarkTileCompleted(frameTileIndex, finalPass && renderedChunks == unsigned(tileCount));
 			}
-
-			++m_renderedChunks;
 		}
 	}
-
-	// Сбрасываем флаг остановки
-	SetStopping(false);
-	// Сообщаем об окончании построения изображения
-	SetRendering(false);
 }
 
 // Запускает визуализацию сцены в буфере кадра в фоновом потоке
@@ -118,12 +156,155 @@ bool Renderer::Render(CScene const& scene, CRenderContext const& context, FrameB
 		return false;
 	}
 
+	// Строим все блоки изображения. Буфер кадра не очищаем: предыдущее изображение остается на экране,
+	// пока его не заменят блоки нового кадра
+	CollectTiles(frameBuffer.GetWidth(), frameBuffer.GetHeight(), nullptr);
+	m_pAccumulationBuffer = nullptr;
+
+	return StartRendering(scene, context, frameBuffer);
+}
+
+// Запускает прогрессивную трассировку путей в фоновом потоке
+bool Renderer::RenderProgressive(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer,
+	AccumulationBuffer& accumulationBuffer, unsigned maxPasses)
+{
+	assert(accumulationBuffer.GetWidth() == frameBuffer.GetWidth());
+	assert(accumulationBuffer.GetHeight() == frameBuffer.GetHeight());
+
+	// Пытаемся перейти в режим рендеринга
+	if (!SetRendering(true))
+	{
+		// В данный момент еще идет построение изображения в параллельном потоке
+		return false;
+	}
+
+	// Каждый проход обрабатывает все блоки изображения
+	CollectTiles(frameBuffer.GetWidth(), frameBuffer.GetHeight(), nullptr);
+	m_pAccumulationBuffer = &accumulationBuffer;
+	m_maxPasses = maxPasses;
+
+	return StartRendering(scene, context, frameBuffer);
+}
+
+// Запускает повторную визуализацию блоков изображения, пересекающихся с заданными областями
+bool Renderer::RenderRegions(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer,
+	std::vector<CScreenRect> const& regions)
+{
+	// Пытаемся перейти в режим рендеринга
+	if (!SetRendering(true))
+	{
+		// В данный момент еще идет построение изображения в параллельном потоке
+		return false;
+	}
+
+	CollectTiles(frameBuffer.GetWidth(), frameBuffer.GetHeight(), &regions);
+	m_pAccumulationBuffer = nullptr;
+	if (m_tiles.empty())
+	{
+		// Изменения не затрагивают ни одного блока изображения
+		SetRendering(false);
+		return false;
+	}
+
+	// Содержимое буфера кадра вне заданных областей остается актуальным
+	return StartRendering(scene, context, frameBuffer);
+}
+
+void Renderer::CollectTiles(unsigned width, unsigned height, std::vector<CScreenRect> const* pRegions)
+{
+	m_tiles.clear();
+
+	const unsigned tileCount = GetTileCount(width, height);
+	for (unsigned tileIndex = 0; tileIndex < tileCount; ++tileIndex)
+	{
+		CScreenRect tile = GetTileRect(tileIndex, width, height);
+
+		bool tileIsNeeded = (pRegions == nullptr);
+		for (size_t i = 0; !tileIsNeeded && i < pRegions->size(); ++i)
+		{
+			tileIsNeeded = tile.Intersects((*pRegions)[i]);
+		}
+
+		if (tileIsNeeded)
+		{
+			m_tiles.push_back(tileIndex);
+		}
+	}
+}
+
+unsigned Renderer::GetTileCount(unsigned width, unsigned height)
+{
+	const unsigned columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const unsigned rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+	return columns * rows;
+}
+
+CScreenRect Renderer::GetTileRect(unsigned tileIndex, unsigned width, unsigned height)
+{
+	const unsigned columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const unsigned left = (tileIndex % columns) * TILE_SIZE;
+	const unsigned top = (tileIndex / columns) * TILE_SIZE;
+	return CScreenRect(left, top, std::min(left + TILE_SIZE, width), std::min(top + TILE_SIZE, height));
+}
+
+void Renderer::RenderTile(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer, CScreenRect const& tile,
+	std::atomic<std::uint64_t>* pRenderedRows)
+{
+	// Пробегаем все строки блока
+	// Внутри параллельного цикла по блокам (RenderFrame) вложенный цикл выполняется последовательно,
+	// а процессы-исполнители, строящие по одному блоку, распределяют строки блока между своими потоками
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int y = int(tile.top); y < int(tile.bottom); ++y)
+	{
+		// Получаем адрес начала y-й строки в буфере кадра
+		std::uint32_t* rowPixels = frameBuffer.GetPixels(unsigned(y));
+
+		// Вычисляем цвета пикселей строки, принадлежащих блоку, и записываем их в буфер кадра.
+		// Точки, попавшие на объекты с одним и тем же шейдером, закрашиваются одним пакетом
+		context.CalculatePixelColors(scene, y, int(tile.left), int(tile.right), rowPixels);
+
+		if (pRenderedRows != nullptr)
+		{
+			++*pRenderedRows;
+		}
+	}
+}
+
+void Renderer::AccumulateTile(CScene const& scene, CRenderContext const& context, AccumulationBuffer& accumulationBuffer,
+	FrameBuffer* pFrameBuffer, CScreenRect const& tile)
+{
+	// Строки блока распределяются между потоками так же, как при построении блока в RenderTile
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int y = int(tile.top); y < int(tile.bottom); ++y)
+	{
+		context.AccumulatePathSamples(scene, y, int(tile.left), int(tile.right), accumulationBuffer,
+			(pFrameBuffer != nullptr) ? pFrameBuffer->GetPixels(unsigned(y)) : nullptr);
+	}
+}
+
+void Renderer::SetDenoising(bool denoising, DenoiserSettings const& settings)
+{
+	assert(!IsRendering());
+	m_denoising = denoising;
+	m_denoiser.SetSettings(settings);
+}
+
+bool Renderer::IsDenoising() const noexcept
+{
+	return m_denoising;
+}
+
+bool Renderer::StartRendering(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer)
+{
 	// Блокируем доступ к общим (для фонового и основного потока) данным класса
-	// вплоть до завершения работа метода Render
+	// вплоть до завершения работа метода StartRendering
 	std::lock_guard lock(m_mutex);
 
-	// Очищаем буфер кадра
-	frameBuffer.Clear();
+	m_completedTiles.SetFrameSize(frameBuffer.GetWidth(), frameBuffer.GetHeight());
 
 	// Сбрасываем количество обработанных и общее количество блоков изображения
 	// сигнализируя о том, что еще ничего не сделано
@@ -170,4 +351,13 @@ void Renderer::Stop()
 		// Сбрасываем флаг остановки, если поток завершил свою работу до вызова SetStopping(true)
 		SetStopping(false);
 	}
+}
+
+void Renderer::Wait()
+{
+	// Дожидаемся окончания работы рабочего потока, если он был запущен
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
 }
\ No newline at end of file
@@ -1,8 +1,13 @@
 ﻿#pragma once
 #include <boost/thread.hpp>
+#include <vector>
+#include "../AccumulationBuffer/AccumulationBuffer.h"
+#include "../Denoiser/Denoiser.h"
 #include "../FrameBuffer/FrameBuffer.h"
 #include "../RenderContext/RenderContext.h"
 #include "../Scene/Scene.h"
+#include "../ScreenRect/ScreenRect.h"
+#include "../TileCompletionTracker/TileCompletionTracker.h"
 
 
 /*
@@ -13,6 +18,9 @@
 class Renderer
 {
 public:
+	// Размер стороны квадратного блока изображения в пикселях
+	static constexpr unsigned TILE_SIZE = 32;
+
 	~Renderer(void);
 
 	// Выполняется ли в данный момент построение изображения в буфере кадра?
@@ -29,12 +37,55 @@ public:
 	bool GetProgress(unsigned& renderedChunks, unsigned& totalChunks) const;
 
 	/*
-		Запускает фоновый поток для визуализации сцены в заданном буфере кадра
+		Устанавливает функцию, вызываемую фоновыми потоками после построения каждого блока изображения.
+		Устанавливать ее следует, пока изображение не строится
+	*/
+	void SetProgressCallback(TileCompletionTracker::ProgressCallback callback);
+
+	/*
+		Возвращает области буфера кадра, построенные с момента предыдущего вызова.
+		Возвращает false, если таких областей нет
+	*/
+	bool TakeChangedRegions(std::vector<CScreenRect>& regions);
+
+	/*
+		Запускает фоновый поток для визуализации сцены в заданном буфере кадра.
+		Буфер кадра не очищается: блоки нового изображения постепенно заменяют блоки предыдущего.
 		Возвращает true, если поток был запущен и false, если поток запущен не был,
 		т.к. не завершилась текущая операция по построению изображения в буфере кадра
 	*/
 	bool Render(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer);
 
+	/*
+		Запускает фоновый поток для повторной визуализации только тех блоков изображения,
+		которые пересекаются с заданными областями. Остальное содержимое буфера кадра сохраняется.
+		Возвращает false, если поток запущен не был (в том числе, если области не содержат ни одного блока)
+	*/
+	bool RenderRegions(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer,
+		std::vector<CScreenRect> const& regions);
+
+	/*
+		Запускает фоновый поток прогрессивной трассировки путей (см. PathTracer). Каждый проход добавляет
+		к каждому пикселю буфера накопления по одной выборке, используя все ядра, и записывает в буфер кадра
+		обновленные средние значения, поэтому изображение постепенно становится менее шумным.
+		Проходы продолжаются до остановки, либо до выполнения maxPasses проходов (0 - без ограничения).
+		Буфер накопления не очищается: повторный запуск продолжает накопление, а очищать его следует
+		после изменения сцены или камеры. Размеры буфера накопления и буфера кадра должны совпадать.
+		Прогресс (см. GetProgress) сообщается для текущего прохода, а о завершении кадра функции обратного вызова
+		сообщается только по окончании последнего прохода.
+		При включенном подавлении шума (см. SetDenoising) буфер кадра заполняется фильтром после каждого прохода
+		(при ограниченном количестве проходов - только после последнего)
+	*/
+	bool RenderProgressive(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer,
+		AccumulationBuffer& accumulationBuffer, unsigned maxPasses = 0);
+
+	/*
+		Включает фильтрацию шума изображения, строящегося прогрессивной трассировкой путей.
+		Устанавливать ее следует, пока изображение не строится
+	*/
+	void SetDenoising(bool denoising, DenoiserSettings const& settings = DenoiserSettings());
+	bool IsDenoising() const noexcept;
+
 	/*
 		Выполняет принудительную остановку фонового построения изображения.
 		Данный метод следует вызывать до вызова деструкторов объектов, используемых классом CRenderer,
@@ -42,12 +93,54 @@ public:
 	*/
 	void Stop();
 
+	// Дожидается окончания фонового построения изображения, не прерывая его
+	void Wait();
+
+	// Количество блоков изображения в буфере кадра заданного размера
+	static unsigned GetTileCount(unsigned width, unsigned height);
+
+	// Область блока изображения с заданным индексом (блоки нумеруются построчно)
+	static CScreenRect GetTileRect(unsigned tileIndex, unsigned width, unsigned height);
+
+	/*
+		Вычисляет цвета всех пикселей блока изображения и записывает их в буфер кадра.
+		pRenderedRows - счетчик, увеличиваемый после построения каждой строки блока (для наблюдения за ходом построения)
+	*/
+	static void RenderTile(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer, CScreenRect const& tile,
+		std::atomic<std::uint64_t>* pRenderedRows = nullptr);
+
+	/*
+		Добавляет к пикселям блока изображения по одной выборке трассировки путей и записывает
+		средние значения накопленных выборок в буфер кадра (при pFrameBuffer == nullptr - только накапливает выборки)
+	*/
+	static void AccumulateTile(CScene const& scene, CRenderContext const& context, AccumulationBuffer& accumulationBuffer,
+		FrameBuffer* pFrameBuffer, CScreenRect const& tile);
+
 private:
 	/*
 		Визуализация кадра, выполняемая в фоновом потоке
 	*/
 	void RenderFrame(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer);
 
+	/*
+		Строит блоки списка m_tiles в параллельных потоках, вызывая renderTile(область блока) для каждого из них.
+		markTiles - записывает ли renderTile пиксели в буфер кадра (только такие блоки переносятся на экран),
+		finalPass - завершает ли построение блоков кадр (иначе о завершении кадра не сообщается)
+	*/
+	template <class RenderTileFunction>
+	void RenderTiles(unsigned width, unsigned height, RenderTileFunction const& renderTile, bool markTiles, bool finalPass);
+
+	/*
+		Запускает визуализацию ранее подготовленного списка блоков m_tiles в фоновом потоке
+	*/
+	bool StartRendering(CScene const& scene, CRenderContext const& context, FrameBuffer& frameBuffer);
+
+	/*
+		Заполняет список m_tiles индексами блоков изображения размером TILE_SIZE x TILE_SIZE,
+		пересекающимися хотя бы с одной из заданных областей (при pRegions == nullptr - всеми блоками)
+	*/
+	void CollectTiles(unsigned width, unsigned height, std::vector<CScreenRect> const* pRegions);
+
 	// Устанавливаем потокобезопасным образом флаг о том, что идет построение изображения
 	// Возвращаем true, если значение флага изменилось, и false, если нет
 	bool SetRendering(bool rendering);
@@ -63,8 +156,8 @@ private:
 	// Поток, в котором выполняется построение изображения
 	std::jthread m_thread;
 
-	// Мьютекс для обеспечения доступа к переменным m_totalChunks и m_renderedChunks
-	mutable std::mutex m_mutex;
+	// Мьютекс, упорядочивающий запуск фонового потока
+	std::mutex m_mutex;
 
 	// Идет ли в данный момент построение изображения?
 	std::atomic_bool m_rendering{ false };
@@ -77,4 +170,20 @@ private:
 
 	// Количество обработанных блоков изображения (для вычисления прогресса)
 	std::atomic_uint32_t m_renderedChunks{ 0 };
+
+	// Индексы блоков изображения, которые требуется построить в текущем кадре
+	std::vector<unsigned> m_tiles;
+
+	// Буфер накопления выборок при прогрессивной трассировке путей (nullptr - обычная визуализация кадра)
+	AccumulationBuffer* m_pAccumulationBuffer = nullptr;
+
+	// Количество проходов прогрессивной трассировки путей (0 - без ограничения)
+	unsigned m_maxPasses = 0;
+
+	// Фильтр шума прогрессивной трассировки путей и признак его использования
+	Denoiser m_denoiser;
+	bool m_denoising = false;
+
+	// Построенные блоки, еще не перенесенные на экран
+	TileCompletionTracker m_completedTiles;
 };
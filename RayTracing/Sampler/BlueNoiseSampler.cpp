@@ -0,0 +1,115 @@
+﻿#include "BlueNoiseSampler.h"
+#include <cmath>
+#include "SobolSampler.h"
+
+namespace
+{
+// Среднеквадратичное отклонение гауссова ядра "энергии" точек маски (в пикселях)
+constexpr double MASK_SIGMA = 1.5;
+
+// Сдвиг маски для измерения dimension (по последовательности R2), чтобы маски разных измерений не совпадали
+unsigned GetMaskOffset(std::uint32_t dimension, double alpha, unsigned size) noexcept
+{
+	const double offset = dimension * alpha;
+	return unsigned((offset - floor(offset)) * size);
+}
+} // namespace
+
+void BlueNoiseSampler::StartPixelSample(unsigned x, unsigned y, unsigned sampleIndex)
+{
+	m_x = x;
+	m_y = y;
+	m_sampleIndex = sampleIndex;
+	m_pair = 0;
+}
+
+double BlueNoiseSampler::Get1D()
+{
+	return Get2D().x;
+}
+
+CVector2d BlueNoiseSampler::Get2D()
+{
+	// Перемешивание зависит только от номера пары измерений, поэтому последовательность общая для всех пикселей
+	const std::uint32_t pair = m_pair++;
+	const std::uint32_t seed = SobolSampler::Hash(pair, 0x9E3779B9u);
+	const std::uint32_t index = SobolSampler::ScrambleOwen(m_sampleIndex, seed);
+	const double u = SobolSampler::ToUnitInterval(
+		SobolSampler::ScrambleOwen(SobolSampler::GetSobolValue(index, 0), SobolSampler::Hash(seed, 0)));
+	const double v = SobolSampler::ToUnitInterval(
+		SobolSampler::ScrambleOwen(SobolSampler::GetSobolValue(index, 1), SobolSampler::Hash(seed, 1)));
+
+	// Сдвиг по модулю 1
+	double shiftedU = u + GetMaskValue(2 * pair);
+	double shiftedV = v + GetMaskValue(2 * pair + 1);
+	shiftedU -= (shiftedU >= 1) ? 1 : 0;
+	shiftedV -= (shiftedV >= 1) ? 1 : 0;
+	return CVector2d(shiftedU, shiftedV);
+}
+
+double BlueNoiseSampler::GetMaskValue(std::uint32_t dimension) const noexcept
+{
+	const unsigned x = (m_x + GetMaskOffset(dimension, 0.7548776662466927, MASK_SIZE)) % MASK_SIZE;
+	const unsigned y = (m_y + GetMaskOffset(dimension, 0.5698402909980532, MASK_SIZE)) % MASK_SIZE;
+	return GetMask()[y * MASK_SIZE + x];
+}
+
+std::vector<float> const& BlueNoiseSampler::GetMask()
+{
+	// Маска строится однократно при первом обращении (инициализация статической переменной потокобезопасна)
+	static const std::vector<float> mask = GenerateMask();
+	return mask;
+}
+
+std::vector<float> BlueNoiseSampler::GenerateMask()
+{
+	/*
+		Метод "void-and-cluster" Улишни: пиксели маски по очереди получают ранги, и каждый следующий ранг получает
+		свободный пиксель, наиболее удаленный от уже выбранных ("самая большая пустота") - пиксель с наименьшей
+		суммой гауссовых ядер выбранных пикселей. Расстояния измеряются с учетом повторения маски по изображению
+	*/
+	constexpr unsigned count = MASK_SIZE * MASK_SIZE;
+
+	// Ядро для всех смещений между пикселями маски с учетом ее повторения
+	std::vector<double> kernel(count);
+	for (unsigned dy = 0; dy < MASK_SIZE; ++dy)
+	{
+		for (unsigned dx = 0; dx < MASK_SIZE; ++dx)
+		{
+			const double wrappedX = std::fmin(dx, MASK_SIZE - dx);
+			const double wrappedY = std::fmin(dy, MASK_SIZE - dy);
+			kernel[dy * MASK_SIZE + dx] = exp(-(wrappedX * wrappedX + wrappedY * wrappedY) / (2 * MASK_SIGMA * MASK_SIGMA));
+		}
+	}
+
+	std::vector<double> energy(count, 0.0);
+	std::vector<bool> ranked(count, false);
+	std::vector<float> mask(count);
+	for (unsigned rank = 0; rank < count; ++rank)
+	{
+		unsigned best = count;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			if (!ranked[i] && (best == count || energy[i] < energy[best]))
+			{
+				best = i;
+			}
+		}
+
+		ranked[best] = true;
+		mask[best] = (rank + 0.5f) / count;
+
+		const unsigned bestX = best % MASK_SIZE;
+		const unsigned bestY = best / MASK_SIZE;
+		for (unsigned y = 0; y < MASK_SIZE; ++y)
+		{
+			const unsigned dy = (y + MASK_SIZE - bestY) % MASK_SIZE;
+			for (unsigned x = 0; x < MASK_SIZE; ++x)
+			{
+				const unsigned dx = (x + MASK_SIZE - bestX) % MASK_SIZE;
+				energy[y * MASK_SIZE + x] += kernel[dy * MASK_SIZE + dx];
+			}
+		}
+	}
+	return mask;
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include "ISampler.h"
+
+/*
+	Генератор выборок, распределяющий ошибку Монте-Карло по изображению в виде синего шума.
+	Все пиксели используют одну и ту же перемешанную последовательность Соболя (см. SobolSampler),
+	а каждое измерение сдвигается по модулю 1 на значение маски синего шума в пикселе (сдвиг Кренли-Паттерсона).
+	Соседние пиксели получают далекие друг от друга сдвиги, поэтому при малом количестве выборок шум
+	содержит лишь высокие частоты: он менее заметен глазу и лучше подавляется фильтрацией (см. Denoiser)
+*/
+class BlueNoiseSampler : public ISampler
+{
+public:
+	// Размер стороны маски синего шума, повторяющейся по изображению
+	static constexpr unsigned MASK_SIZE = 64;
+
+	virtual void StartPixelSample(unsigned x, unsigned y, unsigned sampleIndex);
+	virtual double Get1D();
+	virtual CVector2d Get2D();
+
+private:
+	// Маска синего шума: значения из [0; 1) - нормированные ранги пикселей MASK_SIZE x MASK_SIZE
+	static std::vector<float> const& GetMask();
+
+	static std::vector<float> GenerateMask();
+
+	// Значение маски для измерения dimension пикселя текущей выборки
+	double GetMaskValue(std::uint32_t dimension) const noexcept;
+
+	unsigned m_x = 0;
+	unsigned m_y = 0;
+	std::uint32_t m_sampleIndex = 0;
+	// Номер следующей пары измерений
+	std::uint32_t m_pair = 0;
+};
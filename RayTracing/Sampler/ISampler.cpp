@@ -0,0 +1,19 @@
+﻿#include "ISampler.h"
+#include "BlueNoiseSampler.h"
+#include "IndependentSampler.h"
+#include "SobolSampler.h"
+
+ISamplerPtr CreateSampler(SamplerType type)
+{
+	switch (type)
+	{
+	case SamplerType::Sobol:
+		return std::make_unique<SobolSampler>(SobolSampler::Scrambling::RandomDigit);
+	case SamplerType::OwenScrambledSobol:
+		return std::make_unique<SobolSampler>(SobolSampler::Scrambling::Owen);
+	case SamplerType::BlueNoise:
+		return std::make_unique<BlueNoiseSampler>();
+	default:
+		return std::make_unique<IndependentSampler>();
+	}
+}
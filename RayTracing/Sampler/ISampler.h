@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <memory>
+#include "../Vector/Vector2.h"
+
+/*
+	Способ генерации выборок пикселей (см. ISampler)
+*/
+enum class SamplerType
+{
+	// Независимые псевдослучайные числа (см. PointRandom)
+	Independent,
+	// Последовательность Соболя со случайным сдвигом разрядов (XOR) для каждого пикселя
+	Sobol,
+	// Последовательность Соболя с вложенным равномерным перемешиванием Оуэна для каждого пикселя
+	OwenScrambledSobol,
+	// Общая для всех пикселей последовательность Соболя, сдвинутая по маске синего шума
+	BlueNoise,
+};
+
+/*
+	Интерфейс "Генератор выборок" для методов Монте-Карло (сглаживание, трассировка путей).
+	Выборка пикселя - точка многомерного единичного куба, измерения которой запрашиваются по очереди
+	(например, смещение внутри пикселя, затем направление каждого отскока пути).
+	Значения измерений определяются только координатами пикселя, номером выборки и порядком запросов,
+	поэтому изображение не зависит от количества потоков и распределения между ними пикселей.
+	Экземпляр хранит состояние текущей выборки, поэтому каждый поток использует собственный экземпляр
+*/
+class ISampler
+{
+public:
+	virtual ~ISampler() = default;
+
+	// Начинает выборку с номером sampleIndex пикселя (x, y) с первого измерения
+	virtual void StartPixelSample(unsigned x, unsigned y, unsigned sampleIndex) = 0;
+
+	// Очередное измерение выборки - число из [0; 1)
+	virtual double Get1D() = 0;
+
+	// Два очередных измерения выборки - точка квадрата [0; 1) x [0; 1)
+	virtual CVector2d Get2D() = 0;
+};
+
+using ISamplerPtr = std::unique_ptr<ISampler>;
+
+// Создает генератор выборок заданного типа
+ISamplerPtr CreateSampler(SamplerType type);
@@ -0,0 +1,19 @@
+﻿#include "IndependentSampler.h"
+
+void IndependentSampler::StartPixelSample(unsigned x, unsigned y, unsigned sampleIndex)
+{
+	// Точкой последовательности служат координаты пикселя и номер выборки
+	m_random = PointRandom(CVector3d(x, y, sampleIndex), PointRandomStream::PathTracing);
+}
+
+double IndependentSampler::Get1D()
+{
+	return m_random.NextDouble();
+}
+
+CVector2d IndependentSampler::Get2D()
+{
+	const double u = m_random.NextDouble();
+	const double v = m_random.NextDouble();
+	return CVector2d(u, v);
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include "ISampler.h"
+#include "../Matrix/Matrix4.h"
+#include "../PointRandom/PointRandom.h"
+
+/*
+	Генератор независимых псевдослучайных выборок (см. PointRandom) - базовый вариант для сравнения
+	со скоростью сходимости квазислучайных последовательностей
+*/
+class IndependentSampler : public ISampler
+{
+public:
+	virtual void StartPixelSample(unsigned x, unsigned y, unsigned sampleIndex);
+	virtual double Get1D();
+	virtual CVector2d Get2D();
+
+private:
+	PointRandom m_random{ CVector3d(), PointRandomStream::PathTracing };
+};
@@ -0,0 +1,107 @@
+﻿#include "SobolSampler.h"
+
+namespace
+{
+std::uint32_t ReverseBits(std::uint32_t x) noexcept
+{
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+	x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+	return (x >> 16) | (x << 16);
+}
+} // namespace
+
+SobolSampler::SobolSampler(Scrambling scrambling)
+	: m_scrambling(scrambling)
+{
+}
+
+void SobolSampler::StartPixelSample(unsigned x, unsigned y, unsigned sampleIndex)
+{
+	m_pixelSeed = Hash(x, y);
+	m_sampleIndex = sampleIndex;
+	m_pair = 0;
+}
+
+double SobolSampler::Get1D()
+{
+	std::uint32_t u, v;
+	NextPair(u, v);
+	return ToUnitInterval(u);
+}
+
+CVector2d SobolSampler::Get2D()
+{
+	std::uint32_t u, v;
+	NextPair(u, v);
+	return CVector2d(ToUnitInterval(u), ToUnitInterval(v));
+}
+
+void SobolSampler::NextPair(std::uint32_t& u, std::uint32_t& v)
+{
+	const std::uint32_t seed = Hash(m_pixelSeed, m_pair++);
+
+	// Номера выборок переставляются для каждой пары по-своему, иначе все пары измерений совпадали бы
+	const std::uint32_t index = ScrambleOwen(m_sampleIndex, seed);
+	u = GetSobolValue(index, 0);
+	v = GetSobolValue(index, 1);
+
+	const std::uint32_t seedU = Hash(seed, 0);
+	const std::uint32_t seedV = Hash(seed, 1);
+	if (m_scrambling == Scrambling::Owen)
+	{
+		u = ScrambleOwen(u, seedU);
+		v = ScrambleOwen(v, seedV);
+	}
+	else
+	{
+		u ^= seedU;
+		v ^= seedV;
+	}
+}
+
+std::uint32_t SobolSampler::GetSobolValue(std::uint32_t index, unsigned dimension) noexcept
+{
+	if (dimension == 0)
+	{
+		// Первое измерение - последовательность ван дер Корпута
+		return ReverseBits(index);
+	}
+
+	// Направляющие числа второго измерения (примитивный многочлен x + 1): v[i] = v[i - 1] ^ (v[i - 1] >> 1)
+	std::uint32_t result = 0;
+	for (std::uint32_t direction = 0x80000000u; index != 0; index >>= 1, direction ^= direction >> 1)
+	{
+		if (index & 1)
+		{
+			result ^= direction;
+		}
+	}
+	return result;
+}
+
+std::uint32_t SobolSampler::ScrambleOwen(std::uint32_t value, std::uint32_t seed) noexcept
+{
+	// Хеш Лэйна-Карраса перемешивает младшие разряды в зависимости от старших, поэтому применяется к обращенной дроби
+	std::uint32_t x = ReverseBits(value);
+	x += seed;
+	x ^= x * 0x6C50B47Cu;
+	x ^= x * 0xB82F1E52u;
+	x ^= x * 0xC7AFE638u;
+	x ^= x * 0x8D22F6E6u;
+	return ReverseBits(x);
+}
+
+std::uint32_t SobolSampler::Hash(std::uint32_t a, std::uint32_t b) noexcept
+{
+	std::uint64_t z = (std::uint64_t(a) << 32 | b) + 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return std::uint32_t((z ^ (z >> 31)) >> 32);
+}
+
+double SobolSampler::ToUnitInterval(std::uint32_t value) noexcept
+{
+	return value * (1.0 / 4294967296.0);
+}
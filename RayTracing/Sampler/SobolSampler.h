@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <cstdint>
+#include "ISampler.h"
+
+/*
+	Генератор выборок на основе двумерной последовательности Соболя, которая является (0,2)-последовательностью:
+	первые 2^k выборок каждой пары измерений равномерно покрывают квадрат, поэтому при одинаковом
+	количестве выборок ошибка убывает быстрее, чем при независимых случайных числах.
+	Каждая пара измерений использует собственную перестановку номеров выборок и собственное перемешивание
+	разрядов значений, зависящие от пикселя и номера пары ("дополненная" последовательность). Это устраняет
+	корреляцию между парами измерений и между пикселями, сохраняя равномерность каждой пары
+*/
+class SobolSampler : public ISampler
+{
+public:
+	enum class Scrambling
+	{
+		// Случайный сдвиг разрядов (XOR с хешем): быстро, но сохраняет структуру последовательности
+		RandomDigit,
+		// Вложенное равномерное перемешивание Оуэна: каждый разряд переставляется в зависимости от старших
+		Owen,
+	};
+
+	explicit SobolSampler(Scrambling scrambling);
+
+	virtual void StartPixelSample(unsigned x, unsigned y, unsigned sampleIndex);
+	virtual double Get1D();
+	virtual CVector2d Get2D();
+
+	// Измерение dimension (0 или 1) точки index последовательности Соболя (в виде 32-разрядной дроби)
+	static std::uint32_t GetSobolValue(std::uint32_t index, unsigned dimension) noexcept;
+
+	/*
+		Вложенное равномерное перемешивание Оуэна разрядов 32-разрядной дроби (хеш Лэйна-Карраса).
+		Перестановка номеров точек таким перемешиванием сохраняет каждый блок из 2^k первых точек
+	*/
+	static std::uint32_t ScrambleOwen(std::uint32_t value, std::uint32_t seed) noexcept;
+
+	// Хеш пары чисел для получения начальных значений перемешивания
+	static std::uint32_t Hash(std::uint32_t a, std::uint32_t b) noexcept;
+
+	// Перевод 32-разрядной дроби в число из [0; 1)
+	static double ToUnitInterval(std::uint32_t value) noexcept;
+
+private:
+	// Очередная пара измерений текущей выборки в виде 32-разрядных дробей
+	void NextPair(std::uint32_t& u, std::uint32_t& v);
+
+	Scrambling m_scrambling;
+	std::uint32_t m_pixelSeed = 0;
+	std::uint32_t m_sampleIndex = 0;
+	// Номер следующей пары измерений
+	std::uint32_t m_pair = 0;
+};
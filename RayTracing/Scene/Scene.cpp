@@ -1,10 +1,16 @@
-﻿#include "Scene.h"
+﻿#include <algorithm>
+#include <cmath>
+#include <functional>
+#include "Scene.h"
 #include "../GeometryObject/IGeometryObject.h"
 #include "../Intersection/Intersection.h"
+#include "../PointRandom/PointRandom.h"
 #include "../Ray/Ray.h"
+#include "../RenderContext/RenderContext.h"
 #include "../SceneObject/SceneObject.h"
 #include "../Shader/IShader.h"
 #include "../Shader/ShadeContext.h"
+#include "../Vector/VectorMath.h"
 
 CScene::CScene(void)
 {
@@ -17,6 +23,12 @@ CScene::CScene(void)
 void CScene::SetBackdropColor(CVector4f const& backdropColor)
 {
 	m_backdropColor = backdropColor;
+	m_irradianceCache.Clear();
+}
+
+CVector4f const& CScene::GetBackdropColor() const
+{
+	return m_backdropColor;
 }
 
 /*
@@ -25,6 +37,7 @@ void CScene::SetBackdropColor(CVector4f const& backdropColor)
 void CScene::AddLightSource(ILightSourcePtr pLightSource)
 {
 	m_lightSources.push_back(pLightSource);
+	InvalidateLights();
 }
 
 /*
@@ -47,18 +60,95 @@ ILightSource const& CScene::GetLight(size_t index) const
 ILightSource& CScene::GetLight(size_t index)
 {
 	assert(index < m_lightSources.size());
+	InvalidateLights();
 	return *m_lightSources[index];
 }
 
+CVector4f const& CScene::GetAmbientIntensity() const
+{
+	GetLightBvh();
+	return m_ambientIntensity;
+}
+
+CVector4f CScene::GetAmbientLight(CVector3d const& point, CVector3d const& normal, CVector3d const& rayDirection,
+	float ambientOcclusion) const
+{
+	if (!m_irradianceCache.GetSettings().enabled)
+	{
+		return ambientOcclusion * GetAmbientIntensity();
+	}
+
+	CVector3d facingNormal = Normalize(normal);
+	if (Dot(rayDirection, facingNormal) > 0)
+	{
+		facingNormal = -facingNormal;
+	}
+	return m_irradianceCache.GetIrradiance(*this, point, facingNormal);
+}
+
+void CScene::SetIrradianceCaching(IrradianceCaching const& caching)
+{
+	m_irradianceCache.SetSettings(caching);
+	m_fullFrameChanged = true;
+}
+
+IrradianceCaching const& CScene::GetIrradianceCaching() const
+{
+	return m_irradianceCache.GetSettings();
+}
+
+IrradianceCacheStatistics CScene::GetIrradianceCacheStatistics() const
+{
+	return m_irradianceCache.GetStatistics();
+}
+
+void CScene::SetLightSampling(LightSampling const& sampling)
+{
+	m_lightSampling = sampling;
+	m_fullFrameChanged = true;
+}
+
+LightSampling const& CScene::GetLightSampling() const
+{
+	return m_lightSampling;
+}
+
+LightBvh const& CScene::GetLightBvh() const
+{
+	if (!m_lightsValid.load(std::memory_order_acquire))
+	{
+		std::lock_guard lock(m_lightsMutex);
+		if (!m_lightsValid.load(std::memory_order_relaxed))
+		{
+			m_lightBvh.Build(m_lightSources);
+			m_ambientIntensity = CVector4f();
+			for (ILightSourcePtr const& pLight : m_lightSources)
+			{
+				m_ambientIntensity += pLight->GetAmbientIntensity();
+			}
+			m_lightsValid.store(true, std::memory_order_release);
+		}
+	}
+	return m_lightBvh;
+}
+
+void CScene::InvalidateLights()
+{
+	m_lightsValid.store(false, std::memory_order_relaxed);
+	// Непрямая освещенность зависит от источников света
+	m_irradianceCache.Clear();
+}
+
 /*
 	Добавляем в сцену объект
 */
 void CScene::AddObject(CSceneObjectPtr pSceneObject)
 {
 	m_objects.push_back(pSceneObject);
+	m_irradianceCache.Clear();
 }
 
-CVector4f CScene::Shade(CRay const& ray) const
+CVector4f CScene::Shade(CRay const& ray, RayPath const& path) const
 {
 	CIntersection bestIntersection;
 	CSceneObject const* pSceneObject = NULL;
@@ -81,7 +171,9 @@ CVector4f CScene::Shade(CRay const& ray) const
 				hit.GetHitPoint(),
 				hit.GetHitPointInObjectSpace(),
 				hit.GetNormal(),
-				ray.GetDirection());
+				ray.GetDirection(),
+				path,
+				hit.GetAmbientOcclusion());
 
 			// Шейдер, связанный с объектом, выполнит вычисление цвета
 			return shader.Shade(shadeContext);
@@ -93,6 +185,233 @@ CVector4f CScene::Shade(CRay const& ray) const
 	return m_backdropColor;
 }
 
+CVector4f CScene::TraceSecondaryRay(CRay const& ray, RayPath const& parentPath, CVector4f const& weight, double random) const
+{
+	RayPath path;
+	path.depth = parentPath.depth + 1;
+	path.throughput = parentPath.throughput * Max(Max(weight.x, weight.y), weight.z);
+	if (!(path.throughput > 0))
+	{
+		return CVector4f();
+	}
+
+	if (path.depth > m_secondaryRayLimits.maxDepth)
+	{
+		m_depthTerminations.fetch_add(1, std::memory_order_relaxed);
+		return CVector4f();
+	}
+
+	// Русская рулетка для путей с малым вкладом в цвет пикселя
+	float survivalScale = 1;
+	if (path.throughput < m_secondaryRayLimits.rouletteThroughput)
+	{
+		const double survivalProbability = path.throughput / m_secondaryRayLimits.rouletteThroughput;
+		if (random >= survivalProbability)
+		{
+			m_rouletteTerminations.fetch_add(1, std::memory_order_relaxed);
+			return CVector4f();
+		}
+		path.throughput = m_secondaryRayLimits.rouletteThroughput;
+		survivalScale = static_cast<float>(1 / survivalProbability);
+	}
+
+	m_tracedSecondaryRays[path.depth - 1].fetch_add(1, std::memory_order_relaxed);
+	return survivalScale * weight * Shade(ray, path);
+}
+
+void CScene::SetSecondaryRayLimits(SecondaryRayLimits const& limits)
+{
+	m_secondaryRayLimits = limits;
+	m_secondaryRayLimits.maxDepth = Min(limits.maxDepth, MAX_SECONDARY_RAY_DEPTH);
+	m_fullFrameChanged = true;
+}
+
+SecondaryRayLimits const& CScene::GetSecondaryRayLimits() const
+{
+	return m_secondaryRayLimits;
+}
+
+SecondaryRayStatistics CScene::GetSecondaryRayStatistics() const
+{
+	SecondaryRayStatistics statistics;
+	for (unsigned depth = 0; depth < m_secondaryRayLimits.maxDepth; ++depth)
+	{
+		statistics.tracedRays.push_back(m_tracedSecondaryRays[depth].load(std::memory_order_relaxed));
+	}
+	statistics.depthTerminations = m_depthTerminations.load(std::memory_order_relaxed);
+	statistics.rouletteTerminations = m_rouletteTerminations.load(std::memory_order_relaxed);
+	return statistics;
+}
+
+SoftShadowStatistics CScene::GetSoftShadowStatistics() const
+{
+	SoftShadowStatistics statistics;
+	statistics.estimates = m_softShadowEstimates.load(std::memory_order_relaxed);
+	statistics.penumbraEstimates = m_penumbraEstimates.load(std::memory_order_relaxed);
+	statistics.shadowRays = m_softShadowRays.load(std::memory_order_relaxed);
+	return statistics;
+}
+
+void CScene::ResetRayStatistics()
+{
+	for (std::atomic<std::uint64_t>& counter : m_tracedSecondaryRays)
+	{
+		counter.store(0, std::memory_order_relaxed);
+	}
+	m_depthTerminations.store(0, std::memory_order_relaxed);
+	m_rouletteTerminations.store(0, std::memory_order_relaxed);
+	m_softShadowEstimates.store(0, std::memory_order_relaxed);
+	m_penumbraEstimates.store(0, std::memory_order_relaxed);
+	m_softShadowRays.store(0, std::memory_order_relaxed);
+	m_irradianceCache.ResetStatistics();
+}
+
+bool CScene::IsOccluded(CVector3d const& point, CVector3d const& direction) const
+{
+	/*
+		Луч начинается на небольшом расстоянии от точки, чтобы из-за погрешности вычисления точки
+		столкновения не столкнуться с поверхностью, на которой она лежит
+	*/
+	const double length = direction.GetLength();
+	const double offset = GetRayOffset(point);
+	const CVector3d rayDirection = direction / length;
+	CRay checkShadowRay(point + offset * rayDirection, rayDirection);
+	CIntersection bestIntersection;
+	CSceneObject const* pSceneObject = NULL;
+
+	if (!GetFirstHit(checkShadowRay, bestIntersection, &pSceneObject))
+	{
+		return false;
+	}
+
+	// Тень отбрасывают только объекты, находящиеся между точкой и концом отрезка
+	const double hitTime = bestIntersection.GetHit(0).GetHitTime();
+	return (hitTime > 0) && (hitTime < length - offset);
+}
+
+double CScene::GetLightVisibility(CVector3d const& point, ILightSource const& light) const
+{
+	if (!light.IsAreaLight())
+	{
+		return IsOccluded(point, light.GetDirectionFromPoint(point)) ? 0.0 : 1.0;
+	}
+
+	// Выборки равномерно распределены внутри ячеек сетки grid x grid (стратифицированная выборка)
+	PointRandom random(point, PointRandomStream::SoftShadows);
+	unsigned visibleSamples = 0;
+	unsigned samples = 0;
+	auto sampleGrid = [&](unsigned grid) {
+		for (unsigned i = 0; i < grid; ++i)
+		{
+			for (unsigned j = 0; j < grid; ++j)
+			{
+				const double u = (i + random.NextDouble()) / grid;
+				const double v = (j + random.NextDouble()) / grid;
+				if (!IsOccluded(point, light.GetShadowSamplePoint(point, u, v) - point))
+				{
+					++visibleSamples;
+				}
+				++samples;
+			}
+		}
+	};
+
+	sampleGrid(Max(m_softShadowSampling.initialGrid, 1u));
+	const bool isPenumbra = (visibleSamples != 0 && visibleSamples != samples);
+	if (isPenumbra)
+	{
+		/*
+			Первые выборки не отбрасываются: каждая из выборок - несмещенная оценка видимости,
+			поэтому несмещенным остается и их среднее
+		*/
+		sampleGrid(m_softShadowSampling.refinedGrid);
+	}
+
+	m_softShadowEstimates.fetch_add(1, std::memory_order_relaxed);
+	m_penumbraEstimates.fetch_add(isPenumbra ? 1 : 0, std::memory_order_relaxed);
+	m_softShadowRays.fetch_add(samples, std::memory_order_relaxed);
+	return double(visibleSamples) / samples;
+}
+
+void CScene::SetSoftShadowSampling(SoftShadowSampling const& sampling)
+{
+	m_softShadowSampling = sampling;
+	m_fullFrameChanged = true;
+}
+
+SoftShadowSampling const& CScene::GetSoftShadowSampling() const
+{
+	return m_softShadowSampling;
+}
+
+void CScene::SetSamplerType(SamplerType type)
+{
+	m_samplerType = type;
+	m_fullFrameChanged = true;
+}
+
+SamplerType CScene::GetSamplerType() const
+{
+	return m_samplerType;
+}
+
+void CScene::Shade(CRay const* rays, size_t count, CVector4f* colors) const
+{
+	// Закрашиваемые точки и шейдеры, которыми они закрашиваются, вместе с индексами лучей
+	struct ShadeRequest
+	{
+		IShader const* pShader;
+		size_t rayIndex;
+		SurfacePoint point;
+	};
+	std::vector<ShadeRequest> requests;
+	requests.reserve(count);
+
+	CIntersection bestIntersection;
+	for (size_t i = 0; i < count; ++i)
+	{
+		CRay const& ray = rays[i];
+		CSceneObject const* pSceneObject = NULL;
+		if (GetFirstHit(ray, bestIntersection, &pSceneObject) && pSceneObject->HasShader())
+		{
+			CHitInfo const& hit = bestIntersection.GetHit(0);
+			requests.push_back({ &pSceneObject->GetShader(), i,
+				{ hit.GetHitPoint(), hit.GetHitPointInObjectSpace(), hit.GetNormal(), ray.GetDirection(), hit.GetAmbientOcclusion() } });
+		}
+		else
+		{
+			colors[i] = m_backdropColor;
+		}
+	}
+
+	// Упорядочиваем точки по шейдерам, сохраняя порядок лучей внутри каждой группы
+	std::stable_sort(requests.begin(), requests.end(), [](ShadeRequest const& a, ShadeRequest const& b) {
+		return std::less<IShader const*>()(a.pShader, b.pShader);
+	});
+
+	std::vector<SurfacePoint> points;
+	std::vector<CVector4f> shadedColors;
+	for (size_t first = 0; first < requests.size();)
+	{
+		IShader const& shader = *requests[first].pShader;
+		size_t last = first;
+		points.clear();
+		while (last < requests.size() && requests[last].pShader == &shader)
+		{
+			points.push_back(requests[last++].point);
+		}
+
+		shadedColors.resize(points.size());
+		shader.ShadeBatch(*this, points.data(), points.size(), shadedColors.data());
+
+		for (size_t i = first; i < last; ++i)
+		{
+			colors[requests[i].rayIndex] = shadedColors[i - first];
+		}
+		first = last;
+	}
+}
+
 bool CScene::GetFirstHit(CRay const& ray, CIntersection& bestIntersection, CSceneObject const** ppIntersectionObject) const
 {
 	// Очищаем информацию о точках столкновения
@@ -135,3 +454,92 @@ bool CScene::GetFirstHit(CRay const& ray, CIntersection& bestIntersection, CScen
 	// Возвращаем true, если было найдено хоть одно столкновение
 	return bestIntersection.GetHitsCount() > 0;
 }
+
+void CScene::SetObjectTransform(IGeometryObject& object, CMatrix4d const& transform)
+{
+	m_changedBounds.push_back(object.GetBounds());
+	object.SetTransform(transform);
+	m_changedBounds.push_back(object.GetBounds());
+	m_irradianceCache.Clear();
+
+	// Непрямая освещенность из кэша меняется во всем кадре, а новые записи зависят от порядка обработки точек,
+	// поэтому частичная перерисовка оставила бы старое освещение и швы на границах перерисованных областей
+	if (m_irradianceCache.GetSettings().enabled)
+	{
+		m_fullFrameChanged = true;
+	}
+}
+
+void CScene::SetLightTransform(size_t index, CMatrix4d const& transform)
+{
+	GetLight(index).SetTransform(transform);
+	m_fullFrameChanged = true;
+}
+
+bool CScene::HasChanges() const
+{
+	return m_fullFrameChanged || !m_changedBounds.empty();
+}
+
+bool CScene::GetChangedScreenArea(CRenderContext const& context, std::vector<CScreenRect>& rects) const
+{
+	rects.clear();
+
+	if (m_fullFrameChanged)
+	{
+		return false;
+	}
+
+	// Измененный объект может отражаться в зеркальных поверхностях или быть виден сквозь прозрачные в любой части кадра
+	const bool hasSecondaryRays = std::any_of(m_objects.begin(), m_objects.end(), [](CSceneObjectPtr const& pObject) {
+		return pObject->HasShader() && pObject->GetShader().HasSecondaryRays();
+	});
+	if (!m_changedBounds.empty() && hasSecondaryRays)
+	{
+		return false;
+	}
+
+	for (CBoundingBox const& bounds : m_changedBounds)
+	{
+		// Область, занимаемая самим объектом
+		CScreenRect rect;
+		if (!context.ProjectBounds(bounds, rect))
+		{
+			return false;
+		}
+		if (!rect.IsEmpty())
+		{
+			rects.push_back(rect);
+		}
+
+		// Область, на которую объект может отбрасывать тень от каждого из источников света
+		/*
+			Тень объекта может упасть только на точки внутри сферы влияния источника: отрезок от такой точки
+			до источника целиком лежит в сфере, поэтому источники, сфера которых не пересекает объект, пропускаются
+		*/
+		bool bounded = true;
+		ForEachLightAffecting(bounds, [&](ILightSource const& light) {
+			// Полутень протяженного источника отбрасывается всей его светящейся поверхностью
+			if (bounded && !context.ProjectShadowVolume(bounds, light.GetEmitterBounds(), rect))
+			{
+				bounded = false;
+			}
+			if (bounded && !rect.IsEmpty())
+			{
+				rects.push_back(rect);
+			}
+		});
+		if (!bounded)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CScene::ResetChanges()
+{
+	m_changedBounds.clear();
+	m_fullFrameChanged = false;
+}
@@ -1,11 +1,81 @@
 ﻿#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <vector>
+#include "../BoundingBox/BoundingBox.h"
+#include "../IrradianceCache/IrradianceCache.h"
+#include "../LightBvh/LightBvh.h"
 #include "../LightSource/ILightSource.h"
+#include "../Sampler/ISampler.h"
+#include "../ScreenRect/ScreenRect.h"
 #include "../SceneObject/SceneObject_fwd.h"
+#include "../Shader/ShadeContext.h"
 #include "../Vector/Vector4.h"
 
+/*
+	Параметры стохастического выбора источников света (см. PhongShader).
+	В сценах с тысячами источников каждый учитываемый источник стоит теневого луча, поэтому вместо перебора
+	всех источников для точки выбирается shadowRays источников с вероятностью, пропорциональной их вкладу
+	без учета теней, и к каждому выпускается один теневой луч
+*/
+struct LightSampling
+{
+	// Количество теневых лучей (выбираемых источников) на закрашиваемую точку. 0 - перебор всех источников
+	unsigned shadowRays = 0;
+	// Количество кандидатов, из которых выбирается каждый источник (при меньшем числе источников - все источники)
+	unsigned candidates = 32;
+};
+
+/*
+	Ограничения рекурсивной трассировки отраженных и преломленных лучей (см. CScene::TraceSecondaryRay)
+*/
+struct SecondaryRayLimits
+{
+	// Максимальное количество отражений/преломлений на пути луча (не более CScene::MAX_SECONDARY_RAY_DEPTH)
+	unsigned maxDepth = 5;
+	/*
+		Путь, доля которого в цвете пикселя меньше порога, продолжается с вероятностью throughput / rouletteThroughput
+		("русская рулетка"). Цвет продолженного пути делится на эту вероятность, поэтому оценка остается несмещенной
+	*/
+	double rouletteThroughput = 0.05;
+};
+
+// Количество отраженных и преломленных лучей, оттрассированных после вызова CScene::ResetRayStatistics
+struct SecondaryRayStatistics
+{
+	// Количество лучей на каждой глубине (элемент 0 - лучи, порожденные точками первичных лучей)
+	std::vector<std::uint64_t> tracedRays;
+	// Количество путей, прерванных из-за ограничения глубины и русской рулеткой
+	std::uint64_t depthTerminations = 0;
+	std::uint64_t rouletteTerminations = 0;
+};
+
+/*
+	Параметры адаптивной выборки мягких теней от протяженных источников света (см. CScene::GetLightVisibility)
+*/
+struct SoftShadowSampling
+{
+	// Количество теневых лучей на сторону сетки стратифицированных выборок при первой оценке видимости источника
+	unsigned initialGrid = 2;
+	// Количество лучей на сторону сетки, добавляемых в точках полутени
+	unsigned refinedGrid = 6;
+};
+
+// Теневые лучи к протяженным источникам света, выпущенные после вызова CScene::ResetRayStatistics
+struct SoftShadowStatistics
+{
+	// Количество оценок видимости протяженных источников и количество из них, потребовавших уточнения (полутень)
+	std::uint64_t estimates = 0;
+	std::uint64_t penumbraEstimates = 0;
+	std::uint64_t shadowRays = 0;
+};
+
 class CRay;
 class CIntersection;
+class CRenderContext;
+class IGeometryObject;
 
 /************************************************************************/
 /* Класс "Сцена" - хранит объекты, предоставляет методы для нахождения  */
@@ -14,10 +84,14 @@ class CIntersection;
 class CScene
 {
 public:
+	// Наибольшая глубина рекурсивной трассировки, которую можно задать в SecondaryRayLimits
+	static constexpr unsigned MAX_SECONDARY_RAY_DEPTH = 16;
+
 	CScene(void);
 
 	// Задать цвет заднего фона сцены
 	void SetBackdropColor(CVector4f const& backdropColor);
+	CVector4f const& GetBackdropColor() const;
 
 	/*
 	Добавляем объект в сцену
@@ -36,21 +110,143 @@ public:
 	size_t GetLightsCount() const;
 
 	/*
-		Доступ к источнику света с указанным индексом
+		Доступ к источнику света с указанным индексом.
+		Неконстантный доступ делает недействительной иерархию источников света: она будет перестроена
+		при следующем обращении к ней, поэтому источник можно изменять до начала визуализации
 	*/
 	ILightSource const& GetLight(size_t index) const;
 	ILightSource& GetLight(size_t index);
 
 	/*
-	Возвращает цвет луча, столкнувшегося с объектами сцены
+		Вызывает callback(ILightSource const&) для источников света, которые могут осветить точки
+		параллелепипеда bounds (см. LightBvh::ForEachLight). Источники, сфера влияния которых не пересекает
+		параллелепипед, пропускаются
+	*/
+	template <class Callback>
+	void ForEachLightAffecting(CBoundingBox const& bounds, Callback&& callback) const
+	{
+		GetLightBvh().ForEachLight(bounds, [&](size_t index) {
+			callback(static_cast<ILightSource const&>(*m_lightSources[index]));
+		});
+	}
+
+	template <class Callback>
+	void ForEachLightAffecting(CVector3d const& point, Callback&& callback) const
+	{
+		ForEachLightAffecting(CBoundingBox(point, point), callback);
+	}
+
+	/*
+		Суммарная интенсивность фонового света всех источников сцены.
+		Фоновый свет не ослабевает с расстоянием, поэтому учитывается и для источников,
+		сфера влияния которых не содержит закрашиваемую точку
+	*/
+	CVector4f const& GetAmbientIntensity() const;
+
+	/*
+		Фоновый свет, падающий на точку поверхности с нормалью normal (нормаль разворачивается навстречу лучу
+		rayDirection). При включенном кэше непрямой освещенности - средняя яркость света, рассеянного окружающими
+		поверхностями и пришедшего от фона (см. IrradianceCache), иначе - GetAmbientIntensity(), ослабленная
+		заранее вычисленным затенением точки ambientOcclusion (кэш учитывает затенение сам)
+	*/
+	CVector4f GetAmbientLight(CVector3d const& point, CVector3d const& normal, CVector3d const& rayDirection,
+		float ambientOcclusion = 1) const;
+
+	/*
+		Параметры кэша непрямой освещенности. Записи кэша сохраняются между кадрами и удаляются
+		при изменении параметров, объектов, источников света или цвета фона
+	*/
+	void SetIrradianceCaching(IrradianceCaching const& caching);
+	IrradianceCaching const& GetIrradianceCaching() const;
+	IrradianceCacheStatistics GetIrradianceCacheStatistics() const;
+
+	// Параметры стохастического выбора источников света
+	void SetLightSampling(LightSampling const& sampling);
+	LightSampling const& GetLightSampling() const;
+
+	/*
+	Возвращает цвет луча, столкнувшегося с объектами сцены. path - путь, по которому луч пришел от наблюдателя
+	*/
+	CVector4f Shade(CRay const& ray, RayPath const& path = RayPath()) const;
+
+	/*
+		Трассирует отраженный или преломленный луч, порожденный точкой, путь к которой задан parentPath.
+		weight - доля цвета луча в цвете точки, random - случайное число из [0; 1) для русской рулетки.
+		Возвращает цвет луча, умноженный на weight и деленный на вероятность продолжения пути,
+		либо нулевой цвет, если путь прерван (см. SecondaryRayLimits)
 	*/
-	CVector4f Shade(CRay const& ray) const;
+	CVector4f TraceSecondaryRay(CRay const& ray, RayPath const& parentPath, CVector4f const& weight, double random) const;
+
+	// Ограничения рекурсивной трассировки
+	void SetSecondaryRayLimits(SecondaryRayLimits const& limits);
+	SecondaryRayLimits const& GetSecondaryRayLimits() const;
+
+	/*
+		Есть ли объекты сцены на отрезке от точки point до точки point + direction (точка в тени)
+	*/
+	bool IsOccluded(CVector3d const& point, CVector3d const& direction) const;
+
+	/*
+		Доля поверхности источника света, видимая из точки (0 - точка в тени, 1 - освещена полностью).
+		Для точечных источников выпускается один теневой луч. Для протяженных сначала выпускается
+		initialGrid x initialGrid стратифицированных лучей, и только если их результаты расходятся
+		(точка в полутени), добавляется еще refinedGrid x refinedGrid лучей (см. SoftShadowSampling)
+	*/
+	double GetLightVisibility(CVector3d const& point, ILightSource const& light) const;
+
+	// Параметры выборки мягких теней
+	void SetSoftShadowSampling(SoftShadowSampling const& sampling);
+	SoftShadowSampling const& GetSoftShadowSampling() const;
+
+	// Способ генерации выборок пикселей при трассировке путей (см. ISampler)
+	void SetSamplerType(SamplerType type);
+	SamplerType GetSamplerType() const;
+
+	// Статистика вторичных и теневых лучей (например, за время построения кадра)
+	SecondaryRayStatistics GetSecondaryRayStatistics() const;
+	SoftShadowStatistics GetSoftShadowStatistics() const;
+	void ResetRayStatistics();
+
+	/*
+		Вычисляет цвета count лучей (как правило, проходящих через соседние пиксели).
+		Точки столкновения лучей с объектами группируются по шейдерам, и каждый шейдер
+		закрашивает свои точки одним пакетом (см. IShader::ShadeBatch)
+	*/
+	void Shade(CRay const* rays, size_t count, CVector4f* colors) const;
 
 	/*
 		Трассирует луч вглубь сцены и возвращает информацию о первом столкновении луча с объектам сцены
 	*/
 	bool GetFirstHit(CRay const& ray, CIntersection& bestIntersection, CSceneObject const** ppIntersectionObject) const;
 
+	/*
+		Изменяет трансформацию геометрического объекта сцены, запоминая его ограничивающий
+		параллелепипед до и после изменения. При включенном кэше непрямой освещенности
+		изменение затрагивает весь кадр
+	*/
+	void SetObjectTransform(IGeometryObject& object, CMatrix4d const& transform);
+
+	/*
+		Изменяет трансформацию источника света.
+		Освещенность меняется во всех точках сцены, поэтому все изображение помечается как измененное
+	*/
+	void SetLightTransform(size_t index, CMatrix4d const& transform);
+
+	// Были ли изменения в сцене с момента последнего вызова ResetChanges
+	bool HasChanges() const;
+
+	/*
+		Вычисляет области видового порта, изображение в которых могло измениться с момента
+		последнего вызова ResetChanges: проекции старых и новых границ измененных объектов,
+		а также отбрасываемых ими теней.
+		Возвращает false, если измененную область невозможно ограничить и нужно перестроить весь кадр
+		(в том числе если в сцене есть отражающие или прозрачные поверхности, см. IShader::HasSecondaryRays)
+	*/
+	bool GetChangedScreenArea(CRenderContext const& context, std::vector<CScreenRect>& rects) const;
+
+	// Сбрасывает информацию об изменениях
+	void ResetChanges();
+
 private:
 	// Коллекция объектов сцены
 	typedef std::vector<CSceneObjectPtr> SceneObjects;
@@ -61,4 +257,40 @@ private:
 
 	// Цвет заднего фона сцены
 	CVector4f m_backdropColor;
+
+	// Ограничивающие параллелепипеды измененных объектов до и после изменения
+	std::vector<CBoundingBox> m_changedBounds;
+
+	// Изменения затрагивают весь кадр
+	bool m_fullFrameChanged = false;
+
+	LightSampling m_lightSampling;
+	SecondaryRayLimits m_secondaryRayLimits;
+
+	// Счетчики отраженных и преломленных лучей (увеличиваются несколькими потоками одновременно)
+	mutable std::array<std::atomic<std::uint64_t>, MAX_SECONDARY_RAY_DEPTH> m_tracedSecondaryRays{};
+	mutable std::atomic<std::uint64_t> m_depthTerminations{ 0 };
+	mutable std::atomic<std::uint64_t> m_rouletteTerminations{ 0 };
+
+	SoftShadowSampling m_softShadowSampling;
+	mutable std::atomic<std::uint64_t> m_softShadowEstimates{ 0 };
+	mutable std::atomic<std::uint64_t> m_penumbraEstimates{ 0 };
+	mutable std::atomic<std::uint64_t> m_softShadowRays{ 0 };
+
+	SamplerType m_samplerType = SamplerType::OwenScrambledSobol;
+
+	// Записи кэша добавляются при закрашивании точек, в том числе несколькими потоками одновременно
+	mutable IrradianceCache m_irradianceCache;
+
+	/*
+		Иерархия источников света и суммарная интенсивность их фонового света строятся при первом
+		обращении после изменения источников (обращения возможны из нескольких потоков одновременно)
+	*/
+	LightBvh const& GetLightBvh() const;
+	void InvalidateLights();
+
+	mutable LightBvh m_lightBvh;
+	mutable CVector4f m_ambientIntensity;
+	mutable std::atomic_bool m_lightsValid{ false };
+	mutable std::mutex m_lightsMutex;
 };
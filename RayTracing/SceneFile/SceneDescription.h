@@ -0,0 +1,119 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../Matrix/Matrix4.h"
+#include "../Vector/Vector3.h"
+#include "../Vector/Vector4.h"
+
+/*
+	Описание сцены, прочитанное из файла (см. SceneFile): параметры камеры, источники света, материалы,
+	ссылки на файлы полигональных сеток и объекты. Объекты ссылаются на материалы и сетки по индексам,
+	поэтому одинаковые материалы и сетки описываются один раз
+*/
+
+// Параметры камеры. Соотношение сторон определяется размером изображения
+struct SceneCameraDescription
+{
+	CVector3d eye = CVector3d(0, 0, 5);
+	CVector3d target = CVector3d(0, 0, 0);
+	CVector3d up = CVector3d(0, 1, 0);
+	// Угол обзора по вертикали в градусах
+	double fieldOfView = 60;
+	// Расстояния до ближней и дальней плоскостей отсечения
+	double zNear = 0.1;
+	double zFar = 100;
+};
+
+// Форма источника света
+enum class SceneLightShape : std::uint32_t
+{
+	// Точечный источник (COmniLightSource)
+	Point = 0,
+	// Светящаяся сфера (CSphereLightSource)
+	Sphere = 1,
+	// Светящийся прямоугольник (CRectangleLightSource)
+	Rectangle = 2,
+};
+
+// Источник света
+struct SceneLightDescription
+{
+	SceneLightShape shape = SceneLightShape::Point;
+	CVector3d position;
+	CVector4f diffuseIntensity = CVector4f(1, 1, 1, 1);
+	CVector4f specularIntensity = CVector4f(1, 1, 1, 1);
+	CVector4f ambientIntensity;
+	// Коэффициенты ослабления света: постоянный, линейный и квадратичный
+	double constantAttenuation = 1;
+	double linearAttenuation = 0;
+	double quadraticAttenuation = 0;
+	// Порог ослабления, задающий радиус влияния источника (0 - источник освещает всю сцену)
+	double influenceCutoff = 0;
+	// Радиус сферического источника
+	double radius = 1;
+	// Стороны прямоугольного источника
+	CVector3d edgeU = CVector3d(1, 0, 0);
+	CVector3d edgeV = CVector3d(0, 0, 1);
+	CMatrix4d transform;
+};
+
+// Тип материала определяет шейдер, выполняющий расчет цвета объектов
+enum class SceneMaterialType : std::uint32_t
+{
+	// CSimpleMaterial и CSimpleDiffuseShader (используется только диффузный цвет)
+	Simple = 0,
+	// ComplexMaterial и PhongShader
+	Phong = 1,
+};
+
+struct SceneMaterialDescription
+{
+	SceneMaterialType type = SceneMaterialType::Phong;
+	CVector4f diffuseColor;
+	CVector4f specularColor;
+	CVector4f ambientColor;
+	float specularCoefficient = 128;
+	// Отражение, прозрачность и показатель преломления (только для PhongShader)
+	CVector4f reflectionColor;
+	CVector4f transparencyColor;
+	float refractiveIndex = 1;
+};
+
+enum class SceneObjectType : std::uint32_t
+{
+	// parameters - коэффициенты уравнения плоскости ax+by+cz+d=0
+	Plane = 0,
+	// parameters - размер и координаты центра куба
+	Cube = 1,
+	Dodecahedron = 2,
+	Icosahedron = 3,
+	HyperbolicParaboloid = 4,
+	// Полигональная сетка из файла meshFiles[mesh]
+	Mesh = 5,
+	Tetrahedron = 6,
+	Octahedron = 7,
+};
+
+struct SceneObjectDescription
+{
+	SceneObjectType type = SceneObjectType::Cube;
+	// Индекс материала в SceneDescription::materials
+	std::uint32_t material = 0;
+	// Индекс файла сетки в SceneDescription::meshFiles (для объектов типа Mesh)
+	std::uint32_t mesh = 0;
+	// Параметры примитива (зависят от типа объекта)
+	double parameters[4] = { 0, 0, 0, 0 };
+	CMatrix4d transform;
+};
+
+struct SceneDescription
+{
+	CVector4f backdropColor = CVector4f(0, 0, 0, 1);
+	SceneCameraDescription camera;
+	std::vector<SceneLightDescription> lights;
+	std::vector<SceneMaterialDescription> materials;
+	// Пути к файлам полигональных сеток (относительно каталога файла сцены)
+	std::vector<std::string> meshFiles;
+	std::vector<SceneObjectDescription> objects;
+};
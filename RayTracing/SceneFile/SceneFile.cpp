@@ -0,0 +1,794 @@
+﻿#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include "SceneFile.h"
+
+namespace
+{
+// Сигнатура и версия двоичного формата
+constexpr char BINARY_SIGNATURE[4] = { 'R', 'T', 'S', 'B' };
+constexpr std::uint32_t BINARY_VERSION = 4;
+
+// Версии двоичного формата, в которых у источников света появился порог ослабления,
+// у материалов - отражение и прозрачность, а у источников света - форма
+constexpr std::uint32_t BINARY_VERSION_LIGHT_CUTOFF = 2;
+constexpr std::uint32_t BINARY_VERSION_SECONDARY_RAYS = 3;
+constexpr std::uint32_t BINARY_VERSION_AREA_LIGHTS = 4;
+
+// Запись об объекте сцены в двоичном файле
+struct BinaryObjectRecord
+{
+	std::uint32_t type;
+	std::uint32_t material;
+	std::uint32_t mesh;
+	std::uint32_t reserved;
+	double parameters[4];
+	double transform[16];
+};
+static_assert(sizeof(BinaryObjectRecord) == 176, "Binary object record must not contain padding");
+static_assert(std::is_trivially_copyable_v<BinaryObjectRecord>);
+
+// Наименьшие размеры записей двоичного файла (в самой ранней версии формата)
+constexpr size_t MIN_BINARY_LIGHT_SIZE = 6 * sizeof(double) + 3 * 4 * sizeof(float) + 16 * sizeof(double);
+constexpr size_t MIN_BINARY_MATERIAL_SIZE = sizeof(std::uint32_t) + 3 * 4 * sizeof(float) + sizeof(float);
+constexpr size_t MIN_BINARY_MESH_FILE_SIZE = sizeof(std::uint32_t);
+
+// Наибольшее количество записей, если размер оставшейся части потока узнать нельзя
+constexpr std::uint32_t MAX_BINARY_COUNT = 1u << 20;
+
+/*
+	Разбор строки текстового формата на лексемы, разделенные пробельными символами
+*/
+class LineParser
+{
+public:
+	LineParser(std::string_view line, unsigned lineNumber)
+		: m_line(line)
+		, m_lineNumber(lineNumber)
+	{
+	}
+
+	bool TryGetToken(std::string_view& token)
+	{
+		const size_t begin = m_line.find_first_not_of(" \t", m_position);
+		if (begin == std::string_view::npos)
+		{
+			m_position = m_line.size();
+			return false;
+		}
+		const size_t end = std::min(m_line.find_first_of(" \t", begin), m_line.size());
+		token = m_line.substr(begin, end - begin);
+		m_position = end;
+		return true;
+	}
+
+	std::string_view GetToken()
+	{
+		std::string_view token;
+		if (!TryGetToken(token))
+		{
+			Fail("unexpected end of line");
+		}
+		return token;
+	}
+
+	double GetNumber()
+	{
+		const std::string_view token = GetToken();
+		double value = 0;
+		const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+		if (error != std::errc() || end != token.data() + token.size())
+		{
+			Fail("invalid number '" + std::string(token) + "'");
+		}
+		return value;
+	}
+
+	CVector3d GetVector3()
+	{
+		const double x = GetNumber();
+		const double y = GetNumber();
+		const double z = GetNumber();
+		return CVector3d(x, y, z);
+	}
+
+	CVector4f GetColor()
+	{
+		const double r = GetNumber();
+		const double g = GetNumber();
+		const double b = GetNumber();
+		const double a = GetNumber();
+		return CVector4f(float(r), float(g), float(b), float(a));
+	}
+
+	[[noreturn]] void Fail(std::string const& message) const
+	{
+		throw std::runtime_error("Scene file line " + std::to_string(m_lineNumber) + ": " + message);
+	}
+
+private:
+	std::string_view m_line;
+	size_t m_position = 0;
+	unsigned m_lineNumber;
+};
+
+// Применяет к матрице трансформацию, заданную ключевым словом. Возвращает false, если это не трансформация
+bool ParseTransform(LineParser& parser, std::string_view keyword, CMatrix4d& transform)
+{
+	if (keyword == "translate")
+	{
+		const CVector3d offset = parser.GetVector3();
+		transform.Translate(offset.x, offset.y, offset.z);
+	}
+	else if (keyword == "rotate")
+	{
+		const double angle = parser.GetNumber();
+		const CVector3d axis = parser.GetVector3();
+		transform.Rotate(angle, axis.x, axis.y, axis.z);
+	}
+	else if (keyword == "scale")
+	{
+		const CVector3d scale = parser.GetVector3();
+		transform.Scale(scale.x, scale.y, scale.z);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+/*
+	Разбор текстового описания сцены. Материалы и файлы сеток получают индексы в порядке первого упоминания
+*/
+class SceneTextParser
+{
+public:
+	SceneDescription Parse(std::string_view text)
+	{
+		// Пропускаем метку порядка байтов UTF-8, если файл сохранен с ней
+		if (text.substr(0, 3) == "\xEF\xBB\xBF")
+		{
+			text.remove_prefix(3);
+		}
+
+		unsigned lineNumber = 0;
+		size_t lineStart = 0;
+		while (lineStart < text.size())
+		{
+			size_t lineEnd = text.find('\n', lineStart);
+			if (lineEnd == std::string_view::npos)
+			{
+				lineEnd = text.size();
+			}
+			std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+			lineStart = lineEnd + 1;
+			++lineNumber;
+
+			// Отбрасываем комментарий и символ возврата каретки
+			line = line.substr(0, line.find('#'));
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+
+			LineParser parser(line, lineNumber);
+			std::string_view keyword;
+			if (parser.TryGetToken(keyword))
+			{
+				ParseLine(parser, keyword);
+			}
+		}
+		return std::move(m_description);
+	}
+
+private:
+	void ParseLine(LineParser& parser, std::string_view keyword)
+	{
+		if (keyword == "backdrop")
+		{
+			m_description.backdropColor = parser.GetColor();
+		}
+		else if (keyword == "camera")
+		{
+			ParseCamera(parser);
+		}
+		else if (keyword == "light")
+		{
+			ParseLight(parser);
+		}
+		else if (keyword == "material")
+		{
+			ParseMaterial(parser);
+		}
+		else if (keyword == "object")
+		{
+			ParseObject(parser);
+		}
+		else
+		{
+			parser.Fail("unknown keyword '" + std::string(keyword) + "'");
+		}
+	}
+
+	void ParseCamera(LineParser& parser)
+	{
+		SceneCameraDescription& camera = m_description.camera;
+		std::string_view token;
+		while (parser.TryGetToken(token))
+		{
+			if (token == "eye")
+			{
+				camera.eye = parser.GetVector3();
+			}
+			else if (token == "target")
+			{
+				camera.target = parser.GetVector3();
+			}
+			else if (token == "up")
+			{
+				camera.up = parser.GetVector3();
+			}
+			else if (token == "fov")
+			{
+				camera.fieldOfView = parser.GetNumber();
+			}
+			else if (token == "near")
+			{
+				camera.zNear = parser.GetNumber();
+			}
+			else if (token == "far")
+			{
+				camera.zFar = parser.GetNumber();
+			}
+			else
+			{
+				parser.Fail("unknown camera parameter '" + std::string(token) + "'");
+			}
+		}
+	}
+
+	void ParseLight(LineParser& parser)
+	{
+		SceneLightDescription light;
+		std::string_view token;
+		while (parser.TryGetToken(token))
+		{
+			if (token == "position")
+			{
+				light.position = parser.GetVector3();
+			}
+			else if (token == "diffuse")
+			{
+				light.diffuseIntensity = parser.GetColor();
+			}
+			else if (token == "specular")
+			{
+				light.specularIntensity = parser.GetColor();
+			}
+			else if (token == "ambient")
+			{
+				light.ambientIntensity = parser.GetColor();
+			}
+			else if (token == "attenuation")
+			{
+				light.constantAttenuation = parser.GetNumber();
+				light.linearAttenuation = parser.GetNumber();
+				light.quadraticAttenuation = parser.GetNumber();
+			}
+			else if (token == "cutoff")
+			{
+				light.influenceCutoff = parser.GetNumber();
+			}
+			else if (token == "sphere")
+			{
+				light.shape = SceneLightShape::Sphere;
+				light.radius = parser.GetNumber();
+			}
+			else if (token == "rectangle")
+			{
+				light.shape = SceneLightShape::Rectangle;
+				light.edgeU = parser.GetVector3();
+				light.edgeV = parser.GetVector3();
+			}
+			else if (!ParseTransform(parser, token, light.transform))
+			{
+				parser.Fail("unknown light parameter '" + std::string(token) + "'");
+			}
+		}
+		m_description.lights.push_back(light);
+	}
+
+	void ParseMaterial(LineParser& parser)
+	{
+		const std::string name(parser.GetToken());
+		if (m_materialIndices.count(name) != 0)
+		{
+			parser.Fail("material '" + name + "' is already defined");
+		}
+
+		SceneMaterialDescription material;
+		const std::string_view type = parser.GetToken();
+		if (type == "simple")
+		{
+			material.type = SceneMaterialType::Simple;
+		}
+		else if (type == "phong")
+		{
+			material.type = SceneMaterialType::Phong;
+		}
+		else
+		{
+			parser.Fail("unknown material type '" + std::string(type) + "'");
+		}
+
+		std::string_view token;
+		while (parser.TryGetToken(token))
+		{
+			if (token == "diffuse")
+			{
+				material.diffuseColor = parser.GetColor();
+			}
+			else if (token == "specular")
+			{
+				material.specularColor = parser.GetColor();
+			}
+			else if (token == "ambient")
+			{
+				material.ambientColor = parser.GetColor();
+			}
+			else if (token == "shininess")
+			{
+				material.specularCoefficient = float(parser.GetNumber());
+			}
+			else if (token == "reflection")
+			{
+				material.reflectionColor = parser.GetColor();
+			}
+			else if (token == "transparency")
+			{
+				material.transparencyColor = parser.GetColor();
+			}
+			else if (token == "ior")
+			{
+				material.refractiveIndex = float(parser.GetNumber());
+			}
+			else
+			{
+				parser.Fail("unknown material parameter '" + std::string(token) + "'");
+			}
+		}
+
+		m_materialIndices.emplace(name, std::uint32_t(m_description.materials.size()));
+		m_description.materials.push_back(material);
+	}
+
+	void ParseObject(LineParser& parser)
+	{
+		SceneObjectDescription object;
+		const std::string_view type = parser.GetToken();
+		if (type == "plane")
+		{
+			object.type = SceneObjectType::Plane;
+		}
+		else if (type == "cube")
+		{
+			object.type = SceneObjectType::Cube;
+			// Куб единичного размера с центром в начале координат
+			object.parameters[0] = 1;
+		}
+		else if (type == "tetrahedron")
+		{
+			object.type = SceneObjectType::Tetrahedron;
+		}
+		else if (type == "octahedron")
+		{
+			object.type = SceneObjectType::Octahedron;
+		}
+		else if (type == "dodecahedron")
+		{
+			object.type = SceneObjectType::Dodecahedron;
+		}
+		else if (type == "icosahedron")
+		{
+			object.type = SceneObjectType::Icosahedron;
+		}
+		else if (type == "hyperbolic_paraboloid")
+		{
+			object.type = SceneObjectType::HyperbolicParaboloid;
+		}
+		else if (type == "mesh")
+		{
+			object.type = SceneObjectType::Mesh;
+		}
+		else
+		{
+			parser.Fail("unknown object type '" + std::string(type) + "'");
+		}
+
+		bool hasMaterial = false;
+		bool hasMeshFile = false;
+		std::string_view token;
+		while (parser.TryGetToken(token))
+		{
+			if (token == "material")
+			{
+				const auto it = m_materialIndices.find(std::string(parser.GetToken()));
+				if (it == m_materialIndices.end())
+				{
+					parser.Fail("undefined material");
+				}
+				object.material = it->second;
+				hasMaterial = true;
+			}
+			else if (token == "equation" && object.type == SceneObjectType::Plane)
+			{
+				for (double& coefficient : object.parameters)
+				{
+					coefficient = parser.GetNumber();
+				}
+			}
+			else if (token == "size" && object.type == SceneObjectType::Cube)
+			{
+				object.parameters[0] = parser.GetNumber();
+			}
+			else if (token == "center" && object.type == SceneObjectType::Cube)
+			{
+				object.parameters[1] = parser.GetNumber();
+				object.parameters[2] = parser.GetNumber();
+				object.parameters[3] = parser.GetNumber();
+			}
+			else if (token == "file" && object.type == SceneObjectType::Mesh)
+			{
+				object.mesh = GetMeshIndex(std::string(parser.GetToken()));
+				hasMeshFile = true;
+			}
+			else if (!ParseTransform(parser, token, object.transform))
+			{
+				parser.Fail("unknown object parameter '" + std::string(token) + "'");
+			}
+		}
+
+		if (!hasMaterial)
+		{
+			parser.Fail("object has no material");
+		}
+		if (object.type == SceneObjectType::Mesh && !hasMeshFile)
+		{
+			parser.Fail("mesh object has no file");
+		}
+		m_description.objects.push_back(object);
+	}
+
+	// Индекс файла сетки. Объекты, ссылающиеся на один и тот же файл, используют общие данные сетки
+	std::uint32_t GetMeshIndex(std::string const& fileName)
+	{
+		const auto [it, inserted] = m_meshIndices.emplace(fileName, std::uint32_t(m_description.meshFiles.size()));
+		if (inserted)
+		{
+			m_description.meshFiles.push_back(fileName);
+		}
+		return it->second;
+	}
+
+private:
+	SceneDescription m_description;
+	std::unordered_map<std::string, std::uint32_t> m_materialIndices;
+	std::unordered_map<std::string, std::uint32_t> m_meshIndices;
+};
+
+template <typename T>
+void WriteValue(std::ostream& output, T const& value)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	output.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteVector(std::ostream& output, CVector3d const& v)
+{
+	WriteValue(output, v.x);
+	WriteValue(output, v.y);
+	WriteValue(output, v.z);
+}
+
+void WriteColor(std::ostream& output, CVector4f const& color)
+{
+	WriteValue(output, color.x);
+	WriteValue(output, color.y);
+	WriteValue(output, color.z);
+	WriteValue(output, color.w);
+}
+
+void WriteMatrix(std::ostream& output, CMatrix4d const& matrix)
+{
+	output.write(reinterpret_cast<const char*>(matrix.data), sizeof(matrix.data));
+}
+
+void ReadBytes(std::istream& input, void* data, size_t size)
+{
+	if (!input.read(static_cast<char*>(data), std::streamsize(size)))
+	{
+		throw std::runtime_error("Unexpected end of binary scene file");
+	}
+}
+
+template <typename T>
+T ReadValue(std::istream& input)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	T value;
+	ReadBytes(input, &value, sizeof(value));
+	return value;
+}
+
+/*
+	Читает количество записей размером не менее minRecordSize байт. Количество не может быть больше,
+	чем помещается в оставшуюся часть потока: иначе поврежденный файл приводил бы к выделению огромного объема памяти
+*/
+std::uint32_t ReadCount(std::istream& input, size_t minRecordSize)
+{
+	const std::uint32_t count = ReadValue<std::uint32_t>(input);
+
+	const std::istream::pos_type position = input.tellg();
+	std::uint64_t maxCount = MAX_BINARY_COUNT;
+	if (position != std::istream::pos_type(-1) && input.seekg(0, std::ios::end))
+	{
+		const std::uint64_t remaining = std::uint64_t(input.tellg() - position);
+		input.seekg(position);
+		maxCount = remaining / minRecordSize;
+	}
+	input.clear();
+
+	if (count > maxCount)
+	{
+		throw std::runtime_error("Invalid record count in binary scene file");
+	}
+	return count;
+}
+
+CVector3d ReadVector(std::istream& input)
+{
+	const double x = ReadValue<double>(input);
+	const double y = ReadValue<double>(input);
+	const double z = ReadValue<double>(input);
+	return CVector3d(x, y, z);
+}
+
+CVector4f ReadColor(std::istream& input)
+{
+	float rgba[4];
+	ReadBytes(input, rgba, sizeof(rgba));
+	return CVector4f(rgba);
+}
+
+CMatrix4d ReadMatrix(std::istream& input)
+{
+	double data[16];
+	ReadBytes(input, data, sizeof(data));
+	return CMatrix4d(data);
+}
+}
+
+SceneDescription SceneFile::Load(std::string const& fileName)
+{
+	std::ifstream input(fileName, std::ios::binary);
+	if (!input)
+	{
+		throw std::runtime_error("Failed to open scene file " + fileName);
+	}
+
+	char signature[sizeof(BINARY_SIGNATURE)] = {};
+	input.read(signature, sizeof(signature));
+	input.clear();
+	input.seekg(0);
+
+	if (std::memcmp(signature, BINARY_SIGNATURE, sizeof(signature)) == 0)
+	{
+		return ReadBinary(input);
+	}
+
+	// Текстовый файл читается целиком и разбирается без копирования строк
+	std::ostringstream text;
+	text << input.rdbuf();
+	return ParseText(text.str());
+}
+
+SceneDescription SceneFile::ParseText(std::string_view text)
+{
+	return SceneTextParser().Parse(text);
+}
+
+SceneDescription SceneFile::ReadBinary(std::istream& input)
+{
+	char signature[sizeof(BINARY_SIGNATURE)];
+	ReadBytes(input, signature, sizeof(signature));
+	if (std::memcmp(signature, BINARY_SIGNATURE, sizeof(signature)) != 0)
+	{
+		throw std::runtime_error("Unsupported binary scene file");
+	}
+	const std::uint32_t version = ReadValue<std::uint32_t>(input);
+	if (version == 0 || version > BINARY_VERSION)
+	{
+		throw std::runtime_error("Unsupported binary scene file");
+	}
+
+	SceneDescription description;
+	description.backdropColor = ReadColor(input);
+
+	SceneCameraDescription& camera = description.camera;
+	camera.eye = ReadVector(input);
+	camera.target = ReadVector(input);
+	camera.up = ReadVector(input);
+	camera.fieldOfView = ReadValue<double>(input);
+	camera.zNear = ReadValue<double>(input);
+	camera.zFar = ReadValue<double>(input);
+
+	description.lights.resize(ReadCount(input, MIN_BINARY_LIGHT_SIZE));
+	for (SceneLightDescription& light : description.lights)
+	{
+		light.position = ReadVector(input);
+		light.diffuseIntensity = ReadColor(input);
+		light.specularIntensity = ReadColor(input);
+		light.ambientIntensity = ReadColor(input);
+		light.constantAttenuation = ReadValue<double>(input);
+		light.linearAttenuation = ReadValue<double>(input);
+		light.quadraticAttenuation = ReadValue<double>(input);
+		if (version >= BINARY_VERSION_LIGHT_CUTOFF)
+		{
+			light.influenceCutoff = ReadValue<double>(input);
+		}
+		if (version >= BINARY_VERSION_AREA_LIGHTS)
+		{
+			const std::uint32_t shape = ReadValue<std::uint32_t>(input);
+			if (shape > std::uint32_t(SceneLightShape::Rectangle))
+			{
+				throw std::runtime_error("Invalid light shape in binary scene file");
+			}
+			light.shape = SceneLightShape(shape);
+			light.radius = ReadValue<double>(input);
+			light.edgeU = ReadVector(input);
+			light.edgeV = ReadVector(input);
+		}
+		light.transform = ReadMatrix(input);
+	}
+
+	description.materials.resize(ReadCount(input, MIN_BINARY_MATERIAL_SIZE));
+	for (SceneMaterialDescription& material : description.materials)
+	{
+		const std::uint32_t type = ReadValue<std::uint32_t>(input);
+		if (type > std::uint32_t(SceneMaterialType::Phong))
+		{
+			throw std::runtime_error("Invalid material type in binary scene file");
+		}
+		material.type = SceneMaterialType(type);
+		material.diffuseColor = ReadColor(input);
+		material.specularColor = ReadColor(input);
+		material.ambientColor = ReadColor(input);
+		material.specularCoefficient = ReadValue<float>(input);
+		if (version >= BINARY_VERSION_SECONDARY_RAYS)
+		{
+			material.reflectionColor = ReadColor(input);
+			material.transparencyColor = ReadColor(input);
+			material.refractiveIndex = ReadValue<float>(input);
+		}
+	}
+
+	description.meshFiles.resize(ReadCount(input, MIN_BINARY_MESH_FILE_SIZE));
+	for (std::string& meshFile : description.meshFiles)
+	{
+		meshFile.resize(ReadCount(input, 1));
+		ReadBytes(input, meshFile.data(), meshFile.size());
+	}
+
+	// Записи об объектах читаются одним блоком
+	std::vector<BinaryObjectRecord> records(ReadCount(input, sizeof(BinaryObjectRecord)));
+	ReadBytes(input, records.data(), records.size() * sizeof(BinaryObjectRecord));
+
+	description.objects.resize(records.size());
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		BinaryObjectRecord const& record = records[i];
+		if (record.type > std::uint32_t(SceneObjectType::Octahedron)
+			|| record.material >= description.materials.size()
+			|| (record.type == std::uint32_t(SceneObjectType::Mesh) && record.mesh >= description.meshFiles.size()))
+		{
+			throw std::runtime_error("Invalid object record in binary scene file");
+		}
+
+		SceneObjectDescription& object = description.objects[i];
+		object.type = SceneObjectType(record.type);
+		object.material = record.material;
+		object.mesh = record.mesh;
+		std::copy(std::begin(record.parameters), std::end(record.parameters), object.parameters);
+		object.transform = CMatrix4d(record.transform);
+	}
+
+	return description;
+}
+
+void SceneFile::WriteBinary(SceneDescription const& description, std::string const& fileName)
+{
+	std::ofstream output(fileName, std::ios::binary);
+	if (!output)
+	{
+		throw std::runtime_error("Failed to open " + fileName + " for writing");
+	}
+	WriteBinary(description, output);
+	output.flush();
+	if (!output)
+	{
+		throw std::runtime_error("Failed to write " + fileName);
+	}
+}
+
+void SceneFile::WriteBinary(SceneDescription const& description, std::ostream& output)
+{
+	output.write(BINARY_SIGNATURE, sizeof(BINARY_SIGNATURE));
+	WriteValue(output, BINARY_VERSION);
+	WriteColor(output, description.backdropColor);
+
+	SceneCameraDescription const& camera = description.camera;
+	WriteVector(output, camera.eye);
+	WriteVector(output, camera.target);
+	WriteVector(output, camera.up);
+	WriteValue(output, camera.fieldOfView);
+	WriteValue(output, camera.zNear);
+	WriteValue(output, camera.zFar);
+
+	WriteValue(output, std::uint32_t(description.lights.size()));
+	for (SceneLightDescription const& light : description.lights)
+	{
+		WriteVector(output, light.position);
+		WriteColor(output, light.diffuseIntensity);
+		WriteColor(output, light.specularIntensity);
+		WriteColor(output, light.ambientIntensity);
+		WriteValue(output, light.constantAttenuation);
+		WriteValue(output, light.linearAttenuation);
+		WriteValue(output, light.quadraticAttenuation);
+		WriteValue(output, light.influenceCutoff);
+		WriteValue(output, std::uint32_t(light.shape));
+		WriteValue(output, light.radius);
+		WriteVector(output, light.edgeU);
+		WriteVector(output, light.edgeV);
+		WriteMatrix(output, light.transform);
+	}
+
+	WriteValue(output, std::uint32_t(description.materials.size()));
+	for (SceneMaterialDescription const& material : description.materials)
+	{
+		WriteValue(output, std::uint32_t(material.type));
+		WriteColor(output, material.diffuseColor);
+		WriteColor(output, material.specularColor);
+		WriteColor(output, material.ambientColor);
+		WriteValue(output, material.specularCoefficient);
+		WriteColor(output, material.reflectionColor);
+		WriteColor(output, material.transparencyColor);
+		WriteValue(output, material.refractiveIndex);
+	}
+
+	WriteValue(output, std::uint32_t(description.meshFiles.size()));
+	for (std::string const& meshFile : description.meshFiles)
+	{
+		WriteValue(output, std::uint32_t(meshFile.size()));
+		output.write(meshFile.data(), std::streamsize(meshFile.size()));
+	}
+
+	std::vector<BinaryObjectRecord> records(description.objects.size());
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		SceneObjectDescription const& object = description.objects[i];
+		BinaryObjectRecord& record = records[i];
+		record.type = std::uint32_t(object.type);
+		record.material = object.material;
+		record.mesh = object.mesh;
+		record.reserved = 0;
+		std::copy(std::begin(object.parameters), std::end(object.parameters), record.parameters);
+		std::copy(std::begin(object.transform.data), std::end(object.transform.data), record.transform);
+	}
+	WriteValue(output, std::uint32_t(records.size()));
+	output.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size() * sizeof(BinaryObjectRecord)));
+}
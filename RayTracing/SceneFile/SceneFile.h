@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include "SceneDescription.h"
+
+/*
+	Чтение и запись файлов описания сцены.
+
+	Текстовый формат построчный, строка начинается с ключевого слова, за которым следуют именованные параметры.
+	Комментарии начинаются с символа '#':
+
+		backdrop <r g b a>
+		camera eye <x y z> target <x y z> up <x y z> fov <градусы> near <z> far <z>
+		light position <x y z> diffuse <r g b a> specular <r g b a> ambient <r g b a>
+			attenuation <постоянный линейный квадратичный> cutoff <порог ослабления>
+			[sphere <радиус> | rectangle <сторона x y z> <сторона x y z>] [трансформации]
+		material <имя> simple|phong diffuse <r g b a> specular <r g b a> ambient <r g b a> shininess <s>
+			reflection <r g b a> transparency <r g b a> ior <показатель преломления>
+		object plane equation <a b c d> material <имя> [трансформации]
+		object cube size <s> center <x y z> material <имя> [трансформации]
+		object tetrahedron|octahedron|dodecahedron|icosahedron|hyperbolic_paraboloid material <имя> [трансформации]
+		object mesh file <путь к .obj или .rtcm> material <имя> [трансформации]
+
+	Трансформации (translate <x y z>, rotate <угол x y z>, scale <x y z>) применяются в порядке перечисления,
+	как при последовательном вызове соответствующих методов CMatrix4d.
+
+	Двоичный формат содержит те же данные. Объекты в нем хранятся массивом записей фиксированного размера,
+	который читается целиком, поэтому время загрузки сцен с сотнями тысяч объектов не зависит от разбора текста.
+	Формат файла определяется по его первым байтам.
+
+	При ошибке в данных методы выбрасывают исключение std::runtime_error
+*/
+class SceneFile
+{
+public:
+	// Загружает описание сцены из текстового или двоичного файла
+	static SceneDescription Load(std::string const& fileName);
+
+	// Разбирает описание сцены в текстовом формате
+	static SceneDescription ParseText(std::string_view text);
+
+	// Читает описание сцены в двоичном формате
+	static SceneDescription ReadBinary(std::istream& input);
+
+	// Сохраняет описание сцены в двоичном формате
+	static void WriteBinary(SceneDescription const& description, std::string const& fileName);
+	static void WriteBinary(SceneDescription const& description, std::ostream& output);
+};
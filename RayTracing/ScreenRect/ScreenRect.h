@@ -0,0 +1,62 @@
+﻿#pragma once
+#include <algorithm>
+
+/*
+	Прямоугольная область буфера кадра в пикселях.
+	Правая и нижняя границы не входят в область: [left; right) x [top; bottom)
+*/
+class CScreenRect
+{
+public:
+	// Пустая область
+	CScreenRect() noexcept
+		: left(0), top(0), right(0), bottom(0)
+	{
+	}
+
+	CScreenRect(unsigned left0, unsigned top0, unsigned right0, unsigned bottom0) noexcept
+		: left(left0), top(top0), right(right0), bottom(bottom0)
+	{
+	}
+
+	bool IsEmpty() const noexcept
+	{
+		return left >= right || top >= bottom;
+	}
+
+	unsigned GetWidth() const noexcept
+	{
+		return IsEmpty() ? 0 : right - left;
+	}
+
+	unsigned GetHeight() const noexcept
+	{
+		return IsEmpty() ? 0 : bottom - top;
+	}
+
+	// Пересекается ли область с другой областью
+	bool Intersects(CScreenRect const& other) const noexcept
+	{
+		return !IsEmpty() && !other.IsEmpty() &&
+			left < other.right && other.left < right &&
+			top < other.bottom && other.top < bottom;
+	}
+
+	// Наименьшая область, содержащая обе области
+	CScreenRect GetUnion(CScreenRect const& other) const noexcept
+	{
+		if (IsEmpty())
+		{
+			return other;
+		}
+		if (other.IsEmpty())
+		{
+			return *this;
+		}
+		return CScreenRect(
+			std::min(left, other.left), std::min(top, other.top),
+			std::max(right, other.right), std::max(bottom, other.bottom));
+	}
+
+	unsigned left, top, right, bottom;
+};
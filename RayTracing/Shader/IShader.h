@@ -1,7 +1,25 @@
 ﻿#pragma once
-#include "../Vector/Vector_fwd.h"
+#include <cstddef>
+#include "ShadeContext.h"
+#include "../Matrix/Matrix4.h"
+#include "../Vector/Vector4.h"
+#include "../Vector/VectorMath.h"
 
-class CShadeContext;
+/*
+	Рассеяние света поверхностью в закрашиваемой точке (см. IShader::GetScattering).
+	Доли света заданы для каждой цветовой компоненты
+*/
+struct SurfaceScattering
+{
+	// Доля света, рассеиваемого диффузно (альбедо поверхности)
+	CVector4f diffuse;
+	// Доли света, отражаемого зеркально и проходящего сквозь поверхность (с учетом формул Френеля)
+	CVector4f reflection;
+	CVector4f refraction;
+	// Единичная нормаль, направленная навстречу лучу, и направление преломленного луча
+	CVector3d normal;
+	CVector3d refractedDirection;
+};
 
 /*
 Интерфейс "шейдер", выполняющий расчет цвета объекта в заданной точке с использованием
@@ -14,4 +32,40 @@ public:
 
 	// Выполняет вычисление цвета с использованием указанного контекста закрашиваиня
 	virtual CVector4f Shade(CShadeContext const & shadeContext) const = 0;
+
+	/*
+		Возвращает описание рассеяния света поверхностью для трассировки путей (см. PathTracer).
+		По умолчанию поверхность поглощает весь свет, не пришедший от источников
+	*/
+	virtual SurfaceScattering GetScattering(CShadeContext const& shadeContext) const
+	{
+		SurfaceScattering scattering;
+		scattering.normal = Normalize(shadeContext.GetSurfaceNormal());
+		if (Dot(shadeContext.GetRayDirection(), scattering.normal) > 0)
+		{
+			scattering.normal = -scattering.normal;
+		}
+		return scattering;
+	}
+
+	/*
+		Трассирует ли шейдер отраженные или преломленные лучи. Цвет таких поверхностей зависит от объектов
+		в других частях сцены (см. CScene::GetChangedScreenArea)
+	*/
+	virtual bool HasSecondaryRays() const
+	{
+		return false;
+	}
+
+	/*
+		Вычисляет цвета count точек поверхности, закрашиваемых данным шейдером (например, точек соседних пикселей).
+		Шейдеры могут переопределять метод, чтобы обрабатывать несколько точек одновременно
+	*/
+	virtual void ShadeBatch(CScene const& scene, SurfacePoint const* points, size_t count, CVector4f* colors) const
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			colors[i] = Shade(CShadeContext(scene, points[i]));
+		}
+	}
 };
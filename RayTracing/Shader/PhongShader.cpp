@@ -7,8 +7,58 @@
 #include "ShadeContext.h"
 #include "../Ray/Ray.h"
 #include "../Intersection/Intersection.h"
+#include "../Vector/SimdFloat4.h"
+#include "../PointRandom/PointRandom.h"
+#include <cmath>
+#include <vector>
 
-bool CastSecondaryRay(const CVector3d& rayStart, const CScene& scene, const CVector3d lightDirection);
+namespace
+{
+//  ,  
+constexpr size_t BATCH_LANES = 4;
+
+//     ,      pow
+constexpr float MAX_BATCH_SPECULAR_COEFFICIENT = 65536;
+
+//  ,        (. PhongShader::SampleLights)
+struct LightCandidate
+{
+	ILightSource const* pLight = nullptr;
+	CVector3d lightDirection;
+	//         ( )
+	CVector4f color;
+	double targetWeight = 0;
+};
+
+// ,          
+struct Reservoir
+{
+	//       weight / weightSum (random -   [0; 1))
+	void Update(LightCandidate const& candidate, double weight, double random) noexcept
+	{
+		weightSum += weight;
+		if (random * weightSum < weight)
+		{
+			selected = candidate;
+		}
+	}
+
+	LightCandidate selected;
+	double weightSum = 0;
+};
+
+//     (        )
+bool IsBlack(CVector4f const& color) noexcept
+{
+	return !(color.x > 0 || color.y > 0 || color.z > 0);
+}
+
+//   ( Rec. 709),     
+double GetLuminance(CVector4f const& color) noexcept
+{
+	return 0.2126 * color.x + 0.7152 * color.y + 0.0722 * color.z;
+}
+} // namespace
 
 PhongShader::PhongShader(const ComplexMaterial& material)
 	: m_material(material)
@@ -28,71 +78,407 @@ CVector4f PhongShader::Shade(CShadeContext const& shadeContext) const
 	*/
 	CScene const& scene = shadeContext.GetScene();
 
-	//  
+	/*
+		            
+		(     , . CScene::GetAmbientLight).
+		             
+	*/
 	CVector4f shadedColor;
+	if (!shadeContext.GetRayPath().isPathTraced)
+	{
+		shadedColor = scene.GetAmbientLight(shadeContext.GetSurfacePoint(), shadeContext.GetSurfaceNormal(),
+			shadeContext.GetRayDirection(), shadeContext.GetAmbientOcclusion())
+			* m_material.GetAmbientColor();
 
-	const size_t numLights = scene.GetLightsCount();
+		//    
+		if (m_material.HasSecondaryRays())
+		{
+			shadedColor += TraceSecondaryRays(shadeContext);
+		}
+	}
 
-	//       
-	for (size_t i = 0; i < numLights; ++i)
+	//           
+	if (scene.GetLightSampling().shadowRays != 0)
 	{
-		//   
-		ILightSource const& light = scene.GetLight(i);
+		return shadedColor + SampleLights(shadeContext);
+	}
 
-		//         
-		CVector3d lightDirection = light.GetDirectionFromPoint(shadeContext.GetSurfacePoint());
+	//    ,      
+	scene.ForEachLightAffecting(shadeContext.GetSurfacePoint(), [&](ILightSource const& light) {
+		//      
+		CVector3d lightDirection;
+		CVector4f lightColor;
+		if (!GetUnshadowedLight(light, shadeContext, lightDirection, lightColor))
+		{
+			return;
+		}
 
-		//  ,             
-		bool isInShadow = CastSecondaryRay(shadeContext.GetSurfacePoint(), shadeContext.GetScene(), lightDirection);
+		/*
+			 ,             
+			(   -  ,     )
+		*/
+		const double visibility = scene.GetLightVisibility(shadeContext.GetSurfacePoint(), light);
+		if (visibility > 0)
+		{
+			shadedColor += static_cast<float>(visibility) * lightColor;
+		}
+	}); //       
 
-		//          
-		double lightIntensity = light.GetIntensityInDirection(lightDirection);
+	//    
+	return shadedColor;
+}
+
+bool PhongShader::GetUnshadowedLight(
+	ILightSource const& light, CShadeContext const& shadeContext, CVector3d& lightDirection, CVector4f& color) const
+{
+	//         
+	lightDirection = light.GetDirectionFromPoint(shadeContext.GetSurfacePoint());
+
+	//       
+	CVector3d const& n = shadeContext.GetSurfaceNormal();
 
-		//       
-		CVector3d const& n = shadeContext.GetSurfaceNormal();
+	//      -    
+	double nDotL = Dot(n, Normalize(lightDirection));
 
-		//      -    
-		double nDotL = Max(Dot(n, Normalize(lightDirection)), 0.0);
+	// ,   ,   ,      
+	if (nDotL <= 0)
+	{
+		return false;
+	}
 
-		//    
-		CVector4f diffuseColor = static_cast<float>(nDotL * lightIntensity) * light.GetDiffuseIntensity() * m_material.GetDiffuseColor();
+	//          
+	double lightIntensity = light.GetIntensityInDirection(lightDirection);
 
-		//    
-		CVector3d h = Normalize(lightDirection - shadeContext.GetRayDirection());
-		double hDotN = Max(Dot(h, n), 0.0);
-		CVector4f specularColor = static_cast<float>(pow(hDotN, m_material.GetSpecularCoefficient())) * light.GetSpecularIntensity() * m_material.GetSpecularColor();
+	//    
+	CVector4f diffuseColor = static_cast<float>(nDotL * lightIntensity) * light.GetDiffuseIntensity() * m_material.GetDiffuseColor();
 
-		//    
-		CVector4f ambientColor = light.GetAmbientIntensity() * m_material.GetAmbientColor();
+	//    
+	CVector3d h = Normalize(lightDirection - shadeContext.GetRayDirection());
+	double hDotN = Max(Dot(h, n), 0.0);
+	CVector4f specularColor = static_cast<float>(pow(hDotN, m_material.GetSpecularCoefficient())) * light.GetSpecularIntensity() * m_material.GetSpecularColor();
+
+	color = diffuseColor + specularColor;
+	return true;
+}
 
-		//       
-		if (!isInShadow)
+CVector4f PhongShader::SampleLights(CShadeContext const& shadeContext) const
+{
+	CScene const& scene = shadeContext.GetScene();
+	CVector3d const& surfacePoint = shadeContext.GetSurfacePoint();
+	LightSampling const& sampling = scene.GetLightSampling();
+	const size_t sampleCount = sampling.shadowRays;
+
+	// ,      (     ,  )
+	thread_local std::vector<ILightSource const*> lights;
+	thread_local std::vector<LightCandidate> candidates;
+	thread_local std::vector<Reservoir> reservoirs;
+	lights.clear();
+	scene.ForEachLightAffecting(surfacePoint, [&](ILightSource const& light) {
+		lights.push_back(&light);
+	});
+
+	CVector4f shadedColor;
+
+	//    ,   ,     -    
+	if (lights.size() <= sampleCount)
+	{
+		for (ILightSource const* pLight : lights)
 		{
-			shadedColor += diffuseColor;
-			shadedColor += specularColor;
+			CVector3d lightDirection;
+			CVector4f lightColor;
+			if (GetUnshadowedLight(*pLight, shadeContext, lightDirection, lightColor))
+			{
+				shadedColor += static_cast<float>(scene.GetLightVisibility(surfacePoint, *pLight)) * lightColor;
+			}
 		}
-		shadedColor += ambientColor;
+		return shadedColor;
+	}
 
-	} //       
+	/*
+		          ,  .
+		    sampling.candidates,       ( - 
+		),        ( -  , 
+		   1 / lights.size())
+	*/
+	PointRandom random(surfacePoint, PointRandomStream::LightSampling);
+	const bool allCandidates = (lights.size() <= sampling.candidates);
+	const size_t candidateCount = allCandidates ? lights.size() : Max(sampling.candidates, 1u);
+	auto evaluateCandidate = [&](ILightSource const& light, LightCandidate& candidate) {
+		candidate.pLight = &light;
+		return GetUnshadowedLight(light, shadeContext, candidate.lightDirection, candidate.color)
+			&& (candidate.targetWeight = GetLuminance(candidate.color)) > 0;
+	};
 
-	//    
+	reservoirs.assign(sampleCount, Reservoir());
+	if (allCandidates)
+	{
+		candidates.clear();
+		for (ILightSource const* pLight : lights)
+		{
+			LightCandidate candidate;
+			if (evaluateCandidate(*pLight, candidate))
+			{
+				candidates.push_back(candidate);
+			}
+		}
+		for (Reservoir& reservoir : reservoirs)
+		{
+			for (LightCandidate const& candidate : candidates)
+			{
+				reservoir.Update(candidate, candidate.targetWeight, random.NextDouble());
+			}
+		}
+	}
+	else
+	{
+		for (Reservoir& reservoir : reservoirs)
+		{
+			for (size_t i = 0; i < candidateCount; ++i)
+			{
+				LightCandidate candidate;
+				if (evaluateCandidate(*lights[random.NextIndex(lights.size())], candidate))
+				{
+					reservoir.Update(candidate, candidate.targetWeight * double(lights.size()), random.NextDouble());
+				}
+			}
+		}
+	}
+
+	/*
+		   y     W / p(y),  p(y) -   ,
+		 W -    (    -   ).
+		  :        
+	*/
+	const double weightScale = (allCandidates ? 1.0 : 1.0 / double(candidateCount)) / double(sampleCount);
+	for (Reservoir const& reservoir : reservoirs)
+	{
+		LightCandidate const& candidate = reservoir.selected;
+		if (reservoir.weightSum > 0)
+		{
+			const double visibility = scene.GetLightVisibility(surfacePoint, *candidate.pLight);
+			shadedColor += static_cast<float>(visibility * reservoir.weightSum * weightScale / candidate.targetWeight) * candidate.color;
+		}
+	}
 	return shadedColor;
 }
 
-bool CastSecondaryRay(const CVector3d& rayStart, const CScene& scene, const CVector3d lightDirection)
+void PhongShader::ShadeBatch(CScene const& scene, SurfacePoint const* points, size_t count, CVector4f* colors) const
 {
-	CVector3d rayDirection = Normalize(lightDirection);
-	CRay checkShadowRay = CRay(rayStart, rayDirection);
-	CIntersection bestIntersection;
-	CSceneObject const* pSceneObject = NULL;
-	
-	bool wasHit = scene.GetFirstHit(checkShadowRay, bestIntersection, &pSceneObject);
-	bool result = wasHit;
-	if (wasHit)
+	/*
+		       ,    
+		   ,   ( ),    pow
+	*/
+	const float specularCoefficient = m_material.GetSpecularCoefficient();
+	if (!(specularCoefficient >= 0 && specularCoefficient <= MAX_BATCH_SPECULAR_COEFFICIENT)
+		|| scene.GetLightSampling().shadowRays != 0)
 	{
-		auto hitTime = bestIntersection.GetHit(0).GetHitTime();
-		result = ((hitTime > 0) && (hitTime < lightDirection.GetLength()));
+		IShader::ShadeBatch(scene, points, count, colors);
+		return;
+	}
+	const unsigned specularPower = unsigned(specularCoefficient);
+	const float specularFraction = specularCoefficient - float(specularPower);
+
+	//      ,         
+	const bool isAmbientUniform = !scene.GetIrradianceCaching().enabled;
+	const CVector4f uniformAmbientColor = scene.GetAmbientIntensity() * m_material.GetAmbientColor();
+
+	for (size_t first = 0; first < count; first += BATCH_LANES)
+	{
+		const size_t lanes = Min(count - first, BATCH_LANES);
+
+		//      .       
+		float nx[BATCH_LANES], ny[BATCH_LANES], nz[BATCH_LANES];
+		float dx[BATCH_LANES], dy[BATCH_LANES], dz[BATCH_LANES];
+		CBoundingBox bounds;
+		for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+		{
+			SurfacePoint const& point = points[first + Min(lane, lanes - 1)];
+			bounds.Extend(point.point);
+			nx[lane] = float(point.normal.x);
+			ny[lane] = float(point.normal.y);
+			nz[lane] = float(point.normal.z);
+			dx[lane] = float(point.rayDirection.x);
+			dy[lane] = float(point.rayDirection.y);
+			dz[lane] = float(point.rayDirection.z);
+		}
+		const SimdFloat4 normalX = SimdFloat4::Load(nx), normalY = SimdFloat4::Load(ny), normalZ = SimdFloat4::Load(nz);
+		const SimdFloat4 rayX = SimdFloat4::Load(dx), rayY = SimdFloat4::Load(dy), rayZ = SimdFloat4::Load(dz);
+
+		//    
+		float ambient[4][BATCH_LANES];
+		CVector4f ambientColor;
+		for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+		{
+			if (lane < lanes)
+			{
+				SurfacePoint const& point = points[first + lane];
+				ambientColor = isAmbientUniform
+					? point.ambientOcclusion * uniformAmbientColor
+					: scene.GetAmbientLight(point.point, point.normal, point.rayDirection, point.ambientOcclusion)
+						* m_material.GetAmbientColor();
+			}
+			ambient[0][lane] = ambientColor.x;
+			ambient[1][lane] = ambientColor.y;
+			ambient[2][lane] = ambientColor.z;
+			ambient[3][lane] = ambientColor.w;
+		}
+		SimdFloat4 shadedColor[4] = {
+			SimdFloat4::Load(ambient[0]), SimdFloat4::Load(ambient[1]), SimdFloat4::Load(ambient[2]), SimdFloat4::Load(ambient[3])
+		};
+
+		//  ,          
+		scene.ForEachLightAffecting(bounds, [&](ILightSource const& light) {
+			const double influenceRadius = light.GetInfluenceRadius();
+
+			/*
+				   ,     ()     .
+				      ,      ,
+				  ,       
+			*/
+			float lx[BATCH_LANES], ly[BATCH_LANES], lz[BATCH_LANES];
+			float diffuseScale[BATCH_LANES], visibility[BATCH_LANES];
+			bool isLit = false;
+			for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+			{
+				SurfacePoint const& point = points[first + Min(lane, lanes - 1)];
+				const CVector3d lightDirection = light.GetDirectionFromPoint(point.point);
+				const bool isLaneFacing = (lane < lanes)
+					&& Dot(lightDirection, lightDirection) <= influenceRadius * influenceRadius
+					&& Dot(point.normal, lightDirection) > 0;
+				const double laneVisibility = isLaneFacing ? scene.GetLightVisibility(point.point, light) : 0.0;
+				const bool isLaneLit = laneVisibility > 0;
+				lx[lane] = float(lightDirection.x);
+				ly[lane] = float(lightDirection.y);
+				lz[lane] = float(lightDirection.z);
+				visibility[lane] = float(laneVisibility);
+				diffuseScale[lane] = isLaneLit ? float(laneVisibility * light.GetIntensityInDirection(lightDirection)) : 0.0f;
+				isLit = isLit || isLaneLit;
+			}
+			if (!isLit)
+			{
+				return;
+			}
+			const SimdFloat4 lightX = SimdFloat4::Load(lx), lightY = SimdFloat4::Load(ly), lightZ = SimdFloat4::Load(lz);
+			const SimdFloat4 zero(0.0f);
+
+			//     -    
+			const SimdFloat4 lightLength = Sqrt(lightX * lightX + lightY * lightY + lightZ * lightZ);
+			const SimdFloat4 nDotL = Max((normalX * lightX + normalY * lightY + normalZ * lightZ) / lightLength, zero);
+
+			//     ,         
+			const SimdFloat4 hx = lightX - rayX, hy = lightY - rayY, hz = lightZ - rayZ;
+			const SimdFloat4 hLength = Sqrt(hx * hx + hy * hy + hz * hz);
+			const SimdFloat4 hDotN = Max((hx * normalX + hy * normalY + hz * normalZ) / hLength, zero);
+
+			SimdFloat4 specular = PowUnit(hDotN, specularPower);
+			if (specularFraction > 0)
+			{
+				float h[BATCH_LANES], s[BATCH_LANES];
+				hDotN.Store(h);
+				specular.Store(s);
+				for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+				{
+					s[lane] *= std::pow(h[lane], specularFraction);
+				}
+				specular = SimdFloat4::Load(s);
+			}
+
+			const SimdFloat4 diffuseFactor = nDotL * SimdFloat4::Load(diffuseScale);
+			const SimdFloat4 specularFactor = specular * SimdFloat4::Load(visibility);
+			const CVector4f diffuseColor = light.GetDiffuseIntensity() * m_material.GetDiffuseColor();
+			const CVector4f specularColor = light.GetSpecularIntensity() * m_material.GetSpecularColor();
+			for (int component = 0; component < 4; ++component)
+			{
+				shadedColor[component] += diffuseFactor * SimdFloat4(diffuseColor[component])
+					+ specularFactor * SimdFloat4(specularColor[component]);
+			}
+		});
+
+		float r[BATCH_LANES], g[BATCH_LANES], b[BATCH_LANES], a[BATCH_LANES];
+		shadedColor[0].Store(r);
+		shadedColor[1].Store(g);
+		shadedColor[2].Store(b);
+		shadedColor[3].Store(a);
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			colors[first + lane] = CVector4f(r[lane], g[lane], b[lane], a[lane]);
+		}
 	}
 
-	return result;
+	//         
+	if (m_material.HasSecondaryRays())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			colors[i] += TraceSecondaryRays(CShadeContext(scene, points[i]));
+		}
+	}
+}
+
+bool PhongShader::HasSecondaryRays() const
+{
+	return m_material.HasSecondaryRays();
+}
+
+SurfaceScattering PhongShader::GetScattering(CShadeContext const& shadeContext) const
+{
+	CVector3d const& rayDirection = shadeContext.GetRayDirection();
+
+	//    : ,     ,   
+	SurfaceScattering scattering = IShader::GetScattering(shadeContext);
+	CVector3d const& normal = scattering.normal;
+	const bool isLeaving = Dot(rayDirection, shadeContext.GetSurfaceNormal()) > 0;
+
+	scattering.diffuse = m_material.GetDiffuseColor();
+	scattering.reflection = m_material.GetReflectionColor();
+	CVector4f const& transparency = m_material.GetTransparencyColor();
+	if (!IsBlack(transparency))
+	{
+		const double refractiveIndex = m_material.GetRefractiveIndex();
+		if (Refract(rayDirection, normal, isLeaving ? refractiveIndex : 1 / refractiveIndex, scattering.refractedDirection))
+		{
+			//    ( ),       
+			const double r0 = Sqr((refractiveIndex - 1) / (refractiveIndex + 1));
+			const double cosine = isLeaving ? -Dot(scattering.refractedDirection, normal) : -Dot(Normalize(rayDirection), normal);
+			const float fresnel = static_cast<float>(r0 + (1 - r0) * pow(1 - cosine, 5));
+			scattering.reflection += fresnel * transparency;
+			scattering.refraction = (1 - fresnel) * transparency;
+		}
+		else
+		{
+			//   
+			scattering.reflection += transparency;
+		}
+	}
+	return scattering;
+}
+
+CVector4f PhongShader::TraceSecondaryRays(CShadeContext const& shadeContext) const
+{
+	CScene const& scene = shadeContext.GetScene();
+	CVector3d const& surfacePoint = shadeContext.GetSurfacePoint();
+	CVector3d const& rayDirection = shadeContext.GetRayDirection();
+
+	const SurfaceScattering scattering = GetScattering(shadeContext);
+	CVector3d const& normal = scattering.normal;
+
+	/*
+		      ,      
+		-    
+	*/
+	const double offset = GetRayOffset(surfacePoint);
+
+	PointRandom random(surfacePoint, PointRandomStream::SecondaryRays);
+	CVector4f color;
+	if (!IsBlack(scattering.reflection))
+	{
+		const CRay reflectedRay(surfacePoint + offset * normal, Reflect(rayDirection, normal));
+		color += scene.TraceSecondaryRay(reflectedRay, shadeContext.GetRayPath(), scattering.reflection, random.NextDouble());
+	}
+	if (!IsBlack(scattering.refraction))
+	{
+		const CRay refractedRay(surfacePoint - offset * normal, scattering.refractedDirection);
+		color += scene.TraceSecondaryRay(refractedRay, shadeContext.GetRayPath(), scattering.refraction, random.NextDouble());
+	}
+	return color;
 }
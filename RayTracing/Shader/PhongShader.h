@@ -1,6 +1,8 @@
 #pragma once
 #include "IShader.h"
 #include "../Material/ComplexMaterial.h"
+#include "../LightSource/ILightSource_fwd.h"
+#include "../Vector/Vector_fwd.h"
 
 
 class PhongShader : public IShader
@@ -19,6 +21,42 @@ public:
 	*/
 	virtual CVector4f Shade(CShadeContext const& shadeContext) const;
 
+	/*
+		   :     4  (SSE2)
+		  ,    -   pow (. PowUnit)
+	*/
+	void ShadeBatch(CScene const& scene, SurfacePoint const* points, size_t count, CVector4f* colors) const override;
+
+	/*
+		   ,    ,    
+		(          )
+	*/
+	SurfaceScattering GetScattering(CShadeContext const& shadeContext) const override;
+
+	//       
+	bool HasSecondaryRays() const override;
+
 private:
+	/*
+		         (   )  
+		 .  false,            
+	*/
+	bool GetUnshadowedLight(ILightSource const& light, CShadeContext const& shadeContext,
+		CVector3d& lightDirection, CVector4f& color) const;
+
+	/*
+		    (. LightSampling):       
+		    (resampled importance sampling)    ,
+		    .   ,    ,  
+		 ,    .      
+	*/
+	CVector4f SampleLights(CShadeContext const& shadeContext) const;
+
+	/*
+		,         (   ).
+		    CScene::TraceSecondaryRay   SecondaryRayLimits
+	*/
+	CVector4f TraceSecondaryRays(CShadeContext const& shadeContext) const;
+
 	ComplexMaterial m_material;
 };
@@ -1,9 +1,39 @@
 ﻿#pragma once
-#include "../Vector/Vector_fwd.h"
+#include "../Vector/Vector3.h"
 
 class CRay;
 class CScene;
 
+/*
+	Точка поверхности, цвет которой вычисляется шейдером при пакетном закрашивании (см. IShader::ShadeBatch)
+*/
+struct SurfacePoint
+{
+	CVector3d point; // Координаты точки в мировой системе координат
+	CVector3d pointInObjectSpace; // Координаты точки в системе координат объекта
+	CVector3d normal; // Нормаль в мировой системе координат
+	CVector3d rayDirection; // Направление луча, попавшего в точку
+	float ambientOcclusion = 1; // Заранее вычисленное фоновое затенение точки (см. CHitInfo::GetAmbientOcclusion)
+};
+
+/*
+	Путь луча от наблюдателя до закрашиваемой точки при рекурсивной трассировке отраженных и преломленных лучей
+	(см. CScene::TraceSecondaryRay)
+*/
+struct RayPath
+{
+	// Количество отражений/преломлений (0 - первичный луч)
+	unsigned depth = 0;
+	// Доля цвета точки в цвете пикселя (яркость произведения коэффициентов отражения/пропускания вдоль пути)
+	double throughput = 1;
+	/*
+		Путь строится трассировщиком путей (см. PathTracer) или лучом кэша освещенности (см. IrradianceCache):
+		непрямое освещение, отражения и преломления вычисляются ими самими, поэтому шейдер возвращает
+		только освещенность точки источниками света
+	*/
+	bool isPathTraced = false;
+};
+
 /*
 	Контекст закрашивания, используемый шейдером для вычисления цвета поверхности
 	Хранит информацию о координатах обрабатываемой точки, нормали и направлении луча, а также ссылку на сцену
@@ -20,16 +50,27 @@ public:
 		CVector3d const& sufracePoint,
 		CVector3d const& sufracePointInObjectSpace,
 		CVector3d const& surfaceNormal,	// нормаль в мировой системе координат
-		CVector3d const& rayDirection	// направление трассируемого луча в мировой системе координат
+		CVector3d const& rayDirection,	// направление трассируемого луча в мировой системе координат
+		RayPath const& rayPath = RayPath(),	// путь луча (для первичных лучей - пустой)
+		float ambientOcclusion = 1	// заранее вычисленное фоновое затенение точки
 		) noexcept
 		: m_sufracePoint(sufracePoint)
 		, m_surfacePointInObjectSpace(sufracePointInObjectSpace)
 		, m_surfaceNormal(surfaceNormal)
 		, m_rayDirection(rayDirection)
+		, m_rayPath(rayPath)
+		, m_ambientOcclusion(ambientOcclusion)
 		, m_scene(scene)
 	{
 	}
 
+	// Инициализирует контекст закрашивания точки, заданной для пакетного закрашивания (точки первичных лучей)
+	CShadeContext(CScene const& scene, SurfacePoint const& surfacePoint) noexcept
+		: CShadeContext(scene, surfacePoint.point, surfacePoint.pointInObjectSpace, surfacePoint.normal, surfacePoint.rayDirection,
+			RayPath(), surfacePoint.ambientOcclusion)
+	{
+	}
+
 	/*
 		Возвращает координаты точки в мировой системе координат.
 	*/
@@ -62,6 +103,22 @@ public:
 		return m_rayDirection;
 	}
 
+	/*
+		Возвращает путь луча, попавшего в данную точку
+	*/
+	RayPath const& GetRayPath() const noexcept
+	{
+		return m_rayPath;
+	}
+
+	/*
+		Возвращает заранее вычисленное фоновое затенение точки (1 - точка не затенена)
+	*/
+	float GetAmbientOcclusion() const noexcept
+	{
+		return m_ambientOcclusion;
+	}
+
 	/*
 		Возвращает ссылку на сцену
 	*/
@@ -75,5 +132,7 @@ private:
 	CVector3d const& m_surfacePointInObjectSpace;
 	CVector3d const& m_surfaceNormal;
 	CVector3d const& m_rayDirection;
+	RayPath m_rayPath;
+	float m_ambientOcclusion;
 	CScene const& m_scene;
 };
@@ -3,8 +3,15 @@
 #include "../Scene/Scene.h"
 #include "../Vector/Vector4.h"
 #include "../Vector/VectorMath.h"
+#include "../Vector/SimdFloat4.h"
 #include "ShadeContext.h"
 
+namespace
+{
+// Количество точек, обрабатываемых одновременно
+constexpr size_t BATCH_LANES = 4;
+} // namespace
+
 CSimpleDiffuseShader::CSimpleDiffuseShader(CSimpleMaterial const& material)
 	: m_material(material)
 {
@@ -29,14 +36,8 @@ CVector4f CSimpleDiffuseShader::Shade(CShadeContext const& shadeContext) const
 	// Результирующий цвет
 	CVector4f shadedColor;
 
-	const size_t numLights = scene.GetLightsCount();
-
-	// Пробегаемся по всем источникам света в сцене
-	for (size_t i = 0; i < numLights; ++i)
-	{
-		// Получаем источник света
-		ILightSource const& light = scene.GetLight(i);
-
+	// Пробегаемся по источникам света, сфера влияния которых содержит обрабатываемую точку
+	scene.ForEachLightAffecting(shadeContext.GetSurfacePoint(), [&](ILightSource const& light) {
 		// Вычисляем вектор направления на источник света из текущей точки
 		CVector3d lightDirection = light.GetDirectionFromPoint(shadeContext.GetSurfacePoint());
 
@@ -55,8 +56,78 @@ CVector4f CSimpleDiffuseShader::Shade(CShadeContext const& shadeContext) const
 
 		// К результирующему цвету прибавляется вычисленный диффузный цвет
 		shadedColor += diffuseColor;
-	}	// Проделываем данные действия для других источников света
+	});	// Проделываем данные действия для других источников света
 
 	// Возвращаем результирующий цвет точки
 	return shadedColor;
-}
\ No newline at end of file
+}
+
+SurfaceScattering CSimpleDiffuseShader::GetScattering(CShadeContext const& shadeContext) const
+{
+	SurfaceScattering scattering = IShader::GetScattering(shadeContext);
+	scattering.diffuse = m_material.GetDiffuseColor();
+	return scattering;
+}
+
+void CSimpleDiffuseShader::ShadeBatch(CScene const& scene, SurfacePoint const* points, size_t count, CVector4f* colors) const
+{
+	for (size_t first = 0; first < count; first += BATCH_LANES)
+	{
+		const size_t lanes = Min(count - first, BATCH_LANES);
+
+		// Нормали точек пакета. Недостающие точки последнего пакета заменяются последней точкой
+		float nx[BATCH_LANES], ny[BATCH_LANES], nz[BATCH_LANES];
+		CBoundingBox bounds;
+		for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+		{
+			bounds.Extend(points[first + Min(lane, lanes - 1)].point);
+			CVector3d const& normal = points[first + Min(lane, lanes - 1)].normal;
+			nx[lane] = float(normal.x);
+			ny[lane] = float(normal.y);
+			nz[lane] = float(normal.z);
+		}
+		const SimdFloat4 normalX = SimdFloat4::Load(nx), normalY = SimdFloat4::Load(ny), normalZ = SimdFloat4::Load(nz);
+
+		// Компоненты цвета точек пакета
+		SimdFloat4 shadedColor[4];
+
+		// Перебираются источники, сфера влияния которых содержит хотя бы одну из точек пакета
+		scene.ForEachLightAffecting(bounds, [&](ILightSource const& light) {
+			const double influenceRadius = light.GetInfluenceRadius();
+
+			// Направления на источник света и его интенсивность вычисляются для каждой точки отдельно (вне сферы влияния - 0)
+			float lx[BATCH_LANES], ly[BATCH_LANES], lz[BATCH_LANES], intensity[BATCH_LANES];
+			for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+			{
+				const CVector3d lightDirection = light.GetDirectionFromPoint(points[first + Min(lane, lanes - 1)].point);
+				lx[lane] = float(lightDirection.x);
+				ly[lane] = float(lightDirection.y);
+				lz[lane] = float(lightDirection.z);
+				intensity[lane] = Dot(lightDirection, lightDirection) <= influenceRadius * influenceRadius
+					? float(light.GetIntensityInDirection(-lightDirection)) : 0.0f;
+			}
+			const SimdFloat4 lightX = SimdFloat4::Load(lx), lightY = SimdFloat4::Load(ly), lightZ = SimdFloat4::Load(lz);
+
+			// Скалярное произведение нормали и орт-вектора направления на источник света
+			const SimdFloat4 lightLength = Sqrt(lightX * lightX + lightY * lightY + lightZ * lightZ);
+			const SimdFloat4 nDotL = Max((normalX * lightX + normalY * lightY + normalZ * lightZ) / lightLength, SimdFloat4(0.0f));
+
+			const SimdFloat4 diffuseFactor = nDotL * SimdFloat4::Load(intensity);
+			const CVector4f diffuseColor = light.GetDiffuseIntensity() * m_material.GetDiffuseColor();
+			for (int component = 0; component < 4; ++component)
+			{
+				shadedColor[component] += diffuseFactor * SimdFloat4(diffuseColor[component]);
+			}
+		});
+
+		float r[BATCH_LANES], g[BATCH_LANES], b[BATCH_LANES], a[BATCH_LANES];
+		shadedColor[0].Store(r);
+		shadedColor[1].Store(g);
+		shadedColor[2].Store(b);
+		shadedColor[3].Store(a);
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			colors[first + lane] = CVector4f(r[lane], g[lane], b[lane], a[lane]);
+		}
+	}
+}
@@ -21,6 +21,12 @@ public:
 	*/
 	virtual CVector4f Shade(CShadeContext const & shadeContext) const;
 
+	// Поверхность рассеивает свет диффузно с альбедо, равным диффузному цвету материала
+	SurfaceScattering GetScattering(CShadeContext const& shadeContext) const override;
+
+	// Пакетное вычисление цвета точек: освещенность вычисляется одновременно для 4 точек (SSE2)
+	void ShadeBatch(CScene const& scene, SurfacePoint const* points, size_t count, CVector4f* colors) const override;
+
 private:
 	CSimpleMaterial m_material;
 };
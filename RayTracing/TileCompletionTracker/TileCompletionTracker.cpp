@@ -0,0 +1,83 @@
+﻿#include "TileCompletionTracker.h"
+#include "../Renderer/Renderer.h"
+
+void TileCompletionTracker::SetFrameSize(unsigned width, unsigned height)
+{
+	// Отмеченные, но еще не отображенные блоки сохраняются: они остаются измененными и в следующем кадре
+	if (width == m_width && height == m_height)
+	{
+		return;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tileCount = Renderer::GetTileCount(width, height);
+	m_wordCount = (size_t(m_tileCount) + 63) / 64;
+	m_completedTiles = std::make_unique<std::atomic<std::uint64_t>[]>(m_wordCount);
+	for (size_t i = 0; i < m_wordCount; ++i)
+	{
+		m_completedTiles[i].store(0, std::memory_order_relaxed);
+	}
+	m_allChanged = true;
+}
+
+void TileCompletionTracker::SetProgressCallback(ProgressCallback callback)
+{
+	m_progressCallback = std::move(callback);
+}
+
+void TileCompletionTracker::MarkTileCompleted(unsigned tileIndex, bool frameCompleted)
+{
+	if (tileIndex < m_tileCount)
+	{
+		// release-семантика гарантирует, что поток, увидевший бит, увидит и пиксели блока
+		m_completedTiles[tileIndex / 64].fetch_or(std::uint64_t(1) << (tileIndex % 64), std::memory_order_release);
+	}
+
+	if (m_progressCallback)
+	{
+		m_progressCallback(frameCompleted);
+	}
+}
+
+bool TileCompletionTracker::TakeChangedRegions(std::vector<CScreenRect>& regions)
+{
+	regions.clear();
+
+	// Биты забираем и в случае полного обновления, чтобы эти блоки не были перенесены на экран повторно
+	std::vector<std::uint64_t> completedTiles(m_wordCount);
+	for (size_t i = 0; i < m_wordCount; ++i)
+	{
+		completedTiles[i] = m_completedTiles[i].exchange(0, std::memory_order_acquire);
+	}
+
+	if (m_allChanged.exchange(false))
+	{
+		if (m_width > 0 && m_height > 0)
+		{
+			regions.emplace_back(0, 0, m_width, m_height);
+		}
+		return !regions.empty();
+	}
+
+	for (unsigned tileIndex = 0; tileIndex < m_tileCount; ++tileIndex)
+	{
+		if ((completedTiles[tileIndex / 64] & (std::uint64_t(1) << (tileIndex % 64))) == 0)
+		{
+			continue;
+		}
+
+		// Блоки нумеруются построчно, поэтому соседний справа блок той же строки можно присоединить к предыдущей области
+		CScreenRect tile = Renderer::GetTileRect(tileIndex, m_width, m_height);
+		if (!regions.empty() && regions.back().right == tile.left && regions.back().top == tile.top)
+		{
+			regions.back().right = tile.right;
+		}
+		else
+		{
+			regions.push_back(tile);
+		}
+	}
+
+	return !regions.empty();
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "../ScreenRect/ScreenRect.h"
+
+/*
+	Отслеживает построенные блоки изображения (см. Renderer::GetTileRect) с помощью битовой карты.
+
+	Потоки, строящие изображение, отмечают завершенные блоки без блокировок, а поток, отображающий
+	буфер кадра, забирает области, изменившиеся с момента предыдущего запроса, и переносит на экран только их.
+	Об отмеченных блоках сообщается через функцию обратного вызова, чтобы отображение не опрашивало
+	визуализатор по таймеру
+*/
+class TileCompletionTracker
+{
+public:
+	/*
+		Функция, вызываемая потоком, построившим блок изображения.
+		frameCompleted - true, если это был последний блок кадра
+	*/
+	using ProgressCallback = std::function<void(bool frameCompleted)>;
+
+	/*
+		Задает размеры буфера кадра. При изменении размеров весь буфер кадра считается измененным.
+		Не должен вызываться одновременно с другими методами
+	*/
+	void SetFrameSize(unsigned width, unsigned height);
+
+	/*
+		Устанавливает функцию обратного вызова. Функция может вызываться из разных потоков одновременно.
+		Устанавливать ее следует, пока изображение не строится
+	*/
+	void SetProgressCallback(ProgressCallback callback);
+
+	// Отмечает построенный блок и сообщает об этом функции обратного вызова
+	void MarkTileCompleted(unsigned tileIndex, bool frameCompleted);
+
+	/*
+		Заменяет содержимое regions областями, изменившимися с момента предыдущего вызова.
+		Соседние блоки одной строки объединяются в одну область.
+		Возвращает false, если изменений нет
+	*/
+	bool TakeChangedRegions(std::vector<CScreenRect>& regions);
+
+private:
+	unsigned m_width = 0;
+	unsigned m_height = 0;
+	unsigned m_tileCount = 0;
+
+	// Битовая карта построенных блоков: бит i слова k соответствует блоку 64 * k + i
+	std::unique_ptr<std::atomic<std::uint64_t>[]> m_completedTiles;
+	size_t m_wordCount = 0;
+
+	// Изменен ли весь буфер кадра
+	std::atomic_bool m_allChanged{ false };
+
+	ProgressCallback m_progressCallback;
+};
@@ -1,8 +1,16 @@
 ﻿#include "TriangleMesh.h"
 #include <algorithm>
+#include <cmath>
 #include "../Vector/VectorMath.h"
 #include "../Intersection/Intersection.h"
 #include "../Ray/Ray.h"
+#include "../RenderContext/RenderContext.h"
+
+namespace
+{
+// Запас, с которым выполняется переход между уровнями детализации (доля требуемого количества треугольников)
+constexpr double LEVEL_OF_DETAIL_HYSTERESIS = 0.25;
+} // namespace
 
 // Конструирует треугольник, вычисляет ряд вспомогательных параметров
 // для ускорения нахождения точки пересечения с лучом
@@ -61,6 +69,21 @@ CTriangle::CTriangle(Vertex const& vertex0, Vertex const& vertex1, Vertex const&
 	m_invEdge20PerpSquare = (edge20PerpSquare > EPSILON) ? (1.0 / edge20PerpSquare) : 0.0;
 }
 
+CTriangle::CTriangle(Vertex const& vertex0, Vertex const& vertex1, Vertex const& vertex2, TriangleSetup const& setup, bool flatShaded)
+	: m_planeEquation(setup.planeEquation)
+	, m_edge01Perp(setup.edge01Perp)
+	, m_edge12Perp(setup.edge12Perp)
+	, m_edge20Perp(setup.edge20Perp)
+	, m_invEdge01PerpSquare(setup.invEdge01PerpSquare)
+	, m_invEdge12PerpSquare(setup.invEdge12PerpSquare)
+	, m_invEdge20PerpSquare(setup.invEdge20PerpSquare)
+	, m_pVertex0(&vertex0)
+	, m_pVertex1(&vertex1)
+	, m_pVertex2(&vertex2)
+	, m_flatShaded(flatShaded)
+{
+}
+
 bool CTriangle::HitTest(CVector3d const& rayStart, CVector3d const& rayDirection, double& hitTime, CVector3d& hitPoint, double& vertex0Weight, double& vertex1Weight, double& vertex2Weight, double const& EPSILON) const
 {
 	//////////////////////////////////////////////////////////////////////////
@@ -144,9 +167,13 @@ bool CTriangle::HitTest(CVector3d const& rayStart, CVector3d const& rayDirection
 /*
 Конструируем данныен полигональной сетки на основе переданной информации о ее вершинах и гранях
 */
-CTriangleMeshData::CTriangleMeshData(std::vector<Vertex> const& vertices, std::vector<Face> const& faces, bool normalize)
+CTriangleMeshData::CTriangleMeshData(std::vector<Vertex> const& vertices, std::vector<Face> const& faces, bool normalize,
+	std::vector<unsigned> originalFaceIndices)
 	: m_vertices(vertices)
+	, m_originalFaceIndices(std::move(originalFaceIndices))
 {
+	assert(m_originalFaceIndices.empty() || m_originalFaceIndices.size() == faces.size());
+
 	size_t const numVertices = m_vertices.size();
 	if (normalize)
 	{
@@ -157,6 +184,73 @@ CTriangleMeshData::CTriangleMeshData(std::vector<Vertex> const& vertices, std::v
 		}
 	}
 
+	InitTriangles(faces, nullptr);
+}
+
+CTriangleMeshData::CTriangleMeshData(std::vector<Vertex> const& vertices, std::vector<Face> const& faces, TriangleSetup const* pTriangleSetups)
+	: m_vertices(vertices)
+{
+	InitTriangles(faces, pTriangleSetups);
+}
+
+CTriangleMeshData::CTriangleMeshData(CTriangleMeshData const& source, CMatrix4d const& transform)
+	: m_vertices(source.m_vertices)
+	, m_originalFaceIndices(source.m_originalFaceIndices)
+	// Затенение гранями самой сетки не меняется при переносе ее в другую систему координат
+	, m_vertexAmbientOcclusion(source.m_vertexAmbientOcclusion)
+{
+	// Нормали преобразуются матрицей нормали (см. CGeometryObjectImpl::SetTransform)
+	const CMatrix4d invTransform = transform.GetInverseMatrix();
+	CMatrix3d normalMatrix;
+	normalMatrix.SetRow(0, invTransform.GetColumn(0));
+	normalMatrix.SetRow(1, invTransform.GetColumn(1));
+	normalMatrix.SetRow(2, invTransform.GetColumn(2));
+
+	for (Vertex& vertex : m_vertices)
+	{
+		vertex.position = (transform * CVector4d(vertex.position, 1)).Project();
+		vertex.normal = normalMatrix * vertex.normal;
+	}
+
+	// Зеркальное отражение меняет порядок обхода вершин граней, а вместе с ним и направление нормалей
+	// плоских граней, поэтому в этом случае порядок обхода восстанавливается
+	const bool mirrored = transform.GetDeterminant() < 0;
+
+	Vertex const* const sourceVertices = source.GetVertices();
+	std::vector<Face> faces;
+	faces.reserve(source.m_triangles.size());
+	for (CTriangle const& triangle : source.m_triangles)
+	{
+		const unsigned i0 = unsigned(&triangle.GetVertex0() - sourceVertices);
+		const unsigned i1 = unsigned(&triangle.GetVertex1() - sourceVertices);
+		const unsigned i2 = unsigned(&triangle.GetVertex2() - sourceVertices);
+		faces.emplace_back(i0, mirrored ? i2 : i1, mirrored ? i1 : i2, triangle.IsFlatShaded());
+	}
+
+	InitTriangles(faces, nullptr);
+
+	if (source.m_pCoarserLevel)
+	{
+		m_pCoarserLevel = std::make_unique<CTriangleMeshData const>(*source.m_pCoarserLevel, transform);
+	}
+}
+
+void CTriangleMeshData::SetVertexAmbientOcclusion(std::vector<float> occlusion)
+{
+	assert(occlusion.empty() || occlusion.size() == m_vertices.size());
+	m_vertexAmbientOcclusion = std::move(occlusion);
+}
+
+void CTriangleMeshData::InitTriangles(std::vector<Face> const& faces, TriangleSetup const* pTriangleSetups)
+{
+	size_t const numVertices = m_vertices.size();
+
+	// Вычисляем ограничивающий параллелепипед сетки
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		m_bounds.Extend(m_vertices[i].position);
+	}
+
 	// Выделяем память под хранение всех треугольных граней
 	m_triangles.reserve(faces.size());
 
@@ -171,21 +265,34 @@ CTriangleMeshData::CTriangleMeshData(std::vector<Vertex> const& vertices, std::v
 		size_t i2 = size_t(face.vertex2);
 		assert(i0 < numVertices && i1 < numVertices && i2 < numVertices);
 
-		CTriangle triangle(m_vertices[i0], m_vertices[i1], m_vertices[i2], face.isFlat);
-		m_triangles.push_back(triangle);
+		if (pTriangleSetups)
+		{
+			m_triangles.push_back(CTriangle(m_vertices[i0], m_vertices[i1], m_vertices[i2], pTriangleSetups[i], face.isFlat));
+		}
+		else
+		{
+			m_triangles.push_back(CTriangle(m_vertices[i0], m_vertices[i1], m_vertices[i2], face.isFlat));
+		}
 	}
 }
 
 CTriangleMesh::CTriangleMesh(CTriangleMeshData const* pMeshData, CMatrix4d const& transform)
 	: CGeometryObjectImpl(transform)
 	, m_pMeshData(pMeshData)
+	, m_identityTransform(transform.IsIdentity())
 {
+	for (CTriangleMeshData const* pLevel = pMeshData; pLevel; pLevel = pLevel->GetCoarserLevel())
+	{
+		m_levels.push_back(pLevel);
+	}
 }
 
 bool CTriangleMesh::Hit(CRay const& ray, CIntersection& intersection) const
 {
-	// Вычисляем обратно преобразованный луч (вместо вполнения прямого преобразования объекта)
-	CRay invRay = Transform(ray, GetInverseTransform());
+	// Вычисляем обратно преобразованный луч (вместо вполнения прямого преобразования объекта).
+	// Вершины сетки с единичной трансформацией заданы в мировой системе координат
+	const bool identityTransform = m_identityTransform;
+	CRay invRay = identityTransform ? ray : Transform(ray, GetInverseTransform());
 	CVector3d const& invRayStart = invRay.GetStart();
 	CVector3d const& invRayDirection = invRay.GetDirection();
 
@@ -199,8 +306,10 @@ bool CTriangleMesh::Hit(CRay const& ray, CIntersection& intersection) const
 	//////////////////////////////////////////////////////////////////////////
 
 	// Получаем информацию о массиве треугольников сетки
-	CTriangle const* const triangles = m_pMeshData->GetTriangles();
-	const size_t numTriangles = m_pMeshData->GetTriangleCount();
+	CTriangleMeshData const& meshData = GetLevelData();
+	CTriangle const* const triangles = meshData.GetTriangles();
+	Vertex const* const vertices = meshData.GetVertices();
+	const size_t numTriangles = meshData.GetTriangleCount();
 
 	// Информация о пересечении луча с гранью сетки
 	struct FaceHit
@@ -312,7 +421,17 @@ bool CTriangleMesh::Hit(CRay const& ray, CIntersection& intersection) const
 		}
 
 		// Нормаль в мировой системе координат
-		CVector3d normal = GetNormalMatrix() * normalInObjectSpace;
+		CVector3d normal = identityTransform ? normalInObjectSpace : GetNormalMatrix() * normalInObjectSpace;
+
+		// Фоновое затенение интерполируется по тем же весовым коэффициентам, что и нормали
+		float ambientOcclusion = 1;
+		if (meshData.HasAmbientOcclusion())
+		{
+			ambientOcclusion = float(
+				faceHit.w0 * meshData.GetVertexAmbientOcclusion(size_t(&triangle.GetVertex0() - vertices))
+				+ faceHit.w1 * meshData.GetVertexAmbientOcclusion(size_t(&triangle.GetVertex1() - vertices))
+				+ faceHit.w2 * meshData.GetVertexAmbientOcclusion(size_t(&triangle.GetVertex2() - vertices)));
+		}
 
 		// Добавляем информацию о точке пересечения в объект intersection
 		intersection.AddHit(
@@ -320,8 +439,62 @@ bool CTriangleMesh::Hit(CRay const& ray, CIntersection& intersection) const
 				faceHit.hitTime, *this,
 				hitPoint,
 				faceHit.hitPointInObjectSpace,
-				normal, normalInObjectSpace));
+				normal, normalInObjectSpace,
+				ambientOcclusion));
 	}
 
 	return true;
+}
+
+CBoundingBox CTriangleMesh::GetBounds() const
+{
+	return GetLevelData().GetBounds().GetTransformed(GetTransform());
+}
+
+void CTriangleMesh::OnUpdateTransform()
+{
+	m_identityTransform = GetTransform().IsIdentity();
+}
+
+bool CTriangleMesh::SelectLevelOfDetail(CRenderContext const& context)
+{
+	if (m_levels.size() < 2)
+	{
+		return false;
+	}
+
+	// Размер проекции определяется по исходной сетке, чтобы он не зависел от выбранного уровня.
+	// Если сетка частично находится позади наблюдателя, используется исходная сетка
+	double width = 0, height = 0;
+	double requiredTriangles = INFINITY;
+	if (context.GetProjectedSize(m_pMeshData->GetBounds().GetTransformed(GetTransform()), width, height))
+	{
+		requiredTriangles = width * height;
+	}
+
+	// Самый грубый уровень, содержащий не меньше заданного количества треугольников
+	auto findLevel = [this](double minTriangleCount) {
+		unsigned level = 0;
+		while (level + 1 < m_levels.size() && double(m_levels[level + 1]->GetTriangleCount()) >= minTriangleCount)
+		{
+			++level;
+		}
+		return level;
+	};
+
+	unsigned level = findLevel(requiredTriangles * (1 + LEVEL_OF_DETAIL_HYSTERESIS));
+	if (level < m_levelOfDetail
+		&& double(m_levels[m_levelOfDetail]->GetTriangleCount()) >= requiredTriangles * (1 - LEVEL_OF_DETAIL_HYSTERESIS))
+	{
+		// Детализация текущего уровня пока достаточна
+		level = m_levelOfDetail;
+	}
+	else if (level < m_levelOfDetail)
+	{
+		level = findLevel(requiredTriangles);
+	}
+
+	const bool changed = (level != m_levelOfDetail);
+	m_levelOfDetail = level;
+	return changed;
 }
\ No newline at end of file
@@ -1,7 +1,11 @@
 ﻿#pragma once
+#include <memory>
 #include <vector>
+#include "../BoundingBox/BoundingBox.h"
 #include "../GeometryObject/GeometryObjectImpl.h"
 
+class CRenderContext;
+
 /*
 	Структура, хранящая информацию о вершине полигональной сетки
 */
@@ -44,6 +48,21 @@ struct Face
 	bool isFlat;
 };
 
+/*
+	Параметры треугольника, вычисляемые по координатам его вершин для ускорения поиска пересечений с лучом.
+	Для сеток, известных на этапе компиляции, вычисляются заранее (см. PolyhedronTables.h)
+*/
+struct TriangleSetup
+{
+	double planeEquation[4]; // Уравнение плоскости
+	double edge01Perp[3]; // Перпендикуляры к ребрам треугольника
+	double edge12Perp[3];
+	double edge20Perp[3];
+	double invEdge01PerpSquare; // Обратные квадраты длин перпендикуляров
+	double invEdge12PerpSquare;
+	double invEdge20PerpSquare;
+};
+
 /*
 	Класс "Треугольник". Хранит подробную информацию о треугольной грани
 */
@@ -53,6 +72,9 @@ public:
 	// Консутруктор
 	CTriangle(Vertex const& vertex0, Vertex const& vertex1, Vertex const& vertex2, bool flatShaded = true);
 
+	// Конструктор треугольника с заранее вычисленными параметрами
+	CTriangle(Vertex const& vertex0, Vertex const& vertex1, Vertex const& vertex2, TriangleSetup const& setup, bool flatShaded = true);
+
 	// Ссылки на вершины треугольника
 	Vertex const& GetVertex0() const { return *m_pVertex0; }
 	Vertex const& GetVertex1() const { return *m_pVertex1; }
@@ -115,9 +137,24 @@ public:
 	CTriangleMeshData(
 		std::vector<Vertex> const& vertices, // Вершины
 		std::vector<Face> const& faces, // Грани
-		bool normalize = false // Выполнить ли нормализацию нормалей вершин?
+		bool normalize = false, // Выполнить ли нормализацию нормалей вершин?
+		std::vector<unsigned> originalFaceIndices = std::vector<unsigned>() // Исходные индексы граней (см. MeshReorder)
 	);
 
+	// Конструирует данные сетки, используя заранее вычисленные параметры треугольников (по одному на грань)
+	CTriangleMeshData(
+		std::vector<Vertex> const& vertices, // Вершины
+		std::vector<Face> const& faces, // Грани
+		TriangleSetup const* pTriangleSetups // Параметры треугольников
+	);
+
+	/*
+		Конструирует копию данных сетки (вместе с уровнями детализации), вершины и нормали которой
+		переведены в другую систему координат матрицей transform. Используется для "заморозки"
+		неподвижных сеток: трансформация объекта переносится в его данные (см. FileScene)
+	*/
+	CTriangleMeshData(CTriangleMeshData const& source, CMatrix4d const& transform);
+
 	// Возвращает количество вершин
 	size_t GetVertexCount() const { return m_vertices.size(); }
 	// Адрес массива вершин
@@ -128,9 +165,52 @@ public:
 	// Адрес массива треугольников
 	CTriangle const* GetTriangles() const { return &m_triangles[0]; }
 
+	// Ограничивающий параллелепипед вершин сетки (в системе координат сетки)
+	CBoundingBox const& GetBounds() const { return m_bounds; }
+
+	// Индекс грани в исходном файле (например, для выбора материала грани), если грани были переупорядочены
+	size_t GetOriginalFaceIndex(size_t triangleIndex) const
+	{
+		return m_originalFaceIndices.empty() ? triangleIndex : m_originalFaceIndices[triangleIndex];
+	}
+
+	/*
+		Следующий, более грубый уровень детализации, полученный упрощением сетки (см. MeshSimplifier).
+		nullptr, если уровень детализации последний
+	*/
+	CTriangleMeshData const* GetCoarserLevel() const { return m_pCoarserLevel.get(); }
+
+	// Задает следующий уровень детализации. Вызывается при построении данных, пока они не используются сетками
+	void SetCoarserLevel(std::unique_ptr<CTriangleMeshData const> pCoarserLevel) { m_pCoarserLevel = std::move(pCoarserLevel); }
+
+	// Вычислено ли фоновое затенение вершин (см. AmbientOcclusionBaker)
+	bool HasAmbientOcclusion() const { return !m_vertexAmbientOcclusion.empty(); }
+
+	// Фоновое затенение вершины (1 - вершина не затенена). Используется, только если HasAmbientOcclusion()
+	float GetVertexAmbientOcclusion(size_t vertexIndex) const { return m_vertexAmbientOcclusion[vertexIndex]; }
+
+	// Задает фоновое затенение вершин (по одному значению на вершину). Вызывается при построении данных
+	void SetVertexAmbientOcclusion(std::vector<float> occlusion);
+
+	// Объем памяти, занимаемой данными сетки (вместе с более грубыми уровнями детализации), в байтах
+	size_t GetMemoryUsage() const
+	{
+		return sizeof(*this) + m_vertices.capacity() * sizeof(Vertex) + m_triangles.capacity() * sizeof(CTriangle)
+			+ m_originalFaceIndices.capacity() * sizeof(unsigned) + m_vertexAmbientOcclusion.capacity() * sizeof(float)
+			+ (m_pCoarserLevel ? m_pCoarserLevel->GetMemoryUsage() : 0);
+	}
+
 private:
+	// Вычисляет ограничивающий параллелепипед и заполняет массив треугольников
+	// (параметры треугольников вычисляются, если pTriangleSetups == nullptr)
+	void InitTriangles(std::vector<Face> const& faces, TriangleSetup const* pTriangleSetups);
+
 	std::vector<Vertex> m_vertices; // Вершины
 	std::vector<CTriangle> m_triangles; // Треугольные грани
+	std::vector<unsigned> m_originalFaceIndices; // Исходные индексы граней (пустой, если грани не переупорядочивались)
+	std::vector<float> m_vertexAmbientOcclusion; // Фоновое затенение вершин (пустой, если не вычислялось)
+	CBoundingBox m_bounds; // Ограничивающий параллелепипед
+	std::unique_ptr<CTriangleMeshData const> m_pCoarserLevel; // Следующий уровень детализации
 };
 
 /*
@@ -144,7 +224,42 @@ public:
 	// Поиск пересечения луча с полигональной сеткой
 	virtual bool Hit(CRay const& ray, CIntersection& intersection) const;
 
+	// Ограничивающий параллелепипед сетки (текущего уровня детализации) в мировой системе координат
+	CBoundingBox GetBounds() const override;
+
+	// Исходные данные сетки (самый подробный уровень детализации)
+	CTriangleMeshData const& GetMeshData() const { return *m_pMeshData; }
+
+	// Количество уровней детализации данных сетки (1, если данные не содержат упрощенных уровней)
+	unsigned GetLevelOfDetailCount() const { return unsigned(m_levels.size()); }
+
+	// Текущий уровень детализации (0 - исходная сетка)
+	unsigned GetLevelOfDetail() const { return m_levelOfDetail; }
+
+	// Данные сетки текущего уровня детализации
+	CTriangleMeshData const& GetLevelData() const { return *m_levels[m_levelOfDetail]; }
+
+	/*
+		Выбирает уровень детализации по размеру проекции сетки при заданных матрицах камеры: самый грубый уровень,
+		содержащий не меньше треугольников, чем пикселей в проекции ограничивающего параллелепипеда сетки.
+		Чтобы при небольших перемещениях камеры на границе между уровнями они не сменялись в каждом кадре,
+		переход к более грубому уровню выполняется с запасом, а текущий уровень сохраняется, пока его
+		детализация не станет заметно ниже требуемой.
+		Не должен вызываться во время построения изображения. Возвращает true, если уровень изменился
+	*/
+	bool SelectLevelOfDetail(CRenderContext const& context);
+
+protected:
+	// Проверяет, является ли новая трансформация единичной
+	void OnUpdateTransform() override;
+
 private:
 	// Адрес данных полигональной сетки
 	CTriangleMeshData const* m_pMeshData;
+	// Трансформация единичная: вершины сетки заданы в мировой системе координат,
+	// и при поиске пересечений луч и нормали не преобразуются
+	bool m_identityTransform = false;
+	// Данные уровней детализации, начиная с исходной сетки
+	std::vector<CTriangleMeshData const*> m_levels;
+	unsigned m_levelOfDetail = 0;
 };
\ No newline at end of file
@@ -0,0 +1,216 @@
+﻿#pragma once
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_FLOAT4_SSE2
+#else
+#include <cmath>
+#endif
+
+/*
+	Четыре числа одинарной точности, обрабатываемые одной SIMD-инструкцией (SSE2).
+	Используется при пакетной обработке данных: каждый элемент ("дорожка") хранит значение для своей точки.
+	На платформах без SSE2 операции выполняются поэлементно
+*/
+class SimdFloat4
+{
+public:
+	SimdFloat4() noexcept
+		: SimdFloat4(0.0f)
+	{
+	}
+
+	// Записывает значение во все элементы
+	explicit SimdFloat4(float value) noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		m_value = _mm_set1_ps(value);
+#else
+		m_value[0] = m_value[1] = m_value[2] = m_value[3] = value;
+#endif
+	}
+
+	// Загружает 4 последовательно расположенных числа (адрес может быть не выровнен)
+	static SimdFloat4 Load(float const* p) noexcept
+	{
+		SimdFloat4 result;
+#ifdef SIMD_FLOAT4_SSE2
+		result.m_value = _mm_loadu_ps(p);
+#else
+		for (int i = 0; i < 4; ++i)
+		{
+			result.m_value[i] = p[i];
+		}
+#endif
+		return result;
+	}
+
+	// Сохраняет элементы в 4 последовательно расположенных числа
+	void Store(float* p) const noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		_mm_storeu_ps(p, m_value);
+#else
+		for (int i = 0; i < 4; ++i)
+		{
+			p[i] = m_value[i];
+		}
+#endif
+	}
+
+	SimdFloat4 operator+(SimdFloat4 const& v) const noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		return SimdFloat4(_mm_add_ps(m_value, v.m_value));
+#else
+		return Apply(v, [](float a, float b) { return a + b; });
+#endif
+	}
+
+	SimdFloat4 operator-(SimdFloat4 const& v) const noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		return SimdFloat4(_mm_sub_ps(m_value, v.m_value));
+#else
+		return Apply(v, [](float a, float b) { return a - b; });
+#endif
+	}
+
+	SimdFloat4 operator*(SimdFloat4 const& v) const noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		return SimdFloat4(_mm_mul_ps(m_value, v.m_value));
+#else
+		return Apply(v, [](float a, float b) { return a * b; });
+#endif
+	}
+
+	SimdFloat4 operator/(SimdFloat4 const& v) const noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		return SimdFloat4(_mm_div_ps(m_value, v.m_value));
+#else
+		return Apply(v, [](float a, float b) { return a / b; });
+#endif
+	}
+
+	SimdFloat4& operator+=(SimdFloat4 const& v) noexcept
+	{
+		return *this = *this + v;
+	}
+
+	SimdFloat4& operator*=(SimdFloat4 const& v) noexcept
+	{
+		return *this = *this * v;
+	}
+
+	friend SimdFloat4 Max(SimdFloat4 const& a, SimdFloat4 const& b) noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		return SimdFloat4(_mm_max_ps(a.m_value, b.m_value));
+#else
+		return a.Apply(b, [](float x, float y) { return x > y ? x : y; });
+#endif
+	}
+
+	friend SimdFloat4 Sqrt(SimdFloat4 const& v) noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		return SimdFloat4(_mm_sqrt_ps(v.m_value));
+#else
+		return v.Apply(v, [](float a, float) { return std::sqrt(a); });
+#endif
+	}
+
+	/*
+		Экспонента элементов (аргументы ограничиваются диапазоном [-87; 88]).
+		Относительная погрешность не превышает 2e-4, чего достаточно для вычисления весов фильтров
+	*/
+	friend SimdFloat4 Exp(SimdFloat4 const& v) noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		// e^v = 2^n * 2^f, где n - целая, а f - дробная часть v * log2(e)
+		const __m128 x = _mm_mul_ps(
+			_mm_max_ps(_mm_min_ps(v.m_value, _mm_set1_ps(88.0f)), _mm_set1_ps(-87.0f)), _mm_set1_ps(1.44269504f));
+		__m128i n = _mm_cvttps_epi32(x);
+		__m128 floorX = _mm_cvtepi32_ps(n);
+		// Отбрасывание дробной части округляет отрицательные числа вверх, а требуется округление вниз
+		const __m128 roundedUp = _mm_cmpgt_ps(floorX, x);
+		n = _mm_add_epi32(n, _mm_castps_si128(roundedUp));
+		floorX = _mm_sub_ps(floorX, _mm_and_ps(roundedUp, _mm_set1_ps(1.0f)));
+		const __m128 f = _mm_sub_ps(x, floorX);
+
+		// 2^f на [0; 1) - многочлен Тейлора 5-й степени
+		__m128 p = _mm_set1_ps(1.3333558e-3f);
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.6181291e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5504109e-2f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4022651e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9314718e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+		// 2^n записывается непосредственно в поле порядка числа
+		const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+		return SimdFloat4(_mm_mul_ps(p, scale));
+#else
+		return v.Apply(v, [](float a, float) { return std::exp(a < -87.0f ? -87.0f : (a > 88.0f ? 88.0f : a)); });
+#endif
+	}
+
+	// Обнуляет элементы, меньшие threshold
+	friend SimdFloat4 ZeroBelow(SimdFloat4 const& v, float threshold) noexcept
+	{
+#ifdef SIMD_FLOAT4_SSE2
+		return SimdFloat4(_mm_and_ps(v.m_value, _mm_cmpge_ps(v.m_value, _mm_set1_ps(threshold))));
+#else
+		return v.Apply(SimdFloat4(threshold), [](float a, float t) { return a >= t ? a : 0.0f; });
+#endif
+	}
+
+private:
+#ifdef SIMD_FLOAT4_SSE2
+	explicit SimdFloat4(__m128 value) noexcept
+		: m_value(value)
+	{
+	}
+
+	__m128 m_value;
+#else
+	template <class Operation>
+	SimdFloat4 Apply(SimdFloat4 const& v, Operation operation) const noexcept
+	{
+		SimdFloat4 result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.m_value[i] = operation(m_value[i], v.m_value[i]);
+		}
+		return result;
+	}
+
+	float m_value[4];
+#endif
+};
+
+/*
+	Возведение элементов из диапазона [0; 1] в целую степень последовательным возведением в квадрат
+	(не более 2*log2(exponent) умножений). Каждое возведение в квадрат удваивает накопленную погрешность,
+	поэтому относительная погрешность растет линейно с показателем и не превышает (exponent - 1) * 2^-24
+	(для exponent = 2048 - около 1.2e-4; измеренное значение - примерно вдвое меньше).
+	Степени, меньшие 1e-18, заменяются нулем, чтобы при больших показателях не возникали
+	денормализованные числа, операции с которыми выполняются очень медленно
+*/
+inline SimdFloat4 PowUnit(SimdFloat4 base, unsigned exponent) noexcept
+{
+	SimdFloat4 result(1.0f);
+	while (exponent != 0)
+	{
+		if (exponent & 1)
+		{
+			result = ZeroBelow(result * base, 1e-18f);
+		}
+		exponent >>= 1;
+		if (exponent != 0)
+		{
+			base = ZeroBelow(base * base, 1e-18f);
+		}
+	}
+	return result;
+}
@@ -8,6 +8,8 @@
 /* Набор вспомогательных функций по работе с векторами и матрицами      */
 /************************************************************************/
 
+inline constexpr double PI = 3.14159265358979323846;
+
 template <class T>
 T Sqr(T const& x) noexcept
 {
@@ -281,4 +283,36 @@ inline CVector3<T> Reflect(CVector3<T> const& incidentVec, CVector3<T> const& no
 	auto normIncidentVec = Normalize(incidentVec);
 	auto normNormal = Normalize(normal);
 	return normIncidentVec - 2.f * Dot(normIncidentVec, normNormal) * normNormal;
-}
\ No newline at end of file
+}
+
+/*
+	Направление преломленного луча по закону Снеллиуса. eta - отношение показателя преломления среды,
+	из которой луч выходит, к показателю преломления среды, в которую он входит. Нормаль должна быть
+	направлена навстречу падающему лучу. Возвращает false при полном внутреннем отражении
+*/
+template <class T>
+inline bool Refract(CVector3<T> const& incidentVec, CVector3<T> const& normal, T eta, CVector3<T>& refractedVec) noexcept
+{
+	auto normIncidentVec = Normalize(incidentVec);
+	auto normNormal = Normalize(normal);
+	const T cosIncidence = -Dot(normIncidentVec, normNormal);
+	const T cosRefractionSquare = 1 - eta * eta * (1 - cosIncidence * cosIncidence);
+	if (cosRefractionSquare < 0)
+	{
+		return false;
+	}
+	refractedVec = eta * normIncidentVec + (eta * cosIncidence - sqrt(cosRefractionSquare)) * normNormal;
+	return true;
+}
+
+/*
+	Смещение начала вторичного луча от точки поверхности, при котором луч не сталкивается с этой же поверхностью
+	из-за погрешности вычисления точки столкновения. Погрешность координат растет с их величиной, поэтому
+	смещение относительное
+*/
+template <class T>
+inline T GetRayOffset(CVector3<T> const& point) noexcept
+{
+	constexpr T RELATIVE_RAY_OFFSET = T(1e-6);
+	return RELATIVE_RAY_OFFSET * (1 + Max(Max(fabs(point.x), fabs(point.y)), fabs(point.z)));
+}
@@ -1,5 +1,11 @@
+#include <cstring>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "Application/Application.h"
+#include "NetworkRenderer/NetworkRenderWorker.h"
+#include "ProcessRenderer/ProcessRenderWorker.h"
 
 /*
 *  - ,        .
@@ -10,9 +16,50 @@
 FILE _iob[] = { *stdin, *stdout, *stderr };
 extern "C" FILE * __cdecl __iob_func(void) { return _iob; }
 
-int main(int /*argc*/, char** /*argv*/)
+/*
+	  :
+		--processes N [threads] -   N -,    
+			     (    )
+		--render-worker <segment> <id> [threads] -    - ( )
+		--render-farm host:port[,host:port...] -     
+		--net-worker <port> [threads] -      
+*/
+int main(int argc, char** argv)
 {
-	Application app;
+	if (argc >= 4 && std::strcmp(argv[1], "--render-worker") == 0)
+	{
+		unsigned threadCount = (argc >= 5) ? unsigned(std::stoul(argv[4])) : 0;
+		ProcessRenderWorker worker(argv[2], unsigned(std::stoul(argv[3])), threadCount);
+		return worker.Run();
+	}
+
+	if (argc >= 3 && std::strcmp(argv[1], "--net-worker") == 0)
+	{
+		unsigned threadCount = (argc >= 4) ? unsigned(std::stoul(argv[3])) : 0;
+		NetworkRenderWorker worker(static_cast<unsigned short>(std::stoul(argv[2])), threadCount);
+		return worker.Run();
+	}
+
+	unsigned workerProcessCount = 0;
+	unsigned threadsPerWorker = 0;
+	if (argc >= 3 && std::strcmp(argv[1], "--processes") == 0)
+	{
+		workerProcessCount = unsigned(std::stoul(argv[2]));
+		threadsPerWorker = (argc >= 4) ? unsigned(std::stoul(argv[3])) : 0;
+	}
+
+	std::vector<std::string> renderFarmWorkers;
+	if (argc >= 3 && std::strcmp(argv[1], "--render-farm") == 0)
+	{
+		std::istringstream addresses(argv[2]);
+		std::string address;
+		while (std::getline(addresses, address, ','))
+		{
+			renderFarmWorkers.push_back(address);
+		}
+	}
+
+	Application app(argv[0], workerProcessCount, threadsPerWorker, renderFarmWorkers);
 	app.MainLoop();
 	return 0;
 }
\ No newline at end of file